@@ -197,6 +197,29 @@ static inline u8 color_match(u8 color, u8 done_color)
 	return (!!(color & IONIC_COMP_COLOR_MASK)) == done_color;
 }
 
+/**
+ * struct ionic_admin_indir_cmd - Compact AdminQ descriptor (queue version 1)
+ * @opcode:     Opcode of the command in the buffer at @addr
+ * @lif_index:  LIF index
+ * @len:        Length of the command in the buffer, in bytes
+ * @addr:       DMA address of the full 64-byte command
+ *
+ * An AdminQ initialized at queue version 1 uses 16-byte ring
+ * descriptors that reference the full command in host memory
+ * instead of carrying it inline, so the descriptor ring is a
+ * quarter the size and the device fetches only @len bytes of
+ * command body per descriptor it consumes.  Completions are
+ * unchanged from version 0.
+ */
+struct ionic_admin_indir_cmd {
+	u8     opcode;
+	u8     rsvd;
+	__le16 lif_index;
+	__le16 len;
+	u8     rsvd2[2];
+	__le64 addr;
+};
+
 /**
  * struct ionic_nop_cmd - NOP command
  * @opcode: opcode
@@ -337,9 +360,12 @@ union ionic_drv_identity {
 /**
  * enum ionic_dev_capability - Device capabilities
  * @IONIC_DEV_CAP_VF_CTRL:     Device supports VF ctrl operations
+ * @IONIC_DEV_CAP_INTR_CREDITS_DMA: Device can poll interrupt credit
+ *                             returns in host memory
  */
 enum ionic_dev_capability {
 	IONIC_DEV_CAP_VF_CTRL        = BIT(0),
+	IONIC_DEV_CAP_INTR_CREDITS_DMA = BIT(1),
 };
 
 /**
@@ -460,6 +486,7 @@ enum ionic_logical_qtype {
  * @IONIC_Q_F_4X_DESC:      Quadruple main descriptor size
  * @IONIC_Q_F_4X_CQ_DESC:   Quadruple cq descriptor size
  * @IONIC_Q_F_4X_SG_DESC:   Quadruple sg descriptor size
+ * @IONIC_QIDENT_F_DBSHADOW: Queue can poll a doorbell shadow in host memory
  */
 enum ionic_q_feature {
 	IONIC_QIDENT_F_CQ		= BIT_ULL(0),
@@ -472,6 +499,7 @@ enum ionic_q_feature {
 	IONIC_Q_F_4X_DESC		= BIT_ULL(7),
 	IONIC_Q_F_4X_CQ_DESC		= BIT_ULL(8),
 	IONIC_Q_F_4X_SG_DESC		= BIT_ULL(9),
+	IONIC_QIDENT_F_DBSHADOW		= BIT_ULL(10),
 };
 
 /**
@@ -748,6 +776,8 @@ union ionic_q_identity {
  * @ring_base:    Queue ring base address
  * @cq_ring_base: Completion queue ring base address
  * @sg_ring_base: Scatter/Gather ring base address
+ * @db_shadow_base: Doorbell shadow address in host memory, valid with
+ *                the DBSHADOW flag (struct ionic_dbell_shadow)
  * @features:     Mask of queue features to enable, if not in the flags above.
  */
 struct ionic_q_init_cmd {
@@ -766,13 +796,15 @@ struct ionic_q_init_cmd {
 #define IONIC_QINIT_F_SG	0x04	/* Enable scatter/gather on the queue */
 #define IONIC_QINIT_F_EQ	0x08	/* Enable event queue */
 #define IONIC_QINIT_F_CMB	0x10	/* Enable cmb-based queue */
+#define IONIC_QINIT_F_DBSHADOW	0x20	/* Poll doorbell shadow in host memory */
 #define IONIC_QINIT_F_DEBUG	0x80	/* Enable queue debugging */
 	u8     cos;
 	u8     ring_size;
 	__le64 ring_base;
 	__le64 cq_ring_base;
 	__le64 sg_ring_base;
-	u8     rsvd2[12];
+	u8     rsvd2[4];
+	__le64 db_shadow_base;
 	__le64 features;
 } __attribute__((packed));
 
@@ -1148,6 +1180,39 @@ struct ionic_rxq_comp {
 #define IONIC_RXQ_COMP_PKT_TYPE_MASK	0x7f
 };
 
+/**
+ * struct ionic_rxq_comp_batch - Batched Ethernet receive completion descriptor
+ * @status:       Status of the command (enum ionic_status_code)
+ * @num_pkts:     Number of packets summarized by this completion, each
+ *                consuming one receive descriptor starting at @comp_index
+ * @comp_index:   Index in the descriptor ring of the first completed
+ *                descriptor
+ * @pkt:          Per-packet records; bits 13:0 are the received packet
+ *                length in bytes excluding FCS, bits 15:14 are reserved
+ *                for per-packet flags
+ * @rsvd:         Word reserved for future per-batch metadata
+ * @csum_flags:   Reserved; batched packets carry no checksum result
+ * @pkt_type_color: IONIC_PKT_TYPE_BATCH and color bit
+ *
+ * Supported on RXQ version 3 and later.  The device may summarize up to
+ * IONIC_RXQ_COMP_BATCH_MAX consecutive same-queue packets in one
+ * completion, and only packets with no offload metadata to report - no
+ * RSS hash, no stripped VLAN tag, no computed checksum, no timestamp.
+ * Packets needing any of those complete individually with the plain
+ * struct ionic_rxq_comp.
+ */
+struct ionic_rxq_comp_batch {
+	u8     status;
+	u8     num_pkts;
+	__le16 comp_index;
+	__le16 pkt[4];
+#define IONIC_RXQ_COMP_BATCH_MAX	4
+#define IONIC_RXQ_COMP_BATCH_LEN_MASK	0x3fff
+	__le16 rsvd;
+	u8     csum_flags;
+	u8     pkt_type_color;
+};
+
 enum ionic_pkt_type {
 	IONIC_PKT_TYPE_NON_IP		= 0x00,
 	IONIC_PKT_TYPE_IPV4		= 0x01,
@@ -1164,6 +1229,8 @@ enum ionic_pkt_type {
 	IONIC_PKT_TYPE_ENCAP_IPV6	= 0x48,
 	IONIC_PKT_TYPE_ENCAP_IPV6_TCP	= 0x58,
 	IONIC_PKT_TYPE_ENCAP_IPV6_UDP	= 0x68,
+	/* marks a struct ionic_rxq_comp_batch, not a real packet type */
+	IONIC_PKT_TYPE_BATCH		= 0x7f,
 };
 
 enum ionic_eth_hw_features {
@@ -1797,6 +1864,7 @@ enum ionic_rss_hash_types {
  * @IONIC_LIF_ATTR_RSS:         LIF RSS attribute
  * @IONIC_LIF_ATTR_STATS_CTRL:  LIF statistics control attribute
  * @IONIC_LIF_ATTR_TXSTAMP:     LIF TX timestamping mode
+ * @IONIC_LIF_ATTR_INTR_CREDITS: LIF interrupt credit return shadow array
  */
 enum ionic_lif_attr {
 	IONIC_LIF_ATTR_STATE        = 0,
@@ -1807,6 +1875,7 @@ enum ionic_lif_attr {
 	IONIC_LIF_ATTR_RSS          = 5,
 	IONIC_LIF_ATTR_STATS_CTRL   = 6,
 	IONIC_LIF_ATTR_TXSTAMP      = 7,
+	IONIC_LIF_ATTR_INTR_CREDITS = 8,
 };
 
 /**
@@ -1825,6 +1894,11 @@ enum ionic_lif_attr {
  *              @addr:      Address for the indirection table shared memory
  * @stats_ctl:  stats control commands (enum ionic_stats_ctl_cmd)
  * @txstamp:    TX Timestamping Mode (enum ionic_txstamp_mode)
+ * @intr_credits: Interrupt credit return shadow array
+ *              @len:       Number of entries in the array
+ *              @addr:      Address of the shadow array in host memory,
+ *                          indexed by interrupt index
+ *                          (struct ionic_intr_credits_shadow)
  */
 struct ionic_lif_setattr_cmd {
 	u8     opcode;
@@ -1844,6 +1918,11 @@ struct ionic_lif_setattr_cmd {
 		} rss;
 		u8      stats_ctl;
 		__le16  txstamp_mode;
+		struct {
+			__le32 len;
+			u8     rsvd3[4];
+			__le64 addr;
+		} intr_credits;
 		u8      rsvd[60];
 	} __attribute__((packed));
 };
@@ -94,6 +94,32 @@ static inline void ionic_intr_mask_assert(struct ionic_intr __iomem *intr_ctrl,
 	iowrite32(mask, &intr_ctrl[intr_idx].mask_assert);
 }
 
+/** struct ionic_intr_credits_shadow - host memory credit return.
+ * @returned:	cumulative count of credits returned.
+ *
+ * Companion DMA mode for the credits register: a device granting
+ * IONIC_DEV_CAP_INTR_CREDITS_DMA polls a per-interrupt word in
+ * host memory, folds the delta of @returned since its last read
+ * into the credit count, and resets the coalesce timer, just as a
+ * flagless credits register write would.  The driver can then
+ * return credits from consecutive busy polls with a plain store,
+ * and only writes the register when it needs the unmask or rearm
+ * flags.  The count is cumulative and wraps naturally, so neither
+ * side ever has to clear it.  Each shadow is cacheline sized so
+ * interrupts never share a line.
+ */
+struct ionic_intr_credits_shadow {
+	u32 returned;
+	u8 rsvd[60];
+};
+
+static inline void
+ionic_intr_credits_dma(struct ionic_intr_credits_shadow *shadow, u32 cred)
+{
+	/* one writer per interrupt: its napi context */
+	WRITE_ONCE(shadow->returned, shadow->returned + cred);
+}
+
 /** enum ionic_dbell_bits - bitwise composition of dbell values.
  *
  * @IONIC_DBELL_QID_MASK:	unshifted mask of valid queue id bits.
@@ -142,4 +168,29 @@ static inline void ionic_dbell_ring(u64 __iomem *db_page, int qtype, u64 val)
 #endif
 }
 
+/** struct ionic_dbell_shadow - host memory doorbell shadow.
+ * @val:	doorbell value, same composition as the register write.
+ *
+ * A queue initialized with IONIC_QINIT_F_DBSHADOW gives the device
+ * the address of one of these.  While the queue has work posted the
+ * device polls @val for new producer indexes instead of relying on
+ * a posted register write per update, and the driver only writes
+ * the doorbell register to kick a queue the device may have idled.
+ * The register and the shadow are reconciled by producer index
+ * order, newest wins.  The shadow is cacheline sized so queues
+ * never share a line.
+ */
+struct ionic_dbell_shadow {
+	u64 val;
+	u8 rsvd[56];
+};
+
+static inline void ionic_dbell_shadow_update(struct ionic_dbell_shadow *shadow,
+					     u64 val)
+{
+	/* commit descriptor writes before publishing the new index */
+	wmb();
+	WRITE_ONCE(shadow->val, val);
+}
+
 #endif /* IONIC_REGS_H */
@@ -24,6 +24,7 @@ struct ionic_lif;
 
 #define DEVCMD_TIMEOUT  5
 #define SHORT_TIMEOUT   1
+#define IONIC_DEVCMD_SPIN_POLLS	100	/* usecs of spin before sleepy poll */
 #define IONIC_ADMINQ_TIME_SLICE	msecs_to_jiffies(100)
 #define MAX_ETH_EQS	64
 
@@ -37,6 +38,7 @@ extern unsigned int rx_fill_threshold;
 extern unsigned int tx_budget;
 extern unsigned int devcmd_timeout;
 extern unsigned long affinity_mask_override;
+extern bool threaded_napi;
 
 struct ionic_vf {
 	u16	 index;
@@ -56,6 +58,7 @@ struct ionic {
 	struct device *dev;
 	struct ionic_dev idev;
 	struct mutex dev_cmd_lock;	/* lock for dev_cmd operations */
+	struct mutex dev_node_lock;	/* serialize dev node overrides */
 	struct dentry *dentry;
 	struct ionic_dev_bar bars[IONIC_BARS_MAX];
 	unsigned int num_bars;
@@ -80,6 +83,13 @@ struct ionic {
 	struct notifier_block nb;
 #ifdef IONIC_DEVLINK
 	struct devlink_port dl_port;
+#ifdef HAVE_DEVLINK_HEALTH
+	struct devlink_health_reporter *fw_reporter;
+	struct devlink_health_reporter *tx_stall_reporter;
+	struct devlink_health_reporter *adminq_reporter;
+	struct delayed_work health_probe;
+	bool fw_unhealthy;
+#endif
 #endif
 	struct rw_semaphore vf_op_lock;	/* lock for VF operations */
 	struct ionic_vf *vfs;
@@ -89,12 +99,22 @@ struct ionic {
 };
 
 int ionic_adminq_post(struct ionic_lif *lif, struct ionic_admin_ctx *ctx);
+int ionic_adminq_post_nowait(struct ionic_lif *lif, struct ionic_admin_ctx *ctx);
+void ionic_adminq_kick(struct ionic_lif *lif);
 int ionic_adminq_wait(struct ionic_lif *lif, struct ionic_admin_ctx *ctx,
 		      const int err, const bool do_msg);
+int ionic_adminq_wait_batch(struct ionic_lif *lif,
+			    struct ionic_admin_ctx **ctxs, int nctx);
 int ionic_adminq_post_wait(struct ionic_lif *lif, struct ionic_admin_ctx *ctx);
 int ionic_adminq_post_wait_nomsg(struct ionic_lif *lif, struct ionic_admin_ctx *ctx);
 void ionic_adminq_netdev_err_print(struct ionic_lif *lif, u8 opcode,
 				   u8 status, int err);
+const char *ionic_opcode_to_str(enum ionic_cmd_opcode opcode);
+
+/* recovery-class work (fw restart replay, tx timeout handling) runs
+ * here so it never queues behind routine per-lif maintenance
+ */
+extern struct workqueue_struct *ionic_recovery_wq;
 
 int ionic_dev_cmd_wait(struct ionic *ionic, unsigned long max_wait);
 int ionic_dev_cmd_wait_nomsg(struct ionic *ionic, unsigned long max_wait);
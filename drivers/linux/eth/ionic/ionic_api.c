@@ -2,6 +2,7 @@
 /* Copyright (c) 2017 - 2022 Pensando Systems, Inc. All rights reserved. */
 
 #include <linux/kernel.h>
+#include <linux/genalloc.h>
 
 #include "ionic.h"
 #include "ionic_bus.h"
@@ -264,3 +265,133 @@ int ionic_api_adminq_post(void *handle, struct ionic_admin_ctx *ctx)
 	return ionic_adminq_post(lif, ctx);
 }
 EXPORT_SYMBOL_GPL(ionic_api_adminq_post);
+
+/* Pooled coherent DMA for client queue memory: clients attach and
+ * detach much more often than their ring sizes change, so hand out
+ * page-aligned carvings of a few large persistent arenas instead of
+ * paying dma_alloc_coherent and IOMMU map/unmap latency on every
+ * attach.  The arenas stay mapped for the life of the lif.
+ */
+#define IONIC_CLIENT_DMA_ARENA_SIZE	SZ_2M
+
+struct ionic_client_dma_arena {
+	struct list_head list;
+	void *va;
+	dma_addr_t pa;
+	size_t size;
+};
+
+static int ionic_client_dma_grow(struct ionic_lif *lif, size_t want)
+{
+	struct device *dev = lif->ionic->dev;
+	struct ionic_client_dma_arena *arena;
+	size_t size;
+	int err;
+
+	size = max_t(size_t, PAGE_ALIGN(want), IONIC_CLIENT_DMA_ARENA_SIZE);
+
+	arena = kzalloc(sizeof(*arena), GFP_KERNEL);
+	if (!arena)
+		return -ENOMEM;
+
+	arena->size = size;
+	arena->va = dma_alloc_coherent(dev, size, &arena->pa, GFP_KERNEL);
+	if (!arena->va) {
+		kfree(arena);
+		return -ENOMEM;
+	}
+
+	err = gen_pool_add_virt(lif->client_dma_pool,
+				(unsigned long)arena->va, arena->pa,
+				size, dev_to_node(dev));
+	if (err) {
+		dma_free_coherent(dev, size, arena->va, arena->pa);
+		kfree(arena);
+		return err;
+	}
+
+	list_add(&arena->list, &lif->client_dma_arenas);
+
+	return 0;
+}
+
+void *ionic_api_dma_alloc(void *handle, size_t size, dma_addr_t *dma_addr)
+{
+	struct ionic_lif *lif = handle;
+	unsigned long va = 0;
+	int err;
+
+	if (!size)
+		return NULL;
+
+	mutex_lock(&lif->client_dma_lock);
+
+	if (!lif->client_dma_pool) {
+		/* page-granular so rings keep their alignment guarantee */
+		lif->client_dma_pool =
+			gen_pool_create(PAGE_SHIFT,
+					dev_to_node(lif->ionic->dev));
+		if (!lif->client_dma_pool)
+			goto out_unlock;
+	}
+
+	va = gen_pool_alloc(lif->client_dma_pool, size);
+	if (!va) {
+		err = ionic_client_dma_grow(lif, size);
+		if (err)
+			goto out_unlock;
+		va = gen_pool_alloc(lif->client_dma_pool, size);
+	}
+
+out_unlock:
+	mutex_unlock(&lif->client_dma_lock);
+
+	if (!va)
+		return NULL;
+
+	*dma_addr = gen_pool_virt_to_phys(lif->client_dma_pool, va);
+
+	/* same clean slate a fresh coherent allocation would give */
+	memset((void *)va, 0, size);
+
+	return (void *)va;
+}
+EXPORT_SYMBOL_GPL(ionic_api_dma_alloc);
+
+void ionic_api_dma_free(void *handle, size_t size, void *vaddr,
+			dma_addr_t dma_addr)
+{
+	struct ionic_lif *lif = handle;
+
+	mutex_lock(&lif->client_dma_lock);
+	gen_pool_free(lif->client_dma_pool, (unsigned long)vaddr, size);
+	mutex_unlock(&lif->client_dma_lock);
+}
+EXPORT_SYMBOL_GPL(ionic_api_dma_free);
+
+void ionic_lif_client_dma_destroy(struct ionic_lif *lif)
+{
+	struct ionic_client_dma_arena *arena, *tmp;
+	struct device *dev = lif->ionic->dev;
+
+	if (!lif->client_dma_pool)
+		return;
+
+	if (gen_pool_avail(lif->client_dma_pool) !=
+	    gen_pool_size(lif->client_dma_pool)) {
+		/* a client leaked; leave the arenas mapped rather than
+		 * yank coherent memory it might still be using
+		 */
+		dev_warn(dev, "client dma pool busy at destroy, leaking arenas\n");
+		return;
+	}
+
+	gen_pool_destroy(lif->client_dma_pool);
+	lif->client_dma_pool = NULL;
+
+	list_for_each_entry_safe(arena, tmp, &lif->client_dma_arenas, list) {
+		dma_free_coherent(dev, arena->size, arena->va, arena->pa);
+		list_del(&arena->list);
+		kfree(arena);
+	}
+}
@@ -238,16 +238,52 @@ int ionic_api_get_dbid(void *handle, u32 *dbid, phys_addr_t *addr);
  */
 void ionic_api_put_dbid(void *handle, int dbid);
 
+/**
+ * ionic_api_dma_alloc() - Allocate pooled coherent DMA memory
+ * @handle:		Handle to lif
+ * @size:		Size of the allocation in bytes
+ * @dma_addr:		Bus address of the allocation returned
+ *
+ * Sub-allocate zeroed, page-aligned coherent memory from large arenas
+ * that stay mapped for the life of the lif, so repeated client attach
+ * and detach avoids per-allocation mapping cost.
+ *
+ * Return: virtual address of the allocation, or NULL
+ */
+void *ionic_api_dma_alloc(void *handle, size_t size, dma_addr_t *dma_addr);
+
+/**
+ * ionic_api_dma_free() - Release pooled coherent DMA memory
+ * @handle:		Handle to lif
+ * @size:		Size used at allocation
+ * @vaddr:		Virtual address from allocation
+ * @dma_addr:		Bus address from allocation
+ *
+ * Return the memory to the lif's pool; the backing arena remains
+ * mapped for reuse.
+ */
+void ionic_api_dma_free(void *handle, size_t size, void *vaddr,
+			dma_addr_t dma_addr);
+
 /**
  * struct ionic_admin_ctx - Admin command context
  * @work:		Work completion wait queue element
+ * @cb:			Optional completion callback, called from the adminq
+ *			napi context with the comp already copied in
+ * @cb_arg:		Argument for the completion callback
  * @cmd:		Admin command (64B) to be copied to the queue
  * @comp:		Admin completion (16B) copied from the queue
+ * @post_ns:		Timestamp at post, for latency accounting
+ * @post_depth:		Commands already in flight at post time
  */
 struct ionic_admin_ctx {
 	struct completion work;
+	void (*cb)(struct ionic_admin_ctx *ctx);
+	void *cb_arg;
 	union ionic_adminq_cmd cmd;
 	union ionic_adminq_comp comp;
+	u64 post_ns;
+	u16 post_depth;
 };
 
 /**
@@ -4,6 +4,7 @@
 #include <linux/module.h>
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
+#include <linux/rtnetlink.h>
 #include <linux/pci.h>
 
 #include "ionic.h"
@@ -287,6 +288,7 @@ static int ionic_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 	ionic->dev = dev;
 	pci_set_drvdata(pdev, ionic);
 	mutex_init(&ionic->dev_cmd_lock);
+	mutex_init(&ionic->dev_node_lock);
 
 	ionic->is_mgmt_nic =
 		ent->device == PCI_DEVICE_ID_PENSANDO_IONIC_ETH_MGMT;
@@ -465,12 +467,58 @@ static void ionic_remove(struct pci_dev *pdev)
 	ionic_devlink_free(ionic);
 }
 
+/* System sleep assumes preserved pci state (the pci core saves and
+ * restores config space around these), so the lif hangs on to its
+ * identity and allocations and only replays the hw programming on
+ * resume; ionic_lif_resume() falls back to the fw_up restore path if
+ * the device lost state while we slept.
+ */
+static int __maybe_unused ionic_suspend(struct device *dev)
+{
+	struct ionic *ionic = dev_get_drvdata(dev);
+
+	if (!ionic->lif)
+		return 0;
+
+	rtnl_lock();
+	ionic_lif_suspend(ionic->lif);
+	rtnl_unlock();
+
+	return 0;
+}
+
+static int __maybe_unused ionic_resume(struct device *dev)
+{
+	struct ionic *ionic = dev_get_drvdata(dev);
+	int err = 0;
+
+	if (!ionic->lif)
+		return 0;
+
+	rtnl_lock();
+	err = ionic_lif_resume(ionic->lif);
+	rtnl_unlock();
+
+	return err;
+}
+
+static SIMPLE_DEV_PM_OPS(ionic_pm_ops, ionic_suspend, ionic_resume);
+
 static struct pci_driver ionic_driver = {
 	.name = IONIC_DRV_NAME,
 	.id_table = ionic_id_table,
 	.probe = ionic_probe,
 	.remove = ionic_remove,
 	.sriov_configure = ionic_sriov_configure,
+	.driver.pm = &ionic_pm_ops,
+#ifdef HAVE_PROBE_PREFER_ASYNCHRONOUS
+	/* Each port is its own PCI function with its own devcmd channel,
+	 * so the ports of a multi-port card can run their long
+	 * identify/init/reset probe sequences in parallel instead of
+	 * waiting in line on the PCI core's synchronous probing.
+	 */
+	.driver.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+#endif
 };
 
 int ionic_bus_register_driver(void)
@@ -229,6 +229,36 @@ static int ionic_mnic_dev_setup(struct ionic *ionic)
 	return 0;
 }
 
+/* Map the doorbell pages as normal non-cacheable (write-combining)
+ * rather than strict device memory.  The doorbell write itself needs
+ * no device-memory ordering -- ionic_dbell_ring() orders descriptor
+ * writes with an explicit wmb() -- and the relaxed mapping lets
+ * back-to-back doorbell writes coalesce in the CPU write buffer
+ * instead of each paying a full device-memory posted write.  Only
+ * safe where the fabric keeps posted writes ordered, so the device
+ * tree node must opt in.
+ */
+static void __iomem *ionic_map_dbell_bar(struct device *dev,
+					 struct resource *res)
+{
+	void __iomem *base;
+
+	if (!of_property_read_bool(dev->of_node, "pensando,wc-doorbell"))
+		return devm_ioremap_resource(dev, res);
+
+	if (!devm_request_mem_region(dev, res->start, resource_size(res),
+				     res->name ?: KBUILD_MODNAME))
+		return IOMEM_ERR_PTR(-EBUSY);
+
+	base = devm_ioremap_wc(dev, res->start, resource_size(res));
+	if (!base)
+		return IOMEM_ERR_PTR(-ENOMEM);
+
+	dev_info(dev, "doorbell pages mapped write-combining\n");
+
+	return base;
+}
+
 static int ionic_map_bars(struct ionic *ionic)
 {
 	struct platform_device *pfdev = ionic->pfdev;
@@ -245,6 +275,8 @@ static int ionic_map_bars(struct ionic *ionic)
 			continue;
 		if (i == IONIC_TSTAMP_BAR)
 			base = ionic_ioremap_shared_resource(&tstamp_res, res);
+		else if (i == IONIC_DOORBELL_BAR)
+			base = ionic_map_dbell_bar(dev, res);
 		else
 			base = devm_ioremap_resource(dev, res);
 		if (IS_ERR(base)) {
@@ -311,6 +343,7 @@ int ionic_probe(struct platform_device *pfdev)
 	platform_set_drvdata(pfdev, ionic);
 	ionic->dev = dev;
 	mutex_init(&ionic->dev_cmd_lock);
+	mutex_init(&ionic->dev_node_lock);
 
 	np = dev->of_node;
 	if (!np) {
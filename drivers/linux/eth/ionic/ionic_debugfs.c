@@ -2,6 +2,7 @@
 /* Copyright(c) 2017 - 2022 Pensando Systems, Inc */
 
 #include <linux/netdevice.h>
+#include <linux/rtnetlink.h>
 
 #include "ionic.h"
 #include "ionic_bus.h"
@@ -199,6 +200,53 @@ static int cq_tail_show(struct seq_file *seq, void *v)
 }
 DEFINE_SHOW_ATTRIBUTE(cq_tail);
 
+#ifdef IONIC_DEBUG_STATS
+static void lat_hist_show_one(struct seq_file *seq, const char *label,
+			      const struct ionic_lat_hist *hist)
+{
+	int i;
+
+	seq_printf(seq, "%s_samples: %llu\n", label, hist->samples);
+	for (i = 0; i < IONIC_LAT_BUCKETS; i++) {
+		if (!hist->buckets[i])
+			continue;
+		seq_printf(seq, "%s_lt_%lluns: %llu\n", label,
+			   BIT_ULL(i + 1), hist->buckets[i]);
+	}
+}
+
+static int lat_hist_show(struct seq_file *seq, void *v)
+{
+	struct ionic_qcq *qcq = seq->private;
+
+	lat_hist_show_one(seq, "post", &qcq->post_hist);
+	lat_hist_show_one(seq, "napi", &qcq->napi_hist);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(lat_hist);
+
+static int adminq_lat_show(struct seq_file *seq, void *v)
+{
+	struct ionic_lif *lif = seq->private;
+	int op;
+
+	if (!lif->adminq_lat)
+		return 0;
+
+	for (op = 0; op < IONIC_ADMINQ_LAT_OPS; op++) {
+		const struct ionic_lat_hist *hist = &lif->adminq_lat[op];
+
+		if (!hist->samples)
+			continue;
+		lat_hist_show_one(seq, ionic_opcode_to_str(op), hist);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(adminq_lat);
+#endif
+
 static const struct debugfs_reg32 intr_ctrl_regs[] = {
 	{ .name = "coal_init", .offset = 0, },
 	{ .name = "mask", .offset = 4, },
@@ -241,6 +289,17 @@ void ionic_debugfs_add_qcq(struct ionic_lif *lif, struct ionic_qcq *qcq)
 	debugfs_create_bool("armed", 0400, qcq_dentry, &qcq->armed);
 #endif
 
+	/* interrupt-free dedicated polling; applied at next queue enable */
+	if (q->type == IONIC_QTYPE_TXQ || q->type == IONIC_QTYPE_RXQ) {
+#if (RHEL_RELEASE_CODE && (RHEL_RELEASE_VERSION(7, 0) < RHEL_RELEASE_CODE))
+		debugfs_create_u8("poll_mode", 0600, qcq_dentry,
+				  (u8 *)&qcq->poll_mode);
+#else
+		debugfs_create_bool("poll_mode", 0600, qcq_dentry,
+				    &qcq->poll_mode);
+#endif
+	}
+
 	q_dentry = debugfs_create_dir("q", qcq->dentry);
 	if (IS_ERR_OR_NULL(q_dentry))
 		return;
@@ -258,6 +317,11 @@ void ionic_debugfs_add_qcq(struct ionic_lif *lif, struct ionic_qcq *qcq)
 	debugfs_create_file("tail", 0400, q_dentry, q, &q_tail_fops);
 	debugfs_create_file("head", 0400, q_dentry, q, &q_head_fops);
 
+#ifdef IONIC_DEBUG_STATS
+	/* sampled post-to-completion and napi poll duration histograms */
+	debugfs_create_file("lat_hist", 0400, qcq_dentry, qcq, &lat_hist_fops);
+#endif
+
 	desc_blob = devm_kzalloc(dev, sizeof(*desc_blob), GFP_KERNEL);
 	if (!desc_blob)
 		return;
@@ -516,6 +580,28 @@ static int lif_n_txrx_alloc_show(struct seq_file *seq, void *v)
 }
 DEFINE_SHOW_ATTRIBUTE(lif_n_txrx_alloc);
 
+static int lif_sw_dbg_stats_get(void *data, u64 *val)
+{
+	struct ionic_lif *lif = data;
+
+	*val = test_bit(IONIC_LIF_F_SW_DEBUG_STATS, lif->state);
+
+	return 0;
+}
+
+static int lif_sw_dbg_stats_set(void *data, u64 val)
+{
+	struct ionic_lif *lif = data;
+
+	rtnl_lock();
+	ionic_dbg_stats_enable(lif, !!val);
+	rtnl_unlock();
+
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(lif_sw_dbg_stats_fops, lif_sw_dbg_stats_get,
+			 lif_sw_dbg_stats_set, "%llu\n");
+
 void ionic_debugfs_add_lif(struct ionic_lif *lif)
 {
 	struct dentry *lif_dentry;
@@ -535,6 +621,14 @@ void ionic_debugfs_add_lif(struct ionic_lif *lif)
 			    lif, &lif_filters_fops);
 	debugfs_create_file("txrx_alloc", 0400, lif->dentry,
 			    lif, &lif_n_txrx_alloc_fops);
+	/* runtime toggle for sw debug stats collection on this lif */
+	debugfs_create_file("sw_dbg_stats", 0600, lif->dentry,
+			    lif, &lif_sw_dbg_stats_fops);
+#ifdef IONIC_DEBUG_STATS
+	/* per-opcode adminq post-to-completion histograms */
+	debugfs_create_file("adminq_lat", 0400, lif->dentry,
+			    lif, &adminq_lat_fops);
+#endif
 }
 
 void ionic_debugfs_del_lif(struct ionic_lif *lif)
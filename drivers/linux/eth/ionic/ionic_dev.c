@@ -12,6 +12,7 @@
 #include "ionic_dev.h"
 #include "ionic_debugfs.h"
 #include "ionic_lif.h"
+#include "ionic_trace.h"
 
 void ionic_watchdog_cb(struct timer_list *t)
 {
@@ -37,7 +38,7 @@ void ionic_watchdog_cb(struct timer_list *t)
 
 	if (test_bit(IONIC_LIF_F_FILTER_SYNC_NEEDED, lif->state) &&
 	    !test_bit(IONIC_LIF_F_FW_RESET, lif->state)) {
-		work = kzalloc(sizeof(*work), GFP_ATOMIC);
+		work = ionic_lif_deferred_get(lif);
 		if (!work) {
 			netdev_err(lif->netdev, "rxmode change dropped\n");
 			return;
@@ -63,6 +64,7 @@ void ionic_watchdog_init(struct ionic *ionic)
 	atomic_long_set(&idev->last_check_time, jiffies - 2 * HZ);
 	idev->last_hb_time = jiffies - 2 * ionic->watchdog_period;
 	/* init as ready, so no transition if the first check succeeds */
+	idev->last_fw_eid = 0;
 	idev->last_fw_hb = 0;
 	idev->fw_hb_ready = true;
 	idev->fw_status_ready = true;
@@ -209,6 +211,25 @@ do_check_time:
 		goto do_check_time;
 	}
 
+	/* The fw DMAs the most recent NotifyQ event id into the lif info
+	 * page with every event it posts, and posts periodic heartbeat
+	 * events when nothing else is happening.  If the eid has moved
+	 * since we last looked, the fw and its DMA engine are healthy and
+	 * we can skip the uncached register reads entirely - they cost a
+	 * PCIe round trip each, and this path runs under the adminq posts.
+	 * A fw that has stalled or restarted stops advancing the eid and
+	 * we fall through to the register checks below.
+	 */
+	if (lif && lif->info && idev->fw_status_ready && idev->fw_hb_ready) {
+		u64 eid = le64_to_cpu(lif->info->status.eid);
+
+		if (eid != idev->last_fw_eid) {
+			idev->last_fw_eid = eid;
+			idev->last_hb_time = check_time;
+			return 0;
+		}
+	}
+
 	fw_status = ioread8(&idev->dev_info_regs->fw_status);
 
 	 /* If fw_status is not ready don't bother with the generation */
@@ -268,7 +289,7 @@ do_check_time:
 		if (trigger) {
 			struct ionic_deferred_work *work;
 
-			work = kzalloc(sizeof(*work), GFP_ATOMIC);
+			work = ionic_lif_deferred_get(lif);
 			if (work) {
 				work->type = IONIC_DW_TYPE_LIF_RESET;
 				work->fw_status = fw_status_ready;
@@ -462,25 +483,71 @@ void ionic_dev_cmd_port_pause(struct ionic_dev *idev, u8 pause_type)
 	ionic_dev_cmd_go(idev, &cmd);
 }
 
+void ionic_dev_cmd_port_loopback(struct ionic_dev *idev, u8 loopback_mode)
+{
+	union ionic_dev_cmd cmd = {
+		.port_setattr.opcode = IONIC_CMD_PORT_SETATTR,
+		.port_setattr.index = 0,
+		.port_setattr.attr = IONIC_PORT_ATTR_LOOPBACK,
+		.port_setattr.loopback_mode = loopback_mode,
+	};
+
+	ionic_dev_cmd_go(idev, &cmd);
+}
+
 /* VF commands */
-int ionic_set_vf_config(struct ionic *ionic, int vf,
-			struct ionic_vf_setattr_cmd *vfc)
+static int ionic_set_vf_config_locked(struct ionic *ionic, int vf,
+				      struct ionic_vf_setattr_cmd *vfc)
 {
 	union ionic_dev_cmd cmd = {
 		.vf_setattr.opcode = IONIC_CMD_VF_SETATTR,
 		.vf_setattr.attr = vfc->attr,
 		.vf_setattr.vf_index = cpu_to_le16(vf),
 	};
+
+	memcpy(cmd.vf_setattr.pad, vfc->pad, sizeof(vfc->pad));
+
+	ionic_dev_cmd_go(&ionic->idev, &cmd);
+	return ionic_dev_cmd_wait(ionic, devcmd_timeout);
+}
+
+int ionic_set_vf_config(struct ionic *ionic, int vf,
+			struct ionic_vf_setattr_cmd *vfc)
+{
 	int err;
 
 	if (vf >= ionic->num_vfs)
 		return -EINVAL;
 
-	memcpy(cmd.vf_setattr.pad, vfc->pad, sizeof(vfc->pad));
+	mutex_lock(&ionic->dev_cmd_lock);
+	err = ionic_set_vf_config_locked(ionic, vf, vfc);
+	mutex_unlock(&ionic->dev_cmd_lock);
+
+	return err;
+}
+
+/* Push a VF's attributes back-to-back under a single lock hold.  The
+ * devcmd channel is a one-command mailbox, so each setattr still
+ * completes before the next is issued, but bulk provisioning stops
+ * paying a dev_cmd_lock round trip per attribute and can't be
+ * interleaved with other devcmd users mid-VF.  Returns the first
+ * error, after attempting all of the attributes.
+ */
+int ionic_set_vf_attrs(struct ionic *ionic, int vf,
+		       struct ionic_vf_setattr_cmd *vfcs, int nattrs)
+{
+	int err = 0;
+	int i, ret;
+
+	if (vf >= ionic->num_vfs)
+		return -EINVAL;
 
 	mutex_lock(&ionic->dev_cmd_lock);
-	ionic_dev_cmd_go(&ionic->idev, &cmd);
-	err = ionic_dev_cmd_wait(ionic, devcmd_timeout);
+	for (i = 0; i < nattrs; i++) {
+		ret = ionic_set_vf_config_locked(ionic, vf, &vfcs[i]);
+		if (ret && !err)
+			err = ret;
+	}
 	mutex_unlock(&ionic->dev_cmd_lock);
 
 	return err;
@@ -701,10 +768,9 @@ static bool ionic_next_eq_comp(struct ionic_eq *eq, int ring_index,
 	return true;
 }
 
-static int ionic_poll_eq_ring(struct ionic_eq *eq, int ring_index)
+static int ionic_poll_eq_ring(struct ionic_eq *eq, int ring_index, int budget)
 {
 	struct ionic_eq_comp comp;
-	int budget = eq->depth;
 	int credits = 0;
 	int code;
 
@@ -734,14 +800,88 @@ static int ionic_poll_eq_ring(struct ionic_eq *eq, int ring_index)
 	return credits;
 }
 
+static void ionic_eq_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct ionic_eq *eq = container_of(dim, struct ionic_eq, dim);
+	struct dim_cq_moder cur_moder;
+	u32 new_coal;
+
+	cur_moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	new_coal = ionic_coal_usec_to_hw(eq->ionic, cur_moder.usec);
+	new_coal = new_coal ? new_coal : 1;
+
+	if (eq->intr.dim_coal_hw != new_coal) {
+		eq->intr.dim_coal_hw = new_coal;
+		ionic_intr_coal_init(eq->ionic->idev.intr_ctrl,
+				     eq->intr.index, new_coal);
+	}
+
+	dim->state = DIM_START_MEASURE;
+}
+
+/* Sample the aggregate event count and let dim tune the eq's intr
+ * coalescing, so shared event queues get the same adaptive moderation
+ * as the per-queue-interrupt path.  Events stand in for packets in
+ * the sample; one sample per re-arm, matching ionic_dim_update().
+ */
+static void ionic_eq_dim_update(struct ionic_eq *eq)
+{
+	struct dim_sample dim_sample;
+
+	if (!eq->intr.dim_coal_hw)
+		return;
+
+	dim_update_sample_with_comps(eq->intr.rearm_count,
+				     eq->n_events, 0, 0, &dim_sample);
+
+	net_dim(&eq->dim, dim_sample);
+}
+
+/* Service up to budget events from each ring.  If either ring might
+ * have more waiting, return the batched credits without unmasking and
+ * let the caller reschedule; the re-arm is deferred to the pass that
+ * finds the rings empty.
+ */
+static bool ionic_eq_service(struct ionic_eq *eq, int budget)
+{
+	int c0, c1;
+
+	c0 = ionic_poll_eq_ring(eq, 0, budget);
+	c1 = ionic_poll_eq_ring(eq, 1, budget);
+
+	eq->n_events += c0 + c1;
+
+	if (c0 < budget && c1 < budget) {
+		eq->intr.rearm_count++;
+		ionic_eq_dim_update(eq);
+		ionic_intr_credits(eq->ionic->idev.intr_ctrl, eq->intr.index,
+				   c0 + c1, IONIC_INTR_CRED_UNMASK);
+		return false;
+	}
+
+	ionic_intr_credits(eq->ionic->idev.intr_ctrl, eq->intr.index,
+			   c0 + c1, 0);
+	return true;
+}
+
+static void ionic_eq_poll_tasklet(unsigned long data)
+{
+	struct ionic_eq *eq = (struct ionic_eq *)data;
+
+	if (!eq->is_init)
+		return;
+
+	if (ionic_eq_service(eq, IONIC_EQ_ISR_BUDGET))
+		tasklet_schedule(&eq->poll);
+}
+
 static irqreturn_t ionic_eq_isr(int irq, void *data)
 {
 	struct ionic_eq *eq = data;
-	int credits;
 
-	credits = ionic_poll_eq_ring(eq, 0) + ionic_poll_eq_ring(eq, 1);
-	ionic_intr_credits(eq->ionic->idev.intr_ctrl, eq->intr.index,
-			   credits, IONIC_INTR_CRED_UNMASK);
+	if (ionic_eq_service(eq, IONIC_EQ_ISR_BUDGET))
+		tasklet_schedule(&eq->poll);
 
 	return IRQ_HANDLED;
 }
@@ -763,12 +903,16 @@ static int ionic_eq_alloc(struct ionic *ionic, int index)
 {
 	const int ring_bytes = sizeof(struct ionic_eq_comp) * IONIC_EQ_DEPTH;
 	struct ionic_eq *eq;
+	int orig_node;
 	int err;
 
 	eq = kzalloc(sizeof(*eq), GFP_KERNEL);
 	eq->ionic = ionic;
 	eq->index = index;
 	eq->depth = IONIC_EQ_DEPTH;
+	tasklet_init(&eq->poll, ionic_eq_poll_tasklet, (unsigned long)eq);
+	INIT_WORK(&eq->dim.work, ionic_eq_dim_work);
+	eq->dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
 
 	err = ionic_intr_alloc(ionic, &eq->intr);
 	if (err) {
@@ -792,6 +936,17 @@ static int ionic_eq_alloc(struct ionic *ionic, int index)
 	if (eq->intr.cpu != -1)
 		cpumask_set_cpu(eq->intr.cpu, &eq->intr.affinity_mask);
 
+	/* put the rings on the node of the core that services the irq,
+	 * so the poll loop isn't pulling events across the interconnect
+	 */
+	if (eq->intr.cpu != -1)
+		eq->node = cpu_to_node(eq->intr.cpu);
+	else
+		eq->node = dev_to_node(ionic->dev);
+
+	orig_node = dev_to_node(ionic->dev);
+	set_dev_node(ionic->dev, eq->node);
+
 	eq->ring[0].gen_color = 1;
 	eq->ring[0].base = dma_alloc_coherent(ionic->dev, ring_bytes,
 					      &eq->ring[0].base_pa,
@@ -802,6 +957,8 @@ static int ionic_eq_alloc(struct ionic *ionic, int index)
 					      &eq->ring[1].base_pa,
 					      GFP_KERNEL);
 
+	set_dev_node(ionic->dev, orig_node);
+
 	ionic->eqs[index] = eq;
 
 	ionic_debugfs_add_eq(eq);
@@ -892,6 +1049,8 @@ static void ionic_eq_deinit(struct ionic_eq *eq)
 	ionic_intr_mask(ionic->idev.intr_ctrl, eq->intr.index,
 			IONIC_INTR_MASK_SET);
 	synchronize_irq(eq->intr.vector);
+	tasklet_kill(&eq->poll);
+	cancel_work_sync(&eq->dim.work);
 
 	irq_set_affinity_hint(eq->intr.vector, NULL);
 	devm_free_irq(ionic->dev, eq->intr.vector, eq);
@@ -972,6 +1131,14 @@ static int ionic_eq_init(struct ionic_eq *eq)
 		return err;
 	}
 
+	/* seed a default coalesce value for dim to tune from */
+	eq->intr.dim_coal_hw = ionic_coal_usec_to_hw(ionic,
+						     IONIC_ITR_COAL_USEC_DEFAULT);
+	if (!eq->intr.dim_coal_hw)
+		eq->intr.dim_coal_hw = 1;
+	ionic_intr_coal_init(ionic->idev.intr_ctrl, eq->intr.index,
+			     eq->intr.dim_coal_hw);
+
 	ionic_intr_mask(ionic->idev.intr_ctrl, eq->intr.index,
 			IONIC_INTR_MASK_CLEAR);
 
@@ -1060,6 +1227,9 @@ unsigned int ionic_cq_service(struct ionic_cq *cq, unsigned int work_to_do,
 	if (work_done && done_cb)
 		done_cb(done_arg);
 
+	if (cq->bound_q)
+		trace_ionic_cq_service(cq->bound_q, work_done);
+
 	return work_done;
 }
 
@@ -1139,6 +1309,14 @@ void ionic_q_post(struct ionic_queue *q, bool ring_doorbell, ionic_desc_cb cb,
 	desc_info->cb = cb;
 	desc_info->cb_arg = cb_arg;
 
+	DEBUG_STATS_DESC_POST(q, desc_info);
+
+	/* posting to an empty queue: the device may have stopped polling
+	 * the doorbell shadow and needs a register write to restart
+	 */
+	if (q->dbell_shadow && q->tail_idx == q->head_idx)
+		q->dbell_kick = true;
+
 	q->head_idx = (q->head_idx + 1) & (q->num_descs - 1);
 
 #ifdef IONIC_DEBUG_STATS
@@ -1150,15 +1328,24 @@ void ionic_q_post(struct ionic_queue *q, bool ring_doorbell, ionic_desc_cb cb,
 		__func__, q->lif->index, q->name, q->hw_type, q->hw_index,
 		q->head_idx, ring_doorbell);
 
+	trace_ionic_q_post(q);
+
+	if (q->dbell_shadow)
+		ionic_dbell_shadow_update(q->dbell_shadow,
+					  q->dbval | q->head_idx);
+
 	if (ring_doorbell) {
-		ionic_dbell_ring(lif->kern_dbpage, q->hw_type,
-				 q->dbval | q->head_idx);
+		if (!q->dbell_shadow || q->dbell_kick) {
+			ionic_dbell_ring(lif->kern_dbpage, q->hw_type,
+					 q->dbval | q->head_idx);
+			trace_ionic_dbell_ring(q);
+			q->dbell_kick = false;
+		}
 
 		q->dbell_jiffies = jiffies;
 
 		if (q_to_qcq(q)->napi_qcq)
-			mod_timer(&q_to_qcq(q)->napi_qcq->napi_deadline,
-				  jiffies + IONIC_NAPI_DEADLINE);
+			ionic_napi_deadline_set(q_to_qcq(q)->napi_qcq);
 	}
 }
 
@@ -5,19 +5,37 @@
 #define _IONIC_DEV_H_
 
 #include <linux/atomic.h>
+#include <linux/interrupt.h>
 #include <linux/mutex.h>
+#include <linux/scatterlist.h>
 #include <linux/workqueue.h>
 
+#ifdef CONFIG_DIMLIB
+#include <linux/dim.h>
+#else
+#include "dim.h"
+#endif
+
 #include "ionic_if.h"
 #include "ionic_api.h"
 #include "ionic_regs.h"
 
+/* The sw debug stats are always built in now; collection is patched
+ * in at runtime through ionic_dbg_stats_key, so production kernels
+ * can capture the work-per-poll and latency histograms without a
+ * -DIONIC_DEBUG_STATS rebuild.
+ */
+#ifndef IONIC_DEBUG_STATS
+#define IONIC_DEBUG_STATS
+#endif
+
 #define IONIC_MAX_TX_DESC		8192
 #define IONIC_MAX_RX_DESC		16384
 #define IONIC_MIN_TXRX_DESC		64
 #define IONIC_DEF_TXRX_DESC		4096
 #define IONIC_RX_FILL_THRESHOLD	64
 #define IONIC_RX_FILL_DIV		8
+#define IONIC_RX_FILL_BURST		64
 #define IONIC_LIFS_MAX			1024
 #define IONIC_WATCHDOG_PCI_SECS		5
 #define IONIC_WATCHDOG_PLAT_MSECS	100
@@ -145,6 +163,7 @@ struct ionic_dev {
 
 	atomic_long_t last_check_time;
 	unsigned long last_hb_time;
+	u64 last_fw_eid;
 	u32 last_fw_hb;
 	bool fw_hb_ready;
 	bool fw_status_ready;
@@ -155,6 +174,8 @@ struct ionic_dev {
 
 	struct ionic_intr __iomem *intr_ctrl;
 	u64 __iomem *intr_status;
+	struct ionic_intr_credits_shadow *intr_credits;
+	dma_addr_t intr_credits_pa;
 	u8 *msix_cfg_base;
 
 	struct mutex cmb_inuse_lock; /* for cmb_inuse */
@@ -180,6 +201,12 @@ struct ionic_cq_info {
 struct ionic_queue;
 struct ionic_qcq;
 struct ionic_desc_info;
+struct bpf_prog;
+struct xdp_rxq_info;
+struct xdp_frame;
+struct xdp_buff;
+struct xsk_buff_pool;
+struct page_pool;
 
 typedef void (*ionic_desc_cb)(struct ionic_queue *q,
 			      struct ionic_desc_info *desc_info,
@@ -199,6 +226,7 @@ struct ionic_buf_info {
 	u32 len;
 };
 
+#ifndef HAVE_PAGE_POOL
 #define IONIC_PAGE_CACHE_SIZE          2048
 
 struct ionic_page_cache {
@@ -206,6 +234,7 @@ struct ionic_page_cache {
 	u32 tail;
 	struct ionic_buf_info ring[IONIC_PAGE_CACHE_SIZE];
 } ____cacheline_aligned_in_smp;
+#endif
 
 #define IONIC_MAX_FRAGS			(1 + IONIC_TX_MAX_SG_ELEMS_V1)
 
@@ -224,9 +253,20 @@ struct ionic_desc_info {
 	};
 	unsigned int bytes;
 	unsigned int nbufs;
+	unsigned int sg_nents;	/* entries in the tx_sgl slot, 0=unbatched */
+#ifdef IONIC_DEBUG_STATS
+	u64 lat_ts;
+#endif
 	struct ionic_buf_info bufs[IONIC_MAX_FRAGS];
 	ionic_desc_cb cb;
 	void *cb_arg;
+#ifdef HAVE_XDP_SUPPORT
+	struct xdp_frame *xdpf;
+	enum xdp_action act;
+#ifdef HAVE_XSK_BUFF_POOL
+	struct xdp_buff *xsk_buf;
+#endif
+#endif
 };
 
 #define IONIC_QUEUE_NAME_MAX_SZ		32
@@ -235,7 +275,14 @@ struct ionic_queue {
 	struct device *dev;
 	struct ionic_lif *lif;
 	struct ionic_desc_info *info;
+	/* per-slot scatterlists (IONIC_MAX_FRAGS each) for batched tx
+	 * mapping under an iommu; NULL when mapping buf-by-buf
+	 */
+	struct scatterlist *tx_sgl;
 	u64 dbval;
+	struct ionic_dbell_shadow *dbell_shadow;
+	dma_addr_t dbell_shadow_pa;
+	bool dbell_kick;	/* device may be idle, needs a register write */
 	unsigned long dbell_deadline;
 	unsigned long dbell_jiffies;
 	u16 head_idx;
@@ -250,8 +297,25 @@ struct ionic_queue {
 #ifdef IONIC_DEBUG_STATS
 	u64 depth;
 	u64 depth_max;
+	u64 lat_sample;
 #endif
 	u64 features;
+	u32 rx_copybreak;
+	u32 rx_pkt_len_avg;
+	bool rx_gro_frags;
+	bool rx_inplace;
+	struct sk_buff *zc_head;	/* zerocopy skbs deferred to poll end */
+	struct sk_buff *zc_tail;
+#ifdef HAVE_XDP_SUPPORT
+	struct bpf_prog *xdp_prog;
+	struct xdp_rxq_info *xdp_rxq_info;
+	struct ionic_queue *partner;
+	bool xdp_flush;
+#ifdef HAVE_XSK_BUFF_POOL
+	struct xsk_buff_pool *xsk_pool;
+	u32 xsk_frames_done;
+#endif
+#endif
 	struct ionic_dev *idev;
 	unsigned int type;
 	unsigned int hw_index;
@@ -274,7 +338,11 @@ struct ionic_queue {
 	unsigned int desc_size;
 	unsigned int sg_desc_size;
 	unsigned int pid;
+#ifdef HAVE_PAGE_POOL
+	struct page_pool *page_pool;
+#else
 	struct ionic_page_cache page_cache;
+#endif
 	char name[IONIC_QUEUE_NAME_MAX_SZ];
 } ____cacheline_aligned_in_smp;
 
@@ -319,14 +387,19 @@ struct ionic_eq {
 	struct ionic *ionic;
 	struct ionic_eq_ring ring[2];
 	struct ionic_intr_info intr;
+	struct tasklet_struct poll;	/* continues a budget-limited poll */
+	struct dim dim;			/* adaptive intr moderation */
+	u64 n_events;
 
 	int index;
 	int depth;
+	int node;
 
 	bool is_init;
 };
 
 #define IONIC_EQ_DEPTH 0x1000
+#define IONIC_EQ_ISR_BUDGET 64
 
 struct ionic;
 
@@ -376,9 +449,12 @@ void ionic_dev_cmd_port_speed(struct ionic_dev *idev, u32 speed);
 void ionic_dev_cmd_port_autoneg(struct ionic_dev *idev, u8 an_enable);
 void ionic_dev_cmd_port_fec(struct ionic_dev *idev, u8 fec_type);
 void ionic_dev_cmd_port_pause(struct ionic_dev *idev, u8 pause_type);
+void ionic_dev_cmd_port_loopback(struct ionic_dev *idev, u8 loopback_mode);
 
 int ionic_set_vf_config(struct ionic *ionic, int vf,
 			struct ionic_vf_setattr_cmd *vfc);
+int ionic_set_vf_attrs(struct ionic *ionic, int vf,
+		       struct ionic_vf_setattr_cmd *vfcs, int nattrs);
 int ionic_dev_cmd_vf_getattr(struct ionic *ionic, int vf, u8 attr,
 			     struct ionic_vf_getattr_comp *comp);
 void ionic_vf_start(struct ionic *ionic, int vf);
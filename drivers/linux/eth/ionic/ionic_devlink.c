@@ -93,6 +93,264 @@ static const struct devlink_ops ionic_dl_ops = {
 	.flash_update	= ionic_dl_flash_update,
 };
 
+#ifdef HAVE_DEVLINK_PARAMS
+enum ionic_dl_param_id {
+	IONIC_DL_PARAM_ID_RX_COPYBREAK = DEVLINK_PARAM_DRIVER_BASE,
+	IONIC_DL_PARAM_ID_RX_FILL_THRESHOLD,
+	IONIC_DL_PARAM_ID_TX_BUDGET,
+	IONIC_DL_PARAM_ID_AFFINITY_MASK,
+};
+
+static int ionic_dl_param_get(struct devlink *dl, u32 id,
+			      struct devlink_param_gset_ctx *ctx)
+{
+	struct ionic *ionic = devlink_priv(dl);
+	struct ionic_lif *lif = ionic->lif;
+
+	switch (id) {
+	case IONIC_DL_PARAM_ID_RX_COPYBREAK:
+		ctx->val.vu32 = lif->rx_copybreak;
+		break;
+	case IONIC_DL_PARAM_ID_RX_FILL_THRESHOLD:
+		ctx->val.vu32 = lif->rx_fill_threshold;
+		break;
+	case IONIC_DL_PARAM_ID_TX_BUDGET:
+		ctx->val.vu32 = lif->tx_budget;
+		break;
+	case IONIC_DL_PARAM_ID_AFFINITY_MASK:
+		snprintf(ctx->val.vstr, sizeof(ctx->val.vstr), "0x%llx",
+			 lif->affinity_mask_override);
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+static int ionic_dl_param_set(struct devlink *dl, u32 id,
+			      struct devlink_param_gset_ctx *ctx)
+{
+	struct ionic *ionic = devlink_priv(dl);
+	struct ionic_lif *lif = ionic->lif;
+	unsigned int i;
+	u64 mask;
+	int err;
+
+	switch (id) {
+	case IONIC_DL_PARAM_ID_RX_COPYBREAK:
+		/* push to the live queues, as the ethtool tunable does */
+		mutex_lock(&lif->queue_lock);
+		lif->rx_copybreak = ctx->val.vu32;
+		for (i = 0; lif->rxqcqs && i < lif->nxqs; i++) {
+			if (!lif->rxqcqs[i])
+				continue;
+			lif->rxqcqs[i]->q.rx_copybreak = lif->rx_copybreak;
+			lif->rxqcqs[i]->q.rx_pkt_len_avg = 0;
+		}
+		mutex_unlock(&lif->queue_lock);
+		break;
+	case IONIC_DL_PARAM_ID_RX_FILL_THRESHOLD:
+		/* read fresh on each napi pass, nothing else to poke */
+		lif->rx_fill_threshold = ctx->val.vu32;
+		break;
+	case IONIC_DL_PARAM_ID_TX_BUDGET:
+		lif->tx_budget = ctx->val.vu32;
+		break;
+	case IONIC_DL_PARAM_ID_AFFINITY_MASK:
+		err = kstrtou64(ctx->val.vstr, 0, &mask);
+		if (err)
+			return err;
+		/* applied the next time the queue interrupts are set up */
+		lif->affinity_mask_override = mask;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+static const struct devlink_param ionic_dl_params[] = {
+	DEVLINK_PARAM_DRIVER(IONIC_DL_PARAM_ID_RX_COPYBREAK,
+			     "rx_copybreak", DEVLINK_PARAM_TYPE_U32,
+			     BIT(DEVLINK_PARAM_CMODE_RUNTIME),
+			     ionic_dl_param_get, ionic_dl_param_set, NULL),
+	DEVLINK_PARAM_DRIVER(IONIC_DL_PARAM_ID_RX_FILL_THRESHOLD,
+			     "rx_fill_threshold", DEVLINK_PARAM_TYPE_U32,
+			     BIT(DEVLINK_PARAM_CMODE_RUNTIME),
+			     ionic_dl_param_get, ionic_dl_param_set, NULL),
+	DEVLINK_PARAM_DRIVER(IONIC_DL_PARAM_ID_TX_BUDGET,
+			     "tx_budget", DEVLINK_PARAM_TYPE_U32,
+			     BIT(DEVLINK_PARAM_CMODE_RUNTIME),
+			     ionic_dl_param_get, ionic_dl_param_set, NULL),
+	DEVLINK_PARAM_DRIVER(IONIC_DL_PARAM_ID_AFFINITY_MASK,
+			     "affinity_mask_override", DEVLINK_PARAM_TYPE_STRING,
+			     BIT(DEVLINK_PARAM_CMODE_RUNTIME),
+			     ionic_dl_param_get, ionic_dl_param_set, NULL),
+};
+#endif /* HAVE_DEVLINK_PARAMS */
+
+#ifdef HAVE_DEVLINK_HEALTH
+#define IONIC_HEALTH_PROBE_INTERVAL	msecs_to_jiffies(250)
+
+/* consecutive probe passes with work outstanding but no completion
+ * progress before a tx queue is called stalled: two passes is about
+ * half a second, well ahead of the 2 second netdev tx watchdog
+ */
+#define IONIC_HEALTH_TX_STALL_PROBES	2
+
+static const struct devlink_health_reporter_ops ionic_fw_reporter_ops = {
+	.name = "fw",
+};
+
+static const struct devlink_health_reporter_ops ionic_tx_stall_reporter_ops = {
+	.name = "tx_stall",
+};
+
+static const struct devlink_health_reporter_ops ionic_adminq_reporter_ops = {
+	.name = "adminq",
+};
+
+void ionic_devlink_health_report_adminq(struct ionic_lif *lif, u8 opcode)
+{
+	struct ionic *ionic = lif->ionic;
+	char msg[64];
+
+	if (!ionic->adminq_reporter)
+		return;
+
+	snprintf(msg, sizeof(msg), "adminq command %d timed out", opcode);
+	devlink_health_report(ionic->adminq_reporter, msg, NULL);
+}
+
+static void ionic_health_probe_fw(struct ionic *ionic)
+{
+	bool fw_bad;
+
+	if (!ionic->fw_reporter)
+		return;
+
+	/* The watchdog's heartbeat check tracks the fw state; here we
+	 * just report its transitions from process context, where the
+	 * devlink health calls are allowed to sleep.
+	 */
+	fw_bad = !ionic->idev.fw_status_ready || !ionic->idev.fw_hb_ready;
+	if (fw_bad == ionic->fw_unhealthy)
+		return;
+
+	ionic->fw_unhealthy = fw_bad;
+	if (fw_bad)
+		devlink_health_report(ionic->fw_reporter,
+				      "fw heartbeat stalled", NULL);
+	else
+		devlink_health_reporter_state_update(ionic->fw_reporter,
+				DEVLINK_HEALTH_REPORTER_STATE_HEALTHY);
+}
+
+static void ionic_health_probe_txqs(struct ionic *ionic)
+{
+	struct ionic_lif *lif = ionic->lif;
+	struct ionic_qcq *qcq;
+	unsigned int i;
+	char msg[64];
+
+	if (!ionic->tx_stall_reporter)
+		return;
+
+	if (!lif || !test_bit(IONIC_LIF_F_UP, lif->state))
+		return;
+
+	/* don't stall the probe behind a queue reconfigure */
+	if (!mutex_trylock(&lif->queue_lock))
+		return;
+
+	for (i = 0; lif->txqcqs && i < lif->nxqs; i++) {
+		qcq = lif->txqcqs[i];
+		if (!qcq)
+			continue;
+
+		/* Unlocked peek at the producer/consumer indexes: a
+		 * stalled queue holds still, so a torn read at worst
+		 * delays detection by one pass.
+		 */
+		if (qcq->q.head_idx == qcq->q.tail_idx ||
+		    qcq->q.tail_idx != qcq->stall_tail) {
+			qcq->stall_tail = qcq->q.tail_idx;
+			qcq->stall_cnt = 0;
+			continue;
+		}
+
+		if (qcq->stall_cnt >= IONIC_HEALTH_TX_STALL_PROBES)
+			continue;	/* already reported this stall */
+
+		if (++qcq->stall_cnt < IONIC_HEALTH_TX_STALL_PROBES)
+			continue;
+
+		snprintf(msg, sizeof(msg),
+			 "tx queue %u stalled with work outstanding", i);
+		devlink_health_report(ionic->tx_stall_reporter, msg, NULL);
+	}
+
+	mutex_unlock(&lif->queue_lock);
+}
+
+static void ionic_health_probe(struct work_struct *work)
+{
+	struct ionic *ionic = container_of(work, struct ionic,
+					   health_probe.work);
+
+	ionic_health_probe_fw(ionic);
+	ionic_health_probe_txqs(ionic);
+
+	schedule_delayed_work(&ionic->health_probe,
+			      IONIC_HEALTH_PROBE_INTERVAL);
+}
+
+void ionic_devlink_health_register(struct ionic *ionic)
+{
+	struct devlink *dl = priv_to_devlink(ionic);
+	struct devlink_health_reporter *r;
+
+	r = devlink_health_reporter_create(dl, &ionic_fw_reporter_ops,
+					   0, ionic);
+	if (!IS_ERR(r))
+		ionic->fw_reporter = r;
+
+	r = devlink_health_reporter_create(dl, &ionic_tx_stall_reporter_ops,
+					   0, ionic);
+	if (!IS_ERR(r))
+		ionic->tx_stall_reporter = r;
+
+	r = devlink_health_reporter_create(dl, &ionic_adminq_reporter_ops,
+					   0, ionic);
+	if (!IS_ERR(r))
+		ionic->adminq_reporter = r;
+
+	INIT_DELAYED_WORK(&ionic->health_probe, ionic_health_probe);
+	schedule_delayed_work(&ionic->health_probe,
+			      IONIC_HEALTH_PROBE_INTERVAL);
+}
+
+void ionic_devlink_health_unregister(struct ionic *ionic)
+{
+	cancel_delayed_work_sync(&ionic->health_probe);
+
+	if (ionic->adminq_reporter) {
+		devlink_health_reporter_destroy(ionic->adminq_reporter);
+		ionic->adminq_reporter = NULL;
+	}
+	if (ionic->tx_stall_reporter) {
+		devlink_health_reporter_destroy(ionic->tx_stall_reporter);
+		ionic->tx_stall_reporter = NULL;
+	}
+	if (ionic->fw_reporter) {
+		devlink_health_reporter_destroy(ionic->fw_reporter);
+		ionic->fw_reporter = NULL;
+	}
+}
+#endif /* HAVE_DEVLINK_HEALTH */
+
 struct ionic *ionic_devlink_alloc(struct device *dev)
 {
 	struct devlink *dl;
@@ -114,6 +372,17 @@ int ionic_devlink_register(struct ionic *ionic)
 	struct devlink *dl = priv_to_devlink(ionic);
 	int err;
 
+#ifdef HAVE_DEVLINK_PARAMS
+	/* register ahead of devlink_register so the params publish with
+	 * the instance; a failure only loses the tuning knobs, so warn
+	 * and carry on
+	 */
+	err = devlink_params_register(dl, ionic_dl_params,
+				      ARRAY_SIZE(ionic_dl_params));
+	if (err)
+		dev_warn(ionic->dev, "devlink_params_register failed: %d\n",
+			 err);
+#endif
 #ifdef HAVE_VOID_DEVLINK_REGISTER
 	err = devlink_port_register(dl, &ionic->dl_port, 0);
 	if (err) {
@@ -139,6 +408,9 @@ int ionic_devlink_register(struct ionic *ionic)
 	}
 
 	devlink_port_type_eth_set(&ionic->dl_port, ionic->lif->netdev);
+#endif
+#ifdef HAVE_DEVLINK_HEALTH
+	ionic_devlink_health_register(ionic);
 #endif
 	return 0;
 }
@@ -147,7 +419,14 @@ void ionic_devlink_unregister(struct ionic *ionic)
 {
 	struct devlink *dl = priv_to_devlink(ionic);
 
+#ifdef HAVE_DEVLINK_HEALTH
+	ionic_devlink_health_unregister(ionic);
+#endif
 	devlink_port_unregister(&ionic->dl_port);
 	devlink_unregister(dl);
+#ifdef HAVE_DEVLINK_PARAMS
+	devlink_params_unregister(dl, ionic_dl_params,
+				  ARRAY_SIZE(ionic_dl_params));
+#endif
 }
 #endif /* IONIC_DEVLINK */
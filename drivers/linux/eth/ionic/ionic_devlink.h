@@ -22,6 +22,11 @@ struct ionic *ionic_devlink_alloc(struct device *dev);
 void ionic_devlink_free(struct ionic *ionic);
 int ionic_devlink_register(struct ionic *ionic);
 void ionic_devlink_unregister(struct ionic *ionic);
+#ifdef HAVE_DEVLINK_HEALTH
+void ionic_devlink_health_register(struct ionic *ionic);
+void ionic_devlink_health_unregister(struct ionic *ionic);
+void ionic_devlink_health_report_adminq(struct ionic_lif *lif, u8 opcode);
+#endif
 #else
 #define ionic_devlink_alloc(dev)  devm_kzalloc(dev, sizeof(struct ionic), GFP_KERNEL)
 #define ionic_devlink_free(i)     devm_kfree(i->dev, i)
@@ -30,6 +35,12 @@ void ionic_devlink_unregister(struct ionic *ionic);
 #define ionic_devlink_unregister(x)
 #endif
 
+#if !defined(IONIC_DEVLINK) || !defined(HAVE_DEVLINK_HEALTH)
+#define ionic_devlink_health_register(i)
+#define ionic_devlink_health_unregister(i)
+#define ionic_devlink_health_report_adminq(lif, opcode)
+#endif
+
 #if !IS_ENABLED(CONFIG_NET_DEVLINK)
 #define priv_to_devlink(i)  0
 #define devlink_flash_update_begin_notify(d)
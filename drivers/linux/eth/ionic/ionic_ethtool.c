@@ -21,6 +21,7 @@ enum {
 #include "ionic.h"
 #include "ionic_bus.h"
 #include "ionic_lif.h"
+#include "ionic_txrx.h"
 #include "ionic_ethtool.h"
 #include "ionic_stats.h"
 
@@ -31,8 +32,10 @@ static const char ionic_priv_flags_strings[][ETH_GSTRING_LEN] = {
 	"device-reset",
 #define IONIC_PRIV_F_CMB_RINGS		BIT(2)
 	"cmb-rings",
+#define IONIC_PRIV_F_RX_GRO_FRAGS	BIT(3)
+	"rx-gro-frags",
 
-#define IONIC_PRIV_F_SW_DBG_STATS	BIT(3)
+#define IONIC_PRIV_F_SW_DBG_STATS	BIT(4)
 #ifdef IONIC_DEBUG_STATS
 	"sw-dbg-stats",
 #endif
@@ -97,6 +100,265 @@ static int ionic_get_stats_count(struct ionic_lif *lif)
 	return num_stats;
 }
 
+/* Loopback benchmark run by the offline ethtool selftest.  The mac is
+ * put in loopback, received frames are intercepted with an rx_handler
+ * before the stack sees them, and each tx queue is driven in turn with
+ * timestamped frames to measure throughput, drops, and round-trip
+ * latency percentiles.
+ */
+#define IONIC_SELFTEST_ETHERTYPE	0x88b5	/* local experimental */
+#define IONIC_SELFTEST_MAGIC		0x494f4e43	/* "IONC" */
+#define IONIC_SELFTEST_PKTS		4096
+#define IONIC_SELFTEST_PKT_LEN		64
+#define IONIC_SELFTEST_NBUCKETS		64	/* log2 latency buckets */
+#define IONIC_SELFTEST_RESULTS		4	/* values per queue */
+#define IONIC_SELFTEST_RX_WAIT_MS	100
+#define IONIC_SELFTEST_XMIT_RETRIES	10
+
+struct ionic_selftest_pkt {
+	__be32 magic;
+	__be16 qindex;
+	__be16 seq;
+	__be64 ts;
+};
+
+struct ionic_selftest_ctx {
+	u16 qindex;
+	atomic64_t rx_pkts;
+	atomic64_t lat_hist[IONIC_SELFTEST_NBUCKETS];
+};
+
+static void ionic_get_test_strings(struct ionic_lif *lif, u8 *buf)
+{
+	unsigned int qi;
+
+	for (qi = 0; qi < lif->nxqs; qi++) {
+		snprintf(buf, ETH_GSTRING_LEN, "q%u_tx_pps", qi);
+		buf += ETH_GSTRING_LEN;
+		snprintf(buf, ETH_GSTRING_LEN, "q%u_drops", qi);
+		buf += ETH_GSTRING_LEN;
+		snprintf(buf, ETH_GSTRING_LEN, "q%u_lat_p50_ns", qi);
+		buf += ETH_GSTRING_LEN;
+		snprintf(buf, ETH_GSTRING_LEN, "q%u_lat_p99_ns", qi);
+		buf += ETH_GSTRING_LEN;
+	}
+}
+
+static rx_handler_result_t ionic_selftest_rx(struct sk_buff **pskb)
+{
+	struct sk_buff *skb = *pskb;
+	struct ionic_selftest_ctx *ctx;
+	struct ionic_selftest_pkt pkt;
+	int bucket;
+	u64 lat;
+
+	if (skb->protocol != htons(IONIC_SELFTEST_ETHERTYPE))
+		return RX_HANDLER_PASS;
+
+	ctx = rcu_dereference(skb->dev->rx_handler_data);
+
+	/* drop anything that isn't one of our frames for this queue */
+	if (skb_copy_bits(skb, 0, &pkt, sizeof(pkt)) ||
+	    pkt.magic != cpu_to_be32(IONIC_SELFTEST_MAGIC) ||
+	    be16_to_cpu(pkt.qindex) != ctx->qindex) {
+		consume_skb(skb);
+		return RX_HANDLER_CONSUMED;
+	}
+
+	lat = ktime_get_ns() - be64_to_cpu(pkt.ts);
+	bucket = fls64(lat | 1) - 1;
+	atomic64_inc(&ctx->lat_hist[bucket]);
+	atomic64_inc(&ctx->rx_pkts);
+
+	consume_skb(skb);
+	return RX_HANDLER_CONSUMED;
+}
+
+static int ionic_selftest_xmit(struct net_device *netdev, u16 qi, u16 seq)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(netdev, qi);
+	struct ionic_selftest_pkt pkt;
+	struct sk_buff *skb;
+	struct ethhdr *eth;
+	netdev_tx_t rc;
+	int tries;
+
+	skb = alloc_skb(IONIC_SELFTEST_PKT_LEN + NET_IP_ALIGN, GFP_KERNEL);
+	if (!skb)
+		return -ENOMEM;
+
+	skb_reserve(skb, NET_IP_ALIGN);
+	memset(skb_put(skb, IONIC_SELFTEST_PKT_LEN), 0, IONIC_SELFTEST_PKT_LEN);
+
+	eth = (struct ethhdr *)skb->data;
+	ether_addr_copy(eth->h_dest, netdev->dev_addr);
+	ether_addr_copy(eth->h_source, netdev->dev_addr);
+	eth->h_proto = htons(IONIC_SELFTEST_ETHERTYPE);
+
+	pkt.magic = cpu_to_be32(IONIC_SELFTEST_MAGIC);
+	pkt.qindex = cpu_to_be16(qi);
+	pkt.seq = cpu_to_be16(seq);
+
+	skb->dev = netdev;
+	skb_set_queue_mapping(skb, qi);
+
+	for (tries = 0; tries < IONIC_SELFTEST_XMIT_RETRIES; tries++) {
+		rc = NETDEV_TX_BUSY;
+
+		/* stamp just before handing the frame to the queue */
+		pkt.ts = cpu_to_be64(ktime_get_ns());
+		memcpy(skb->data + ETH_HLEN, &pkt, sizeof(pkt));
+
+		__netif_tx_lock_bh(txq);
+		if (!netif_tx_queue_stopped(txq))
+			rc = ionic_start_xmit(skb, netdev);
+		__netif_tx_unlock_bh(txq);
+
+		if (rc == NETDEV_TX_OK)
+			return 0;
+
+		usleep_range(100, 200);
+	}
+
+	kfree_skb(skb);
+	return -EBUSY;
+}
+
+static u64 ionic_selftest_pctl(struct ionic_selftest_ctx *ctx,
+			       u64 total, int pct)
+{
+	u64 target = div64_u64(total * pct, 100);
+	u64 seen = 0;
+	int i;
+
+	if (!target)
+		target = 1;
+	for (i = 0; i < IONIC_SELFTEST_NBUCKETS; i++) {
+		seen += atomic64_read(&ctx->lat_hist[i]);
+		if (seen >= target)
+			return BIT_ULL(i);
+	}
+	return 0;
+}
+
+static u64 ionic_selftest_run_queue(struct ionic_lif *lif,
+				    struct ionic_selftest_ctx *ctx,
+				    u16 qi, u64 *data)
+{
+	struct net_device *netdev = lif->netdev;
+	u64 t0, elapsed, ntx = 0, nrx;
+	int i, wait;
+
+	ctx->qindex = qi;
+	atomic64_set(&ctx->rx_pkts, 0);
+	for (i = 0; i < IONIC_SELFTEST_NBUCKETS; i++)
+		atomic64_set(&ctx->lat_hist[i], 0);
+
+	t0 = ktime_get_ns();
+	for (i = 0; i < IONIC_SELFTEST_PKTS; i++)
+		if (!ionic_selftest_xmit(netdev, qi, i))
+			ntx++;
+
+	for (wait = 0; wait < IONIC_SELFTEST_RX_WAIT_MS; wait++) {
+		if (atomic64_read(&ctx->rx_pkts) >= ntx)
+			break;
+		msleep(1);
+	}
+	elapsed = ktime_get_ns() - t0;
+	nrx = atomic64_read(&ctx->rx_pkts);
+
+	if (elapsed)
+		data[0] = div64_u64(ntx * NSEC_PER_SEC, elapsed);
+	data[1] = ntx - nrx;
+	if (nrx) {
+		data[2] = ionic_selftest_pctl(ctx, nrx, 50);
+		data[3] = ionic_selftest_pctl(ctx, nrx, 99);
+	}
+
+	netdev_dbg(netdev, "selftest q%u: tx %llu rx %llu pps %llu p50 %llu p99 %llu\n",
+		   qi, ntx, nrx, data[0], data[2], data[3]);
+
+	return nrx;
+}
+
+static void ionic_self_test(struct net_device *netdev,
+			    struct ethtool_test *etest, u64 *data)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	struct ionic *ionic = lif->ionic;
+	struct ionic_selftest_ctx *ctx;
+	unsigned int qi;
+	int err;
+
+	memset(data, 0, lif->nxqs * IONIC_SELFTEST_RESULTS * sizeof(*data));
+
+	if (!(etest->flags & ETH_TEST_FL_OFFLINE)) {
+		/* online test is just a link check */
+		if (!netif_carrier_ok(netdev))
+			etest->flags |= ETH_TEST_FL_FAILED;
+		return;
+	}
+
+	if (!netif_running(netdev) ||
+	    test_bit(IONIC_LIF_F_FW_RESET, lif->state)) {
+		etest->flags |= ETH_TEST_FL_FAILED;
+		return;
+	}
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx) {
+		etest->flags |= ETH_TEST_FL_FAILED;
+		return;
+	}
+
+	/* steal looped-back frames before the stack sees them */
+	err = netdev_rx_handler_register(netdev, ionic_selftest_rx, ctx);
+	if (err) {
+		netdev_err(netdev, "selftest: rx handler busy: %d\n", err);
+		etest->flags |= ETH_TEST_FL_FAILED;
+		kfree(ctx);
+		return;
+	}
+
+	mutex_lock(&ionic->dev_cmd_lock);
+	ionic_dev_cmd_port_loopback(&ionic->idev,
+				    IONIC_PORT_LOOPBACK_MODE_MAC);
+	err = ionic_dev_cmd_wait(ionic, devcmd_timeout);
+	mutex_unlock(&ionic->dev_cmd_lock);
+	if (err) {
+		netdev_err(netdev, "selftest: loopback enable failed: %d\n",
+			   err);
+		etest->flags |= ETH_TEST_FL_FAILED;
+		goto err_out_unregister;
+	}
+
+	/* let the mac settle into loopback */
+	msleep(50);
+
+	for (qi = 0; qi < lif->nxqs; qi++) {
+		u64 *qdata = &data[qi * IONIC_SELFTEST_RESULTS];
+
+		if (!ionic_selftest_run_queue(lif, ctx, qi, qdata))
+			etest->flags |= ETH_TEST_FL_FAILED;
+	}
+
+	mutex_lock(&ionic->dev_cmd_lock);
+	ionic_dev_cmd_port_loopback(&ionic->idev,
+				    IONIC_PORT_LOOPBACK_MODE_NONE);
+	err = ionic_dev_cmd_wait(ionic, devcmd_timeout);
+	mutex_unlock(&ionic->dev_cmd_lock);
+	if (err) {
+		netdev_err(netdev, "selftest: loopback disable failed: %d\n",
+			   err);
+		etest->flags |= ETH_TEST_FL_FAILED;
+	}
+
+err_out_unregister:
+	/* unregister synchronizes rcu before returning */
+	netdev_rx_handler_unregister(netdev);
+	kfree(ctx);
+}
+
 static int ionic_get_sset_count(struct net_device *netdev, int sset)
 {
 	struct ionic_lif *lif = netdev_priv(netdev);
@@ -109,6 +371,9 @@ static int ionic_get_sset_count(struct net_device *netdev, int sset)
 	case ETH_SS_PRIV_FLAGS:
 		count = IONIC_PRIV_FLAGS_COUNT;
 		break;
+	case ETH_SS_TEST:
+		count = lif->nxqs * IONIC_SELFTEST_RESULTS;
+		break;
 	}
 	return count;
 }
@@ -126,6 +391,9 @@ static void ionic_get_strings(struct net_device *netdev,
 		memcpy(buf, ionic_priv_flags_strings,
 		       IONIC_PRIV_FLAGS_COUNT * ETH_GSTRING_LEN);
 		break;
+	case ETH_SS_TEST:
+		ionic_get_test_strings(lif, buf);
+		break;
 	}
 }
 
@@ -653,12 +921,16 @@ static int ionic_set_coalesce(struct net_device *netdev,
 	}
 
 	if (test_bit(IONIC_LIF_F_UP, lif->state)) {
+		/* a lif-wide setting supersedes any per-queue overrides */
 		for (i = 0; i < lif->nxqs; i++) {
 			if (lif->rxqcqs[i]->flags & IONIC_QCQ_F_INTR) {
 				ionic_intr_coal_init(lif->ionic->idev.intr_ctrl,
 						     lif->rxqcqs[i]->intr.index,
 						     lif->rx_coalesce_hw);
 				lif->rxqcqs[i]->intr.dim_coal_hw = rx_dim;
+				lif->rxqcqs[i]->coal_override = false;
+				lif->rxqcqs[i]->dim_usecs_min = 0;
+				lif->rxqcqs[i]->dim_usecs_max = 0;
 			}
 
 			if (lif->txqcqs[i]->flags & IONIC_QCQ_F_INTR) {
@@ -666,6 +938,9 @@ static int ionic_set_coalesce(struct net_device *netdev,
 						     lif->txqcqs[i]->intr.index,
 						     lif->tx_coalesce_hw);
 				lif->txqcqs[i]->intr.dim_coal_hw = tx_dim;
+				lif->txqcqs[i]->coal_override = false;
+				lif->txqcqs[i]->dim_usecs_min = 0;
+				lif->txqcqs[i]->dim_usecs_max = 0;
 			}
 		}
 	}
@@ -673,6 +948,153 @@ static int ionic_set_coalesce(struct net_device *netdev,
 	return 0;
 }
 
+#ifdef ETHTOOL_PERQUEUE
+static int ionic_get_per_queue_coalesce(struct net_device *netdev, u32 q_num,
+					struct ethtool_coalesce *coalesce)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	struct ionic_qcq *qcq;
+
+	if (q_num >= lif->nxqs)
+		return -EINVAL;
+
+	/* start from the lif-wide values, then apply any overrides */
+	coalesce->rx_coalesce_usecs = lif->rx_coalesce_usecs;
+	coalesce->use_adaptive_rx_coalesce =
+		test_bit(IONIC_LIF_F_RX_DIM_INTR, lif->state);
+	coalesce->tx_coalesce_usecs = lif->tx_coalesce_usecs;
+	coalesce->use_adaptive_tx_coalesce =
+		test_bit(IONIC_LIF_F_TX_DIM_INTR, lif->state);
+
+	if (!lif->rxqcqs || !lif->rxqcqs[q_num])
+		return 0;
+
+	qcq = lif->rxqcqs[q_num];
+	if (qcq->coal_override) {
+		coalesce->rx_coalesce_usecs = qcq->coal_usecs;
+		coalesce->use_adaptive_rx_coalesce = qcq->intr.dim_coal_hw != 0;
+	}
+	coalesce->rx_coalesce_usecs_low = qcq->dim_usecs_min;
+	coalesce->rx_coalesce_usecs_high = qcq->dim_usecs_max;
+
+	if (test_bit(IONIC_LIF_F_SPLIT_INTR, lif->state) &&
+	    lif->txqcqs && lif->txqcqs[q_num]) {
+		qcq = lif->txqcqs[q_num];
+		if (qcq->coal_override) {
+			coalesce->tx_coalesce_usecs = qcq->coal_usecs;
+			coalesce->use_adaptive_tx_coalesce =
+				qcq->intr.dim_coal_hw != 0;
+		}
+		coalesce->tx_coalesce_usecs_low = qcq->dim_usecs_min;
+		coalesce->tx_coalesce_usecs_high = qcq->dim_usecs_max;
+	}
+
+	return 0;
+}
+
+static int ionic_set_per_queue_coalesce(struct net_device *netdev, u32 q_num,
+					struct ethtool_coalesce *coalesce)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	struct ionic_identity *ident;
+	u32 rx_coal, tx_coal;
+	struct ionic_qcq *qcq;
+
+	if (coalesce->rx_max_coalesced_frames ||
+	    coalesce->rx_coalesce_usecs_irq ||
+	    coalesce->rx_max_coalesced_frames_irq ||
+	    coalesce->tx_max_coalesced_frames ||
+	    coalesce->tx_coalesce_usecs_irq ||
+	    coalesce->tx_max_coalesced_frames_irq ||
+	    coalesce->stats_block_coalesce_usecs ||
+	    coalesce->pkt_rate_low ||
+	    coalesce->rx_max_coalesced_frames_low ||
+	    coalesce->tx_max_coalesced_frames_low ||
+	    coalesce->pkt_rate_high ||
+	    coalesce->rx_max_coalesced_frames_high ||
+	    coalesce->tx_max_coalesced_frames_high ||
+	    coalesce->rate_sample_interval)
+		return -EINVAL;
+
+	/* in EQ mode the queues don't own their interrupts */
+	if (lif->ionic->neth_eqs)
+		return -EINVAL;
+
+	if (q_num >= lif->nxqs)
+		return -EINVAL;
+
+	if (coalesce->rx_coalesce_usecs_high &&
+	    coalesce->rx_coalesce_usecs_high < coalesce->rx_coalesce_usecs_low)
+		return -EINVAL;
+
+	if (coalesce->tx_coalesce_usecs_high &&
+	    coalesce->tx_coalesce_usecs_high < coalesce->tx_coalesce_usecs_low)
+		return -EINVAL;
+
+	ident = &lif->ionic->ident;
+	if (ident->dev.intr_coal_div == 0) {
+		netdev_warn(netdev, "bad HW value in dev.intr_coal_div = %d\n",
+			    ident->dev.intr_coal_div);
+		return -EIO;
+	}
+
+	/* Tx normally shares Rx interrupt, so only change Rx if not split */
+	if (!test_bit(IONIC_LIF_F_SPLIT_INTR, lif->state) &&
+	    (coalesce->tx_coalesce_usecs != coalesce->rx_coalesce_usecs ||
+	     coalesce->use_adaptive_tx_coalesce ||
+	     coalesce->tx_coalesce_usecs_low ||
+	     coalesce->tx_coalesce_usecs_high)) {
+		netdev_warn(netdev, "only rx parameters can be changed\n");
+		return -EINVAL;
+	}
+
+	rx_coal = ionic_coal_usec_to_hw(lif->ionic, coalesce->rx_coalesce_usecs);
+	if (!rx_coal && coalesce->rx_coalesce_usecs)
+		rx_coal = 1;
+	tx_coal = ionic_coal_usec_to_hw(lif->ionic, coalesce->tx_coalesce_usecs);
+	if (!tx_coal && coalesce->tx_coalesce_usecs)
+		tx_coal = 1;
+
+	if (rx_coal > IONIC_INTR_CTRL_COAL_MAX ||
+	    tx_coal > IONIC_INTR_CTRL_COAL_MAX)
+		return -ERANGE;
+
+	/* the settings live in the qcq, so the queue has to be up */
+	if (!test_bit(IONIC_LIF_F_UP, lif->state) ||
+	    !lif->rxqcqs || !lif->rxqcqs[q_num])
+		return -EAGAIN;
+
+	qcq = lif->rxqcqs[q_num];
+	if (qcq->flags & IONIC_QCQ_F_INTR) {
+		qcq->coal_usecs = coalesce->rx_coalesce_usecs;
+		qcq->coal_override = true;
+		qcq->dim_usecs_min = coalesce->rx_coalesce_usecs_low;
+		qcq->dim_usecs_max = coalesce->rx_coalesce_usecs_high;
+		ionic_intr_coal_init(lif->ionic->idev.intr_ctrl,
+				     qcq->intr.index, rx_coal);
+		qcq->intr.dim_coal_hw =
+			coalesce->use_adaptive_rx_coalesce ? rx_coal : 0;
+	}
+
+	if (test_bit(IONIC_LIF_F_SPLIT_INTR, lif->state) &&
+	    lif->txqcqs && lif->txqcqs[q_num]) {
+		qcq = lif->txqcqs[q_num];
+		if (qcq->flags & IONIC_QCQ_F_INTR) {
+			qcq->coal_usecs = coalesce->tx_coalesce_usecs;
+			qcq->coal_override = true;
+			qcq->dim_usecs_min = coalesce->tx_coalesce_usecs_low;
+			qcq->dim_usecs_max = coalesce->tx_coalesce_usecs_high;
+			ionic_intr_coal_init(lif->ionic->idev.intr_ctrl,
+					     qcq->intr.index, tx_coal);
+			qcq->intr.dim_coal_hw =
+				coalesce->use_adaptive_tx_coalesce ? tx_coal : 0;
+		}
+	}
+
+	return 0;
+}
+#endif /* ETHTOOL_PERQUEUE */
+
 #ifdef HAVE_RINGPARAM_EXTACK
 static void ionic_get_ringparam(struct net_device *netdev,
 				struct ethtool_ringparam *ring,
@@ -952,6 +1374,9 @@ static u32 ionic_get_priv_flags(struct net_device *netdev)
 	if (test_bit(IONIC_LIF_F_CMB_RINGS, lif->state))
 		priv_flags |= IONIC_PRIV_F_CMB_RINGS;
 
+	if (test_bit(IONIC_LIF_F_RX_GRO_FRAGS, lif->state))
+		priv_flags |= IONIC_PRIV_F_RX_GRO_FRAGS;
+
 	return priv_flags;
 }
 
@@ -959,15 +1384,15 @@ static int ionic_set_priv_flags(struct net_device *netdev, u32 priv_flags)
 {
 	struct ionic_lif *lif = netdev_priv(netdev);
 	bool cmb_now, cmb_req;
+	unsigned int i;
 	int rdma;
+	int gro;
 	int ret;
 
 	if (priv_flags & IONIC_PRIV_F_DEVICE_RESET)
 		ionic_device_reset(lif);
 
-	clear_bit(IONIC_LIF_F_SW_DEBUG_STATS, lif->state);
-	if (priv_flags & IONIC_PRIV_F_SW_DBG_STATS)
-		set_bit(IONIC_LIF_F_SW_DEBUG_STATS, lif->state);
+	ionic_dbg_stats_enable(lif, !!(priv_flags & IONIC_PRIV_F_SW_DBG_STATS));
 
 	rdma = test_bit(IONIC_LIF_F_RDMA_SNIFFER, lif->state);
 	clear_bit(IONIC_LIF_F_RDMA_SNIFFER, lif->state);
@@ -977,6 +1402,17 @@ static int ionic_set_priv_flags(struct net_device *netdev, u32 priv_flags)
 	if (rdma != test_bit(IONIC_LIF_F_RDMA_SNIFFER, lif->state))
 		ionic_lif_rx_mode(lif);
 
+	gro = test_bit(IONIC_LIF_F_RX_GRO_FRAGS, lif->state);
+	clear_bit(IONIC_LIF_F_RX_GRO_FRAGS, lif->state);
+	if (priv_flags & IONIC_PRIV_F_RX_GRO_FRAGS)
+		set_bit(IONIC_LIF_F_RX_GRO_FRAGS, lif->state);
+
+	/* push the new rx mode out to any live queues */
+	if (gro != test_bit(IONIC_LIF_F_RX_GRO_FRAGS, lif->state))
+		for (i = 0; lif->rxqcqs && i < lif->nxqs; i++)
+			lif->rxqcqs[i]->q.rx_gro_frags =
+				test_bit(IONIC_LIF_F_RX_GRO_FRAGS, lif->state);
+
 	cmb_now = test_bit(IONIC_LIF_F_CMB_RINGS, lif->state);
 	cmb_req = !!(priv_flags & IONIC_PRIV_F_CMB_RINGS);
 	if (cmb_now != cmb_req) {
@@ -1061,6 +1497,12 @@ static int ionic_set_rxfh(struct net_device *netdev, const u32 *indir,
 		return -EOPNOTSUPP;
 #endif
 
+	/* an indir-only change is the dynamic rebalancing case, take the
+	 * incremental path and skip the device update if nothing changed
+	 */
+	if (indir && !key)
+		return ionic_lif_rss_update_indir(lif, indir);
+
 	return ionic_lif_rss_config(lif, lif->rss_types, key, indir);
 }
 
@@ -1069,10 +1511,19 @@ static int ionic_set_tunable(struct net_device *dev,
 			     const void *data)
 {
 	struct ionic_lif *lif = netdev_priv(dev);
+	unsigned int i;
 
 	switch (tuna->id) {
 	case ETHTOOL_RX_COPYBREAK:
 		lif->rx_copybreak = *(u32 *)data;
+
+		/* restart the per-queue adaptation from the new ceiling */
+		for (i = 0; lif->rxqcqs && i < lif->nxqs; i++) {
+			if (!lif->rxqcqs[i])
+				continue;
+			lif->rxqcqs[i]->q.rx_copybreak = lif->rx_copybreak;
+			lif->rxqcqs[i]->q.rx_pkt_len_avg = 0;
+		}
 		break;
 	default:
 		return -EOPNOTSUPP;
@@ -1307,6 +1758,7 @@ static int ionic_flash_device(struct net_device *netdev,
 static const struct ethtool_ops ionic_ethtool_ops = {
 #ifdef ETHTOOL_COALESCE_USECS
 	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
+				     ETHTOOL_COALESCE_USECS_LOW_HIGH |
 				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX |
 				     ETHTOOL_COALESCE_USE_ADAPTIVE_TX,
 #endif
@@ -1318,6 +1770,10 @@ static const struct ethtool_ops ionic_ethtool_ops = {
 	.set_link_ksettings	= ionic_set_link_ksettings,
 	.get_coalesce		= ionic_get_coalesce,
 	.set_coalesce		= ionic_set_coalesce,
+#ifdef ETHTOOL_PERQUEUE
+	.get_per_queue_coalesce	= ionic_get_per_queue_coalesce,
+	.set_per_queue_coalesce	= ionic_set_per_queue_coalesce,
+#endif
 	.get_ringparam		= ionic_get_ringparam,
 	.set_ringparam		= ionic_set_ringparam,
 	.get_channels		= ionic_get_channels,
@@ -1346,6 +1802,7 @@ static const struct ethtool_ops ionic_ethtool_ops = {
 	.get_ts_info		= ionic_get_ts_info,
 #endif
 	.nway_reset		= ionic_nway_reset,
+	.self_test		= ionic_self_test,
 	.flash_device	= ionic_flash_device,
 };
 
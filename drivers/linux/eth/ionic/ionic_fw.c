@@ -4,6 +4,7 @@
 #include <linux/kernel.h>
 #include <linux/types.h>
 #include <linux/errno.h>
+#include <linux/dma-mapping.h>
 
 #include "ionic.h"
 #include "ionic_dev.h"
@@ -20,6 +21,12 @@
 /* Number of periodic log updates during fw file download */
 #define IONIC_FW_INTERVAL_FRACTION	32
 
+/* Size of each host buffer in the double-buffered DMA download path;
+ * large enough to amortize the devcmd round trip, small enough that a
+ * pair of them is a cheap allocation.
+ */
+#define IONIC_FW_BUF_SZ			(256 * 1024)
+
 static void ionic_dev_cmd_firmware_download(struct ionic_dev *idev, u64 addr,
 					    u32 offset, u32 length)
 {
@@ -74,20 +81,19 @@ static void ionic_dev_cmd_firmware_activate_status(struct ionic_dev *idev)
 	ionic_dev_cmd_go(idev, &cmd);
 }
 
-int ionic_firmware_update(struct ionic_lif *lif, const struct firmware *fw)
+/* Download through the devcmd data window, one bounce-buffer copy and
+ * one devcmd round trip per window-sized chunk.
+ */
+static int ionic_firmware_download_bounce(struct ionic_lif *lif,
+					  const struct firmware *fw,
+					  struct devlink *dl)
 {
 	struct ionic_dev *idev = &lif->ionic->idev;
 	struct net_device *netdev = lif->netdev;
 	struct ionic *ionic = lif->ionic;
-	union ionic_dev_cmd_comp comp;
 	u32 buf_sz, copy_sz, offset;
-	struct devlink *dl;
 	int next_interval;
 	int err = 0;
-	u8 fw_slot;
-
-	dl = priv_to_devlink(ionic);
-	devlink_flash_update_status_notify(dl, "Preparing to flash", NULL, 0, 0);
 
 	buf_sz = sizeof(idev->dev_cmd_regs->data);
 
@@ -95,7 +101,6 @@ int ionic_firmware_update(struct ionic_lif *lif, const struct firmware *fw)
 		   "downloading firmware - size %d part_sz %d nparts %lu\n",
 		   (int)fw->size, buf_sz, DIV_ROUND_UP(fw->size, buf_sz));
 
-	devlink_flash_update_status_notify(dl, "Downloading", NULL, 0, fw->size);
 	offset = 0;
 	next_interval = fw->size / IONIC_FW_INTERVAL_FRACTION;
 	while (offset < fw->size) {
@@ -112,7 +117,7 @@ int ionic_firmware_update(struct ionic_lif *lif, const struct firmware *fw)
 				   "download failed offset 0x%x addr 0x%lx len 0x%x\n",
 				   offset, offsetof(union ionic_dev_cmd_regs, data),
 				   copy_sz);
-			goto err_out;
+			return err;
 		}
 		offset += copy_sz;
 
@@ -122,6 +127,131 @@ int ionic_firmware_update(struct ionic_lif *lif, const struct firmware *fw)
 			next_interval = offset + (fw->size / IONIC_FW_INTERVAL_FRACTION);
 		}
 	}
+
+	return 0;
+}
+
+/* Download from a pair of host DMA buffers, staging the next chunk into
+ * one buffer while the device is still pulling from the other, so the
+ * host-side copy is hidden behind the device's consumption time.
+ */
+static int ionic_firmware_download_dma(struct ionic_lif *lif,
+				       const struct firmware *fw,
+				       struct devlink *dl)
+{
+	struct ionic_dev *idev = &lif->ionic->idev;
+	struct net_device *netdev = lif->netdev;
+	struct ionic *ionic = lif->ionic;
+	u32 offset, next_offset;
+	u32 in_flight_len;
+	u32 staged_len = 0;
+	dma_addr_t buf_pa[2];
+	int next_interval;
+	unsigned int cur;
+	void *buf[2];
+	int err = 0;
+
+	buf[0] = dma_alloc_coherent(ionic->dev, IONIC_FW_BUF_SZ,
+				    &buf_pa[0], GFP_KERNEL);
+	buf[1] = dma_alloc_coherent(ionic->dev, IONIC_FW_BUF_SZ,
+				    &buf_pa[1], GFP_KERNEL);
+	if (!buf[0] || !buf[1]) {
+		err = -ENOMEM;
+		goto out_free;
+	}
+
+	netdev_dbg(netdev,
+		   "downloading firmware - size %d part_sz %d nparts %lu\n",
+		   (int)fw->size, IONIC_FW_BUF_SZ,
+		   DIV_ROUND_UP(fw->size, IONIC_FW_BUF_SZ));
+
+	/* Hold the devcmd lock across the whole pipeline so no other
+	 * command can slip in while a download is still in flight; the
+	 * install status wait below holds it far longer than this will.
+	 */
+	mutex_lock(&ionic->dev_cmd_lock);
+
+	cur = 0;
+	offset = 0;
+	next_interval = fw->size / IONIC_FW_INTERVAL_FRACTION;
+	in_flight_len = min_t(unsigned int, IONIC_FW_BUF_SZ, fw->size);
+	memcpy(buf[cur], fw->data, in_flight_len);
+	ionic_dev_cmd_firmware_download(idev, buf_pa[cur],
+					offset, in_flight_len);
+
+	while (offset < fw->size) {
+		next_offset = offset + in_flight_len;
+
+		/* stage the next chunk while the device pulls this one */
+		if (next_offset < fw->size) {
+			staged_len = min_t(unsigned int, IONIC_FW_BUF_SZ,
+					   fw->size - next_offset);
+			memcpy(buf[!cur], fw->data + next_offset, staged_len);
+		}
+
+		err = ionic_dev_cmd_wait(ionic, devcmd_timeout);
+		if (err) {
+			netdev_err(netdev,
+				   "download failed offset 0x%x addr 0x%llx len 0x%x\n",
+				   offset, (u64)buf_pa[cur], in_flight_len);
+			break;
+		}
+
+		offset = next_offset;
+		if (offset < fw->size) {
+			cur = !cur;
+			in_flight_len = staged_len;
+			ionic_dev_cmd_firmware_download(idev, buf_pa[cur],
+							offset, in_flight_len);
+		}
+
+		if (offset > next_interval && offset < fw->size) {
+			devlink_flash_update_status_notify(dl, "Downloading",
+							   NULL, offset, fw->size);
+			next_interval = offset + (fw->size / IONIC_FW_INTERVAL_FRACTION);
+		}
+	}
+
+	mutex_unlock(&ionic->dev_cmd_lock);
+
+out_free:
+	if (buf[0])
+		dma_free_coherent(ionic->dev, IONIC_FW_BUF_SZ,
+				  buf[0], buf_pa[0]);
+	if (buf[1])
+		dma_free_coherent(ionic->dev, IONIC_FW_BUF_SZ,
+				  buf[1], buf_pa[1]);
+
+	return err;
+}
+
+int ionic_firmware_update(struct ionic_lif *lif, const struct firmware *fw)
+{
+	struct ionic_dev *idev = &lif->ionic->idev;
+	struct net_device *netdev = lif->netdev;
+	struct ionic *ionic = lif->ionic;
+	union ionic_dev_cmd_comp comp;
+	struct devlink *dl;
+	int err = 0;
+	u8 fw_slot;
+
+	dl = priv_to_devlink(ionic);
+	devlink_flash_update_status_notify(dl, "Preparing to flash", NULL, 0, 0);
+
+	devlink_flash_update_status_notify(dl, "Downloading", NULL, 0, fw->size);
+
+	err = ionic_firmware_download_dma(lif, fw, dl);
+	if (err && err != -ETIMEDOUT && err != -ENXIO) {
+		/* older fw takes only devcmd-window offsets in the
+		 * download address, so push it through the window
+		 */
+		netdev_dbg(netdev, "dma download not usable (%d), using devcmd window\n",
+			   err);
+		err = ionic_firmware_download_bounce(lif, fw, dl);
+	}
+	if (err)
+		goto err_out;
+
 	devlink_flash_update_status_notify(dl, "Downloading", NULL, 1, 1);
 
 	netdev_info(netdev, "installing firmware\n");
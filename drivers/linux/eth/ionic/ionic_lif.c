@@ -7,24 +7,63 @@
 #include <linux/interrupt.h>
 #include <linux/pci.h>
 #include <linux/cpumask.h>
+#include <linux/cpu_rmap.h>
 #include <linux/crash_dump.h>
 #include <linux/vmalloc.h>
 
 #include "ionic.h"
+
+#ifdef HAVE_PAGE_POOL
+#include <net/page_pool.h>
+#endif
+#ifdef HAVE_XDP_SUPPORT
+#include <linux/bpf.h>
+#include <net/xdp.h>
+#ifdef HAVE_XSK_BUFF_POOL
+#include <net/xdp_sock_drv.h>
+#include <net/xsk_buff_pool.h>
+#endif
+#endif
 #include "ionic_bus.h"
 #include "ionic_dev.h"
 #include "ionic_lif.h"
 #include "ionic_txrx.h"
 #include "ionic_ethtool.h"
+#include "ionic_stats.h"
 #include "ionic_debugfs.h"
+#include "ionic_trace.h"
+
+DEFINE_STATIC_KEY_FALSE(ionic_dbg_stats_key);
+
+/* Toggle debug stats collection for this lif; the static key counts
+ * lifs with collection enabled so the datapath branch is patched out
+ * once the last collector goes away.  Callers serialize under rtnl.
+ */
+void ionic_dbg_stats_enable(struct ionic_lif *lif, bool enable)
+{
+	if (enable == test_bit(IONIC_LIF_F_SW_DEBUG_STATS, lif->state))
+		return;
+
+	if (enable) {
+		set_bit(IONIC_LIF_F_SW_DEBUG_STATS, lif->state);
+		static_branch_inc(&ionic_dbg_stats_key);
+	} else {
+		clear_bit(IONIC_LIF_F_SW_DEBUG_STATS, lif->state);
+		static_branch_dec(&ionic_dbg_stats_key);
+	}
+}
 
 /* queuetype support level */
 static const u8 ionic_qtype_versions[IONIC_QTYPE_MAX] = {
-	[IONIC_QTYPE_ADMINQ]  = 0,   /* 0 = Base version with CQ support */
+	[IONIC_QTYPE_ADMINQ]  = 1,   /* 0 = Base version with CQ support
+				      * 1 =       ... with compact indirect
+				      *           descriptors
+				      */
 	[IONIC_QTYPE_NOTIFYQ] = 0,   /* 0 = Base version */
-	[IONIC_QTYPE_RXQ]     = 2,   /* 0 = Base version with CQ+SG support
+	[IONIC_QTYPE_RXQ]     = 3,   /* 0 = Base version with CQ+SG support
 				      * 1 =       ... with EQ
 				      * 2 =       ... with CMB rings
+				      * 3 =       ... with batched completions
 				      */
 	[IONIC_QTYPE_TXQ]     = 3,   /* 0 = Base version with CQ+SG support
 				      * 1 =   ... with Tx SG version 1
@@ -34,6 +73,7 @@ static const u8 ionic_qtype_versions[IONIC_QTYPE_MAX] = {
 };
 
 static void ionic_link_status_check(struct ionic_lif *lif);
+static void ionic_lif_intr_credits_deinit(struct ionic_lif *lif);
 static void ionic_lif_handle_fw_down(struct ionic_lif *lif);
 static void ionic_lif_handle_fw_up(struct ionic_lif *lif);
 
@@ -45,6 +85,9 @@ static void ionic_stop_queues(struct ionic_lif *lif);
 static int ionic_stop(struct net_device *netdev);
 static void ionic_lif_queue_identify(struct ionic_lif *lif);
 static void ionic_lif_set_netdev_info(struct ionic_lif *lif);
+static int ionic_resize_qcq_pair(struct ionic_lif *lif, unsigned int i,
+				 struct ionic_qcq *tx_swap,
+				 struct ionic_qcq *rx_swap);
 
 static void ionic_dim_work(struct work_struct *work)
 {
@@ -52,10 +95,20 @@ static void ionic_dim_work(struct work_struct *work)
 	struct dim_cq_moder cur_moder;
 	struct ionic_qcq *qcq;
 	u32 new_coal;
+	u32 usecs;
 
 	cur_moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
 	qcq = container_of(dim, struct ionic_qcq, dim);
-	new_coal = ionic_coal_usec_to_hw(qcq->q.lif->ionic, cur_moder.usec);
+
+	/* constrain the profile's choice to this queue's moderation
+	 * window, if one has been set with per-queue coalesce
+	 */
+	usecs = cur_moder.usec;
+	if (qcq->dim_usecs_max)
+		usecs = clamp_t(u32, usecs, qcq->dim_usecs_min,
+				qcq->dim_usecs_max);
+
+	new_coal = ionic_coal_usec_to_hw(qcq->q.lif->ionic, usecs);
 	new_coal = new_coal ? new_coal : 1;
 
 	if (qcq->intr.dim_coal_hw != new_coal) {
@@ -72,23 +125,80 @@ static void ionic_dim_work(struct work_struct *work)
 	dim->state = DIM_START_MEASURE;
 }
 
+/* Deferred work entries come from a small per-lif preallocated pool, so
+ * the atomic-context producers (napi, timers, ndo_set_rx_mode) keep
+ * working under memory pressure; kzalloc is only a fallback for the
+ * unlikely case that the whole pool is in flight.
+ */
+struct ionic_deferred_work *ionic_lif_deferred_get(struct ionic_lif *lif)
+{
+	struct ionic_deferred *def = &lif->deferred;
+	struct ionic_deferred_work *work = NULL;
+	struct llist_node *node;
+
+	/* the lock only serializes pool consumers, as required for
+	 * llist_del_first; returns to the pool are lock-free
+	 */
+	spin_lock_bh(&def->lock);
+	node = llist_del_first(&def->free_list);
+	spin_unlock_bh(&def->lock);
+
+	if (node) {
+		work = llist_entry(node, struct ionic_deferred_work, node);
+		work->type = 0;
+		memset(work->addr, 0, sizeof(work->addr));
+	} else {
+		work = kzalloc(sizeof(*work), GFP_ATOMIC);
+	}
+
+	return work;
+}
+
+static void ionic_lif_deferred_put(struct ionic_lif *lif,
+				   struct ionic_deferred_work *work)
+{
+	if (!work->preallocated) {
+		kfree(work);
+		return;
+	}
+
+	llist_add(&work->node, &lif->deferred.free_list);
+}
+
+/* Payload-free work types can be coalesced: a second identical entry
+ * queued behind an unprocessed first would only repeat the same work.
+ */
+static bool ionic_lif_dw_coalesce(enum ionic_deferred_work_type type)
+{
+	switch (type) {
+	case IONIC_DW_TYPE_RX_MODE:
+	case IONIC_DW_TYPE_LINK_STATUS:
+	case IONIC_DW_TYPE_RSS_UPDATE:
+		return true;
+	default:
+		return false;
+	}
+}
+
 static void ionic_lif_deferred_work(struct work_struct *work)
 {
 	struct ionic_lif *lif = container_of(work, struct ionic_lif, deferred.work);
 	struct ionic_deferred *def = &lif->deferred;
-	struct ionic_deferred_work *w = NULL;
+	struct ionic_deferred_work *w, *next;
+	struct llist_node *list;
 
-	do {
-		spin_lock_bh(&def->lock);
-		if (!list_empty(&def->list)) {
-			w = list_first_entry(&def->list,
-					     struct ionic_deferred_work, list);
-			list_del(&w->list);
-		}
-		spin_unlock_bh(&def->lock);
+	/* take the whole batch in one atomic op, oldest entry first;
+	 * anything added after this reschedules the work item
+	 */
+	list = llist_del_all(&def->list);
+	list = llist_reverse_order(list);
 
-		if (!w)
-			break;
+	llist_for_each_entry_safe(w, next, list, node) {
+		/* clear before running the handler, so a request that
+		 * arrives during it gets its own fresh entry
+		 */
+		if (ionic_lif_dw_coalesce(w->type))
+			clear_bit(w->type, &def->pending);
 
 		switch (w->type) {
 		case IONIC_DW_TYPE_RX_MODE:
@@ -97,6 +207,13 @@ static void ionic_lif_deferred_work(struct work_struct *work)
 		case IONIC_DW_TYPE_LINK_STATUS:
 			ionic_link_status_check(lif);
 			break;
+#ifdef CONFIG_RFS_ACCEL
+		case IONIC_DW_TYPE_RSS_UPDATE:
+			if (test_bit(IONIC_LIF_F_UP, lif->state))
+				ionic_lif_rss_config(lif, lif->rss_types,
+						     NULL, NULL);
+			break;
+#endif
 		case IONIC_DW_TYPE_LIF_RESET:
 			if (w->fw_status) {
 				ionic_lif_handle_fw_up(lif);
@@ -113,18 +230,41 @@ static void ionic_lif_deferred_work(struct work_struct *work)
 		default:
 			break;
 		}
-		kfree(w);
-		w = NULL;
-	} while (true);
+		ionic_lif_deferred_put(lif, w);
+	}
 }
 
 void ionic_lif_deferred_enqueue(struct ionic_deferred *def,
 				struct ionic_deferred_work *work)
 {
-	spin_lock_bh(&def->lock);
-	list_add_tail(&work->list, &def->list);
-	spin_unlock_bh(&def->lock);
-	schedule_work(&def->work);
+	struct ionic_lif *lif = container_of(def, struct ionic_lif, deferred);
+	bool recovery;
+
+	/* if an identical entry is already waiting it covers this
+	 * request too, and this one can go straight back to the pool
+	 */
+	if (ionic_lif_dw_coalesce(work->type) &&
+	    test_and_set_bit(work->type, &def->pending)) {
+		ionic_lif_deferred_put(lif, work);
+		return;
+	}
+
+	/* capture the type before llist_add - once the entry is on the
+	 * list a concurrent drain may consume and free it
+	 */
+	recovery = work->type == IONIC_DW_TYPE_LIF_RESET;
+	llist_add(&work->node, &def->list);
+
+	/* If def->work is already pending on the other queue the second
+	 * queue_work is a no-op, but that pending run drains the whole
+	 * list so this entry is still covered.  Within one lif the work
+	 * stays serialized; the isolation win is across lifs - recovery
+	 * on one port no longer waits behind maintenance on another.
+	 */
+	if (recovery)
+		queue_work(ionic_recovery_wq, &def->work);
+	else
+		queue_work(lif->wq, &def->work);
 }
 
 static void ionic_link_status_check(struct ionic_lif *lif)
@@ -193,7 +333,7 @@ void ionic_link_status_check_request(struct ionic_lif *lif, bool can_sleep)
 		return;
 
 	if (!can_sleep) {
-		work = kzalloc(sizeof(*work), GFP_ATOMIC);
+		work = ionic_lif_deferred_get(lif);
 		if (!work) {
 			clear_bit(IONIC_LIF_F_LINK_CHECK_REQUESTED, lif->state);
 			return;
@@ -206,13 +346,41 @@ void ionic_link_status_check_request(struct ionic_lif *lif, bool can_sleep)
 	}
 }
 
-static void ionic_napi_deadline(struct timer_list *timer)
+static void ionic_qcq_deadline_check(struct ionic_qcq *qcq)
 {
-	struct ionic_qcq *qcq = container_of(timer, struct ionic_qcq, napi_deadline);
+	if (!qcq || !READ_ONCE(qcq->dbell_pending))
+		return;
 
+	WRITE_ONCE(qcq->dbell_pending, false);
 	napi_schedule(&qcq->napi);
 }
 
+static void ionic_napi_deadline(struct timer_list *timer)
+{
+	struct ionic_lif *lif = from_timer(lif, timer, dbell_timer);
+	unsigned int i;
+
+	ionic_qcq_deadline_check(lif->adminqcq);
+
+	/* The data queues are only safe to touch while the lif is up.
+	 * A queue flagged after we've walked past it isn't lost: the
+	 * timer isn't pending while we're in the callback, so the
+	 * flagging path re-arms it for another pass.
+	 */
+	if (!test_bit(IONIC_LIF_F_UP, lif->state))
+		return;
+
+	for (i = 0; i < lif->nxqs; i++) {
+		if (lif->txqcqs)
+			ionic_qcq_deadline_check(lif->txqcqs[i]);
+		if (lif->rxqcqs)
+			ionic_qcq_deadline_check(lif->rxqcqs[i]);
+	}
+
+	ionic_qcq_deadline_check(lif->hwstamp_txq);
+	ionic_qcq_deadline_check(lif->hwstamp_rxq);
+}
+
 static irqreturn_t ionic_napi_isr(int irq, void *data)
 {
 	struct napi_struct *napi = data;
@@ -245,14 +413,18 @@ int ionic_intr_alloc(struct ionic *ionic, struct ionic_intr_info *intr)
 {
 	int index;
 
-	index = find_first_zero_bit(ionic->intrs, ionic->nintrs);
-	if (index == ionic->nintrs) {
-		dev_warn(ionic->dev, "%s: no intr, index=%d nintrs=%d\n",
-			 __func__, index, ionic->nintrs);
-		return -ENOSPC;
-	}
+	/* qcqs can be allocated in parallel, so claim the bit atomically
+	 * and retry if somebody else got there first
+	 */
+	do {
+		index = find_first_zero_bit(ionic->intrs, ionic->nintrs);
+		if (index == ionic->nintrs) {
+			dev_warn(ionic->dev, "%s: no intr, index=%d nintrs=%d\n",
+				 __func__, index, ionic->nintrs);
+			return -ENOSPC;
+		}
+	} while (test_and_set_bit(index, ionic->intrs));
 
-	set_bit(index, ionic->intrs);
 	ionic_intr_init(&ionic->idev, intr, index);
 
 	return 0;
@@ -307,10 +479,18 @@ static int ionic_qcq_enable(struct ionic_qcq *qcq)
 				 IONIC_DBELL_QID(qcq->q.hw_index) |
 				 qcq->cq.tail_idx);
 	} else if (qcq->flags & IONIC_QCQ_F_INTR) {
-		irq_set_affinity_hint(qcq->intr.vector,
-				      &qcq->intr.affinity_mask);
-		ionic_intr_mask(idev->intr_ctrl, qcq->intr.index,
-				IONIC_INTR_MASK_CLEAR);
+		if (qcq->poll_mode) {
+			/* Interrupt-free polling: leave the interrupt masked
+			 * and kick napi once; the poller keeps itself
+			 * scheduled from then on.
+			 */
+			napi_schedule(&qcq->napi);
+		} else {
+			irq_set_affinity_hint(qcq->intr.vector,
+					      &qcq->intr.affinity_mask);
+			ionic_intr_mask(idev->intr_ctrl, qcq->intr.index,
+					IONIC_INTR_MASK_CLEAR);
+		}
 	}
 
 	return 0;
@@ -337,7 +517,7 @@ static int ionic_qcq_disable(struct ionic_lif *lif, struct ionic_qcq *qcq, int f
 
 	if (qcq->napi.poll) {
 		napi_disable(&qcq->napi);
-		del_timer_sync(&qcq->napi_deadline);
+		WRITE_ONCE(qcq->dbell_pending, false);
 	}
 
 	if (qcq->flags & IONIC_QCQ_F_INTR) {
@@ -365,6 +545,69 @@ static int ionic_qcq_disable(struct ionic_lif *lif, struct ionic_qcq *qcq, int f
 	return ionic_adminq_post_wait(lif, &ctx);
 }
 
+#ifdef HAVE_XDP_SUPPORT
+static void ionic_xdp_unregister_rxq_info(struct ionic_queue *q)
+{
+	struct xdp_rxq_info *xi;
+
+	if (!q->xdp_rxq_info)
+		return;
+
+	xi = q->xdp_rxq_info;
+	q->xdp_rxq_info = NULL;
+
+	xdp_rxq_info_unreg(xi);
+	kfree(xi);
+}
+
+static int ionic_xdp_register_rxq_info(struct ionic_queue *q,
+				       unsigned int napi_id)
+{
+	struct xdp_rxq_info *rxq_info;
+	int err;
+
+	rxq_info = kzalloc(sizeof(*rxq_info), GFP_KERNEL);
+	if (!rxq_info)
+		return -ENOMEM;
+
+#ifdef HAVE_XDP_RXQ_INFO_REG_3_PARAMS
+	err = xdp_rxq_info_reg(rxq_info, q->lif->netdev, q->index);
+#else
+	err = xdp_rxq_info_reg(rxq_info, q->lif->netdev, q->index, napi_id);
+#endif
+	if (err) {
+		dev_err(q->dev, "Queue %d xdp_rxq_info_reg failed, err %d\n",
+			q->index, err);
+		goto err_out;
+	}
+
+#ifdef HAVE_PAGE_POOL
+	if (q->page_pool)
+		err = xdp_rxq_info_reg_mem_model(rxq_info, MEM_TYPE_PAGE_POOL,
+						 q->page_pool);
+	else
+		err = xdp_rxq_info_reg_mem_model(rxq_info, MEM_TYPE_PAGE_ORDER0,
+						 NULL);
+#else
+	err = xdp_rxq_info_reg_mem_model(rxq_info, MEM_TYPE_PAGE_ORDER0, NULL);
+#endif
+	if (err) {
+		dev_err(q->dev, "Queue %d xdp_rxq_info_reg_mem_model failed, err %d\n",
+			q->index, err);
+		xdp_rxq_info_unreg(rxq_info);
+		goto err_out;
+	}
+
+	q->xdp_rxq_info = rxq_info;
+
+	return 0;
+
+err_out:
+	kfree(rxq_info);
+	return err;
+}
+#endif /* HAVE_XDP_SUPPORT */
+
 static void ionic_lif_qcq_deinit(struct ionic_lif *lif, struct ionic_qcq *qcq)
 {
 	struct ionic_dev *idev = &lif->ionic->idev;
@@ -372,6 +615,10 @@ static void ionic_lif_qcq_deinit(struct ionic_lif *lif, struct ionic_qcq *qcq)
 	if (!qcq)
 		return;
 
+#ifdef HAVE_XDP_SUPPORT
+	ionic_xdp_unregister_rxq_info(&qcq->q);
+#endif
+
 	if (!(qcq->flags & IONIC_QCQ_F_INITED))
 		return;
 
@@ -432,6 +679,13 @@ static void ionic_qcq_free(struct ionic_lif *lif, struct ionic_qcq *qcq)
 		qcq->sg_base_pa = 0;
 	}
 
+	if (qcq->q.dbell_shadow) {
+		dma_free_coherent(dev, sizeof(*qcq->q.dbell_shadow),
+				  qcq->q.dbell_shadow, qcq->q.dbell_shadow_pa);
+		qcq->q.dbell_shadow = NULL;
+		qcq->q.dbell_shadow_pa = 0;
+	}
+
 	ionic_qcq_intr_free(lif, qcq);
 
 	if (qcq->cq.info) {
@@ -442,6 +696,17 @@ static void ionic_qcq_free(struct ionic_lif *lif, struct ionic_qcq *qcq)
 		vfree(qcq->q.info);
 		qcq->q.info = NULL;
 	}
+	if (qcq->q.tx_sgl) {
+		vfree(qcq->q.tx_sgl);
+		qcq->q.tx_sgl = NULL;
+	}
+
+#ifdef HAVE_PAGE_POOL
+	if (qcq->q.page_pool) {
+		page_pool_destroy(qcq->q.page_pool);
+		qcq->q.page_pool = NULL;
+	}
+#endif
 }
 
 static void ionic_qcqs_free(struct ionic_lif *lif)
@@ -467,6 +732,12 @@ static void ionic_qcqs_free(struct ionic_lif *lif)
 		}
 	}
 
+	if (lif->adminq_cmds) {
+		dma_free_coherent(dev, lif->adminq_cmds_sz,
+				  lif->adminq_cmds, lif->adminq_cmds_pa);
+		lif->adminq_cmds = NULL;
+	}
+
 	if (lif->rxqcqs) {
 		devm_kfree(dev, lif->rxqstats);
 		lif->rxqstats = NULL;
@@ -528,13 +799,13 @@ static int ionic_alloc_qcq_interrupt(struct ionic_lif *lif, struct ionic_qcq *qc
 		goto err_out_free_intr;
 	}
 
-	if (affinity_mask_override) {
+	if (lif->affinity_mask_override) {
 		cpumask_copy(&qcq->intr.affinity_mask, cpu_none_mask);
 
-		netdev_dbg(lif->netdev, "%s: setting irq affinity_mask 0x%lx\n",
-				qcq->q.name, affinity_mask_override);
+		netdev_dbg(lif->netdev, "%s: setting irq affinity_mask 0x%llx\n",
+				qcq->q.name, lif->affinity_mask_override);
 		for (cpu = 0; cpu < num_present_cpus(); cpu++) {
-			if (BIT(cpu) & affinity_mask_override)
+			if (BIT_ULL(cpu) & lif->affinity_mask_override)
 				cpumask_set_cpu(cpu, &qcq->intr.affinity_mask);
 		}
 
@@ -560,6 +831,28 @@ err_out:
 	return err;
 }
 
+static void *ionic_dma_alloc_node(struct ionic *ionic, int node, size_t size,
+				  dma_addr_t *pa)
+{
+	struct device *dev = ionic->dev;
+	int orig_node;
+	void *va;
+
+	/* dma_alloc_coherent() places memory on the device's node; nudge
+	 * it toward the queue's node for the duration of the call.  The
+	 * device node is shared state and the qcq alloc workers run in
+	 * parallel, so serialize the override.
+	 */
+	mutex_lock(&ionic->dev_node_lock);
+	orig_node = dev_to_node(dev);
+	set_dev_node(dev, node);
+	va = dma_alloc_coherent(dev, size, pa, GFP_KERNEL);
+	set_dev_node(dev, orig_node);
+	mutex_unlock(&ionic->dev_node_lock);
+
+	return va;
+}
+
 static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 			   unsigned int index,
 			   const char *name, unsigned int flags,
@@ -576,6 +869,7 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 	dma_addr_t q_base_pa = 0;
 	struct ionic_qcq *new;
 	int err;
+	int cpu;
 
 	*qcq = NULL;
 
@@ -589,13 +883,6 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 	new->q.dev = dev;
 	new->flags = flags;
 
-	new->q.info = vzalloc(num_descs * sizeof(*new->q.info));
-	if (!new->q.info) {
-		netdev_err(lif->netdev, "Cannot allocate queue info\n");
-		err = -ENOMEM;
-		goto err_out_free_qcq;
-	}
-
 	new->q.type = type;
 	new->q.max_sg_elems = lif->qtype_info[type].max_sg_elems;
 
@@ -603,18 +890,63 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 			   desc_size, sg_desc_size, pid);
 	if (err) {
 		netdev_err(lif->netdev, "Cannot initialize queue\n");
-		goto err_out_free_q_info;
+		goto err_out_free_qcq;
+	}
+
+	if (lif->qtype_info[type].features & IONIC_QIDENT_F_DBSHADOW) {
+		new->q.dbell_shadow =
+			dma_alloc_coherent(dev, sizeof(*new->q.dbell_shadow),
+					   &new->q.dbell_shadow_pa, GFP_KERNEL);
+		if (!new->q.dbell_shadow) {
+			netdev_err(lif->netdev, "Cannot allocate doorbell shadow\n");
+			err = -ENOMEM;
+			goto err_out_free_qcq;
+		}
 	}
 
 	err = ionic_alloc_qcq_interrupt(lif, new);
 	if (err)
-		goto err_out;
+		goto err_out_free_qcq;
+
+	/* Land the rings and info arrays on the node of the CPU that
+	 * will poll this queue, now that the irq affinity is known.
+	 * Queues without their own interrupt stay on the device's node.
+	 */
+	cpu = cpumask_first(&new->intr.affinity_mask);
+	if ((flags & IONIC_QCQ_F_INTR) && cpu < nr_cpu_ids)
+		new->node = cpu_to_node(cpu);
+	else
+		new->node = dev_to_node(dev);
+
+	new->q.info = vzalloc_node(num_descs * sizeof(*new->q.info),
+				   new->node);
+	if (!new->q.info) {
+		netdev_err(lif->netdev, "Cannot allocate queue info\n");
+		err = -ENOMEM;
+		goto err_out_free_irq;
+	}
+
+#ifdef HAVE_DEVICE_IOMMU_MAPPED
+	/* With an iommu translating dma, tx buffers are mapped through
+	 * a per-skb scatterlist so the frags share one IOVA allocation.
+	 * Without the array we just fall back to buf-by-buf mapping.
+	 */
+	if (type == IONIC_QTYPE_TXQ && device_iommu_mapped(dev)) {
+		new->q.tx_sgl = vzalloc_node(num_descs * IONIC_MAX_FRAGS *
+					     sizeof(*new->q.tx_sgl),
+					     new->node);
+		if (!new->q.tx_sgl)
+			netdev_warn(lif->netdev, "No tx sgl array, unbatched dma mapping on %s\n",
+				    name);
+	}
+#endif
 
-	new->cq.info = vzalloc(num_descs * sizeof(*new->cq.info));
+	new->cq.info = vzalloc_node(num_descs * sizeof(*new->cq.info),
+				    new->node);
 	if (!new->cq.info) {
 		netdev_err(lif->netdev, "Cannot allocate completion queue info\n");
 		err = -ENOMEM;
-		goto err_out_free_irq;
+		goto err_out_free_q_info;
 	}
 
 	err = ionic_cq_init(lif, &new->cq, &new->intr, num_descs, cq_desc_size);
@@ -627,8 +959,9 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 		/* q & cq need to be contiguous in case of notifyq */
 		new->q_size = PAGE_SIZE + ALIGN(num_descs * desc_size, PAGE_SIZE) +
 						ALIGN(num_descs * cq_desc_size, PAGE_SIZE);
-		new->q_base = dma_alloc_coherent(dev, new->q_size + new->cq_size,
-						&new->q_base_pa, GFP_KERNEL);
+		new->q_base = ionic_dma_alloc_node(lif->ionic, new->node,
+						   new->q_size + new->cq_size,
+						   &new->q_base_pa);
 		if (!new->q_base) {
 			netdev_err(lif->netdev, "Cannot allocate qcq DMA memory\n");
 			err = -ENOMEM;
@@ -647,8 +980,8 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 	} else {
 		/* regular DMA q descriptors */
 		new->q_size = PAGE_SIZE + (num_descs * desc_size);
-		new->q_base = dma_alloc_coherent(dev, new->q_size, &new->q_base_pa,
-						 GFP_KERNEL);
+		new->q_base = ionic_dma_alloc_node(lif->ionic, new->node,
+						   new->q_size, &new->q_base_pa);
 		if (!new->q_base) {
 			netdev_err(lif->netdev, "Cannot allocate queue DMA memory\n");
 			err = -ENOMEM;
@@ -686,8 +1019,9 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 
 		/* cq DMA descriptors */
 		new->cq_size = PAGE_SIZE + (num_descs * cq_desc_size);
-		new->cq_base = dma_alloc_coherent(dev, new->cq_size, &new->cq_base_pa,
-						  GFP_KERNEL);
+		new->cq_base = ionic_dma_alloc_node(lif->ionic, new->node,
+						    new->cq_size,
+						    &new->cq_base_pa);
 		if (!new->cq_base) {
 			netdev_err(lif->netdev, "Cannot allocate cq DMA memory\n");
 			err = -ENOMEM;
@@ -701,8 +1035,9 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 
 	if (flags & IONIC_QCQ_F_SG) {
 		new->sg_size = PAGE_SIZE + (num_descs * sg_desc_size);
-		new->sg_base = dma_alloc_coherent(dev, new->sg_size, &new->sg_base_pa,
-						  GFP_KERNEL);
+		new->sg_base = ionic_dma_alloc_node(lif->ionic, new->node,
+						    new->sg_size,
+						    &new->sg_base_pa);
 		if (!new->sg_base) {
 			netdev_err(lif->netdev, "Cannot allocate sg DMA memory\n");
 			err = -ENOMEM;
@@ -713,6 +1048,29 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 		ionic_q_sg_map(&new->q, sg_base, sg_base_pa);
 	}
 
+#ifdef HAVE_PAGE_POOL
+	if (type == IONIC_QTYPE_RXQ) {
+		struct page_pool_params pp_params = {
+			.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+			.order = IONIC_PAGE_ORDER,
+			.pool_size = num_descs,
+			.nid = new->node,
+			.dev = dev,
+			/* XDP_TX transmits straight out of the rx buffers */
+			.dma_dir = DMA_BIDIRECTIONAL,
+			.max_len = IONIC_PAGE_SIZE,
+		};
+
+		new->q.page_pool = page_pool_create(&pp_params);
+		if (IS_ERR(new->q.page_pool)) {
+			netdev_err(lif->netdev, "Cannot create page_pool\n");
+			err = PTR_ERR(new->q.page_pool);
+			new->q.page_pool = NULL;
+			goto err_out_free_sg;
+		}
+	}
+#endif
+
 	INIT_WORK(&new->dim.work, ionic_dim_work);
 	new->dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
 
@@ -720,6 +1078,11 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 
 	return 0;
 
+#ifdef HAVE_PAGE_POOL
+err_out_free_sg:
+	if (new->sg_base)
+		dma_free_coherent(dev, new->sg_size, new->sg_base, new->sg_base_pa);
+#endif
 err_out_free_cq:
 	dma_free_coherent(dev, new->cq_size, new->cq_base, new->cq_base_pa);
 err_out_free_q:
@@ -730,34 +1093,142 @@ err_out_free_q:
 	dma_free_coherent(dev, new->q_size, new->q_base, new->q_base_pa);
 err_out_free_cq_info:
 	vfree(new->cq.info);
+err_out_free_q_info:
+	vfree(new->q.tx_sgl);
+	vfree(new->q.info);
 err_out_free_irq:
 	if (flags & IONIC_QCQ_F_INTR) {
 		devm_free_irq(dev, new->intr.vector, &new->napi);
 		ionic_intr_free(lif->ionic, new->intr.index);
 	}
-err_out_free_q_info:
-	vfree(new->q.info);
 err_out_free_qcq:
+	if (new->q.dbell_shadow)
+		dma_free_coherent(dev, sizeof(*new->q.dbell_shadow),
+				  new->q.dbell_shadow, new->q.dbell_shadow_pa);
 	devm_kfree(dev, new);
 err_out:
 	dev_err(dev, "qcq alloc of %s%d failed %d\n", name, index, err);
 	return err;
 }
 
+struct ionic_qcq_alloc_work {
+	struct work_struct work;
+	struct ionic_lif *lif;
+	unsigned int type;
+	unsigned int index;
+	const char *name;
+	unsigned int flags;
+	unsigned int num_descs;
+	unsigned int desc_sz;
+	unsigned int comp_sz;
+	unsigned int sg_desc_sz;
+	struct ionic_qcq **pqcq;
+	int err;
+};
+
+static void ionic_qcq_alloc_worker(struct work_struct *work)
+{
+	struct ionic_qcq_alloc_work *w =
+		container_of(work, struct ionic_qcq_alloc_work, work);
+
+	w->err = ionic_qcq_alloc(w->lif, w->type, w->index, w->name, w->flags,
+				 w->num_descs, w->desc_sz, w->comp_sz,
+				 w->sg_desc_sz, w->lif->kern_pid, w->pqcq);
+}
+
+/* Allocate a lif's worth of queues of one type, fanning the work out
+ * across the unbound workqueue so the descriptor ring and info array
+ * allocations for a large queue set proceed on several cores at once
+ * instead of serializing on one.
+ */
+static int ionic_qcqs_alloc_parallel(struct ionic_lif *lif, unsigned int type,
+				     unsigned int index_base, const char *name,
+				     unsigned int flags, unsigned int num_descs,
+				     unsigned int desc_sz, unsigned int comp_sz,
+				     unsigned int sg_desc_sz,
+				     struct ionic_qcq **qcqs)
+{
+	struct ionic_qcq_alloc_work *works;
+	unsigned int i;
+	int err = 0;
+
+	works = kcalloc(lif->nxqs, sizeof(*works), GFP_KERNEL);
+	if (!works) {
+		/* no memory for the fanout, just allocate in line */
+		for (i = 0; i < lif->nxqs; i++) {
+			err = ionic_qcq_alloc(lif, type, index_base + i, name,
+					      flags, num_descs, desc_sz,
+					      comp_sz, sg_desc_sz,
+					      lif->kern_pid, &qcqs[i]);
+			if (err)
+				return err;
+		}
+		return 0;
+	}
+
+	for (i = 0; i < lif->nxqs; i++) {
+		struct ionic_qcq_alloc_work *w = &works[i];
+
+		w->lif = lif;
+		w->type = type;
+		w->index = index_base + i;
+		w->name = name;
+		w->flags = flags;
+		w->num_descs = num_descs;
+		w->desc_sz = desc_sz;
+		w->comp_sz = comp_sz;
+		w->sg_desc_sz = sg_desc_sz;
+		w->pqcq = &qcqs[i];
+
+		INIT_WORK(&w->work, ionic_qcq_alloc_worker);
+		queue_work(system_unbound_wq, &w->work);
+	}
+
+	/* any failures leave their qcq pointer NULL for the caller's
+	 * cleanup to skip over
+	 */
+	for (i = 0; i < lif->nxqs; i++) {
+		flush_work(&works[i].work);
+		if (works[i].err && !err)
+			err = works[i].err;
+	}
+
+	kfree(works);
+
+	return err;
+}
+
 static int ionic_qcqs_alloc(struct ionic_lif *lif)
 {
 	struct device *dev = lif->ionic->dev;
-	unsigned int flags;
+	unsigned int flags, desc_sz;
 	int err;
 
+	/* An AdminQ at queue version 1 uses compact descriptors that
+	 * reference the full command in host memory, so give it a
+	 * command body buffer per descriptor slot.
+	 */
+	desc_sz = sizeof(struct ionic_admin_cmd);
+	if (lif->qtype_info[IONIC_QTYPE_ADMINQ].version >= 1 &&
+	    lif->qtype_info[IONIC_QTYPE_ADMINQ].desc_sz ==
+				sizeof(struct ionic_admin_indir_cmd)) {
+		lif->adminq_cmds_sz = IONIC_ADMINQ_LENGTH *
+				      sizeof(union ionic_adminq_cmd);
+		lif->adminq_cmds = dma_alloc_coherent(dev, lif->adminq_cmds_sz,
+						      &lif->adminq_cmds_pa,
+						      GFP_KERNEL);
+		if (!lif->adminq_cmds)
+			return -ENOMEM;
+		desc_sz = sizeof(struct ionic_admin_indir_cmd);
+	}
+
 	flags = IONIC_QCQ_F_INTR;
 	err = ionic_qcq_alloc(lif, IONIC_QTYPE_ADMINQ, 0, "admin", flags,
-			      IONIC_ADMINQ_LENGTH,
-			      sizeof(struct ionic_admin_cmd),
+			      IONIC_ADMINQ_LENGTH, desc_sz,
 			      sizeof(struct ionic_admin_comp),
 			      0, lif->kern_pid, &lif->adminqcq);
 	if (err)
-		return err;
+		goto err_out;
 	ionic_debugfs_add_qcq(lif, lif->adminqcq);
 
 	if (lif->ionic->nnqs_per_lif) {
@@ -801,95 +1272,194 @@ err_out:
 	return err;
 }
 
-static inline int ionic_choose_eq(struct ionic_lif *lif, int q_index)
+#ifdef HAVE_XDP_SUPPORT
+static void ionic_xdp_queues_free(struct ionic_lif *lif)
 {
-	unsigned int abs_q;
+	unsigned int i;
 
-	if (lif->index)
-		abs_q = (lif->ionic->nrxqs_per_lif + lif->index);
-	else
-		abs_q = q_index;
+	if (!lif->xdpqcqs)
+		return;
+
+	for (i = 0; i < lif->nxqs && lif->xdpqcqs[i]; i++) {
+		ionic_qcq_free(lif, lif->xdpqcqs[i]);
+		devm_kfree(lif->ionic->dev, lif->xdpqcqs[i]);
+		lif->xdpqcqs[i] = NULL;
+	}
 
-	return abs_q % lif->ionic->neth_eqs;
+	devm_kfree(lif->ionic->dev, lif->xdpqcqs);
+	lif->xdpqcqs = NULL;
 }
 
-static void ionic_qcq_sanitize(struct ionic_qcq *qcq)
+static int ionic_xdp_queues_alloc(struct ionic_lif *lif)
 {
-	qcq->q.tail_idx = 0;
-	qcq->q.head_idx = 0;
-	qcq->cq.tail_idx = 0;
-	qcq->cq.done_color = 1;
+	unsigned int comp_sz, desc_sz, num_desc, sg_desc_sz;
+	unsigned int flags, i;
+	int err = 0;
 
-	memset(qcq->q_base, 0, qcq->q_size);
-	if (qcq->cmb_q_base)
-		memset_io(qcq->cmb_q_base, 0, qcq->cmb_q_size);
-	memset(qcq->cq_base, 0, qcq->cq_size);
-	memset(qcq->sg_base, 0, qcq->sg_size);
+	if (!lif->xdp_prog)
+		return 0;
+
+	lif->xdpqcqs = devm_kcalloc(lif->ionic->dev, lif->nxqs,
+				    sizeof(*lif->xdpqcqs), GFP_KERNEL);
+	if (!lif->xdpqcqs)
+		return -ENOMEM;
+
+	num_desc = lif->ntxq_descs;
+	desc_sz = sizeof(struct ionic_txq_desc);
+	comp_sz = sizeof(struct ionic_txq_comp);
+	sg_desc_sz = sizeof(struct ionic_txq_sg_desc);
+
+	/* The XDP TX queues live in the upper half of the lif's tx queue
+	 * space, beyond the queues used for the stack, and take their
+	 * completions in the paired rx queue's napi context, so they
+	 * don't get their own interrupt.
+	 */
+	flags = IONIC_QCQ_F_TX_STATS | IONIC_QCQ_F_SG;
+	err = ionic_qcqs_alloc_parallel(lif, IONIC_QTYPE_TXQ, lif->nxqs,
+					"xdptx", flags, num_desc, desc_sz,
+					comp_sz, sg_desc_sz, lif->xdpqcqs);
+	if (err)
+		goto err_out;
+
+	for (i = 0; i < lif->nxqs; i++)
+		ionic_debugfs_add_qcq(lif, lif->xdpqcqs[i]);
+
+	return 0;
+
+err_out:
+	ionic_xdp_queues_free(lif);
+	return err;
 }
+#endif /* HAVE_XDP_SUPPORT */
 
-static int ionic_lif_txq_init(struct ionic_lif *lif, struct ionic_qcq *qcq)
+static inline int ionic_choose_eq(struct ionic_lif *lif, int q_index)
+{
+	struct ionic *ionic = lif->ionic;
+	unsigned int abs_q;
+	unsigned int neq;
+	int node;
+	int i;
+
+	if (lif->index)
+		abs_q = (ionic->nrxqs_per_lif + lif->index);
+	else
+		abs_q = q_index;
+
+	/* The EQ rings and irqs are spread across the numa nodes, and the
+	 * queue would be serviced from the node that local_spread assigns
+	 * its index, so prefer an EQ from that node and spread the queues
+	 * across those EQs; if the node has none, fall back to spreading
+	 * across all of them.
+	 */
+	node = cpu_to_node(cpumask_local_spread(abs_q, dev_to_node(ionic->dev)));
+
+	neq = 0;
+	for (i = 0; i < ionic->neth_eqs; i++)
+		if (ionic->eqs[i] && ionic->eqs[i]->node == node)
+			neq++;
+
+	if (neq) {
+		unsigned int n = abs_q % neq;
+
+		for (i = 0; i < ionic->neth_eqs; i++) {
+			if (!ionic->eqs[i] || ionic->eqs[i]->node != node)
+				continue;
+			if (!n--)
+				return i;
+		}
+	}
+
+	return abs_q % ionic->neth_eqs;
+}
+
+static void ionic_qcq_sanitize(struct ionic_qcq *qcq)
+{
+	qcq->q.tail_idx = 0;
+	qcq->q.head_idx = 0;
+	qcq->cq.tail_idx = 0;
+	qcq->cq.done_color = 1;
+	qcq->cred_defer = 0;
+
+	memset(qcq->q_base, 0, qcq->q_size);
+	if (qcq->cmb_q_base)
+		memset_io(qcq->cmb_q_base, 0, qcq->cmb_q_size);
+	memset(qcq->cq_base, 0, qcq->cq_size);
+	memset(qcq->sg_base, 0, qcq->sg_size);
+}
+
+static void ionic_lif_txq_init_cmd(struct ionic_lif *lif,
+				   struct ionic_qcq *qcq,
+				   struct ionic_admin_ctx *ctx)
 {
 	struct device *dev = lif->ionic->dev;
 	struct ionic_queue *q = &qcq->q;
 	struct ionic_cq *cq = &qcq->cq;
-	struct ionic_admin_ctx ctx = {
-		.work = COMPLETION_INITIALIZER_ONSTACK(ctx.work),
-		.cmd.q_init = {
-			.opcode = IONIC_CMD_Q_INIT,
-			.lif_index = cpu_to_le16(lif->index),
-			.type = q->type,
-			.ver = lif->qtype_info[q->type].version,
-			.index = cpu_to_le32(q->index),
-			.pid = cpu_to_le16(q->pid),
-			.ring_size = ilog2(q->num_descs),
-			.ring_base = cpu_to_le64(q->base_pa),
-			.cq_ring_base = cpu_to_le64(cq->base_pa),
-			.sg_ring_base = cpu_to_le64(q->sg_base_pa),
-			.features = cpu_to_le64(q->features),
-		},
+
+	memset(ctx, 0, sizeof(*ctx));
+	init_completion(&ctx->work);
+	ctx->cmd.q_init = (struct ionic_q_init_cmd) {
+		.opcode = IONIC_CMD_Q_INIT,
+		.lif_index = cpu_to_le16(lif->index),
+		.type = q->type,
+		.ver = lif->qtype_info[q->type].version,
+		.index = cpu_to_le32(q->index),
+		.pid = cpu_to_le16(q->pid),
+		.ring_size = ilog2(q->num_descs),
+		.ring_base = cpu_to_le64(q->base_pa),
+		.cq_ring_base = cpu_to_le64(cq->base_pa),
+		.sg_ring_base = cpu_to_le64(q->sg_base_pa),
+		.features = cpu_to_le64(q->features),
 	};
-	int err;
 
 	if (lif->ionic->neth_eqs &&
 	    lif->qtype_info[q->type].features & IONIC_QIDENT_F_EQ) {
 		unsigned int eq_index = ionic_choose_eq(lif, q->index);
 
-		ctx.cmd.q_init.flags = cpu_to_le16(IONIC_QINIT_F_EQ |
-						   IONIC_QINIT_F_SG);
-		ctx.cmd.q_init.intr_index = cpu_to_le16(eq_index);
+		ctx->cmd.q_init.flags = cpu_to_le16(IONIC_QINIT_F_EQ |
+						    IONIC_QINIT_F_SG);
+		ctx->cmd.q_init.intr_index = cpu_to_le16(eq_index);
 	} else {
 		unsigned int intr_index;
 
 		intr_index = qcq->intr.index;
 
-		ctx.cmd.q_init.flags = cpu_to_le16(IONIC_QINIT_F_IRQ |
-						   IONIC_QINIT_F_SG);
-		ctx.cmd.q_init.intr_index = cpu_to_le16(intr_index);
+		ctx->cmd.q_init.flags = cpu_to_le16(IONIC_QINIT_F_IRQ |
+						    IONIC_QINIT_F_SG);
+		ctx->cmd.q_init.intr_index = cpu_to_le16(intr_index);
 	}
 
 	if (qcq->flags & IONIC_QCQ_F_CMB_RINGS) {
-		ctx.cmd.q_init.flags |= cpu_to_le16(IONIC_QINIT_F_CMB);
-		ctx.cmd.q_init.ring_base = cpu_to_le64(qcq->cmb_q_base_pa);
+		ctx->cmd.q_init.flags |= cpu_to_le16(IONIC_QINIT_F_CMB);
+		ctx->cmd.q_init.ring_base = cpu_to_le64(qcq->cmb_q_base_pa);
+	}
+
+	if (q->dbell_shadow) {
+		ctx->cmd.q_init.flags |= cpu_to_le16(IONIC_QINIT_F_DBSHADOW);
+		ctx->cmd.q_init.db_shadow_base = cpu_to_le64(q->dbell_shadow_pa);
 	}
 
-	dev_dbg(dev, "txq_init.pid %d\n", ctx.cmd.q_init.pid);
-	dev_dbg(dev, "txq_init.index %d\n", ctx.cmd.q_init.index);
-	dev_dbg(dev, "txq_init.ring_base 0x%llx\n", ctx.cmd.q_init.ring_base);
-	dev_dbg(dev, "txq_init.ring_size %d\n", ctx.cmd.q_init.ring_size);
-	dev_dbg(dev, "txq_init.cq_ring_base 0x%llx\n", ctx.cmd.q_init.cq_ring_base);
-	dev_dbg(dev, "txq_init.sg_ring_base 0x%llx\n", ctx.cmd.q_init.sg_ring_base);
-	dev_dbg(dev, "txq_init.flags 0x%x\n", ctx.cmd.q_init.flags);
-	dev_dbg(dev, "txq_init.ver %d\n", ctx.cmd.q_init.ver);
-	dev_dbg(dev, "txq_init.intr_index %d\n", ctx.cmd.q_init.intr_index);
+	dev_dbg(dev, "txq_init.pid %d\n", ctx->cmd.q_init.pid);
+	dev_dbg(dev, "txq_init.index %d\n", ctx->cmd.q_init.index);
+	dev_dbg(dev, "txq_init.ring_base 0x%llx\n", ctx->cmd.q_init.ring_base);
+	dev_dbg(dev, "txq_init.ring_size %d\n", ctx->cmd.q_init.ring_size);
+	dev_dbg(dev, "txq_init.cq_ring_base 0x%llx\n", ctx->cmd.q_init.cq_ring_base);
+	dev_dbg(dev, "txq_init.sg_ring_base 0x%llx\n", ctx->cmd.q_init.sg_ring_base);
+	dev_dbg(dev, "txq_init.flags 0x%x\n", ctx->cmd.q_init.flags);
+	dev_dbg(dev, "txq_init.ver %d\n", ctx->cmd.q_init.ver);
+	dev_dbg(dev, "txq_init.intr_index %d\n", ctx->cmd.q_init.intr_index);
 
 	ionic_qcq_sanitize(qcq);
+}
 
-	err = ionic_adminq_post_wait(lif, &ctx);
-	if (err)
-		return err;
+static void ionic_lif_txq_init_finish(struct ionic_lif *lif,
+				      struct ionic_qcq *qcq,
+				      struct ionic_admin_ctx *ctx)
+{
+	struct device *dev = lif->ionic->dev;
+	struct ionic_queue *q = &qcq->q;
 
-	q->hw_type = ctx.comp.q_init.hw_type;
-	q->hw_index = le32_to_cpu(ctx.comp.q_init.hw_index);
+	q->hw_type = ctx->comp.q_init.hw_type;
+	q->hw_index = le32_to_cpu(ctx->comp.q_init.hw_index);
 	q->dbval = IONIC_DBELL_QID(q->hw_index);
 
 	dev_dbg(dev, "txq->hw_type %d\n", q->hw_type);
@@ -901,73 +1471,99 @@ static int ionic_lif_txq_init(struct ionic_lif *lif, struct ionic_qcq *qcq)
 	if (test_bit(IONIC_LIF_F_SPLIT_INTR, lif->state)) {
 		netif_napi_add(lif->netdev, &qcq->napi, ionic_tx_napi);
 		qcq->napi_qcq = qcq;
-		timer_setup(&qcq->napi_deadline, ionic_napi_deadline, 0);
 	}
 
 	qcq->flags |= IONIC_QCQ_F_INITED;
+}
+
+static int ionic_lif_txq_init(struct ionic_lif *lif, struct ionic_qcq *qcq)
+{
+	struct ionic_admin_ctx ctx;
+	int err;
+
+	ionic_lif_txq_init_cmd(lif, qcq, &ctx);
+
+	err = ionic_adminq_post_wait(lif, &ctx);
+	if (err)
+		return err;
+
+	ionic_lif_txq_init_finish(lif, qcq, &ctx);
 
 	return 0;
 }
 
-static int ionic_lif_rxq_init(struct ionic_lif *lif, struct ionic_qcq *qcq)
+static void ionic_lif_rxq_init_cmd(struct ionic_lif *lif,
+				   struct ionic_qcq *qcq,
+				   struct ionic_admin_ctx *ctx)
 {
 	struct device *dev = lif->ionic->dev;
 	struct ionic_queue *q = &qcq->q;
 	struct ionic_cq *cq = &qcq->cq;
-	struct ionic_admin_ctx ctx = {
-		.work = COMPLETION_INITIALIZER_ONSTACK(ctx.work),
-		.cmd.q_init = {
-			.opcode = IONIC_CMD_Q_INIT,
-			.lif_index = cpu_to_le16(lif->index),
-			.type = q->type,
-			.ver = lif->qtype_info[q->type].version,
-			.index = cpu_to_le32(q->index),
-			.pid = cpu_to_le16(q->pid),
-			.ring_size = ilog2(q->num_descs),
-			.ring_base = cpu_to_le64(q->base_pa),
-			.cq_ring_base = cpu_to_le64(cq->base_pa),
-			.sg_ring_base = cpu_to_le64(q->sg_base_pa),
-			.features = cpu_to_le64(q->features),
-		},
+
+	memset(ctx, 0, sizeof(*ctx));
+	init_completion(&ctx->work);
+	ctx->cmd.q_init = (struct ionic_q_init_cmd) {
+		.opcode = IONIC_CMD_Q_INIT,
+		.lif_index = cpu_to_le16(lif->index),
+		.type = q->type,
+		.ver = lif->qtype_info[q->type].version,
+		.index = cpu_to_le32(q->index),
+		.pid = cpu_to_le16(q->pid),
+		.ring_size = ilog2(q->num_descs),
+		.ring_base = cpu_to_le64(q->base_pa),
+		.cq_ring_base = cpu_to_le64(cq->base_pa),
+		.sg_ring_base = cpu_to_le64(q->sg_base_pa),
+		.features = cpu_to_le64(q->features),
 	};
-	int err;
 
 	if (lif->ionic->neth_eqs &&
 	    lif->qtype_info[q->type].features & IONIC_QIDENT_F_EQ) {
 		unsigned int eq_index = ionic_choose_eq(lif, q->index);
 
-		ctx.cmd.q_init.flags = cpu_to_le16(IONIC_QINIT_F_EQ |
-						   IONIC_QINIT_F_SG);
-		ctx.cmd.q_init.intr_index = cpu_to_le16(eq_index);
+		ctx->cmd.q_init.flags = cpu_to_le16(IONIC_QINIT_F_EQ |
+						    IONIC_QINIT_F_SG);
+		ctx->cmd.q_init.intr_index = cpu_to_le16(eq_index);
 	} else {
-		ctx.cmd.q_init.flags = cpu_to_le16(IONIC_QINIT_F_IRQ |
-						   IONIC_QINIT_F_SG);
-		ctx.cmd.q_init.intr_index = cpu_to_le16(cq->bound_intr->index);
+		ctx->cmd.q_init.flags = cpu_to_le16(IONIC_QINIT_F_IRQ |
+						    IONIC_QINIT_F_SG);
+		ctx->cmd.q_init.intr_index = cpu_to_le16(cq->bound_intr->index);
 	}
 
 	if (qcq->flags & IONIC_QCQ_F_CMB_RINGS) {
-		ctx.cmd.q_init.flags |= cpu_to_le16(IONIC_QINIT_F_CMB);
-		ctx.cmd.q_init.ring_base = cpu_to_le64(qcq->cmb_q_base_pa);
+		ctx->cmd.q_init.flags |= cpu_to_le16(IONIC_QINIT_F_CMB);
+		ctx->cmd.q_init.ring_base = cpu_to_le64(qcq->cmb_q_base_pa);
+	}
+
+	if (q->dbell_shadow) {
+		ctx->cmd.q_init.flags |= cpu_to_le16(IONIC_QINIT_F_DBSHADOW);
+		ctx->cmd.q_init.db_shadow_base = cpu_to_le64(q->dbell_shadow_pa);
 	}
 
-	dev_dbg(dev, "rxq_init.pid %d\n", ctx.cmd.q_init.pid);
-	dev_dbg(dev, "rxq_init.index %d\n", ctx.cmd.q_init.index);
-	dev_dbg(dev, "rxq_init.ring_base 0x%llx\n", ctx.cmd.q_init.ring_base);
-	dev_dbg(dev, "rxq_init.ring_size %d\n", ctx.cmd.q_init.ring_size);
-	dev_dbg(dev, "rxq_init.cq_ring_base 0x%llx\n", ctx.cmd.q_init.cq_ring_base);
-	dev_dbg(dev, "rxq_init.sg_ring_base 0x%llx\n", ctx.cmd.q_init.sg_ring_base);
-	dev_dbg(dev, "rxq_init.flags 0x%x\n", ctx.cmd.q_init.flags);
-	dev_dbg(dev, "rxq_init.ver %d\n", ctx.cmd.q_init.ver);
-	dev_dbg(dev, "rxq_init.intr_index %d\n", ctx.cmd.q_init.intr_index);
+	dev_dbg(dev, "rxq_init.pid %d\n", ctx->cmd.q_init.pid);
+	dev_dbg(dev, "rxq_init.index %d\n", ctx->cmd.q_init.index);
+	dev_dbg(dev, "rxq_init.ring_base 0x%llx\n", ctx->cmd.q_init.ring_base);
+	dev_dbg(dev, "rxq_init.ring_size %d\n", ctx->cmd.q_init.ring_size);
+	dev_dbg(dev, "rxq_init.cq_ring_base 0x%llx\n", ctx->cmd.q_init.cq_ring_base);
+	dev_dbg(dev, "rxq_init.sg_ring_base 0x%llx\n", ctx->cmd.q_init.sg_ring_base);
+	dev_dbg(dev, "rxq_init.flags 0x%x\n", ctx->cmd.q_init.flags);
+	dev_dbg(dev, "rxq_init.ver %d\n", ctx->cmd.q_init.ver);
+	dev_dbg(dev, "rxq_init.intr_index %d\n", ctx->cmd.q_init.intr_index);
 
 	ionic_qcq_sanitize(qcq);
+}
 
-	err = ionic_adminq_post_wait(lif, &ctx);
-	if (err)
-		return err;
+static int ionic_lif_rxq_init_finish(struct ionic_lif *lif,
+				     struct ionic_qcq *qcq,
+				     struct ionic_admin_ctx *ctx)
+{
+	struct device *dev = lif->ionic->dev;
+	struct ionic_queue *q = &qcq->q;
+#ifdef HAVE_XDP_SUPPORT
+	int err;
+#endif
 
-	q->hw_type = ctx.comp.q_init.hw_type;
-	q->hw_index = le32_to_cpu(ctx.comp.q_init.hw_index);
+	q->hw_type = ctx->comp.q_init.hw_type;
+	q->hw_index = le32_to_cpu(ctx->comp.q_init.hw_index);
 	q->dbval = IONIC_DBELL_QID(q->hw_index);
 
 	dev_dbg(dev, "rxq->hw_type %d\n", q->hw_type);
@@ -976,19 +1572,46 @@ static int ionic_lif_rxq_init(struct ionic_lif *lif, struct ionic_qcq *qcq)
 	q->dbell_deadline = IONIC_RX_MIN_DOORBELL_DEADLINE;
 	q->dbell_jiffies = jiffies;
 
+	q->rx_copybreak = lif->rx_copybreak;
+	q->rx_pkt_len_avg = 0;
+	q->rx_gro_frags = test_bit(IONIC_LIF_F_RX_GRO_FRAGS, lif->state);
+
 	if (test_bit(IONIC_LIF_F_SPLIT_INTR, lif->state))
 		netif_napi_add(lif->netdev, &qcq->napi, ionic_rx_napi);
 	else
 		netif_napi_add(lif->netdev, &qcq->napi, ionic_txrx_napi);
 
 	qcq->napi_qcq = qcq;
-	timer_setup(&qcq->napi_deadline, ionic_napi_deadline, 0);
+
+#ifdef HAVE_XDP_SUPPORT
+	if (lif->xdp_prog) {
+		err = ionic_xdp_register_rxq_info(q, qcq->napi.napi_id);
+		if (err) {
+			netif_napi_del(&qcq->napi);
+			return err;
+		}
+	}
+#endif
 
 	qcq->flags |= IONIC_QCQ_F_INITED;
 
 	return 0;
 }
 
+static int ionic_lif_rxq_init(struct ionic_lif *lif, struct ionic_qcq *qcq)
+{
+	struct ionic_admin_ctx ctx;
+	int err;
+
+	ionic_lif_rxq_init_cmd(lif, qcq, &ctx);
+
+	err = ionic_adminq_post_wait(lif, &ctx);
+	if (err)
+		return err;
+
+	return ionic_lif_rxq_init_finish(lif, qcq, &ctx);
+}
+
 int ionic_lif_create_hwstamp_txq(struct ionic_lif *lif)
 {
 	unsigned int num_desc, desc_sz, comp_sz, sg_desc_sz;
@@ -1040,6 +1663,8 @@ int ionic_lif_create_hwstamp_txq(struct ionic_lif *lif)
 		}
 	}
 
+	static_branch_inc(&ionic_hwstamp_key);
+
 	return 0;
 
 err_qcq_enable:
@@ -1100,6 +1725,8 @@ int ionic_lif_create_hwstamp_rxq(struct ionic_lif *lif)
 		}
 	}
 
+	static_branch_inc(&ionic_hwstamp_key);
+
 	return 0;
 
 err_qcq_enable:
@@ -1116,21 +1743,32 @@ err_qcq_alloc:
 int ionic_lif_config_hwstamp_rxq_all(struct ionic_lif *lif, bool rx_all)
 {
 	struct ionic_queue_params qparam;
+	bool had_hwstamp, has_hwstamp;
+	int err = 0;
 
 	ionic_init_queue_params(lif, &qparam);
 
+	had_hwstamp = lif->rxq_features & IONIC_RXQ_F_HWSTAMP;
+
 	if (rx_all)
 		qparam.rxq_features = IONIC_Q_F_2X_CQ_DESC | IONIC_RXQ_F_HWSTAMP;
 	else
 		qparam.rxq_features = 0;
 
 	/* if we're not running, just set the values and return */
-	if (!netif_running(lif->netdev)) {
+	if (!netif_running(lif->netdev))
 		lif->rxq_features = qparam.rxq_features;
-		return 0;
-	}
+	else
+		err = ionic_reconfigure_queues(lif, &qparam);
 
-	return ionic_reconfigure_queues(lif, &qparam);
+	/* track the hwstamp feature transition, whatever actually stuck */
+	has_hwstamp = lif->rxq_features & IONIC_RXQ_F_HWSTAMP;
+	if (has_hwstamp && !had_hwstamp)
+		static_branch_inc(&ionic_hwstamp_key);
+	else if (!has_hwstamp && had_hwstamp)
+		static_branch_dec(&ionic_hwstamp_key);
+
+	return err;
 }
 
 int ionic_lif_set_hwstamp_txmode(struct ionic_lif *lif, u16 txstamp_mode)
@@ -1267,7 +1905,7 @@ static bool ionic_notifyq_service(struct ionic_cq *cq,
 		if (lif->ionic->idev.fw_status_ready &&
 		    !test_bit(IONIC_LIF_F_FW_RESET, lif->state) &&
 		    !test_and_set_bit(IONIC_LIF_F_FW_STOPPING, lif->state)) {
-			work = kzalloc(sizeof(*work), GFP_ATOMIC);
+			work = ionic_lif_deferred_get(lif);
 			if (!work) {
 				netdev_err(lif->netdev, "Reset event dropped\n");
 				clear_bit(IONIC_LIF_F_FW_STOPPING, lif->state);
@@ -1327,6 +1965,8 @@ static int ionic_adminq_napi(struct napi_struct *napi, int budget)
 	int work_done;
 	int credits;
 
+	trace_ionic_napi_poll(&lif->adminqcq->q, budget);
+
 	if (lif->notifyqcq && lif->notifyqcq->flags & IONIC_QCQ_F_INITED)
 		n_work = ionic_cq_service(&lif->notifyqcq->cq, budget,
 					  ionic_notifyq_service, NULL, NULL);
@@ -1337,9 +1977,11 @@ static int ionic_adminq_napi(struct napi_struct *napi, int budget)
 					  ionic_adminq_service, NULL, NULL);
 	spin_unlock_irqrestore(&lif->adminq_lock, irqflags);
 
-	if (lif->hwstamp_rxq)
+	if (lif->hwstamp_rxq) {
+		ionic_lif_phc_snap(lif, &lif->hwstamp_rxq->phc_snap);
 		rx_work = ionic_cq_service(&lif->hwstamp_rxq->cq, budget,
 					   ionic_rx_service, NULL, NULL);
+	}
 
 	if (lif->hwstamp_txq)
 		tx_work = ionic_cq_service(&lif->hwstamp_txq->cq, budget,
@@ -1364,25 +2006,17 @@ static int ionic_adminq_napi(struct napi_struct *napi, int budget)
 	if (lif->hwstamp_txq && !tx_work && ionic_txq_poke_doorbell(&lif->hwstamp_txq->q))
 		resched = true;
 	if (resched)
-		mod_timer(&lif->adminqcq->napi_deadline,
-			  jiffies + IONIC_NAPI_DEADLINE);
+		ionic_napi_deadline_set(lif->adminqcq);
+
+	trace_ionic_napi_poll_done(&lif->adminqcq->q, work_done);
 
 	return work_done;
 }
 
-#ifdef HAVE_VOID_NDO_GET_STATS64
-void ionic_get_stats64(struct net_device *netdev,
-		       struct rtnl_link_stats64 *ns)
-#else
-struct rtnl_link_stats64 *ionic_get_stats64(struct net_device *netdev,
-					    struct rtnl_link_stats64 *ns)
-#endif
+void ionic_fill_stats64(struct ionic_lif_stats *ls,
+			struct rtnl_link_stats64 *ns)
 {
-	struct ionic_lif *lif = netdev_priv(netdev);
-	struct ionic_lif_stats *ls;
-
 	memset(ns, 0, sizeof(*ns));
-	ls = &lif->info->stats;
 
 	ns->rx_packets = le64_to_cpu(ls->rx_ucast_packets) +
 			 le64_to_cpu(ls->rx_mcast_packets) +
@@ -1426,6 +2060,19 @@ struct rtnl_link_stats64 *ionic_get_stats64(struct net_device *netdev,
 			ns->rx_missed_errors;
 
 	ns->tx_errors = ns->tx_aborted_errors;
+}
+
+#ifdef HAVE_VOID_NDO_GET_STATS64
+void ionic_get_stats64(struct net_device *netdev,
+		       struct rtnl_link_stats64 *ns)
+#else
+struct rtnl_link_stats64 *ionic_get_stats64(struct net_device *netdev,
+					    struct rtnl_link_stats64 *ns)
+#endif
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+
+	ionic_fill_stats64(&lif->info->stats, ns);
 
 #ifndef HAVE_VOID_NDO_GET_STATS64
 	return ns;
@@ -1542,7 +2189,7 @@ static void ionic_ndo_set_rx_mode(struct net_device *netdev)
 	/* Shove off the rest of the rxmode work to the work task
 	 * which will include syncing the filters to the firmware.
 	 */
-	work = kzalloc(sizeof(*work), GFP_ATOMIC);
+	work = ionic_lif_deferred_get(lif);
 	if (!work) {
 		netdev_err(lif->netdev, "rxmode change dropped\n");
 		return;
@@ -1916,6 +2563,180 @@ static int ionic_start_queues_reconfig(struct ionic_lif *lif)
 	return err;
 }
 
+#ifdef HAVE_XDP_SUPPORT
+static bool ionic_xdp_is_valid_mtu(struct ionic_lif *lif, u32 mtu,
+				   struct bpf_prog *xdp_prog)
+{
+	if (!xdp_prog)
+		return true;
+
+	return mtu <= IONIC_XDP_MAX_LINEAR_MTU;
+}
+#endif
+
+#ifdef HAVE_NDO_BPF
+static int ionic_xdp_config(struct net_device *netdev, struct netdev_bpf *bpf)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	struct bpf_prog *old_prog;
+	int err;
+
+	if (test_bit(IONIC_LIF_F_SPLIT_INTR, lif->state)) {
+#define XDP_ERR_SPLIT "XDP not available with split Tx/Rx interrupts"
+		NL_SET_ERR_MSG_MOD(bpf->extack, XDP_ERR_SPLIT);
+		netdev_info(lif->netdev, XDP_ERR_SPLIT);
+		return -EOPNOTSUPP;
+	}
+
+	if (!ionic_xdp_is_valid_mtu(lif, netdev->mtu, bpf->prog)) {
+#define XDP_ERR_MTU "MTU is too large for XDP without frags support"
+		NL_SET_ERR_MSG_MOD(bpf->extack, XDP_ERR_MTU);
+		netdev_info(lif->netdev, XDP_ERR_MTU);
+		return -EINVAL;
+	}
+
+	/* the XDP TX queues are carved out of the second half of
+	 * the lif's tx queue space
+	 */
+	if (bpf->prog && lif->ionic->ntxqs_per_lif < 2 * lif->nxqs) {
+#define XDP_ERR_TXQS "Not enough tx queues available for XDP"
+		NL_SET_ERR_MSG_MOD(bpf->extack, XDP_ERR_TXQS);
+		netdev_info(lif->netdev, XDP_ERR_TXQS);
+		return -ENOSPC;
+	}
+
+	if (!netif_running(netdev)) {
+		old_prog = xchg(&lif->xdp_prog, bpf->prog);
+	} else {
+		mutex_lock(&lif->queue_lock);
+		ionic_stop_queues_reconfig(lif);
+		old_prog = xchg(&lif->xdp_prog, bpf->prog);
+		ionic_xdp_queues_free(lif);
+		err = ionic_xdp_queues_alloc(lif);
+		if (err) {
+			mutex_unlock(&lif->queue_lock);
+			NL_SET_ERR_MSG_MOD(bpf->extack,
+					   "Could not allocate XDP queues");
+			return err;
+		}
+		ionic_start_queues_reconfig(lif);
+		mutex_unlock(&lif->queue_lock);
+	}
+
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+#ifdef HAVE_XSK_BUFF_POOL
+static int ionic_xsk_pool_enable(struct ionic_lif *lif,
+				 struct xsk_buff_pool *pool, u16 qid)
+{
+	int err;
+
+	if (qid >= lif->nxqs)
+		return -EINVAL;
+
+	/* the pool's TX ring is serviced through the per-queue XDP
+	 * TX queues, so zero-copy needs a program attached
+	 */
+	if (!lif->xdp_prog)
+		return -EOPNOTSUPP;
+
+	err = xsk_pool_dma_map(pool, lif->ionic->dev, 0);
+	if (err) {
+		netdev_err(lif->netdev, "Queue %d xsk_pool_dma_map failed, err %d\n",
+			   qid, err);
+		return err;
+	}
+
+	set_bit(qid, lif->af_xdp_zc_qps);
+
+	if (netif_running(lif->netdev)) {
+		mutex_lock(&lif->queue_lock);
+		ionic_stop_queues_reconfig(lif);
+		ionic_start_queues_reconfig(lif);
+		mutex_unlock(&lif->queue_lock);
+	}
+
+	return 0;
+}
+
+static int ionic_xsk_pool_disable(struct ionic_lif *lif, u16 qid)
+{
+	struct xsk_buff_pool *pool;
+
+	if (qid >= lif->nxqs)
+		return -EINVAL;
+
+	pool = xsk_get_pool_from_qid(lif->netdev, qid);
+	if (!pool)
+		return -EINVAL;
+
+	clear_bit(qid, lif->af_xdp_zc_qps);
+
+	if (netif_running(lif->netdev)) {
+		mutex_lock(&lif->queue_lock);
+		ionic_stop_queues_reconfig(lif);
+		ionic_start_queues_reconfig(lif);
+		mutex_unlock(&lif->queue_lock);
+	}
+
+	xsk_pool_dma_unmap(pool, 0);
+
+	return 0;
+}
+
+static int ionic_xsk_pool_setup(struct net_device *netdev,
+				struct xsk_buff_pool *pool, u16 qid)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+
+	if (pool)
+		return ionic_xsk_pool_enable(lif, pool, qid);
+
+	return ionic_xsk_pool_disable(lif, qid);
+}
+
+static int ionic_xsk_wakeup(struct net_device *netdev, u32 qid, u32 flags)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	struct ionic_qcq *qcq;
+
+	if (!netif_running(netdev) || !test_bit(IONIC_LIF_F_UP, lif->state))
+		return -ENETDOWN;
+
+	if (qid >= lif->nxqs || !lif->rxqcqs || !lif->rxqcqs[qid])
+		return -EINVAL;
+
+	qcq = lif->rxqcqs[qid];
+	if (!qcq->q.xsk_pool)
+		return -EINVAL;
+
+	if (!napi_if_scheduled_mark_missed(&qcq->napi))
+		napi_schedule(&qcq->napi);
+
+	return 0;
+}
+#endif /* HAVE_XSK_BUFF_POOL */
+
+static int ionic_xdp(struct net_device *netdev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return ionic_xdp_config(netdev, bpf);
+#ifdef HAVE_XSK_BUFF_POOL
+	case XDP_SETUP_XSK_POOL:
+		return ionic_xsk_pool_setup(netdev, bpf->xsk.pool,
+					    bpf->xsk.queue_id);
+#endif
+	default:
+		return -EINVAL;
+	}
+}
+#endif /* HAVE_NDO_BPF */
+
 static int ionic_change_mtu(struct net_device *netdev, int new_mtu)
 {
 	struct ionic_lif *lif = netdev_priv(netdev);
@@ -1938,6 +2759,13 @@ static int ionic_change_mtu(struct net_device *netdev, int new_mtu)
 		return -EINVAL;
 	}
 
+#ifdef HAVE_XDP_SUPPORT
+	if (!ionic_xdp_is_valid_mtu(lif, new_mtu, lif->xdp_prog)) {
+		netdev_err(netdev, "MTU %d is too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+#endif
+
 	err = ionic_adminq_post_wait(lif, &ctx);
 	if (err)
 		return err;
@@ -1960,22 +2788,43 @@ static int ionic_change_mtu(struct net_device *netdev, int new_mtu)
 	return err;
 }
 
+/* no queue restart pending, and the fallback when the wedged queue is
+ * unknown or more than one queue is implicated
+ */
+#define IONIC_TX_TIMEOUT_NONE		(~0u)
+#define IONIC_TX_TIMEOUT_ALL_QUEUES	(~0u - 1)
+
 static void ionic_tx_timeout_work(struct work_struct *ws)
 {
 	struct ionic_lif *lif = container_of(ws, struct ionic_lif, tx_timeout_work);
+	u32 txqueue;
 
 	if (test_bit(IONIC_LIF_F_FW_RESET, lif->state))
 		return;
 
-	// TODO: queue specific reset
-
 	/* if we were stopped before this scheduled job was launched,
 	 * don't bother the queues as they are already stopped.
 	 */
 	if (!netif_running(lif->netdev))
 		return;
 
+	txqueue = xchg(&lif->tx_timeout_txq, IONIC_TX_TIMEOUT_NONE);
+
 	mutex_lock(&lif->queue_lock);
+
+	/* Restart just the wedged queue pair when we know which one it
+	 * is: quiesce it, reset it through IONIC_CMD_Q_CONTROL, and
+	 * re-init and re-enable it in place, leaving the rest of the
+	 * lif passing traffic.  Anything else - unknown queue, several
+	 * queues implicated, or the restart itself failing - falls back
+	 * to the full lif restart.
+	 */
+	if (txqueue < lif->nxqs &&
+	    !ionic_resize_qcq_pair(lif, txqueue, NULL, NULL)) {
+		mutex_unlock(&lif->queue_lock);
+		return;
+	}
+
 	ionic_stop_queues_reconfig(lif);
 	ionic_start_queues_reconfig(lif);
 	mutex_unlock(&lif->queue_lock);
@@ -1989,11 +2838,37 @@ static void ionic_tx_timeout(struct net_device *netdev)
 {
 	struct ionic_lif *lif = netdev_priv(netdev);
 #if !defined(HAVE_TX_TIMEOUT_TXQUEUE)
-	unsigned int txqueue = -1;
+	unsigned int txqueue = IONIC_TX_TIMEOUT_ALL_QUEUES;
 #endif
+	u32 pending;
+
+	/* remember which queue wedged; a second, different timeout
+	 * before the worker runs widens recovery to the whole lif
+	 */
+	pending = READ_ONCE(lif->tx_timeout_txq);
+	if (pending == IONIC_TX_TIMEOUT_NONE)
+		WRITE_ONCE(lif->tx_timeout_txq, txqueue);
+	else if (pending != txqueue)
+		WRITE_ONCE(lif->tx_timeout_txq, IONIC_TX_TIMEOUT_ALL_QUEUES);
 
 	netdev_info(lif->netdev, "Tx Timeout triggered - txq %d\n", txqueue);
-	schedule_work(&lif->tx_timeout_work);
+	queue_work(ionic_recovery_wq, &lif->tx_timeout_work);
+}
+
+/* Kick the deferred rx_mode work that runs the filter sync; repeat
+ * requests coalesce on the deferred queue, so a storm of vid changes
+ * piles up in the filter table and is synced in one batched pass.
+ */
+static void ionic_lif_filter_sync_request(struct ionic_lif *lif)
+{
+	struct ionic_deferred_work *work;
+
+	work = ionic_lif_deferred_get(lif);
+	if (!work)
+		return;	/* the watchdog will see SYNC_NEEDED and retry */
+
+	work->type = IONIC_DW_TYPE_RX_MODE;
+	ionic_lif_deferred_enqueue(&lif->deferred, work);
 }
 
 static int ionic_vlan_rx_add_vid(struct net_device *netdev, __be16 proto,
@@ -2002,11 +2877,11 @@ static int ionic_vlan_rx_add_vid(struct net_device *netdev, __be16 proto,
 	struct ionic_lif *lif = netdev_priv(netdev);
 	int err;
 
-	err = ionic_lif_vlan_add(lif, vid);
+	err = ionic_lif_list_vlan(lif, vid, ADD_ADDR);
 	if (err)
 		return err;
 
-	ionic_lif_rx_mode(lif);
+	ionic_lif_filter_sync_request(lif);
 
 	return 0;
 }
@@ -2017,11 +2892,11 @@ static int ionic_vlan_rx_kill_vid(struct net_device *netdev, __be16 proto,
 	struct ionic_lif *lif = netdev_priv(netdev);
 	int err;
 
-	err = ionic_lif_vlan_del(lif, vid);
+	err = ionic_lif_list_vlan(lif, vid, DEL_ADDR);
 	if (err)
 		return err;
 
-	ionic_lif_rx_mode(lif);
+	ionic_lif_filter_sync_request(lif);
 
 	return 0;
 }
@@ -2059,6 +2934,178 @@ int ionic_lif_rss_config(struct ionic_lif *lif, const u16 types,
 	return ionic_adminq_post_wait(lif, &ctx);
 }
 
+/* Incremental indirection table update for RSS rebalancing: write only
+ * the entries that changed into the table the fw reads by address, and
+ * notify the fw with a single setattr - or none at all if the new map
+ * matches what's already programmed.  The running queues are never
+ * touched; traffic just starts hashing to the new destinations.
+ */
+int ionic_lif_rss_update_indir(struct ionic_lif *lif, const u32 *indir)
+{
+	unsigned int nchanged = 0;
+	unsigned int i, tbl_sz;
+
+	tbl_sz = le16_to_cpu(lif->ionic->ident.lif.eth.rss_ind_tbl_sz);
+	for (i = 0; i < tbl_sz; i++) {
+		if (lif->rss_ind_tbl[i] != indir[i]) {
+			lif->rss_ind_tbl[i] = indir[i];
+			nchanged++;
+		}
+	}
+
+	if (!nchanged)
+		return 0;
+
+	return ionic_lif_rss_config(lif, lif->rss_types, NULL, NULL);
+}
+
+#ifdef CONFIG_RFS_ACCEL
+/* The device's rx filters match only MAC/VLAN/pkt-class, so per-flow
+ * hardware filters aren't expressible; instead a flow is steered by
+ * pointing its RSS indirection slot at the desired queue.  The fw reads
+ * the table by address, so the slot is rewritten in place and a
+ * deferred setattr tells the fw to take notice.  The slot index is the
+ * filter id handed back to the stack, and stale steerings are found by
+ * a short lazy expiry scan piggybacked on each steering call.
+ */
+#define IONIC_ARFS_EXPIRE_SCAN		4
+
+static void ionic_lif_arfs_expire(struct ionic_lif *lif, bool *dirty)
+{
+	u32 tbl_sz = le16_to_cpu(lif->ionic->ident.lif.eth.rss_ind_tbl_sz);
+	struct ionic_arfs_bucket *b;
+	unsigned int i;
+	u32 slot;
+
+	for (i = 0; i < IONIC_ARFS_EXPIRE_SCAN; i++) {
+		slot = lif->arfs_expiry_cursor++ % tbl_sz;
+		b = &lif->arfs_buckets[slot];
+
+		if (!b->steered)
+			continue;
+		if (!rps_may_expire_flow(lif->netdev, b->rxq_index,
+					 b->flow_id, slot))
+			continue;
+
+		b->steered = false;
+		lif->rss_ind_tbl[slot] =
+			ethtool_rxfh_indir_default(slot, lif->nxqs);
+		*dirty = true;
+	}
+}
+
+static int ionic_rx_flow_steer(struct net_device *netdev,
+			       const struct sk_buff *skb,
+			       u16 rxq_index, u32 flow_id)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	struct ionic_arfs_bucket *b;
+	bool dirty = false;
+	u32 tbl_sz;
+	u32 slot;
+	int ret;
+
+	if (!lif->arfs_buckets || !(lif->hw_features & IONIC_ETH_HW_RX_HASH))
+		return -EOPNOTSUPP;
+	if (rxq_index >= lif->nxqs)
+		return -EINVAL;
+
+	/* the skb hash is the device's RSS hash, so this picks the
+	 * indirection slot the device will use for the flow
+	 */
+	tbl_sz = le16_to_cpu(lif->ionic->ident.lif.eth.rss_ind_tbl_sz);
+	slot = skb_get_hash_raw(skb) % tbl_sz;
+
+	spin_lock_bh(&lif->arfs_lock);
+
+	b = &lif->arfs_buckets[slot];
+	if (b->steered && b->rxq_index != rxq_index &&
+	    !rps_may_expire_flow(netdev, b->rxq_index, b->flow_id, slot)) {
+		/* the slot is busy steering another live flow */
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	b->flow_id = flow_id;
+	b->rxq_index = rxq_index;
+	b->steered = true;
+
+	if (lif->rss_ind_tbl[slot] != rxq_index) {
+		lif->rss_ind_tbl[slot] = rxq_index;
+		dirty = true;
+	}
+
+	ret = slot;
+
+	ionic_lif_arfs_expire(lif, &dirty);
+
+out_unlock:
+	spin_unlock_bh(&lif->arfs_lock);
+
+	if (dirty) {
+		struct ionic_deferred_work *work;
+
+		work = ionic_lif_deferred_get(lif);
+		if (work) {
+			work->type = IONIC_DW_TYPE_RSS_UPDATE;
+			ionic_lif_deferred_enqueue(&lif->deferred, work);
+		}
+	}
+
+	return ret;
+}
+
+/* The stack only calls ndo_rx_flow_steer when it can map the rx queues
+ * to irqs, so feed the rxq interrupts into a cpu_rmap while the queues
+ * are up.
+ */
+static void ionic_lif_arfs_up(struct ionic_lif *lif)
+{
+	struct cpu_rmap *rmap;
+	unsigned int i;
+	int err;
+
+	if (!lif->arfs_buckets)
+		return;
+
+	rmap = alloc_irq_cpu_rmap(lif->nxqs);
+	if (!rmap)
+		return;
+
+	for (i = 0; i < lif->nxqs; i++) {
+		if (!(lif->rxqcqs[i]->flags & IONIC_QCQ_F_INTR))
+			continue;
+		err = irq_cpu_rmap_add(rmap, lif->rxqcqs[i]->intr.vector);
+		if (err) {
+			free_irq_cpu_rmap(rmap);
+			return;
+		}
+	}
+
+	lif->netdev->rx_cpu_rmap = rmap;
+}
+
+static void ionic_lif_arfs_down(struct ionic_lif *lif)
+{
+	u32 tbl_sz = le16_to_cpu(lif->ionic->ident.lif.eth.rss_ind_tbl_sz);
+
+	if (lif->netdev->rx_cpu_rmap) {
+		free_irq_cpu_rmap(lif->netdev->rx_cpu_rmap);
+		lif->netdev->rx_cpu_rmap = NULL;
+	}
+
+	/* the flows are gone and the indirection table goes back to
+	 * defaults on the next rss init, so drop the steering state
+	 */
+	if (lif->arfs_buckets) {
+		spin_lock_bh(&lif->arfs_lock);
+		memset(lif->arfs_buckets, 0,
+		       tbl_sz * sizeof(*lif->arfs_buckets));
+		spin_unlock_bh(&lif->arfs_lock);
+	}
+}
+#endif /* CONFIG_RFS_ACCEL */
+
 static int ionic_lif_rss_init(struct ionic_lif *lif)
 {
 	unsigned int tbl_sz;
@@ -2118,6 +3165,13 @@ static void ionic_txrx_disable(struct ionic_lif *lif)
 			err = ionic_qcq_disable(lif, lif->txqcqs[i], err);
 	}
 
+#ifdef HAVE_XDP_SUPPORT
+	if (lif->xdpqcqs) {
+		for (i = 0; i < lif->nxqs; i++)
+			err = ionic_qcq_disable(lif, lif->xdpqcqs[i], err);
+	}
+#endif
+
 	if (lif->hwstamp_txq)
 		err = ionic_qcq_disable(lif, lif->hwstamp_txq, err);
 
@@ -2136,6 +3190,16 @@ static void ionic_txrx_deinit(struct ionic_lif *lif)
 {
 	unsigned int i;
 
+	/* Make sure a deadline pass isn't still walking the queues; with
+	 * IONIC_LIF_F_UP now clear, any re-arm from the adminq will only
+	 * look at the adminq itself.
+	 */
+	del_timer_sync(&lif->dbell_timer);
+
+#ifdef CONFIG_RFS_ACCEL
+	ionic_lif_arfs_down(lif);
+#endif
+
 	if (lif->txqcqs && lif->txqcqs[0]) {
 		for (i = 0; i < lif->nxqs && lif->txqcqs[i]; i++) {
 			ionic_lif_qcq_deinit(lif, lif->txqcqs[i]);
@@ -2144,6 +3208,16 @@ static void ionic_txrx_deinit(struct ionic_lif *lif)
 		}
 	}
 
+#ifdef HAVE_XDP_SUPPORT
+	if (lif->xdpqcqs && lif->xdpqcqs[0]) {
+		for (i = 0; i < lif->nxqs && lif->xdpqcqs[i]; i++) {
+			ionic_lif_qcq_deinit(lif, lif->xdpqcqs[i]);
+			ionic_tx_flush(&lif->xdpqcqs[i]->cq);
+			ionic_tx_empty(&lif->xdpqcqs[i]->q);
+		}
+	}
+#endif
+
 	if (lif->rxqcqs && lif->rxqcqs[0]) {
 		for (i = 0; i < lif->nxqs && lif->rxqcqs[i]; i++) {
 			ionic_lif_qcq_deinit(lif, lif->rxqcqs[i]);
@@ -2164,6 +3238,23 @@ static void ionic_txrx_deinit(struct ionic_lif *lif)
 	}
 }
 
+static void ionic_txrx_free_hwstamp(struct ionic_lif *lif)
+{
+	if (lif->hwstamp_txq) {
+		ionic_qcq_free(lif, lif->hwstamp_txq);
+		devm_kfree(lif->ionic->dev, lif->hwstamp_txq);
+		lif->hwstamp_txq = NULL;
+		static_branch_dec(&ionic_hwstamp_key);
+	}
+
+	if (lif->hwstamp_rxq) {
+		ionic_qcq_free(lif, lif->hwstamp_rxq);
+		devm_kfree(lif->ionic->dev, lif->hwstamp_rxq);
+		lif->hwstamp_rxq = NULL;
+		static_branch_dec(&ionic_hwstamp_key);
+	}
+}
+
 static void ionic_txrx_free(struct ionic_lif *lif)
 {
 	unsigned int i;
@@ -2176,6 +3267,10 @@ static void ionic_txrx_free(struct ionic_lif *lif)
 		}
 	}
 
+#ifdef HAVE_XDP_SUPPORT
+	ionic_xdp_queues_free(lif);
+#endif
+
 	if (lif->rxqcqs) {
 		for (i = 0; i < lif->ionic->nrxqs_per_lif && lif->rxqcqs[i]; i++) {
 			ionic_qcq_free(lif, lif->rxqcqs[i]);
@@ -2184,17 +3279,7 @@ static void ionic_txrx_free(struct ionic_lif *lif)
 		}
 	}
 
-	if (lif->hwstamp_txq) {
-		ionic_qcq_free(lif, lif->hwstamp_txq);
-		devm_kfree(lif->ionic->dev, lif->hwstamp_txq);
-		lif->hwstamp_txq = NULL;
-	}
-
-	if (lif->hwstamp_rxq) {
-		ionic_qcq_free(lif, lif->hwstamp_rxq);
-		devm_kfree(lif->ionic->dev, lif->hwstamp_rxq);
-		lif->hwstamp_rxq = NULL;
-	}
+	ionic_txrx_free_hwstamp(lif);
 }
 
 static int ionic_txrx_alloc(struct ionic_lif *lif)
@@ -2224,13 +3309,13 @@ static int ionic_txrx_alloc(struct ionic_lif *lif)
 	      lif->qtype_info[IONIC_QTYPE_TXQ].features & IONIC_QIDENT_F_EQ))
 		flags |= IONIC_QCQ_F_INTR;
 
-	for (i = 0; i < lif->nxqs; i++) {
-		err = ionic_qcq_alloc(lif, IONIC_QTYPE_TXQ, i, "tx", flags,
-				      num_desc, desc_sz, comp_sz, sg_desc_sz,
-				      lif->kern_pid, &lif->txqcqs[i]);
-		if (err)
-			goto err_out;
+	err = ionic_qcqs_alloc_parallel(lif, IONIC_QTYPE_TXQ, 0, "tx", flags,
+					num_desc, desc_sz, comp_sz, sg_desc_sz,
+					lif->txqcqs);
+	if (err)
+		goto err_out;
 
+	for (i = 0; i < lif->nxqs; i++) {
 		if (flags & IONIC_QCQ_F_INTR) {
 			ionic_intr_coal_init(lif->ionic->idev.intr_ctrl,
 					     lif->txqcqs[i]->intr.index,
@@ -2242,6 +3327,12 @@ static int ionic_txrx_alloc(struct ionic_lif *lif)
 		ionic_debugfs_add_qcq(lif, lif->txqcqs[i]);
 	}
 
+#ifdef HAVE_XDP_SUPPORT
+	err = ionic_xdp_queues_alloc(lif);
+	if (err)
+		goto err_out;
+#endif
+
 	flags = IONIC_QCQ_F_RX_STATS | IONIC_QCQ_F_SG;
 	if (!ionic_use_eqs(lif))
 		flags |= IONIC_QCQ_F_INTR;
@@ -2257,13 +3348,13 @@ static int ionic_txrx_alloc(struct ionic_lif *lif)
 	if (lif->rxq_features & IONIC_Q_F_2X_CQ_DESC)
 		comp_sz *= 2;
 
-	for (i = 0; i < lif->nxqs; i++) {
-		err = ionic_qcq_alloc(lif, IONIC_QTYPE_RXQ, i, "rx", flags,
-				      num_desc, desc_sz, comp_sz, sg_desc_sz,
-				      lif->kern_pid, &lif->rxqcqs[i]);
-		if (err)
-			goto err_out;
+	err = ionic_qcqs_alloc_parallel(lif, IONIC_QTYPE_RXQ, 0, "rx", flags,
+					num_desc, desc_sz, comp_sz, sg_desc_sz,
+					lif->rxqcqs);
+	if (err)
+		goto err_out;
 
+	for (i = 0; i < lif->nxqs; i++) {
 		lif->rxqcqs[i]->q.features = lif->rxq_features;
 
 		if (flags & IONIC_QCQ_F_INTR) {
@@ -2281,32 +3372,200 @@ static int ionic_txrx_alloc(struct ionic_lif *lif)
 		ionic_debugfs_add_qcq(lif, lif->rxqcqs[i]);
 	}
 
-	lif->n_txrx_alloc++;
+	lif->n_txrx_alloc++;
+
+	return 0;
+
+err_out:
+	ionic_txrx_free(lif);
+
+	return err;
+}
+
+static void ionic_lif_xps_seed(struct ionic_lif *lif)
+{
+	struct ionic_qcq *napi_qcq;
+	unsigned int i;
+
+	if (!lif->txqcqs)
+		return;
+
+	/* Pin each tx queue to the cpu set of the interrupt that
+	 * processes its completions, so submission, completion, and
+	 * the qcq's memory stay local to one another.
+	 */
+	for (i = 0; i < lif->nxqs; i++) {
+		if (!lif->txqcqs[i])
+			continue;
+
+		napi_qcq = lif->txqcqs[i]->napi_qcq;
+		if (!napi_qcq)
+			continue;
+
+		netif_set_xps_queue(lif->netdev,
+				    &napi_qcq->intr.affinity_mask, i);
+	}
+}
+
+#define IONIC_TXRX_INIT_BATCH	(IONIC_ADMINQ_LENGTH / 2)
+
+static int ionic_txrx_init_batch(struct ionic_lif *lif,
+				 struct ionic_qcq **qcqs,
+				 struct ionic_admin_ctx *ctxs,
+				 unsigned int nbatch,
+				 unsigned int *ndone)
+{
+	unsigned int nposted = 0;
+	int post_err = 0;
+	int err = 0;
+	unsigned int i;
+
+	for (i = 0; i < nbatch; i++) {
+		if (qcqs[i]->q.type == IONIC_QTYPE_RXQ)
+			ionic_lif_rxq_init_cmd(lif, qcqs[i], &ctxs[i]);
+		else
+			ionic_lif_txq_init_cmd(lif, qcqs[i], &ctxs[i]);
+
+		post_err = ionic_adminq_post_nowait(lif, &ctxs[i]);
+		if (post_err)
+			break;
+		nposted++;
+	}
+
+	ionic_adminq_kick(lif);
+
+	for (i = 0; i < nposted; i++) {
+		int werr;
+
+		werr = ionic_adminq_wait(lif, &ctxs[i], 0, true);
+		if (!werr) {
+			if (qcqs[i]->q.type == IONIC_QTYPE_RXQ)
+				werr = ionic_lif_rxq_init_finish(lif, qcqs[i],
+								 &ctxs[i]);
+			else
+				ionic_lif_txq_init_finish(lif, qcqs[i],
+							  &ctxs[i]);
+		}
+		if (werr && !err)
+			err = werr;
+	}
+
+	*ndone = nposted;
+
+	return err ? : post_err;
+}
+
+static int ionic_txrx_init(struct ionic_lif *lif)
+{
+	struct ionic_admin_ctx *ctxs;
+	struct ionic_qcq **qcqs;
+	unsigned int nq = 0;
+	unsigned int i;
+	int err = 0;
+
+	ctxs = kcalloc(IONIC_TXRX_INIT_BATCH, sizeof(*ctxs), GFP_KERNEL);
+	qcqs = kcalloc(3 * lif->nxqs, sizeof(*qcqs), GFP_KERNEL);
+	if (!ctxs || !qcqs) {
+		kfree(ctxs);
+		kfree(qcqs);
+
+		/* low on memory, init the queues one round trip at a time */
+		for (i = 0; i < lif->nxqs; i++) {
+			err = ionic_lif_txq_init(lif, lif->txqcqs[i]);
+			if (err)
+				goto err_out;
+
+			err = ionic_lif_rxq_init(lif, lif->rxqcqs[i]);
+			if (err)
+				goto err_out;
+
+#ifdef HAVE_XDP_SUPPORT
+			if (lif->xdpqcqs && lif->xdpqcqs[i]) {
+				err = ionic_lif_txq_init(lif, lif->xdpqcqs[i]);
+				if (err)
+					goto err_out;
+			}
+#endif
+		}
+
+		goto qs_inited;
+	}
+
+	/* Post the queue init commands in batches and consume their
+	 * completions in posting order, so one firmware round trip
+	 * covers a batch of queues instead of a single queue.
+	 */
+	for (i = 0; i < lif->nxqs; i++) {
+		qcqs[nq++] = lif->txqcqs[i];
+		qcqs[nq++] = lif->rxqcqs[i];
+#ifdef HAVE_XDP_SUPPORT
+		if (lif->xdpqcqs && lif->xdpqcqs[i])
+			qcqs[nq++] = lif->xdpqcqs[i];
+#endif
+	}
+
+	i = 0;
+	while (i < nq) {
+		unsigned int ndone;
 
-	return 0;
+		err = ionic_txrx_init_batch(lif, &qcqs[i], ctxs,
+					    min_t(unsigned int,
+						  IONIC_TXRX_INIT_BATCH,
+						  nq - i),
+					    &ndone);
 
-err_out:
-	ionic_txrx_free(lif);
+		/* a full adminq isn't fatal as long as we made progress;
+		 * the batch wait drained our share of it, so try again
+		 */
+		if (err == -ENOSPC && ndone)
+			err = 0;
+		if (err)
+			break;
 
-	return err;
-}
+		i += ndone;
+	}
 
-static int ionic_txrx_init(struct ionic_lif *lif)
-{
-	unsigned int i;
-	int err;
+	kfree(ctxs);
+	kfree(qcqs);
+
+	if (err)
+		goto err_out;
 
+qs_inited:
+#ifdef HAVE_XDP_SUPPORT
 	for (i = 0; i < lif->nxqs; i++) {
-		err = ionic_lif_txq_init(lif, lif->txqcqs[i]);
-		if (err)
-			goto err_out;
+		if (lif->xdpqcqs && lif->xdpqcqs[i]) {
+			lif->rxqcqs[i]->q.partner = &lif->xdpqcqs[i]->q;
+			lif->xdpqcqs[i]->q.partner = &lif->rxqcqs[i]->q;
+		} else {
+			lif->rxqcqs[i]->q.partner = NULL;
+		}
 
-		err = ionic_lif_rxq_init(lif, lif->rxqcqs[i]);
-		if (err) {
-			ionic_lif_qcq_deinit(lif, lif->txqcqs[i]);
-			goto err_out;
+		WRITE_ONCE(lif->rxqcqs[i]->q.xdp_prog, lif->xdp_prog);
+
+#ifdef HAVE_XSK_BUFF_POOL
+		{
+			struct xsk_buff_pool *pool = NULL;
+
+			if (lif->af_xdp_zc_qps &&
+			    test_bit(i, lif->af_xdp_zc_qps))
+				pool = xsk_get_pool_from_qid(lif->netdev, i);
+
+			lif->rxqcqs[i]->q.xsk_pool = pool;
+			if (lif->xdpqcqs && lif->xdpqcqs[i]) {
+				lif->xdpqcqs[i]->q.xsk_pool = pool;
+				lif->xdpqcqs[i]->q.xsk_frames_done = 0;
+			}
 		}
+#endif
 	}
+#endif
+
+	ionic_lif_xps_seed(lif);
+
+#ifdef CONFIG_RFS_ACCEL
+	ionic_lif_arfs_up(lif);
+#endif
 
 	if (lif->netdev->features & NETIF_F_RXHASH)
 		ionic_lif_rss_init(lif);
@@ -2316,9 +3575,14 @@ static int ionic_txrx_init(struct ionic_lif *lif)
 	return 0;
 
 err_out:
-	while (i--) {
+	/* deinit skips over any queue that didn't make it to inited */
+	for (i = 0; i < lif->nxqs; i++) {
 		ionic_lif_qcq_deinit(lif, lif->txqcqs[i]);
 		ionic_lif_qcq_deinit(lif, lif->rxqcqs[i]);
+#ifdef HAVE_XDP_SUPPORT
+		if (lif->xdpqcqs && lif->xdpqcqs[i])
+			ionic_lif_qcq_deinit(lif, lif->xdpqcqs[i]);
+#endif
 	}
 
 	return err;
@@ -2346,6 +3610,17 @@ static int ionic_txrx_enable(struct ionic_lif *lif)
 			derr = ionic_qcq_disable(lif, lif->rxqcqs[i], err);
 			goto err_out;
 		}
+
+#ifdef HAVE_XDP_SUPPORT
+		if (lif->xdpqcqs && lif->xdpqcqs[i]) {
+			err = ionic_qcq_enable(lif->xdpqcqs[i]);
+			if (err) {
+				derr = ionic_qcq_disable(lif, lif->txqcqs[i], err);
+				derr = ionic_qcq_disable(lif, lif->rxqcqs[i], derr);
+				goto err_out;
+			}
+		}
+#endif
 	}
 
 	if (lif->hwstamp_rxq) {
@@ -2370,6 +3645,10 @@ err_out_hwstamp_rx:
 	i = lif->nxqs;
 err_out:
 	while (i--) {
+#ifdef HAVE_XDP_SUPPORT
+		if (lif->xdpqcqs && lif->xdpqcqs[i])
+			derr = ionic_qcq_disable(lif, lif->xdpqcqs[i], derr);
+#endif
 		derr = ionic_qcq_disable(lif, lif->txqcqs[i], derr);
 		derr = ionic_qcq_disable(lif, lif->rxqcqs[i], derr);
 	}
@@ -2486,6 +3765,48 @@ static int ionic_stop(struct net_device *netdev)
 	return 0;
 }
 
+/* Fast system suspend/resume: pci config state is preserved across
+ * the sleep, so the lif keeps its identity and queue allocations and
+ * only the hw queue programming is torn down and replayed.  Resume
+ * goes through ionic_txrx_init(), so queue restore is one fw round
+ * trip per batch of queues plus the rss/rx_mode replay, instead of a
+ * full re-identify and lif re-init.
+ */
+int ionic_lif_suspend(struct ionic_lif *lif)
+{
+	mutex_lock(&lif->queue_lock);
+	if (netif_running(lif->netdev))
+		ionic_stop_queues_reconfig(lif);
+	else
+		netif_device_detach(lif->netdev);
+	mutex_unlock(&lif->queue_lock);
+
+	return 0;
+}
+
+int ionic_lif_resume(struct ionic_lif *lif)
+{
+	int err = 0;
+
+	/* If fw restarted while we slept, let the fw_up machinery do
+	 * the full restore rather than replaying onto a blank device.
+	 */
+	if (ionic_heartbeat_check(lif->ionic) ||
+	    test_bit(IONIC_LIF_F_FW_RESET, lif->state)) {
+		netif_device_attach(lif->netdev);
+		return 0;
+	}
+
+	mutex_lock(&lif->queue_lock);
+	if (netif_running(lif->netdev))
+		err = ionic_start_queues_reconfig(lif);
+	else
+		netif_device_attach(lif->netdev);
+	mutex_unlock(&lif->queue_lock);
+
+	return err;
+}
+
 static int ionic_eth_ioctl(struct net_device *netdev, struct ifreq *ifr, int cmd)
 {
 	struct ionic_lif *lif = netdev_priv(netdev);
@@ -2857,9 +4178,10 @@ static int ionic_set_vf_link_state(struct net_device *netdev, int vf, int set)
 
 static void ionic_vf_attr_replay(struct ionic_lif *lif)
 {
-	struct ionic_vf_setattr_cmd vfc = { 0 };
+	struct ionic_vf_setattr_cmd vfcs[7];
 	struct ionic *ionic = lif->ionic;
 	struct ionic_vf *v;
+	int nattrs;
 	int i;
 
 	if (!ionic->vfs)
@@ -2868,56 +4190,62 @@ static void ionic_vf_attr_replay(struct ionic_lif *lif)
 	down_read(&ionic->vf_op_lock);
 
 	for (i = 0; i < ionic->num_vfs; i++) {
+		struct ionic_vf_setattr_cmd *vfc;
+
 		v = &ionic->vfs[i];
+		nattrs = 0;
 
 		if (v->stats_pa) {
-			vfc.attr = IONIC_VF_ATTR_STATSADDR;
-			vfc.stats_pa = cpu_to_le64(v->stats_pa);
-			(void)ionic_set_vf_config(ionic, i, &vfc);
-			vfc.stats_pa = 0;
+			vfc = &vfcs[nattrs++];
+			memset(vfc, 0, sizeof(*vfc));
+			vfc->attr = IONIC_VF_ATTR_STATSADDR;
+			vfc->stats_pa = cpu_to_le64(v->stats_pa);
 		}
 
 		if (!is_zero_ether_addr(v->macaddr)) {
-			vfc.attr = IONIC_VF_ATTR_MAC;
-			ether_addr_copy(vfc.macaddr, v->macaddr);
-			(void)ionic_set_vf_config(ionic, i, &vfc);
-			eth_zero_addr(vfc.macaddr);
+			vfc = &vfcs[nattrs++];
+			memset(vfc, 0, sizeof(*vfc));
+			vfc->attr = IONIC_VF_ATTR_MAC;
+			ether_addr_copy(vfc->macaddr, v->macaddr);
 		}
 
 		if (v->vlanid) {
-			vfc.attr = IONIC_VF_ATTR_VLAN;
-			vfc.vlanid = v->vlanid;
-			(void)ionic_set_vf_config(ionic, i, &vfc);
-			vfc.vlanid = 0;
+			vfc = &vfcs[nattrs++];
+			memset(vfc, 0, sizeof(*vfc));
+			vfc->attr = IONIC_VF_ATTR_VLAN;
+			vfc->vlanid = v->vlanid;
 		}
 
 		if (v->maxrate) {
-			vfc.attr = IONIC_VF_ATTR_RATE;
-			vfc.maxrate = v->maxrate;
-			(void)ionic_set_vf_config(ionic, i, &vfc);
-			vfc.maxrate = 0;
+			vfc = &vfcs[nattrs++];
+			memset(vfc, 0, sizeof(*vfc));
+			vfc->attr = IONIC_VF_ATTR_RATE;
+			vfc->maxrate = v->maxrate;
 		}
 
 		if (v->spoofchk) {
-			vfc.attr = IONIC_VF_ATTR_SPOOFCHK;
-			vfc.spoofchk = v->spoofchk;
-			(void)ionic_set_vf_config(ionic, i, &vfc);
-			vfc.spoofchk = 0;
+			vfc = &vfcs[nattrs++];
+			memset(vfc, 0, sizeof(*vfc));
+			vfc->attr = IONIC_VF_ATTR_SPOOFCHK;
+			vfc->spoofchk = v->spoofchk;
 		}
 
 		if (v->trusted) {
-			vfc.attr = IONIC_VF_ATTR_TRUST;
-			vfc.trust = v->trusted;
-			(void)ionic_set_vf_config(ionic, i, &vfc);
-			vfc.trust = 0;
+			vfc = &vfcs[nattrs++];
+			memset(vfc, 0, sizeof(*vfc));
+			vfc->attr = IONIC_VF_ATTR_TRUST;
+			vfc->trust = v->trusted;
 		}
 
 		if (v->linkstate) {
-			vfc.attr = IONIC_VF_ATTR_LINKSTATE;
-			vfc.linkstate = v->linkstate;
-			(void)ionic_set_vf_config(ionic, i, &vfc);
-			vfc.linkstate = 0;
+			vfc = &vfcs[nattrs++];
+			memset(vfc, 0, sizeof(*vfc));
+			vfc->attr = IONIC_VF_ATTR_LINKSTATE;
+			vfc->linkstate = v->linkstate;
 		}
+
+		if (nattrs)
+			(void)ionic_set_vf_attrs(ionic, i, vfcs, nattrs);
 	}
 
 	up_read(&ionic->vf_op_lock);
@@ -2925,13 +4253,62 @@ static void ionic_vf_attr_replay(struct ionic_lif *lif)
 	ionic_vf_start(ionic, -1);
 }
 
+static u16
+#ifdef HAVE_NDO_SELECT_QUEUE_FALLBACK_REMOVED
+ionic_select_queue(struct net_device *netdev, struct sk_buff *skb,
+		   struct net_device *sb_dev)
+#elif defined(HAVE_NDO_SELECT_QUEUE_SB_DEV)
+ionic_select_queue(struct net_device *netdev, struct sk_buff *skb,
+		   struct net_device *sb_dev,
+		   select_queue_fallback_t fallback)
+#elif defined(HAVE_NDO_SELECT_QUEUE_ACCEL_FALLBACK)
+ionic_select_queue(struct net_device *netdev, struct sk_buff *skb,
+		   void *accel_priv, select_queue_fallback_t fallback)
+#else
+ionic_select_queue(struct net_device *netdev, struct sk_buff *skb)
+#endif
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	int cpu = smp_processor_id();
+
+	/* With the default interrupt layout the TxRx pairs 0..n-1 are
+	 * affinitized to cpus 1..n, so the submitting core maps straight
+	 * to the queue whose completions it will also process.  With an
+	 * affinity override, defer to the stack's pick, which uses the
+	 * XPS maps seeded from the actual irq masks.
+	 */
+	if (!lif->affinity_mask_override && lif->nxqs)
+		return cpu ? (cpu - 1) % lif->nxqs : 0;
+
+#ifdef HAVE_NDO_SELECT_QUEUE_FALLBACK_REMOVED
+	return netdev_pick_tx(netdev, skb, sb_dev);
+#elif defined(HAVE_NDO_SELECT_QUEUE_SB_DEV)
+	return fallback(netdev, skb, sb_dev);
+#elif defined(HAVE_NDO_SELECT_QUEUE_ACCEL_FALLBACK)
+	return fallback(netdev, skb);
+#else
+	return skb_tx_hash(netdev, skb);
+#endif
+}
+
 static const struct net_device_ops ionic_netdev_ops = {
 	.ndo_open               = ionic_open,
 	.ndo_stop               = ionic_stop,
 	.ndo_eth_ioctl		= ionic_eth_ioctl,
 	.ndo_start_xmit		= ionic_start_xmit,
+	.ndo_select_queue	= ionic_select_queue,
+#ifdef HAVE_NDO_BPF
+	.ndo_bpf		= ionic_xdp,
+	.ndo_xdp_xmit		= ionic_xdp_xmit,
+#ifdef HAVE_XSK_BUFF_POOL
+	.ndo_xsk_wakeup		= ionic_xsk_wakeup,
+#endif
+#endif
 	.ndo_get_stats64	= ionic_get_stats64,
 	.ndo_set_rx_mode	= ionic_ndo_set_rx_mode,
+#ifdef CONFIG_RFS_ACCEL
+	.ndo_rx_flow_steer	= ionic_rx_flow_steer,
+#endif
 	.ndo_set_features	= ionic_set_features,
 	.ndo_set_mac_address	= ionic_set_mac_address,
 	.ndo_validate_addr	= eth_validate_addr,
@@ -2981,6 +4358,9 @@ static const struct net_device_ops ionic_mnic_netdev_ops = {
 	.ndo_start_xmit		= ionic_start_xmit,
 	.ndo_get_stats64	= ionic_get_stats64,
 	.ndo_set_rx_mode	= ionic_ndo_set_rx_mode,
+#ifdef CONFIG_RFS_ACCEL
+	.ndo_rx_flow_steer	= ionic_rx_flow_steer,
+#endif
 	.ndo_set_features	= ionic_set_features,
 	.ndo_set_mac_address	= ionic_set_mac_address,
 	.ndo_validate_addr	= eth_validate_addr,
@@ -3061,6 +4441,7 @@ static void ionic_swap_queues(struct ionic_qcq *a, struct ionic_qcq *b)
 	swap(a->q.base,       b->q.base);
 	swap(a->q.base_pa,    b->q.base_pa);
 	swap(a->q.info,       b->q.info);
+	swap(a->q.tx_sgl,     b->q.tx_sgl);
 	swap(a->q_base,       b->q_base);
 	swap(a->q_base_pa,    b->q_base_pa);
 	swap(a->q_size,       b->q_size);
@@ -3085,6 +4466,168 @@ static void ionic_swap_queues(struct ionic_qcq *a, struct ionic_qcq *b)
 	ionic_debugfs_add_qcq(a->q.lif, a);
 }
 
+static int ionic_resize_qcq_pair(struct ionic_lif *lif, unsigned int i,
+				 struct ionic_qcq *tx_swap,
+				 struct ionic_qcq *rx_swap)
+{
+	struct ionic_qcq *txqcq = lif->txqcqs[i];
+	struct ionic_qcq *rxqcq = lif->rxqcqs[i];
+	int err;
+
+	/* quiesce just this pair; the stack keeps using the other queues */
+	netif_stop_subqueue(lif->netdev, i);
+
+	err = ionic_qcq_disable(lif, txqcq, 0);
+	err = ionic_qcq_disable(lif, rxqcq, err);
+
+	ionic_lif_qcq_deinit(lif, txqcq);
+	ionic_tx_flush(&txqcq->cq);
+	ionic_tx_empty(&txqcq->q);
+
+	ionic_lif_qcq_deinit(lif, rxqcq);
+	ionic_rx_empty(&rxqcq->q);
+
+	/* if the fw has gone away there's no point trying to restart */
+	if (err == -ETIMEDOUT || err == -ENXIO)
+		return err;
+
+	/* swap in the new rings, keeping the existing interrupt config */
+	if (tx_swap)
+		ionic_swap_queues(txqcq, tx_swap);
+	if (rx_swap)
+		ionic_swap_queues(rxqcq, rx_swap);
+
+	err = ionic_lif_txq_init(lif, txqcq);
+	if (err)
+		return err;
+
+	err = ionic_lif_rxq_init(lif, rxqcq);
+	if (err) {
+		ionic_lif_qcq_deinit(lif, txqcq);
+		return err;
+	}
+
+	ionic_rx_fill(&rxqcq->q);
+
+	err = ionic_qcq_enable(rxqcq);
+	if (err)
+		return err;
+
+	err = ionic_qcq_enable(txqcq);
+	if (err) {
+		ionic_qcq_disable(lif, rxqcq, err);
+		return err;
+	}
+
+	netif_wake_subqueue(lif->netdev, i);
+
+	if (tx_swap) {
+		ionic_debugfs_del_qcq(txqcq);
+		ionic_debugfs_add_qcq(lif, txqcq);
+	}
+	if (rx_swap) {
+		ionic_debugfs_del_qcq(rxqcq);
+		ionic_debugfs_add_qcq(lif, rxqcq);
+	}
+
+	return 0;
+}
+
+/* Resize the descriptor rings one queue pair at a time: allocate the
+ * replacement rings up front, quiesce just the pair being resized, swap
+ * the new rings in, and re-init and restart that pair via the adminq,
+ * all while the lif's other queues continue to pass traffic.
+ */
+static int ionic_reconfigure_rings(struct ionic_lif *lif,
+				   struct ionic_queue_params *qparam)
+{
+	unsigned int comp_sz, desc_sz, num_desc, sg_desc_sz;
+	bool tx_resize = qparam->ntxq_descs != lif->ntxq_descs;
+	bool rx_resize = qparam->nrxq_descs != lif->nrxq_descs;
+	struct ionic_qcq *tx_qcq = NULL;
+	struct ionic_qcq *rx_qcq = NULL;
+	unsigned int flags, i;
+	int err = 0;
+
+	for (i = 0; i < lif->nxqs; i++) {
+		/* allocate the replacement rings before touching the live
+		 * queues, so an allocation failure leaves them untouched
+		 */
+		if (tx_resize) {
+			num_desc = qparam->ntxq_descs;
+			desc_sz = sizeof(struct ionic_txq_desc);
+			comp_sz = sizeof(struct ionic_txq_comp);
+
+			if (lif->qtype_info[IONIC_QTYPE_TXQ].version >= 1 &&
+			    lif->qtype_info[IONIC_QTYPE_TXQ].sg_desc_sz ==
+			    sizeof(struct ionic_txq_sg_desc_v1))
+				sg_desc_sz = sizeof(struct ionic_txq_sg_desc_v1);
+			else
+				sg_desc_sz = sizeof(struct ionic_txq_sg_desc);
+
+			flags = lif->txqcqs[i]->flags & ~IONIC_QCQ_F_INTR;
+			err = ionic_qcq_alloc(lif, IONIC_QTYPE_TXQ, i, "tx",
+					      flags, num_desc, desc_sz,
+					      comp_sz, sg_desc_sz,
+					      lif->kern_pid, &tx_qcq);
+			if (err)
+				break;
+		}
+
+		if (rx_resize) {
+			num_desc = qparam->nrxq_descs;
+			desc_sz = sizeof(struct ionic_rxq_desc);
+			comp_sz = sizeof(struct ionic_rxq_comp);
+			sg_desc_sz = sizeof(struct ionic_rxq_sg_desc);
+
+			if (lif->rxq_features & IONIC_Q_F_2X_CQ_DESC)
+				comp_sz *= 2;
+
+			flags = lif->rxqcqs[i]->flags & ~IONIC_QCQ_F_INTR;
+			err = ionic_qcq_alloc(lif, IONIC_QTYPE_RXQ, i, "rx",
+					      flags, num_desc, desc_sz,
+					      comp_sz, sg_desc_sz,
+					      lif->kern_pid, &rx_qcq);
+			if (err)
+				break;
+		}
+
+		err = ionic_resize_qcq_pair(lif, i, tx_qcq, rx_qcq);
+
+		/* the swap qcqs now hold the old rings; free them either way */
+		if (tx_qcq) {
+			tx_qcq->flags &= ~IONIC_QCQ_F_INTR;
+			ionic_qcq_free(lif, tx_qcq);
+			devm_kfree(lif->ionic->dev, tx_qcq);
+			tx_qcq = NULL;
+		}
+		if (rx_qcq) {
+			rx_qcq->flags &= ~IONIC_QCQ_F_INTR;
+			ionic_qcq_free(lif, rx_qcq);
+			devm_kfree(lif->ionic->dev, rx_qcq);
+			rx_qcq = NULL;
+		}
+
+		if (err)
+			break;
+	}
+
+	if (tx_qcq) {
+		tx_qcq->flags &= ~IONIC_QCQ_F_INTR;
+		ionic_qcq_free(lif, tx_qcq);
+		devm_kfree(lif->ionic->dev, tx_qcq);
+	}
+
+	if (!err) {
+		lif->ntxq_descs = qparam->ntxq_descs;
+		lif->nrxq_descs = qparam->nrxq_descs;
+	} else {
+		netdev_info(lif->netdev, "%s: failed %d\n", __func__, err);
+	}
+
+	return err;
+}
+
 int ionic_reconfigure_queues(struct ionic_lif *lif,
 			     struct ionic_queue_params *qparam)
 {
@@ -3098,6 +4641,18 @@ int ionic_reconfigure_queues(struct ionic_lif *lif,
 	if (test_bit(IONIC_LIF_F_CMB_RINGS, lif->state) && qparam->cmb_enabled)
 		return ionic_cmb_reconfig(lif, qparam);
 
+	/* If only the ring depths are changing, resize each queue pair in
+	 * place rather than stopping the whole lif for the duration.
+	 */
+	if (qparam->nxqs == lif->nxqs &&
+	    qparam->intr_split == test_bit(IONIC_LIF_F_SPLIT_INTR, lif->state) &&
+	    qparam->rxq_features == lif->rxq_features &&
+	    !qparam->cmb_enabled &&
+	    !test_bit(IONIC_LIF_F_CMB_RINGS, lif->state) &&
+	    (qparam->ntxq_descs != lif->ntxq_descs ||
+	     qparam->nrxq_descs != lif->nrxq_descs))
+		return ionic_reconfigure_rings(lif, qparam);
+
 	/* allocate temporary qcq arrays to hold new queue structs */
 	if (qparam->nxqs != lif->nxqs || qparam->ntxq_descs != lif->ntxq_descs) {
 		tx_qcqs = devm_kcalloc(lif->ionic->dev, lif->ionic->ntxqs_per_lif,
@@ -3327,6 +4882,7 @@ err_out:
 
 int ionic_lif_alloc(struct ionic *ionic)
 {
+	struct ionic_deferred_work *dwork_pool;
 	struct device *dev = ionic->dev;
 	union ionic_lif_identity *lid;
 	struct net_device *netdev;
@@ -3334,6 +4890,7 @@ int ionic_lif_alloc(struct ionic *ionic)
 	u32 minfs, maxfs;
 	int tbl_sz;
 	int err;
+	int i;
 
 	lid = kzalloc(sizeof(*lid), GFP_KERNEL);
 	if (!lid)
@@ -3361,6 +4918,15 @@ int ionic_lif_alloc(struct ionic *ionic)
 	netdev->watchdog_timeo = 2 * HZ;
 	netif_carrier_off(netdev);
 
+	/* per-lif datapath tunables start at the module param values and
+	 * can be adjusted per device through devlink params; set at alloc
+	 * so a fw reset doesn't revert runtime tuning
+	 */
+	lif->rx_copybreak = rx_copybreak;
+	lif->rx_fill_threshold = rx_fill_threshold;
+	lif->tx_budget = tx_budget;
+	lif->affinity_mask_override = affinity_mask_override;
+
 	lif->nrdma_eqs_avail = ionic->nrdma_eqs_per_lif;
 	lif->nrdma_eqs = ionic->nrdma_eqs_per_lif;
 	lif->nxqs = ionic->ntxqs_per_lif;
@@ -3407,13 +4973,42 @@ int ionic_lif_alloc(struct ionic *ionic)
 	mutex_init(&lif->queue_lock);
 	mutex_init(&lif->config_lock);
 	mutex_init(&lif->dbid_inuse_lock);
+	mutex_init(&lif->client_dma_lock);
+	INIT_LIST_HEAD(&lif->client_dma_arenas);
 
 	spin_lock_init(&lif->adminq_lock);
 
 	spin_lock_init(&lif->deferred.lock);
-	INIT_LIST_HEAD(&lif->deferred.list);
+	init_llist_head(&lif->deferred.list);
+	init_llist_head(&lif->deferred.free_list);
 	INIT_WORK(&lif->deferred.work, ionic_lif_deferred_work);
 
+	timer_setup(&lif->dbell_timer, ionic_napi_deadline, 0);
+
+	/* seed the deferred work pool; if this fails the users simply
+	 * fall back to atomic allocation
+	 */
+	dwork_pool = devm_kcalloc(dev, IONIC_DEFERRED_POOL_SIZE,
+				  sizeof(*dwork_pool), GFP_KERNEL);
+	if (dwork_pool) {
+		for (i = 0; i < IONIC_DEFERRED_POOL_SIZE; i++) {
+			dwork_pool[i].preallocated = true;
+			llist_add(&dwork_pool[i].node,
+				  &lif->deferred.free_list);
+		}
+	}
+
+	/* Routine deferred work runs on an ordered queue private to this
+	 * lif, so one port's slow operation can't delay another's.
+	 * lif->name is "lif0" on every port, so name by bus info instead.
+	 */
+	lif->wq = alloc_ordered_workqueue("ionic-%s", 0,
+					 ionic_bus_info(ionic));
+	if (!lif->wq) {
+		err = -ENOMEM;
+		goto err_out_free_mutex;
+	}
+
 	/* allocate lif info */
 	lif->info_sz = ALIGN(sizeof(*lif->info), PAGE_SIZE);
 	lif->info = dma_alloc_coherent(dev, lif->info_sz,
@@ -3421,9 +5016,13 @@ int ionic_lif_alloc(struct ionic *ionic)
 	if (!lif->info) {
 		dev_err(dev, "Failed to allocate lif info, aborting\n");
 		err = -ENOMEM;
-		goto err_out_free_mutex;
+		goto err_out_free_wq;
 	}
 
+	/* optional; the stats paths fall back to reading the live pages */
+	lif->stats_snap = devm_kzalloc(dev, sizeof(*lif->stats_snap),
+				       GFP_KERNEL);
+
 	ionic_debugfs_add_lif(lif);
 
 	/* allocate control queues and txrx queue arrays */
@@ -3446,20 +5045,53 @@ int ionic_lif_alloc(struct ionic *ionic)
 	}
 	netdev_rss_key_fill(lif->rss_hash_key, IONIC_RSS_HASH_KEY_SIZE);
 
+#ifdef CONFIG_RFS_ACCEL
+	/* optional; without it ndo_rx_flow_steer just reports no support */
+	spin_lock_init(&lif->arfs_lock);
+	lif->arfs_buckets = devm_kcalloc(dev, tbl_sz,
+					 sizeof(*lif->arfs_buckets),
+					 GFP_KERNEL);
+#endif
+
+#ifdef IONIC_DEBUG_STATS
+	/* optional; without it adminq latency just isn't tracked */
+	lif->adminq_lat = vzalloc(IONIC_ADMINQ_LAT_OPS *
+				  sizeof(*lif->adminq_lat));
+#endif
+
+#ifdef HAVE_XSK_BUFF_POOL
+	lif->af_xdp_zc_qps = bitmap_zalloc(lif->ionic->nrxqs_per_lif,
+					   GFP_KERNEL);
+	if (!lif->af_xdp_zc_qps) {
+		err = -ENOMEM;
+		goto err_out_free_rss;
+	}
+#endif
+
 	ionic_lif_alloc_phc(lif);
 
 	return 0;
 
+#ifdef HAVE_XSK_BUFF_POOL
+err_out_free_rss:
+	dma_free_coherent(dev, lif->rss_ind_tbl_sz, lif->rss_ind_tbl,
+			  lif->rss_ind_tbl_pa);
+	lif->rss_ind_tbl = NULL;
+#endif
 err_out_free_qcqs:
 	ionic_qcqs_free(lif);
 err_out_free_lif_info:
 	dma_free_coherent(dev, lif->info_sz, lif->info, lif->info_pa);
 	lif->info = NULL;
 	lif->info_pa = 0;
+err_out_free_wq:
+	destroy_workqueue(lif->wq);
+	lif->wq = NULL;
 err_out_free_mutex:
 	mutex_destroy(&lif->config_lock);
 	mutex_destroy(&lif->queue_lock);
 	mutex_destroy(&lif->dbid_inuse_lock);
+	mutex_destroy(&lif->client_dma_lock);
 	free_netdev(lif->netdev);
 	lif = NULL;
 err_out_free_lid:
@@ -3481,11 +5113,23 @@ static void ionic_lif_reset(struct ionic_lif *lif)
 static void ionic_lif_handle_fw_down(struct ionic_lif *lif)
 {
 	struct ionic *ionic = lif->ionic;
+	bool warm;
 
 	if (test_and_set_bit(IONIC_LIF_F_FW_RESET, lif->state))
 		return;
 
 	dev_info(ionic->dev, "FW Down: Stopping LIFs\n");
+	trace_ionic_fw_down(lif);
+
+	/* Most fw restarts leave the host-side ring memory perfectly
+	 * valid, so keep the qcq allocations and their interrupts and
+	 * only replay the device-side state on the way back up.  Rings
+	 * in controller memory don't get this treatment - the restart
+	 * may repave the CMB, so those are rebuilt from scratch.
+	 */
+	warm = !test_bit(IONIC_LIF_F_CMB_RINGS, lif->state);
+	if (warm)
+		set_bit(IONIC_LIF_F_WARM_RECOVERY, lif->state);
 
 	/* put off the next watchdog if it has been set up */
 	netif_device_detach(lif->netdev);
@@ -3498,11 +5142,19 @@ static void ionic_lif_handle_fw_down(struct ionic_lif *lif)
 
 	if (netif_running(lif->netdev)) {
 		ionic_txrx_deinit(lif);
-		ionic_txrx_free(lif);
+		if (!warm)
+			ionic_txrx_free(lif);
+	}
+	if (warm) {
+		/* the hwstamp replay on the way up expects to recreate
+		 * these, so don't hold them over the restart
+		 */
+		ionic_txrx_free_hwstamp(lif);
 	}
 	ionic_lif_deinit(lif);
 	ionic_reset(ionic);
-	ionic_qcqs_free(lif);
+	if (!warm)
+		ionic_qcqs_free(lif);
 
 	mutex_unlock(&lif->queue_lock);
 
@@ -3513,12 +5165,16 @@ static void ionic_lif_handle_fw_down(struct ionic_lif *lif)
 static void ionic_lif_handle_fw_up(struct ionic_lif *lif)
 {
 	struct ionic *ionic = lif->ionic;
+	bool warm;
 	int err;
 
 	if (!test_bit(IONIC_LIF_F_FW_RESET, lif->state))
 		return;
 
-	dev_info(ionic->dev, "FW Up: restarting LIFs\n");
+	warm = test_and_clear_bit(IONIC_LIF_F_WARM_RECOVERY, lif->state);
+	dev_info(ionic->dev, "FW Up: restarting LIFs%s\n",
+		 warm ? " (warm)" : "");
+	trace_ionic_fw_up(lif);
 
 	ionic_init_devinfo(ionic);
 	err = ionic_identify(ionic);
@@ -3536,13 +5192,22 @@ static void ionic_lif_handle_fw_up(struct ionic_lif *lif)
 	if (test_and_clear_bit(IONIC_LIF_F_BROKEN, lif->state))
 		dev_info(ionic->dev, "FW Up: clearing broken state\n");
 
-	err = ionic_qcqs_alloc(lif);
-	if (err)
-		goto err_unlock;
+	/* on a warm recovery the qcqs and their interrupts survived the
+	 * restart, so only the device-side state needs replaying
+	 */
+	if (!warm) {
+		err = ionic_qcqs_alloc(lif);
+		if (err)
+			goto err_unlock;
+	}
 
 	err = ionic_lif_init(lif);
-	if (err)
+	if (err) {
+		/* the preserved queues don't survive an aborted recovery */
+		if (warm && netif_running(lif->netdev))
+			ionic_txrx_free(lif);
 		goto err_qcqs_free;
+	}
 
 	ionic_vf_attr_replay(lif);
 
@@ -3552,9 +5217,11 @@ static void ionic_lif_handle_fw_up(struct ionic_lif *lif)
 	ionic_rx_filter_replay(lif);
 
 	if (netif_running(lif->netdev)) {
-		err = ionic_txrx_alloc(lif);
-		if (err)
-			goto err_lifs_deinit;
+		if (!warm) {
+			err = ionic_txrx_alloc(lif);
+			if (err)
+				goto err_lifs_deinit;
+		}
 
 		err = ionic_txrx_init(lif);
 		if (err)
@@ -3597,19 +5264,45 @@ void ionic_lif_free(struct ionic_lif *lif)
 {
 	struct device *dev = lif->ionic->dev;
 
+	/* drop this lif's debug stats reference on the datapath key */
+	ionic_dbg_stats_enable(lif, false);
+
 	ionic_lif_free_phc(lif);
 
+#ifdef HAVE_XDP_SUPPORT
+	/* drop any lingering XDP program reference */
+	if (lif->xdp_prog) {
+		bpf_prog_put(lif->xdp_prog);
+		lif->xdp_prog = NULL;
+	}
+#ifdef HAVE_XSK_BUFF_POOL
+	bitmap_free(lif->af_xdp_zc_qps);
+	lif->af_xdp_zc_qps = NULL;
+#endif
+#endif
+
 	/* free rss indirection table */
 	dma_free_coherent(dev, lif->rss_ind_tbl_sz, lif->rss_ind_tbl,
 			  lif->rss_ind_tbl_pa);
 	lif->rss_ind_tbl = NULL;
 	lif->rss_ind_tbl_pa = 0;
 
+	/* free client dma arenas */
+	ionic_lif_client_dma_destroy(lif);
+
 	/* free queues */
 	ionic_qcqs_free(lif);
 	if (!test_bit(IONIC_LIF_F_FW_RESET, lif->state))
 		ionic_lif_reset(lif);
 
+	/* free the pregenerated ethtool stats layout */
+	ionic_stats_layout_free(lif);
+
+#ifdef IONIC_DEBUG_STATS
+	vfree(lif->adminq_lat);
+	lif->adminq_lat = NULL;
+#endif
+
 	/* free lif info */
 	kfree(lif->identity);
 	dma_free_coherent(dev, lif->info_sz, lif->info, lif->info_pa);
@@ -3621,9 +5314,15 @@ void ionic_lif_free(struct ionic_lif *lif)
 	lif->kern_dbpage = NULL;
 	ionic_lif_dbid_inuse_free(lif);
 
+	if (lif->wq) {
+		destroy_workqueue(lif->wq);
+		lif->wq = NULL;
+	}
+
 	mutex_destroy(&lif->config_lock);
 	mutex_destroy(&lif->queue_lock);
 	mutex_destroy(&lif->dbid_inuse_lock);
+	mutex_destroy(&lif->client_dma_lock);
 
 	/* free netdev & lif */
 	ionic_debugfs_del_lif(lif);
@@ -3647,12 +5346,15 @@ void ionic_lif_deinit(struct ionic_lif *lif)
 	ionic_eqs_free(lif->ionic);
 
 	napi_disable(&lif->adminqcq->napi);
+	del_timer_sync(&lif->dbell_timer);
 	ionic_lif_qcq_deinit(lif, lif->notifyqcq);
 	ionic_lif_qcq_deinit(lif, lif->adminqcq);
 
 	ionic_lif_dbid_inuse_free(lif);
 
 	ionic_lif_reset(lif);
+
+	ionic_lif_intr_credits_deinit(lif);
 }
 
 static int ionic_lif_adminq_init(struct ionic_lif *lif)
@@ -3691,7 +5393,6 @@ static int ionic_lif_adminq_init(struct ionic_lif *lif)
 	netif_napi_add(lif->netdev, &qcq->napi, ionic_adminq_napi);
 
 	qcq->napi_qcq = qcq;
-	timer_setup(&qcq->napi_deadline, ionic_napi_deadline, 0);
 
 	napi_enable(&qcq->napi);
 
@@ -3704,6 +5405,66 @@ static int ionic_lif_adminq_init(struct ionic_lif *lif)
 	return 0;
 }
 
+/* Hand the device a per-interrupt credit return shadow array so busy
+ * napi polls can return credits with a plain store instead of a
+ * register write.  Best effort: without the capability, or if the
+ * setattr fails, the register path is used for everything as before.
+ */
+static void ionic_lif_intr_credits_init(struct ionic_lif *lif)
+{
+	struct ionic_dev *idev = &lif->ionic->idev;
+	struct ionic *ionic = lif->ionic;
+	struct ionic_admin_ctx ctx = {
+		.work = COMPLETION_INITIALIZER_ONSTACK(ctx.work),
+		.cmd.lif_setattr = {
+			.opcode = IONIC_CMD_LIF_SETATTR,
+			.index = cpu_to_le16(lif->index),
+			.attr = IONIC_LIF_ATTR_INTR_CREDITS,
+		},
+	};
+	int err;
+
+	if (!(le64_to_cpu(ionic->ident.dev.capabilities) &
+	      IONIC_DEV_CAP_INTR_CREDITS_DMA))
+		return;
+
+	if (!idev->intr_credits) {
+		idev->intr_credits =
+			dma_alloc_coherent(ionic->dev, ionic->nintrs *
+					   sizeof(*idev->intr_credits),
+					   &idev->intr_credits_pa, GFP_KERNEL);
+		if (!idev->intr_credits)
+			return;
+	}
+
+	ctx.cmd.lif_setattr.intr_credits.len = cpu_to_le32(ionic->nintrs);
+	ctx.cmd.lif_setattr.intr_credits.addr =
+		cpu_to_le64(idev->intr_credits_pa);
+
+	err = ionic_adminq_post_wait_nomsg(lif, &ctx);
+	if (err) {
+		dev_dbg(ionic->dev, "intr credit shadow not set: %d\n", err);
+		dma_free_coherent(ionic->dev,
+				  ionic->nintrs * sizeof(*idev->intr_credits),
+				  idev->intr_credits, idev->intr_credits_pa);
+		idev->intr_credits = NULL;
+	}
+}
+
+static void ionic_lif_intr_credits_deinit(struct ionic_lif *lif)
+{
+	struct ionic_dev *idev = &lif->ionic->idev;
+	struct ionic *ionic = lif->ionic;
+
+	if (!idev->intr_credits)
+		return;
+
+	dma_free_coherent(ionic->dev,
+			  ionic->nintrs * sizeof(*idev->intr_credits),
+			  idev->intr_credits, idev->intr_credits_pa);
+	idev->intr_credits = NULL;
+}
+
 static int ionic_lif_notifyq_init(struct ionic_lif *lif)
 {
 	struct ionic_qcq *qcq = lif->notifyqcq;
@@ -3888,6 +5649,8 @@ int ionic_lif_init(struct ionic_lif *lif)
 	if (err)
 		goto err_out_adminq_deinit;
 
+	ionic_lif_intr_credits_init(lif);
+
 	if (lif->ionic->nnqs_per_lif) {
 		err = ionic_lif_notifyq_init(lif);
 		if (err)
@@ -3908,11 +5671,10 @@ int ionic_lif_init(struct ionic_lif *lif)
 	if (err)
 		goto err_out_notifyq_deinit;
 
-	lif->rx_copybreak = rx_copybreak;
-
 	set_bit(IONIC_LIF_F_INITED, lif->state);
 
 	INIT_WORK(&lif->tx_timeout_work, ionic_tx_timeout_work);
+	lif->tx_timeout_txq = IONIC_TX_TIMEOUT_NONE;
 
 	return 0;
 
@@ -4002,6 +5764,16 @@ int ionic_lif_register(struct ionic_lif *lif)
 		return err;
 	}
 
+#ifdef HAVE_NETDEV_THREADED
+	/* One poller kthread per napi instance; in the combined tx/rx
+	 * interrupt mode each thread services the whole queue pair.  The
+	 * threads can be prioritized and pinned from userspace, and the
+	 * mode toggled later through /sys/class/net/<dev>/threaded.
+	 */
+	if (threaded_napi)
+		dev_set_threaded(lif->netdev, true);
+
+#endif
 	ionic_link_status_check_request(lif, CAN_SLEEP);
 	lif->registered = true;
 	ionic_lif_set_netdev_info(lif);
@@ -4,6 +4,7 @@
 #ifndef _IONIC_LIF_H_
 #define _IONIC_LIF_H_
 
+#include <linux/llist.h>
 #include <linux/ptp_clock_kernel.h>
 #include <linux/timecounter.h>
 
@@ -30,8 +31,28 @@
 
 /* Tunables */
 #define IONIC_RX_COPYBREAK_DEFAULT	256
+#define IONIC_RX_COPYBREAK_MIN		64
+#define IONIC_RX_MAX_HEADER_LEN		256
 #define IONIC_TX_BUDGET_DEFAULT		256
 
+/* Byte queue limits on the tx rings; the netdev_tx_* accounting
+ * calls compile away on kernels built without CONFIG_BQL.
+ */
+#define IONIC_SUPPORTS_BQL
+
+/* XDP_PACKET_HEADROOM is taken out of the single rx buffer,
+ * so only a linear frame that also fits the headroom can be
+ * handled by an attached XDP program.
+ */
+#define IONIC_XDP_MAX_LINEAR_MTU	(IONIC_PAGE_SIZE -		\
+					 (XDP_PACKET_HEADROOM +		\
+					  SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) + \
+					  ETH_HLEN + VLAN_HLEN))
+
+/* Queue counters have a single writer, the queue's napi context, and the
+ * collectors only read; keep each queue's block on its own cachelines so
+ * stats collection never shares a line with a neighbor's datapath.
+ */
 struct ionic_tx_stats {
 	u64 pkts;
 	u64 bytes;
@@ -44,13 +65,14 @@ struct ionic_tx_stats {
 	u64 clean;
 	u64 linearize;
 	u64 crc32_csum;
+	u64 xdp_frames;
 #ifdef IONIC_DEBUG_STATS
 	u64 sg_cntr[IONIC_MAX_NUM_SG_CNTR];
 #endif
 	u64 dma_map_err;
 	u64 hwstamp_valid;
 	u64 hwstamp_invalid;
-};
+} ____cacheline_aligned_in_smp;
 
 struct ionic_rx_stats {
 	u64 pkts;
@@ -75,7 +97,12 @@ struct ionic_rx_stats {
 	u64 buf_reused;
 	u64 buf_exhausted;
 	u64 buf_not_reusable;
-};
+	u64 xdp_drop;
+	u64 xdp_aborted;
+	u64 xdp_pass;
+	u64 xdp_tx;
+	u64 xdp_redirect;
+} ____cacheline_aligned_in_smp;
 
 #define IONIC_QCQ_F_INITED		BIT(0)
 #define IONIC_QCQ_F_SG			BIT(1)
@@ -89,9 +116,29 @@ struct ionic_rx_stats {
 struct ionic_napi_stats {
 	u64 poll_count;
 	u64 work_done_cntr[IONIC_MAX_NUM_NAPI_CNTR];
-};
+} ____cacheline_aligned_in_smp;
+
+/* log2(nsec) buckets; the last bucket is a catch-all for the tail */
+#define IONIC_LAT_BUCKETS		32
+/* sample 1 in (IONIC_LAT_SAMPLE_MASK + 1) descriptors */
+#define IONIC_LAT_SAMPLE_MASK		63
+/* adminq latency is tracked per opcode; the opcode is a u8 */
+#define IONIC_ADMINQ_LAT_OPS		256
+
+struct ionic_lat_hist {
+	u64 samples;
+	u64 buckets[IONIC_LAT_BUCKETS];
+} ____cacheline_aligned_in_smp;
 #endif
 
+/* per-napi-poll snapshot of the phc conversion state, so each packet
+ * in a poll converts with pure arithmetic; see ionic_lif_phc_snap()
+ */
+struct ionic_phc_snap {
+	struct cyclecounter cc;
+	struct timecounter tc;
+};
+
 struct ionic_qcq {
 	void *q_base;
 	dma_addr_t q_base_pa;	/* might not be page aligned */
@@ -108,14 +155,27 @@ struct ionic_qcq {
 	u32 cmb_pgid;
 	u32 cmb_order;
 	bool armed;
+	bool dbell_pending;
+	bool poll_mode;
+	int node;
+	bool coal_override;
+	u16 stall_tail;		/* health probe's last seen consumer index */
+	u8 stall_cnt;
+	u32 cred_defer;
+	u32 coal_usecs;
+	u32 dim_usecs_min;
+	u32 dim_usecs_max;
 	struct dim dim;
 	struct ionic_queue q;
 	struct ionic_cq cq;
 	struct ionic_intr_info intr;
-	struct timer_list napi_deadline;
+	struct ionic_phc_snap phc_snap;
 	struct napi_struct napi;
 #ifdef IONIC_DEBUG_STATS
 	struct ionic_napi_stats napi_stats;
+	struct ionic_lat_hist post_hist;
+	struct ionic_lat_hist napi_hist;
+	u64 napi_start_ns;
 #endif
 	unsigned int flags;
 	struct ionic_qcq *napi_qcq;
@@ -132,20 +192,26 @@ enum ionic_deferred_work_type {
 	IONIC_DW_TYPE_RX_MODE,
 	IONIC_DW_TYPE_LINK_STATUS,
 	IONIC_DW_TYPE_LIF_RESET,
+	IONIC_DW_TYPE_RSS_UPDATE,
 };
 
 struct ionic_deferred_work {
-	struct list_head list;
+	struct llist_node node;
 	enum ionic_deferred_work_type type;
+	bool preallocated;
 	union {
 		u8 addr[ETH_ALEN];
 		u8 fw_status;
 	};
 };
 
+#define IONIC_DEFERRED_POOL_SIZE	16
+
 struct ionic_deferred {
-	spinlock_t lock;		/* lock for deferred work list */
-	struct list_head list;
+	spinlock_t lock;		/* serializes free pool consumers */
+	struct llist_head list;
+	struct llist_head free_list;
+	unsigned long pending;		/* one bit per coalescable work type */
 	struct work_struct work;
 };
 
@@ -172,6 +238,21 @@ struct ionic_lif_sw_stats {
 	u64 hw_tx_aborted_errors;
 };
 
+/* Host-side snapshot of the fw-maintained stats regions, so one ethtool
+ * scrape reports values from a single pass over each live page rather
+ * than field-by-field reads racing the fw's DMA updates.
+ */
+struct ionic_stats_snap {
+	struct ionic_lif_stats lif;
+	union {
+		struct ionic_port_stats      port;
+		struct ionic_mgmt_port_stats mgmt;
+	};
+};
+
+/* pregenerated ethtool stats layout, see ionic_stats.c */
+struct ionic_stats_layout;
+
 enum ionic_lif_state_flags {
 	IONIC_LIF_F_INITED,
 	IONIC_LIF_F_SW_DEBUG_STATS,
@@ -186,6 +267,8 @@ enum ionic_lif_state_flags {
 	IONIC_LIF_F_TX_DIM_INTR,
 	IONIC_LIF_F_RX_DIM_INTR,
 	IONIC_LIF_F_CMB_RINGS,
+	IONIC_LIF_F_RX_GRO_FRAGS,
+	IONIC_LIF_F_WARM_RECOVERY,
 
 	/* leave this as last */
 	IONIC_LIF_F_STATE_SIZE
@@ -211,6 +294,18 @@ struct ionic_qtype_info {
 };
 
 struct ionic_phc;
+struct gen_pool;
+
+#ifdef CONFIG_RFS_ACCEL
+/* Per RSS indirection slot aRFS steering state; the slot index doubles
+ * as the filter id handed back to the stack.
+ */
+struct ionic_arfs_bucket {
+	u32 flow_id;
+	u16 rxq_index;
+	bool steered;
+};
+#endif
 
 #define IONIC_LIF_NAME_MAX_SZ		32
 struct ionic_lif {
@@ -219,16 +314,32 @@ struct ionic_lif {
 	struct ionic *ionic;
 	u64 __iomem *kern_dbpage;
 	u32 rx_copybreak;
+	u32 rx_fill_threshold;
+	u32 tx_budget;
+	u64 affinity_mask_override;
 	unsigned int nxqs;
 
 	struct ionic_qcq **txqcqs;
 	struct ionic_tx_stats *txqstats;
 	struct ionic_qcq **rxqcqs;
 	struct ionic_rx_stats *rxqstats;
+#ifdef HAVE_XDP_SUPPORT
+	struct ionic_qcq **xdpqcqs;
+	struct bpf_prog *xdp_prog;
+#ifdef HAVE_XSK_BUFF_POOL
+	unsigned long *af_xdp_zc_qps;	/* bitmap of XSK zero-copy queues */
+#endif
+#endif
 	struct ionic_qcq *hwstamp_txq;
 	struct ionic_qcq *hwstamp_rxq;
 
 	struct ionic_qcq *adminqcq;
+	union ionic_adminq_cmd *adminq_cmds; /* v1 indirect command bodies */
+	dma_addr_t adminq_cmds_pa;
+	u32 adminq_cmds_sz;
+#ifdef IONIC_DEBUG_STATS
+	struct ionic_lat_hist *adminq_lat; /* per-opcode post-to-completion */
+#endif
 	struct ionic_qcq *notifyqcq;
 	struct mutex queue_lock;	/* lock for queue structures */
 	struct mutex config_lock;	/* lock for config actions */
@@ -236,7 +347,10 @@ struct ionic_lif {
 	unsigned int kern_pid;
 
 	struct work_struct tx_timeout_work;
+	u32 tx_timeout_txq;
 	struct ionic_deferred deferred;
+	struct workqueue_struct *wq;	/* ordered, per-lif deferred work */
+	struct timer_list dbell_timer;	/* doorbell deadline for all queues */
 
 	u64 last_eid;
 	unsigned int nrdma_eqs;
@@ -256,6 +370,12 @@ struct ionic_lif {
 	u32 rss_ind_tbl_sz;
 	u16 rss_types;
 
+#ifdef CONFIG_RFS_ACCEL
+	struct ionic_arfs_bucket *arfs_buckets;
+	spinlock_t arfs_lock;		/* aRFS steering table lock */
+	u32 arfs_expiry_cursor;
+#endif
+
 	u16 lif_type;
 	unsigned int nmcast;
 	unsigned int nucast;
@@ -266,11 +386,17 @@ struct ionic_lif {
 	struct ionic_lif_info *info;
 	dma_addr_t info_pa;
 	u32 info_sz;
+	struct ionic_stats_snap *stats_snap;
+	struct ionic_stats_layout *stats_layout;
 
 	unsigned int dbid_count;
 	struct mutex dbid_inuse_lock;	/* lock the dbid bit list */
 	unsigned long *dbid_inuse;
 
+	struct gen_pool *client_dma_pool;
+	struct list_head client_dma_arenas;
+	struct mutex client_dma_lock;	/* lock the client dma pool */
+
 	union ionic_lif_identity *identity;
 	struct ionic_qtype_info qtype_info[IONIC_QTYPE_MAX];
 
@@ -292,7 +418,8 @@ struct ionic_lif {
 
 #if IS_ENABLED(CONFIG_PTP_1588_CLOCK)
 struct ionic_phc {
-	spinlock_t lock; /* lock for cc and tc */
+	spinlock_t lock; /* lock for cc and tc updates */
+	seqcount_t seq;  /* for lockless cc and tc readers */
 	struct cyclecounter cc;
 	struct timecounter tc;
 
@@ -352,6 +479,20 @@ static inline void ionic_set_queue_params(struct ionic_lif *lif,
 		clear_bit(IONIC_LIF_F_CMB_RINGS, lif->state);
 }
 
+/* Flag the queue as having unrung doorbell work and make sure the lif's
+ * deadline timer is running.  One timer covers all of the lif's queues,
+ * so when it is already pending - the common case under load - this is
+ * just a flag set, with no timer base lock taken on the hot path.
+ */
+static inline void ionic_napi_deadline_set(struct ionic_qcq *qcq)
+{
+	struct ionic_lif *lif = qcq->q.lif;
+
+	WRITE_ONCE(qcq->dbell_pending, true);
+	if (!timer_pending(&lif->dbell_timer))
+		mod_timer(&lif->dbell_timer, jiffies + IONIC_NAPI_DEADLINE);
+}
+
 static inline u32 ionic_coal_usec_to_hw(struct ionic *ionic, u32 usecs)
 {
 	u32 mult = le32_to_cpu(ionic->ident.dev.intr_coal_mult);
@@ -380,6 +521,7 @@ static inline bool ionic_use_eqs(struct ionic_lif *lif)
 	       lif->qtype_info[IONIC_QTYPE_RXQ].features & IONIC_QIDENT_F_EQ;
 }
 
+struct ionic_deferred_work *ionic_lif_deferred_get(struct ionic_lif *lif);
 void ionic_lif_deferred_enqueue(struct ionic_deferred *def,
 				struct ionic_deferred_work *work);
 void ionic_link_status_check_request(struct ionic_lif *lif, bool can_sleep);
@@ -390,6 +532,8 @@ void ionic_get_stats64(struct net_device *netdev,
 struct rtnl_link_stats64 *ionic_get_stats64(struct net_device *netdev,
 					    struct rtnl_link_stats64 *ns);
 #endif
+void ionic_fill_stats64(struct ionic_lif_stats *ls,
+			struct rtnl_link_stats64 *ns);
 int ionic_lif_register(struct ionic_lif *lif);
 void ionic_lif_unregister(struct ionic_lif *lif);
 int ionic_lif_identify(struct ionic *ionic, u8 lif_type,
@@ -402,6 +546,8 @@ void ionic_lif_hwstamp_recreate_queues(struct ionic_lif *lif);
 int ionic_lif_hwstamp_set(struct ionic_lif *lif, struct ifreq *ifr);
 int ionic_lif_hwstamp_get(struct ionic_lif *lif, struct ifreq *ifr);
 ktime_t ionic_lif_phc_ktime(struct ionic_lif *lif, u64 counter);
+void ionic_lif_phc_snap(struct ionic_lif *lif, struct ionic_phc_snap *snap);
+ktime_t ionic_lif_phc_snap_ktime(struct ionic_phc_snap *snap, u64 tick);
 void ionic_lif_register_phc(struct ionic_lif *lif);
 void ionic_lif_unregister_phc(struct ionic_lif *lif);
 void ionic_lif_alloc_phc(struct ionic_lif *lif);
@@ -425,6 +571,14 @@ static inline ktime_t ionic_lif_phc_ktime(struct ionic_lif *lif, u64 counter)
 	return ns_to_ktime(0);
 }
 
+static inline void ionic_lif_phc_snap(struct ionic_lif *lif,
+				      struct ionic_phc_snap *snap) {}
+static inline ktime_t ionic_lif_phc_snap_ktime(struct ionic_phc_snap *snap,
+					       u64 tick)
+{
+	return ns_to_ktime(0);
+}
+
 static inline void ionic_lif_register_phc(struct ionic_lif *lif) {}
 static inline void ionic_lif_unregister_phc(struct ionic_lif *lif) {}
 static inline void ionic_lif_alloc_phc(struct ionic_lif *lif) {}
@@ -439,6 +593,7 @@ int ionic_lif_set_hwstamp_rxfilt(struct ionic_lif *lif, u64 pkt_class);
 
 int ionic_lif_rss_config(struct ionic_lif *lif, u16 types,
 			 const u8 *key, const u32 *indir);
+int ionic_lif_rss_update_indir(struct ionic_lif *lif, const u32 *indir);
 
 int ionic_intr_alloc(struct ionic *ionic, struct ionic_intr_info *intr);
 void ionic_intr_free(struct ionic *ionic, int index);
@@ -447,8 +602,11 @@ int ionic_reconfigure_queues(struct ionic_lif *lif,
 			     struct ionic_queue_params *qparam);
 int ionic_lif_alloc(struct ionic *ionic);
 int ionic_lif_init(struct ionic_lif *lif);
+int ionic_lif_suspend(struct ionic_lif *lif);
+int ionic_lif_resume(struct ionic_lif *lif);
 void ionic_lif_free(struct ionic_lif *lif);
 void ionic_lif_deinit(struct ionic_lif *lif);
+void ionic_lif_client_dma_destroy(struct ionic_lif *lif);
 
 int ionic_lif_addr_add(struct ionic_lif *lif, const u8 *addr);
 int ionic_lif_addr_del(struct ionic_lif *lif, const u8 *addr);
@@ -457,6 +615,20 @@ struct ionic_lif *ionic_netdev_lif(struct net_device *netdev);
 void ionic_device_reset(struct ionic_lif *lif);
 
 #ifdef IONIC_DEBUG_STATS
+/* patched in only while some lif has debug stats collection enabled
+ * (the sw-dbg-stats priv flag or the lif's sw_dbg_stats debugfs file),
+ * so with no collectors the hot path costs a patched-out branch
+ */
+DECLARE_STATIC_KEY_FALSE(ionic_dbg_stats_key);
+
+void ionic_dbg_stats_enable(struct ionic_lif *lif, bool enable);
+
+static inline bool ionic_dbg_stats_on(struct ionic_lif *lif)
+{
+	return static_branch_unlikely(&ionic_dbg_stats_key) &&
+	       test_bit(IONIC_LIF_F_SW_DEBUG_STATS, lif->state);
+}
+
 static inline void debug_stats_txq_post(struct ionic_queue *q, bool dbell)
 {
 	struct ionic_txq_desc *desc = &q->txq[q->head_idx];
@@ -472,26 +644,110 @@ static inline void debug_stats_txq_post(struct ionic_queue *q, bool dbell)
 	q->lif->txqstats[q->index].sg_cntr[num_sg_elems]++;
 }
 
+static inline void ionic_lat_hist_add(struct ionic_lat_hist *hist, u64 ns)
+{
+	int bucket = ns ? min(ilog2(ns), IONIC_LAT_BUCKETS - 1) : 0;
+
+	hist->buckets[bucket]++;
+	hist->samples++;
+}
+
+/* Stamp every Nth descriptor as it is posted; ionic_tx_clean() and
+ * ionic_rx_clean() turn the stamp into a post-to-completion sample.
+ */
+static inline void debug_stats_desc_post(struct ionic_queue *q,
+					 struct ionic_desc_info *desc_info)
+{
+	if (likely(q->lat_sample++ & IONIC_LAT_SAMPLE_MASK))
+		desc_info->lat_ts = 0;
+	else
+		desc_info->lat_ts = ktime_get_ns();
+}
+
+static inline void debug_stats_desc_comp(struct ionic_qcq *qcq,
+					 struct ionic_desc_info *desc_info)
+{
+	if (desc_info->lat_ts) {
+		ionic_lat_hist_add(&qcq->post_hist,
+				   ktime_get_ns() - desc_info->lat_ts);
+		desc_info->lat_ts = 0;
+	}
+}
+
+static inline void debug_stats_napi_enter(struct ionic_qcq *qcq)
+{
+	if (!(qcq->napi_stats.poll_count & IONIC_LAT_SAMPLE_MASK))
+		qcq->napi_start_ns = ktime_get_ns();
+	else
+		qcq->napi_start_ns = 0;
+}
+
 static inline void debug_stats_napi_poll(struct ionic_qcq *qcq,
 					 unsigned int work_done)
 {
 	qcq->napi_stats.poll_count++;
 
+	if (qcq->napi_start_ns) {
+		ionic_lat_hist_add(&qcq->napi_hist,
+				   ktime_get_ns() - qcq->napi_start_ns);
+		qcq->napi_start_ns = 0;
+	}
+
 	if (work_done > (IONIC_MAX_NUM_NAPI_CNTR - 1))
 		work_done = IONIC_MAX_NUM_NAPI_CNTR - 1;
 
 	qcq->napi_stats.work_done_cntr[work_done]++;
 }
 
-#define DEBUG_STATS_CQE_CNT(cq)		((cq)->compl_count++)
-#define DEBUG_STATS_RX_BUFF_CNT(q)	((q)->lif->rxqstats[q->index].buffers_posted++)
-#define DEBUG_STATS_TXQ_POST(q, dbell)  debug_stats_txq_post(q, dbell)
-#define DEBUG_STATS_NAPI_POLL(qcq, work_done) \
-	debug_stats_napi_poll(qcq, work_done)
+#define DEBUG_STATS_CQE_CNT(cq)						\
+	do {								\
+		if (ionic_dbg_stats_on((cq)->lif))			\
+			(cq)->compl_count++;				\
+	} while (0)
+#define DEBUG_STATS_RX_BUFF_CNT(q)					\
+	do {								\
+		if (ionic_dbg_stats_on((q)->lif))			\
+			(q)->lif->rxqstats[(q)->index].buffers_posted++; \
+	} while (0)
+#define DEBUG_STATS_TXQ_POST(q, dbell)					\
+	do {								\
+		if (ionic_dbg_stats_on((q)->lif))			\
+			debug_stats_txq_post(q, dbell);			\
+	} while (0)
+/* clear any stale stamp when disabled so an enable mid-flight can't
+ * turn an old stamp into a bogus post-to-completion sample
+ */
+#define DEBUG_STATS_DESC_POST(q, desc_info)				\
+	do {								\
+		if (ionic_dbg_stats_on((q)->lif))			\
+			debug_stats_desc_post(q, desc_info);		\
+		else							\
+			(desc_info)->lat_ts = 0;			\
+	} while (0)
+#define DEBUG_STATS_DESC_COMP(qcq, desc_info)				\
+	do {								\
+		if (ionic_dbg_stats_on((qcq)->q.lif))			\
+			debug_stats_desc_comp(qcq, desc_info);		\
+	} while (0)
+#define DEBUG_STATS_NAPI_ENTER(qcq)					\
+	do {								\
+		if (ionic_dbg_stats_on((qcq)->q.lif))			\
+			debug_stats_napi_enter(qcq);			\
+		else							\
+			(qcq)->napi_start_ns = 0;			\
+	} while (0)
+#define DEBUG_STATS_NAPI_POLL(qcq, work_done)				\
+	do {								\
+		if (ionic_dbg_stats_on((qcq)->q.lif))			\
+			debug_stats_napi_poll(qcq, work_done);		\
+	} while (0)
 #else
 #define DEBUG_STATS_CQE_CNT(cq)
 #define DEBUG_STATS_RX_BUFF_CNT(q)
 #define DEBUG_STATS_TXQ_POST(q, dbell)
+#define DEBUG_STATS_DESC_POST(q, desc_info)
+#define DEBUG_STATS_DESC_COMP(qcq, desc_info)
+#define DEBUG_STATS_NAPI_ENTER(qcq)
 #define DEBUG_STATS_NAPI_POLL(qcq, work_done)
 #endif
 
@@ -13,6 +13,9 @@
 #include "ionic_lif.h"
 #include "ionic_debugfs.h"
 
+#define CREATE_TRACE_POINTS
+#include "ionic_trace.h"
+
 bool port_init_up = 1;
 module_param(port_init_up, bool, 0);
 MODULE_PARM_DESC(max_slaves, "Set port to ADMIN_UP on init (default 1, 0 to disable)");
@@ -43,6 +46,10 @@ unsigned long affinity_mask_override;
 module_param(affinity_mask_override, ulong, 0600);
 MODULE_PARM_DESC(affinity_mask_override, "IRQ affinity mask to override (max 64 bits)");
 
+bool threaded_napi;
+module_param(threaded_napi, bool, 0444);
+MODULE_PARM_DESC(threaded_napi, "Run NAPI polling in kthreads instead of softirq (default 0)");
+
 static const char *ionic_error_to_str(enum ionic_status_code code)
 {
 	switch (code) {
@@ -142,7 +149,7 @@ int ionic_error_to_errno(enum ionic_status_code code)
 }
 EXPORT_SYMBOL_GPL(ionic_error_to_errno);
 
-static const char *ionic_opcode_to_str(enum ionic_cmd_opcode opcode)
+const char *ionic_opcode_to_str(enum ionic_cmd_opcode opcode)
 {
 	switch (opcode) {
 	case IONIC_CMD_NOP:
@@ -254,7 +261,7 @@ static void ionic_adminq_flush(struct ionic_lif *lif)
 
 	while (q->tail_idx != q->head_idx) {
 		desc_info = &q->info[q->tail_idx];
-		memset(desc_info->desc, 0, sizeof(union ionic_adminq_cmd));
+		memset(desc_info->desc, 0, q->desc_size);
 		desc_info->cb = NULL;
 		desc_info->cb_arg = NULL;
 		q->tail_idx = (q->tail_idx + 1) & (q->num_descs - 1);
@@ -289,13 +296,19 @@ static int ionic_adminq_check_err(struct ionic_lif *lif,
 			ionic_adminq_netdev_err_print(lif, ctx->cmd.cmd.opcode,
 						      ctx->comp.comp.status, err);
 
-		if (timeout)
+		if (timeout) {
+			ionic_devlink_health_report_adminq(lif,
+							   ctx->cmd.cmd.opcode);
 			ionic_adminq_flush(lif);
+		}
 	}
 
 	return err;
 }
 
+/* post-to-completion time past which an admin command is called out */
+#define IONIC_ADMINQ_SLOW_NS	(10 * NSEC_PER_MSEC)
+
 static void ionic_adminq_cb(struct ionic_queue *q,
 			    struct ionic_desc_info *desc_info,
 			    struct ionic_cq_info *cq_info, void *cb_arg)
@@ -314,6 +327,33 @@ static void ionic_adminq_cb(struct ionic_queue *q,
 	dynamic_hex_dump("comp ", DUMP_PREFIX_OFFSET, 16, 1,
 			 &ctx->comp, sizeof(ctx->comp), true);
 
+	trace_ionic_adminq_comp(q->lif, ctx->cmd.cmd.opcode,
+				comp->status);
+
+	if (ctx->post_ns) {
+		u64 lat_ns = ktime_get_ns() - ctx->post_ns;
+
+#ifdef IONIC_DEBUG_STATS
+		if (q->lif->adminq_lat)
+			ionic_lat_hist_add(&q->lif->adminq_lat[ctx->cmd.cmd.opcode],
+					   lat_ns);
+#endif
+		/* slow completions with a deep ring at post point at
+		 * contention for the ring; slow with a shallow ring
+		 * point at fw backpressure on the command itself
+		 */
+		if (lat_ns > IONIC_ADMINQ_SLOW_NS)
+			netdev_warn_ratelimited(q->lif->netdev,
+						"slow adminq cmd %s (%d): %llu usecs, %u cmds in flight at post\n",
+						ionic_opcode_to_str(ctx->cmd.cmd.opcode),
+						ctx->cmd.cmd.opcode,
+						div_u64(lat_ns, NSEC_PER_USEC),
+						ctx->post_depth);
+	}
+
+	if (ctx->cb)
+		ctx->cb(ctx);
+
 	complete_all(&ctx->work);
 }
 
@@ -346,7 +386,9 @@ bool ionic_adminq_poke_doorbell(struct ionic_queue *q)
 	return true;
 }
 
-int ionic_adminq_post(struct ionic_lif *lif, struct ionic_admin_ctx *ctx)
+static int __ionic_adminq_post(struct ionic_lif *lif,
+			       struct ionic_admin_ctx *ctx,
+			       const bool ring_db)
 {
 	struct ionic_desc_info *desc_info;
 	unsigned long irqflags;
@@ -371,13 +413,31 @@ int ionic_adminq_post(struct ionic_lif *lif, struct ionic_admin_ctx *ctx)
 		goto err_out;
 
 	desc_info = &q->info[q->head_idx];
-	memcpy(desc_info->desc, &ctx->cmd, sizeof(ctx->cmd));
+	if (lif->adminq_cmds) {
+		/* compact v1 descriptor referencing the command body */
+		struct ionic_admin_indir_cmd *desc = desc_info->desc;
+
+		memcpy(&lif->adminq_cmds[q->head_idx], &ctx->cmd,
+		       sizeof(ctx->cmd));
+		desc->opcode = ctx->cmd.cmd.opcode;
+		desc->lif_index = ctx->cmd.cmd.lif_index;
+		desc->len = cpu_to_le16(sizeof(ctx->cmd));
+		desc->addr = cpu_to_le64(lif->adminq_cmds_pa +
+					 q->head_idx * sizeof(ctx->cmd));
+	} else {
+		memcpy(desc_info->desc, &ctx->cmd, sizeof(ctx->cmd));
+	}
 
 	dev_dbg(&lif->netdev->dev, "post admin queue command:\n");
 	dynamic_hex_dump("cmd ", DUMP_PREFIX_OFFSET, 16, 1,
 			 &ctx->cmd, sizeof(ctx->cmd), true);
 
-	ionic_q_post(q, true, ionic_adminq_cb, ctx);
+	trace_ionic_adminq_post(lif, ctx->cmd.cmd.opcode);
+
+	ctx->post_ns = ktime_get_ns();
+	ctx->post_depth = (q->head_idx - q->tail_idx) & (q->num_descs - 1);
+
+	ionic_q_post(q, ring_db, ionic_adminq_cb, ctx);
 
 err_out:
 	spin_unlock_irqrestore(&lif->adminq_lock, irqflags);
@@ -385,6 +445,36 @@ err_out:
 	return err;
 }
 
+int ionic_adminq_post(struct ionic_lif *lif, struct ionic_admin_ctx *ctx)
+{
+	return __ionic_adminq_post(lif, ctx, true);
+}
+
+int ionic_adminq_post_nowait(struct ionic_lif *lif, struct ionic_admin_ctx *ctx)
+{
+	return __ionic_adminq_post(lif, ctx, false);
+}
+
+void ionic_adminq_kick(struct ionic_lif *lif)
+{
+	unsigned long irqflags;
+	struct ionic_queue *q;
+
+	spin_lock_irqsave(&lif->adminq_lock, irqflags);
+	if (!lif->adminqcq) {
+		spin_unlock_irqrestore(&lif->adminq_lock, irqflags);
+		return;
+	}
+
+	q = &lif->adminqcq->q;
+	if (q->tail_idx != q->head_idx) {
+		ionic_dbell_ring(lif->kern_dbpage, q->hw_type,
+				 q->dbval | q->head_idx);
+		q->dbell_jiffies = jiffies;
+	}
+	spin_unlock_irqrestore(&lif->adminq_lock, irqflags);
+}
+
 int ionic_adminq_wait(struct ionic_lif *lif, struct ionic_admin_ctx *ctx,
 		      const int err, const bool do_msg)
 {
@@ -464,6 +554,27 @@ int ionic_adminq_post_wait_nomsg(struct ionic_lif *lif, struct ionic_admin_ctx *
 	return __ionic_adminq_post_wait(lif, ctx, false);
 }
 
+/* Wait on a batch of commands posted with ionic_adminq_post_nowait()
+ * and kicked with a single doorbell from ionic_adminq_kick().  The
+ * device completes in posting order, so after the last command's wait
+ * is satisfied the earlier ones mostly return without sleeping.
+ */
+int ionic_adminq_wait_batch(struct ionic_lif *lif,
+			    struct ionic_admin_ctx **ctxs, int nctx)
+{
+	int first_err = 0;
+	int err;
+	int i;
+
+	for (i = 0; i < nctx; i++) {
+		err = ionic_adminq_wait(lif, ctxs[i], 0, true);
+		if (err && !first_err)
+			first_err = err;
+	}
+
+	return first_err;
+}
+
 static void ionic_dev_cmd_clean(struct ionic *ionic)
 {
 	struct ionic_dev *idev = &ionic->idev;
@@ -489,6 +600,7 @@ static int __ionic_dev_cmd_wait(struct ionic *ionic, unsigned long max_seconds,
 {
 	struct ionic_dev *idev = &ionic->idev;
 	unsigned long start_time;
+	unsigned int spin_polls;
 	unsigned long max_wait;
 	unsigned long duration;
 	int done = 0;
@@ -503,13 +615,24 @@ static int __ionic_dev_cmd_wait(struct ionic *ionic, unsigned long max_seconds,
 try_again:
 	opcode = ioread8(&idev->dev_cmd_regs->cmd.cmd.opcode);
 	start_time = jiffies;
+	spin_polls = IONIC_DEVCMD_SPIN_POLLS;
 	for (fw_up = ionic_is_fw_running(idev);
 	     !done && fw_up && time_before(jiffies, max_wait);
 	     fw_up = ionic_is_fw_running(idev)) {
 		done = ionic_dev_cmd_done(idev);
 		if (done)
 			break;
-		usleep_range(100, 200);
+		/* Most commands finish in tens of microseconds, so spin
+		 * on the done bit briefly before dropping into sleepy
+		 * polling; otherwise the identify chains at probe time
+		 * pay the sleep granularity on every single command.
+		 */
+		if (spin_polls) {
+			spin_polls--;
+			udelay(1);
+		} else {
+			usleep_range(100, 200);
+		}
 	}
 	duration = jiffies - start_time;
 
@@ -789,6 +912,8 @@ int ionic_port_reset(struct ionic *ionic)
 	return err;
 }
 
+struct workqueue_struct *ionic_recovery_wq;
+
 static int __init ionic_init_module(void)
 {
 	unsigned long max_affinity = GENMASK_ULL((min(num_present_cpus(),
@@ -797,6 +922,12 @@ static int __init ionic_init_module(void)
 	pr_info("%s %s, ver %s\n",
 		IONIC_DRV_NAME, IONIC_DRV_DESCRIPTION, IONIC_DRV_VERSION);
 
+	ionic_recovery_wq = alloc_workqueue("ionic-recovery",
+					    WQ_UNBOUND | WQ_HIGHPRI |
+					    WQ_MEM_RECLAIM, 0);
+	if (!ionic_recovery_wq)
+		return -ENOMEM;
+
 	ionic_debugfs_create();
 
 	if (affinity_mask_override) {
@@ -822,6 +953,7 @@ static void __exit ionic_cleanup_module(void)
 	devcmd_timeout = min_t(int, devcmd_timeout, SHORT_TIMEOUT);
 
 	ionic_bus_unregister_driver();
+	destroy_workqueue(ionic_recovery_wq);
 	ionic_debugfs_destroy();
 
 	pr_info("%s removed\n", IONIC_DRV_NAME);
@@ -320,6 +320,33 @@ static u64 ionic_cc_read(const struct cyclecounter *cc)
 #endif
 }
 
+/* Convert a device tick to nanoseconds from a coherent snapshot of the
+ * timecounter state, without taking phc->lock.  Writers hold the lock and
+ * bump phc->seq around their updates; readers retry if they raced one.
+ * Only cc.mult and the timecounter basis ever change after alloc, so the
+ * rest of the local cyclecounter copy is stable.
+ */
+static u64 ionic_phc_cyc2time(struct ionic_phc *phc, u64 tick)
+{
+	struct cyclecounter cc;
+	struct timecounter tc;
+	unsigned int seq;
+
+	cc = phc->cc;
+	tc.cc = &cc;
+	tc.mask = (1ULL << cc.shift) - 1;
+
+	do {
+		seq = read_seqcount_begin(&phc->seq);
+		tc.cycle_last = phc->tc.cycle_last;
+		tc.nsec = phc->tc.nsec;
+		tc.frac = phc->tc.frac;
+		cc.mult = phc->cc.mult;
+	} while (read_seqcount_retry(&phc->seq, seq));
+
+	return timecounter_cyc2time(&tc, tick);
+}
+
 static int ionic_setphc_cmd(struct ionic_phc *phc, struct ionic_admin_ctx *ctx)
 {
 	ctx->work = COMPLETION_INITIALIZER_ONSTACK(ctx->work);
@@ -361,8 +388,10 @@ static int ionic_phc_adjfine(struct ptp_clock_info *info, long scaled_ppm)
 	spin_lock_irqsave(&phc->lock, irqflags);
 
 	/* update the point-in-time basis to now, before adjusting the rate */
+	write_seqcount_begin(&phc->seq);
 	timecounter_read(&phc->tc);
 	phc->cc.mult = adj;
+	write_seqcount_end(&phc->seq);
 
 	/* Setphc commands are posted in-order, sequenced by phc->lock.  We
 	 * need to drop the lock before waiting for the command to complete.
@@ -388,7 +417,9 @@ static int ionic_phc_adjtime(struct ptp_clock_info *info, s64 delta)
 
 	spin_lock_irqsave(&phc->lock, irqflags);
 
+	write_seqcount_begin(&phc->seq);
 	timecounter_adjtime(&phc->tc, delta);
+	write_seqcount_end(&phc->seq);
 
 	/* Setphc commands are posted in-order, sequenced by phc->lock.  We
 	 * need to drop the lock before waiting for the command to complete.
@@ -417,7 +448,9 @@ static int ionic_phc_settime64(struct ptp_clock_info *info,
 
 	spin_lock_irqsave(&phc->lock, irqflags);
 
+	write_seqcount_begin(&phc->seq);
 	timecounter_init(&phc->tc, &phc->cc, ns);
+	write_seqcount_end(&phc->seq);
 
 	/* Setphc commands are posted in-order, sequenced by phc->lock.  We
 	 * need to drop the lock before waiting for the command to complete.
@@ -440,24 +473,22 @@ static int ionic_phc_gettime64(struct ptp_clock_info *info,
 {
 	struct ionic_phc *phc = container_of(info, struct ionic_phc, ptp_info);
 	struct ionic *ionic = phc->lif->ionic;
-	unsigned long irqflags;
 	u64 tick, ns;
 
 	/* Do not attempt to read device time during upgrade */
 	if (test_bit(IONIC_LIF_F_FW_RESET, phc->lif->state))
 		return -EBUSY;
 
-	spin_lock_irqsave(&phc->lock, irqflags);
-
+	/* Concurrent readers don't serialize on phc->lock, each computes
+	 * its own timestamp from the seqcount-protected snapshot.
+	 */
 #ifdef HAVE_PHC_GETTIMEX64
 	tick = ionic_hwstamp_read(ionic, sts);
 #else
 	tick = ionic_hwstamp_read(ionic);
 #endif
 
-	ns = timecounter_cyc2time(&phc->tc, tick);
-
-	spin_unlock_irqrestore(&phc->lock, irqflags);
+	ns = ionic_phc_cyc2time(phc, tick);
 
 	*ts = ns_to_timespec64(ns);
 
@@ -483,7 +514,9 @@ static long ionic_phc_aux_work(struct ptp_clock_info *info)
 	spin_lock_irqsave(&phc->lock, irqflags);
 
 	/* update point-in-time basis to now */
+	write_seqcount_begin(&phc->seq);
 	timecounter_read(&phc->tc);
+	write_seqcount_end(&phc->seq);
 
 	/* Setphc commands are posted in-order, sequenced by phc->lock.  We
 	 * need to drop the lock before waiting for the command to complete.
@@ -510,17 +543,45 @@ void ionic_phc_aux_work_helper(struct work_struct *work)
 
 ktime_t ionic_lif_phc_ktime(struct ionic_lif *lif, u64 tick)
 {
-	unsigned long irqflags;
-	u64 ns;
-
 	if (!lif->phc)
 		return ktime_set(0, 0);
 
-	spin_lock_irqsave(&lif->phc->lock, irqflags);
-	ns = timecounter_cyc2time(&lif->phc->tc, tick);
-	spin_unlock_irqrestore(&lif->phc->lock, irqflags);
+	return ns_to_ktime(ionic_phc_cyc2time(lif->phc, tick));
+}
+
+/* Capture a coherent copy of the conversion state once per napi poll;
+ * every packet in the batch then converts with pure arithmetic in
+ * ionic_lif_phc_snap_ktime(), with no per-packet seqcount round trip.
+ */
+void ionic_lif_phc_snap(struct ionic_lif *lif, struct ionic_phc_snap *snap)
+{
+	struct ionic_phc *phc = lif->phc;
+	unsigned int seq;
+
+	if (!phc) {
+		snap->tc.cc = NULL;
+		return;
+	}
+
+	snap->cc = phc->cc;
+	snap->tc.cc = &snap->cc;
+	snap->tc.mask = (1ULL << snap->cc.shift) - 1;
+
+	do {
+		seq = read_seqcount_begin(&phc->seq);
+		snap->tc.cycle_last = phc->tc.cycle_last;
+		snap->tc.nsec = phc->tc.nsec;
+		snap->tc.frac = phc->tc.frac;
+		snap->cc.mult = phc->cc.mult;
+	} while (read_seqcount_retry(&phc->seq, seq));
+}
+
+ktime_t ionic_lif_phc_snap_ktime(struct ionic_phc_snap *snap, u64 tick)
+{
+	if (!snap->tc.cc)
+		return ktime_set(0, 0);
 
-	return ns_to_ktime(ns);
+	return ns_to_ktime(timecounter_cyc2time(&snap->tc, tick));
 }
 
 static const struct ptp_clock_info ionic_ptp_info = {
@@ -619,6 +680,7 @@ void ionic_lif_alloc_phc(struct ionic_lif *lif)
 		phc->cc.mask, phc->cc.mult, phc->cc.shift);
 
 	spin_lock_init(&phc->lock);
+	seqcount_init(&phc->seq);
 	mutex_init(&phc->config_lock);
 
 	/* max ticks is limited by the multiplier, or by the update period. */
@@ -10,58 +10,153 @@
 #include "ionic_lif.h"
 #include "ionic_rx_filter.h"
 
-void ionic_rx_filter_free(struct ionic_lif *lif, struct ionic_rx_filter *f)
+static const struct rhashtable_params ionic_rx_filter_ht_params = {
+	.key_len	= sizeof(struct ionic_rx_filter_key),
+	.key_offset	= offsetof(struct ionic_rx_filter, key),
+	.head_offset	= offsetof(struct ionic_rx_filter, node),
+	.automatic_shrinking = true,
+};
+
+static void ionic_rx_filter_key_fill(struct ionic_rx_filter_key *key,
+				     const struct ionic_rx_filter_add_cmd *ac)
 {
-	struct device *dev = lif->ionic->dev;
+	memset(key, 0, sizeof(*key));
+	key->match = le16_to_cpu(ac->match);
+
+	switch (key->match) {
+	case IONIC_RX_FILTER_MATCH_VLAN:
+		key->vlan = le16_to_cpu(ac->vlan.vlan);
+		break;
+	case IONIC_RX_FILTER_MATCH_MAC:
+		memcpy(key->addr, ac->mac.addr, ETH_ALEN);
+		break;
+	case IONIC_RX_FILTER_MATCH_MAC_VLAN:
+		key->vlan = le16_to_cpu(ac->mac_vlan.vlan);
+		memcpy(key->addr, ac->mac_vlan.addr, ETH_ALEN);
+		break;
+	}
+}
 
+void ionic_rx_filter_free(struct ionic_lif *lif, struct ionic_rx_filter *f)
+{
 	hlist_del(&f->by_id);
-	hlist_del(&f->by_hash);
-	devm_kfree(dev, f);
+	rhashtable_remove_fast(&lif->rx_filters.table, &f->node,
+			       ionic_rx_filter_ht_params);
+	kfree_rcu(f, rcu);
 }
 
-void ionic_rx_filter_replay(struct ionic_lif *lif)
+/* half the adminq, so a batch can post while the previous one drains */
+#define IONIC_RX_FILTER_REPLAY_BATCH	(IONIC_ADMINQ_LENGTH / 2)
+
+static void ionic_rx_filter_replay_flush(struct ionic_lif *lif,
+					 struct ionic_admin_ctx *ctxs,
+					 struct ionic_rx_filter **fs,
+					 unsigned int nbatch,
+					 struct hlist_head *new_id_list)
 {
 	struct ionic_rx_filter_add_cmd *ac;
+	struct ionic_rx_filter *f;
+	unsigned int i;
+	int err;
+
+	ionic_adminq_kick(lif);
+
+	for (i = 0; i < nbatch; i++) {
+		f = fs[i];
+		ac = &ctxs[i].cmd.rx_filter_add;
+
+		err = ionic_adminq_wait(lif, &ctxs[i], 0, true);
+		if (err) {
+			switch (le16_to_cpu(ac->match)) {
+			case IONIC_RX_FILTER_MATCH_VLAN:
+				netdev_info(lif->netdev, "Replay failed - %d: vlan %d\n",
+					    err,
+					    le16_to_cpu(ac->vlan.vlan));
+				break;
+			case IONIC_RX_FILTER_MATCH_MAC:
+				netdev_info(lif->netdev, "Replay failed - %d: mac %pM\n",
+					    err, ac->mac.addr);
+				break;
+			case IONIC_RX_FILTER_MATCH_MAC_VLAN:
+				netdev_info(lif->netdev, "Replay failed - %d: vlan %d mac %pM\n",
+					    err,
+					    le16_to_cpu(ac->vlan.vlan),
+					    ac->mac.addr);
+				break;
+			}
+			spin_lock_bh(&lif->rx_filters.lock);
+			ionic_rx_filter_free(lif, f);
+			spin_unlock_bh(&lif->rx_filters.lock);
+
+			continue;
+		}
+
+		/* remove from old id list, save new id in tmp list */
+		spin_lock_bh(&lif->rx_filters.lock);
+		hlist_del(&f->by_id);
+		spin_unlock_bh(&lif->rx_filters.lock);
+		f->filter_id = le32_to_cpu(ctxs[i].comp.rx_filter_add.filter_id);
+		hlist_add_head(&f->by_id, new_id_list);
+	}
+}
+
+void ionic_rx_filter_replay(struct ionic_lif *lif)
+{
+	struct ionic_rx_filter *sf, **fs;
 	struct hlist_head new_id_list;
-	struct ionic_admin_ctx ctx;
+	struct ionic_admin_ctx *ctxs;
+	struct ionic_admin_ctx sctx;
 	struct ionic_rx_filter *f;
+	unsigned int batch_max;
 	struct hlist_head *head;
 	struct hlist_node *tmp;
+	unsigned int nbatch = 0;
+	struct ionic_admin_ctx *ctx;
 	unsigned int key;
 	unsigned int i;
 	int err;
 
 	INIT_HLIST_HEAD(&new_id_list);
-	ac = &ctx.cmd.rx_filter_add;
+
+	/* Pipeline the adds through the adminq in batches behind one
+	 * doorbell each, so restoring thousands of filters costs a few
+	 * ring round trips instead of one per filter.
+	 */
+	batch_max = IONIC_RX_FILTER_REPLAY_BATCH;
+	ctxs = kcalloc(batch_max, sizeof(*ctxs), GFP_KERNEL);
+	fs = kcalloc(batch_max, sizeof(*fs), GFP_KERNEL);
+	if (!ctxs || !fs) {
+		/* fall back to one command at a time */
+		kfree(ctxs);
+		kfree(fs);
+		memset(&sctx, 0, sizeof(sctx));
+		ctxs = &sctx;
+		fs = &sf;
+		batch_max = 1;
+	}
 
 	for (i = 0; i < IONIC_RX_FILTER_HLISTS; i++) {
 		head = &lif->rx_filters.by_id[i];
 		hlist_for_each_entry_safe(f, tmp, head, by_id) {
-			ctx.work = COMPLETION_INITIALIZER_ONSTACK(ctx.work);
-			memcpy(ac, &f->cmd, sizeof(f->cmd));
+			ctx = &ctxs[nbatch];
+			init_completion(&ctx->work);
+			memcpy(&ctx->cmd.rx_filter_add, &f->cmd, sizeof(f->cmd));
 			dev_dbg(&lif->netdev->dev, "replay filter command:\n");
 			dynamic_hex_dump("cmd ", DUMP_PREFIX_OFFSET, 16, 1,
-					 &ctx.cmd, sizeof(ctx.cmd), true);
-
-			err = ionic_adminq_post_wait(lif, &ctx);
+					 &ctx->cmd, sizeof(ctx->cmd), true);
+
+			err = ionic_adminq_post_nowait(lif, ctx);
+			if (err == -ENOSPC && nbatch) {
+				/* settle what's in flight and try again */
+				ionic_rx_filter_replay_flush(lif, ctxs, fs,
+							     nbatch,
+							     &new_id_list);
+				nbatch = 0;
+				err = ionic_adminq_post_nowait(lif, ctx);
+			}
 			if (err) {
-				switch (le16_to_cpu(ac->match)) {
-				case IONIC_RX_FILTER_MATCH_VLAN:
-					netdev_info(lif->netdev, "Replay failed - %d: vlan %d\n",
-						    err,
-						    le16_to_cpu(ac->vlan.vlan));
-					break;
-				case IONIC_RX_FILTER_MATCH_MAC:
-					netdev_info(lif->netdev, "Replay failed - %d: mac %pM\n",
-						    err, ac->mac.addr);
-					break;
-				case IONIC_RX_FILTER_MATCH_MAC_VLAN:
-					netdev_info(lif->netdev, "Replay failed - %d: vlan %d mac %pM\n",
-						    err,
-						    le16_to_cpu(ac->vlan.vlan),
-						    ac->mac.addr);
-					break;
-				}
+				netdev_info(lif->netdev, "Replay failed - %d\n",
+					    err);
 				spin_lock_bh(&lif->rx_filters.lock);
 				ionic_rx_filter_free(lif, f);
 				spin_unlock_bh(&lif->rx_filters.lock);
@@ -69,15 +164,25 @@ void ionic_rx_filter_replay(struct ionic_lif *lif)
 				continue;
 			}
 
-			/* remove from old id list, save new id in tmp list */
-			spin_lock_bh(&lif->rx_filters.lock);
-			hlist_del(&f->by_id);
-			spin_unlock_bh(&lif->rx_filters.lock);
-			f->filter_id = le32_to_cpu(ctx.comp.rx_filter_add.filter_id);
-			hlist_add_head(&f->by_id, &new_id_list);
+			fs[nbatch++] = f;
+			if (nbatch == batch_max) {
+				ionic_rx_filter_replay_flush(lif, ctxs, fs,
+							     nbatch,
+							     &new_id_list);
+				nbatch = 0;
+			}
 		}
 	}
 
+	if (nbatch)
+		ionic_rx_filter_replay_flush(lif, ctxs, fs, nbatch,
+					     &new_id_list);
+
+	if (ctxs != &sctx) {
+		kfree(ctxs);
+		kfree(fs);
+	}
+
 	/* rebuild the by_id hash lists with the new filter ids */
 	spin_lock_bh(&lif->rx_filters.lock);
 	hlist_for_each_entry_safe(f, tmp, &new_id_list, by_id) {
@@ -91,19 +196,28 @@ void ionic_rx_filter_replay(struct ionic_lif *lif)
 int ionic_rx_filters_init(struct ionic_lif *lif)
 {
 	unsigned int i;
+	int err;
 
 	spin_lock_init(&lif->rx_filters.lock);
 
+	err = rhashtable_init(&lif->rx_filters.table,
+			      &ionic_rx_filter_ht_params);
+	if (err)
+		return err;
+
 	spin_lock_bh(&lif->rx_filters.lock);
-	for (i = 0; i < IONIC_RX_FILTER_HLISTS; i++) {
-		INIT_HLIST_HEAD(&lif->rx_filters.by_hash[i]);
+	for (i = 0; i < IONIC_RX_FILTER_HLISTS; i++)
 		INIT_HLIST_HEAD(&lif->rx_filters.by_id[i]);
-	}
 	spin_unlock_bh(&lif->rx_filters.lock);
 
 	return 0;
 }
 
+static void ionic_rx_filter_destroy_cb(void *ptr, void *arg)
+{
+	kfree(ptr);
+}
+
 void ionic_rx_filters_deinit(struct ionic_lif *lif)
 {
 	struct ionic_rx_filter *f;
@@ -111,41 +225,42 @@ void ionic_rx_filters_deinit(struct ionic_lif *lif)
 	struct hlist_node *tmp;
 	unsigned int i;
 
+	/* unlink the id lists, then let the table teardown free
+	 * everything in one batched walk
+	 */
 	spin_lock_bh(&lif->rx_filters.lock);
 	for (i = 0; i < IONIC_RX_FILTER_HLISTS; i++) {
 		head = &lif->rx_filters.by_id[i];
 		hlist_for_each_entry_safe(f, tmp, head, by_id)
-			ionic_rx_filter_free(lif, f);
+			hlist_del(&f->by_id);
 	}
 	spin_unlock_bh(&lif->rx_filters.lock);
+
+	rhashtable_free_and_destroy(&lif->rx_filters.table,
+				    ionic_rx_filter_destroy_cb, NULL);
 }
 
 int ionic_rx_filter_save(struct ionic_lif *lif, u32 flow_id, u16 rxq_index,
 			 u32 hash, struct ionic_admin_ctx *ctx,
 			 enum ionic_filter_state state)
 {
-	struct device *dev = lif->ionic->dev;
 	struct ionic_rx_filter_add_cmd *ac;
 	struct ionic_rx_filter *f = NULL;
 	struct hlist_head *head;
 	unsigned int key;
+	int err;
 
 	ac = &ctx->cmd.rx_filter_add;
 
 	switch (le16_to_cpu(ac->match)) {
 	case IONIC_RX_FILTER_MATCH_VLAN:
-		key = le16_to_cpu(ac->vlan.vlan);
 		f = ionic_rx_filter_by_vlan(lif, le16_to_cpu(ac->vlan.vlan));
 		break;
 	case IONIC_RX_FILTER_MATCH_MAC:
-		key = *(u32 *)ac->mac.addr;
 		f = ionic_rx_filter_by_addr(lif, ac->mac.addr);
 		break;
 	case IONIC_RX_FILTER_MATCH_MAC_VLAN:
-		key = le16_to_cpu(ac->mac_vlan.vlan);
-		break;
 	case IONIC_RX_FILTER_STEER_PKTCLASS:
-		key = 0;
 		break;
 	default:
 		return -EINVAL;
@@ -154,9 +269,10 @@ int ionic_rx_filter_save(struct ionic_lif *lif, u32 flow_id, u16 rxq_index,
 	if (f) {
 		/* remove from current linking so we can refresh it */
 		hlist_del(&f->by_id);
-		hlist_del(&f->by_hash);
+		rhashtable_remove_fast(&lif->rx_filters.table, &f->node,
+				       ionic_rx_filter_ht_params);
 	} else {
-		f = devm_kzalloc(dev, sizeof(*f), GFP_ATOMIC);
+		f = kzalloc(sizeof(*f), GFP_ATOMIC);
 		if (!f)
 			return -ENOMEM;
 	}
@@ -166,14 +282,17 @@ int ionic_rx_filter_save(struct ionic_lif *lif, u32 flow_id, u16 rxq_index,
 	f->state = state;
 	f->rxq_index = rxq_index;
 	memcpy(&f->cmd, ac, sizeof(f->cmd));
+	ionic_rx_filter_key_fill(&f->key, ac);
 	netdev_dbg(lif->netdev, "rx_filter add filter_id %d\n", f->filter_id);
 
-	INIT_HLIST_NODE(&f->by_hash);
 	INIT_HLIST_NODE(&f->by_id);
 
-	key = hash_32(key, IONIC_RX_FILTER_HASH_BITS);
-	head = &lif->rx_filters.by_hash[key];
-	hlist_add_head(&f->by_hash, head);
+	err = rhashtable_insert_fast(&lif->rx_filters.table, &f->node,
+				     ionic_rx_filter_ht_params);
+	if (err) {
+		kfree(f);
+		return err;
+	}
 
 	key = f->filter_id & IONIC_RX_FILTER_HLISTS_MASK;
 	head = &lif->rx_filters.by_id[key];
@@ -184,59 +303,36 @@ int ionic_rx_filter_save(struct ionic_lif *lif, u32 flow_id, u16 rxq_index,
 
 struct ionic_rx_filter *ionic_rx_filter_by_vlan(struct ionic_lif *lif, u16 vid)
 {
-	struct ionic_rx_filter *f;
-	struct hlist_head *head;
-	unsigned int key;
-
-	key = hash_32(vid, IONIC_RX_FILTER_HASH_BITS);
-	head = &lif->rx_filters.by_hash[key];
-
-	hlist_for_each_entry(f, head, by_hash) {
-		if (le16_to_cpu(f->cmd.match) != IONIC_RX_FILTER_MATCH_VLAN)
-			continue;
-		if (le16_to_cpu(f->cmd.vlan.vlan) == vid)
-			return f;
-	}
+	struct ionic_rx_filter_key key = {
+		.match = IONIC_RX_FILTER_MATCH_VLAN,
+		.vlan = vid,
+	};
 
-	return NULL;
+	return rhashtable_lookup_fast(&lif->rx_filters.table, &key,
+				      ionic_rx_filter_ht_params);
 }
 
 struct ionic_rx_filter *ionic_rx_filter_by_addr(struct ionic_lif *lif,
 						const u8 *addr)
 {
-	struct ionic_rx_filter *f;
-	struct hlist_head *head;
-	unsigned int key;
+	struct ionic_rx_filter_key key = {
+		.match = IONIC_RX_FILTER_MATCH_MAC,
+	};
 
-	key = hash_32(*(u32 *)addr, IONIC_RX_FILTER_HASH_BITS);
-	head = &lif->rx_filters.by_hash[key];
+	memcpy(key.addr, addr, ETH_ALEN);
 
-	hlist_for_each_entry(f, head, by_hash) {
-		if (le16_to_cpu(f->cmd.match) != IONIC_RX_FILTER_MATCH_MAC)
-			continue;
-		if (memcmp(addr, f->cmd.mac.addr, ETH_ALEN) == 0)
-			return f;
-	}
-
-	return NULL;
+	return rhashtable_lookup_fast(&lif->rx_filters.table, &key,
+				      ionic_rx_filter_ht_params);
 }
 
 struct ionic_rx_filter *ionic_rx_filter_rxsteer(struct ionic_lif *lif)
 {
-	struct ionic_rx_filter *f;
-	struct hlist_head *head;
-	unsigned int key;
-
-	key = hash_32(0, IONIC_RX_FILTER_HASH_BITS);
-	head = &lif->rx_filters.by_hash[key];
-
-	hlist_for_each_entry(f, head, by_hash) {
-		if (le16_to_cpu(f->cmd.match) != IONIC_RX_FILTER_STEER_PKTCLASS)
-			continue;
-		return f;
-	}
+	struct ionic_rx_filter_key key = {
+		.match = IONIC_RX_FILTER_STEER_PKTCLASS,
+	};
 
-	return NULL;
+	return rhashtable_lookup_fast(&lif->rx_filters.table, &key,
+				      ionic_rx_filter_ht_params);
 }
 
 static struct ionic_rx_filter *ionic_rx_filter_find(struct ionic_lif *lif,
@@ -301,34 +397,88 @@ int ionic_lif_list_addr(struct ionic_lif *lif, const u8 *addr, bool mode)
 	return 0;
 }
 
-static int ionic_lif_filter_add(struct ionic_lif *lif,
-				struct ionic_rx_filter_add_cmd *ac)
+/* Record a vlan filter change without touching the adminq, the same
+ * way ionic_lif_list_addr() does for mac filters: an add saves a NEW
+ * entry for the next sync pass, a del of a NEW entry just drops it,
+ * and a del of a synced entry marks it OLD for the sync to clean up.
+ * Back-to-back add/del storms thereby cancel out in the table and
+ * only the survivors cost adminq commands.
+ */
+int ionic_lif_list_vlan(struct ionic_lif *lif, const u16 vid, bool mode)
+{
+	struct ionic_rx_filter *f;
+	int err = 0;
+
+	spin_lock_bh(&lif->rx_filters.lock);
+
+	f = ionic_rx_filter_by_vlan(lif, vid);
+	if (mode == ADD_ADDR && !f) {
+		struct ionic_admin_ctx ctx = {
+			.work = COMPLETION_INITIALIZER_ONSTACK(ctx.work),
+			.cmd.rx_filter_add = {
+				.opcode = IONIC_CMD_RX_FILTER_ADD,
+				.lif_index = cpu_to_le16(lif->index),
+				.match = cpu_to_le16(IONIC_RX_FILTER_MATCH_VLAN),
+				.vlan.vlan = cpu_to_le16(vid),
+			},
+		};
+
+		err = ionic_rx_filter_save(lif, 0, IONIC_RXQ_INDEX_ANY, 0, &ctx,
+					   IONIC_FILTER_STATE_NEW);
+	} else if (mode == ADD_ADDR && f) {
+		if (f->state == IONIC_FILTER_STATE_OLD)
+			f->state = IONIC_FILTER_STATE_SYNCED;
+	} else if (mode == DEL_ADDR && f) {
+		if (f->state == IONIC_FILTER_STATE_NEW)
+			ionic_rx_filter_free(lif, f);
+		else if (f->state == IONIC_FILTER_STATE_SYNCED)
+			f->state = IONIC_FILTER_STATE_OLD;
+	} else if (mode == DEL_ADDR && !f) {
+		err = -ENOENT;
+	}
+
+	spin_unlock_bh(&lif->rx_filters.lock);
+	if (err)
+		return err;
+
+	set_bit(IONIC_LIF_F_FILTER_SYNC_NEEDED, lif->state);
+
+	return 0;
+}
+
+/* First half of a filter add: stake the filter's claim in the table
+ * and build the adminq command.  Returns -EEXIST if the filter is
+ * already synced and there's nothing to do, -ENOSPC if the command
+ * should be skipped but the bookkeeping in the finish half still run.
+ */
+static int ionic_lif_filter_add_prepare(struct ionic_lif *lif,
+					struct ionic_admin_ctx *ctx,
+					struct ionic_rx_filter_add_cmd *ac)
 {
-	struct ionic_admin_ctx ctx = {
-		.work = COMPLETION_INITIALIZER_ONSTACK(ctx.work),
-	};
 	struct ionic_rx_filter *f;
 	int nfilters;
 	int err = 0;
 
-	ctx.cmd.rx_filter_add = *ac;
-	ctx.cmd.rx_filter_add.opcode = IONIC_CMD_RX_FILTER_ADD,
-	ctx.cmd.rx_filter_add.lif_index = cpu_to_le16(lif->index),
+	memset(ctx, 0, sizeof(*ctx));
+	init_completion(&ctx->work);
+	ctx->cmd.rx_filter_add = *ac;
+	ctx->cmd.rx_filter_add.opcode = IONIC_CMD_RX_FILTER_ADD;
+	ctx->cmd.rx_filter_add.lif_index = cpu_to_le16(lif->index);
 
 	spin_lock_bh(&lif->rx_filters.lock);
-	f = ionic_rx_filter_find(lif, &ctx.cmd.rx_filter_add);
+	f = ionic_rx_filter_find(lif, &ctx->cmd.rx_filter_add);
 	if (f) {
 		/* don't bother if we already have it and it is sync'd */
 		if (f->state == IONIC_FILTER_STATE_SYNCED) {
 			spin_unlock_bh(&lif->rx_filters.lock);
-			return 0;
+			return -EEXIST;
 		}
 
 		/* mark preemptively as sync'd to block any parallel attempts */
 		f->state = IONIC_FILTER_STATE_SYNCED;
 	} else {
 		/* save as SYNCED to catch any DEL requests while processing */
-		err = ionic_rx_filter_save(lif, 0, IONIC_RXQ_INDEX_ANY, 0, &ctx,
+		err = ionic_rx_filter_save(lif, 0, IONIC_RXQ_INDEX_ANY, 0, ctx,
 					   IONIC_FILTER_STATE_SYNCED);
 	}
 	spin_unlock_bh(&lif->rx_filters.lock);
@@ -340,30 +490,38 @@ static int ionic_lif_filter_add(struct ionic_lif *lif,
 	 * Since the FW doesn't have a way to tell us the vlan limit,
 	 * we start max_vlans at 0 until we hit the ENOSPC error.
 	 */
-	switch (le16_to_cpu(ctx.cmd.rx_filter_add.match)) {
+	switch (le16_to_cpu(ctx->cmd.rx_filter_add.match)) {
 	case IONIC_RX_FILTER_MATCH_VLAN:
 		netdev_dbg(lif->netdev, "%s: rx_filter add VLAN %d\n",
-			   __func__, ctx.cmd.rx_filter_add.vlan.vlan);
+			   __func__, ctx->cmd.rx_filter_add.vlan.vlan);
 		if (lif->max_vlans && lif->nvlans >= lif->max_vlans)
 			err = -ENOSPC;
 		break;
 	case IONIC_RX_FILTER_MATCH_MAC:
 		netdev_dbg(lif->netdev, "%s: rx_filter add ADDR %pM\n",
-			   __func__, ctx.cmd.rx_filter_add.mac.addr);
+			   __func__, ctx->cmd.rx_filter_add.mac.addr);
 		nfilters = le32_to_cpu(lif->identity->eth.max_ucast_filters);
 		if ((lif->nucast + lif->nmcast) >= nfilters)
 			err = -ENOSPC;
 		break;
 	}
 
-	if (err != -ENOSPC)
-		err = ionic_adminq_post_wait_nomsg(lif, &ctx);
+	return err;
+}
+
+/* Second half of a filter add, after the adminq command completed (or
+ * was skipped) with err: update the counters and the table state.
+ */
+static int ionic_lif_filter_add_finish(struct ionic_lif *lif,
+				       struct ionic_admin_ctx *ctx, int err)
+{
+	struct ionic_rx_filter *f;
 
 	spin_lock_bh(&lif->rx_filters.lock);
 
 	if (err && err != -EEXIST) {
 		/* set the state back to NEW so we can try again later */
-		f = ionic_rx_filter_find(lif, &ctx.cmd.rx_filter_add);
+		f = ionic_rx_filter_find(lif, &ctx->cmd.rx_filter_add);
 		if (f && f->state == IONIC_FILTER_STATE_SYNCED) {
 			f->state = IONIC_FILTER_STATE_NEW;
 
@@ -378,7 +536,7 @@ static int ionic_lif_filter_add(struct ionic_lif *lif,
 
 		/* store the max_vlans limit that we found */
 		if (err == -ENOSPC &&
-		    le16_to_cpu(ctx.cmd.rx_filter_add.match) == IONIC_RX_FILTER_MATCH_VLAN)
+		    le16_to_cpu(ctx->cmd.rx_filter_add.match) == IONIC_RX_FILTER_MATCH_VLAN)
 			lif->max_vlans = lif->nvlans;
 
 		/* Prevent unnecessary error messages on recoverable
@@ -396,45 +554,45 @@ static int ionic_lif_filter_add(struct ionic_lif *lif,
 			break;
 		}
 
-		ionic_adminq_netdev_err_print(lif, ctx.cmd.cmd.opcode,
-					      ctx.comp.comp.status, err);
-		switch (le16_to_cpu(ctx.cmd.rx_filter_add.match)) {
+		ionic_adminq_netdev_err_print(lif, ctx->cmd.cmd.opcode,
+					      ctx->comp.comp.status, err);
+		switch (le16_to_cpu(ctx->cmd.rx_filter_add.match)) {
 		case IONIC_RX_FILTER_MATCH_VLAN:
 			netdev_info(lif->netdev, "rx_filter add failed: VLAN %d\n",
-				    ctx.cmd.rx_filter_add.vlan.vlan);
+				    ctx->cmd.rx_filter_add.vlan.vlan);
 			break;
 		case IONIC_RX_FILTER_MATCH_MAC:
 			netdev_info(lif->netdev, "rx_filter add failed: ADDR %pM\n",
-				    ctx.cmd.rx_filter_add.mac.addr);
+				    ctx->cmd.rx_filter_add.mac.addr);
 			break;
 		}
 
 		return err;
 	}
 
-	switch (le16_to_cpu(ctx.cmd.rx_filter_add.match)) {
+	switch (le16_to_cpu(ctx->cmd.rx_filter_add.match)) {
 	case IONIC_RX_FILTER_MATCH_VLAN:
 		lif->nvlans++;
 		break;
 	case IONIC_RX_FILTER_MATCH_MAC:
-		if (is_multicast_ether_addr(ctx.cmd.rx_filter_add.mac.addr))
+		if (is_multicast_ether_addr(ctx->cmd.rx_filter_add.mac.addr))
 			lif->nmcast++;
 		else
 			lif->nucast++;
 		break;
 	}
 
-	f = ionic_rx_filter_find(lif, &ctx.cmd.rx_filter_add);
+	f = ionic_rx_filter_find(lif, &ctx->cmd.rx_filter_add);
 	if (f && f->state == IONIC_FILTER_STATE_OLD) {
 		/* Someone requested a delete while we were adding
 		 * so update the filter info with the results from the add
 		 * and the data will be there for the delete on the next
 		 * sync cycle.
 		 */
-		err = ionic_rx_filter_save(lif, 0, IONIC_RXQ_INDEX_ANY, 0, &ctx,
+		err = ionic_rx_filter_save(lif, 0, IONIC_RXQ_INDEX_ANY, 0, ctx,
 					   IONIC_FILTER_STATE_OLD);
 	} else {
-		err = ionic_rx_filter_save(lif, 0, IONIC_RXQ_INDEX_ANY, 0, &ctx,
+		err = ionic_rx_filter_save(lif, 0, IONIC_RXQ_INDEX_ANY, 0, ctx,
 					   IONIC_FILTER_STATE_SYNCED);
 	}
 
@@ -443,6 +601,24 @@ static int ionic_lif_filter_add(struct ionic_lif *lif,
 	return err;
 }
 
+static int ionic_lif_filter_add(struct ionic_lif *lif,
+				struct ionic_rx_filter_add_cmd *ac)
+{
+	struct ionic_admin_ctx ctx;
+	int err;
+
+	err = ionic_lif_filter_add_prepare(lif, &ctx, ac);
+	if (err == -EEXIST)
+		return 0;
+	if (err && err != -ENOSPC)
+		return err;
+
+	if (err != -ENOSPC)
+		err = ionic_adminq_post_wait_nomsg(lif, &ctx);
+
+	return ionic_lif_filter_add_finish(lif, &ctx, err);
+}
+
 int ionic_lif_addr_add(struct ionic_lif *lif, const u8 *addr)
 {
 	struct ionic_rx_filter_add_cmd ac = {
@@ -464,19 +640,22 @@ int ionic_lif_vlan_add(struct ionic_lif *lif, const u16 vid)
 	return ionic_lif_filter_add(lif, &ac);
 }
 
-static int ionic_lif_filter_del(struct ionic_lif *lif,
-				struct ionic_rx_filter_add_cmd *ac)
+/* First half of a filter del: drop the filter from the table, adjust
+ * the counters, and build the adminq command.  Sets *post false when
+ * the filter never reached the fw and there's no command to send.
+ */
+static int ionic_lif_filter_del_prepare(struct ionic_lif *lif,
+					struct ionic_admin_ctx *ctx,
+					struct ionic_rx_filter_add_cmd *ac,
+					bool *post)
 {
-	struct ionic_admin_ctx ctx = {
-		.work = COMPLETION_INITIALIZER_ONSTACK(ctx.work),
-		.cmd.rx_filter_del = {
-			.opcode = IONIC_CMD_RX_FILTER_DEL,
-			.lif_index = cpu_to_le16(lif->index),
-		},
-	};
 	struct ionic_rx_filter *f;
 	int state;
-	int err;
+
+	memset(ctx, 0, sizeof(*ctx));
+	init_completion(&ctx->work);
+	ctx->cmd.rx_filter_del.opcode = IONIC_CMD_RX_FILTER_DEL;
+	ctx->cmd.rx_filter_del.lif_index = cpu_to_le16(lif->index);
 
 	spin_lock_bh(&lif->rx_filters.lock);
 	f = ionic_rx_filter_find(lif, ac);
@@ -502,31 +681,49 @@ static int ionic_lif_filter_del(struct ionic_lif *lif,
 	}
 
 	state = f->state;
-	ctx.cmd.rx_filter_del.filter_id = cpu_to_le32(f->filter_id);
+	ctx->cmd.rx_filter_del.filter_id = cpu_to_le32(f->filter_id);
 	ionic_rx_filter_free(lif, f);
 
 	spin_unlock_bh(&lif->rx_filters.lock);
 
-	if (state != IONIC_FILTER_STATE_NEW) {
-		err = ionic_adminq_post_wait_nomsg(lif, &ctx);
+	*post = state != IONIC_FILTER_STATE_NEW;
 
-		switch (err) {
-			/* ignore these errors */
-		case -EEXIST:
-		case -ENXIO:
-		case -ETIMEDOUT:
-		case -EAGAIN:
-		case -EBUSY:
-		case 0:
-			break;
-		default:
-			ionic_adminq_netdev_err_print(lif, ctx.cmd.cmd.opcode,
-						      ctx.comp.comp.status, err);
-			return err;
-		}
+	return 0;
+}
+
+static int ionic_lif_filter_del_finish(struct ionic_lif *lif,
+				       struct ionic_admin_ctx *ctx, int err)
+{
+	switch (err) {
+		/* ignore these errors */
+	case -EEXIST:
+	case -ENXIO:
+	case -ETIMEDOUT:
+	case -EAGAIN:
+	case -EBUSY:
+	case 0:
+		return 0;
+	default:
+		ionic_adminq_netdev_err_print(lif, ctx->cmd.cmd.opcode,
+					      ctx->comp.comp.status, err);
+		return err;
 	}
+}
 
-	return 0;
+static int ionic_lif_filter_del(struct ionic_lif *lif,
+				struct ionic_rx_filter_add_cmd *ac)
+{
+	struct ionic_admin_ctx ctx;
+	bool post;
+	int err;
+
+	err = ionic_lif_filter_del_prepare(lif, &ctx, ac, &post);
+	if (err || !post)
+		return err;
+
+	err = ionic_adminq_post_wait_nomsg(lif, &ctx);
+
+	return ionic_lif_filter_del_finish(lif, &ctx, err);
 }
 
 int ionic_lif_addr_del(struct ionic_lif *lif, const u8 *addr)
@@ -553,8 +750,15 @@ int ionic_lif_vlan_del(struct ionic_lif *lif, const u16 vid)
 struct sync_item {
 	struct list_head list;
 	struct ionic_rx_filter f;
+	struct ionic_admin_ctx ctx;
+	int err;
 };
 
+/* how many filter commands are left in flight on the adminq at once;
+ * must leave room in the 16-entry ring for other adminq users
+ */
+#define IONIC_RX_FILTER_SYNC_WINDOW	8
+
 void ionic_rx_filter_sync(struct ionic_lif *lif)
 {
 	struct device *dev = lif->ionic->dev;
@@ -564,7 +768,6 @@ void ionic_rx_filter_sync(struct ionic_lif *lif)
 	struct ionic_rx_filter *f;
 	struct hlist_head *head;
 	struct hlist_node *tmp;
-	struct sync_item *spos;
 	unsigned int i;
 
 	INIT_LIST_HEAD(&sync_add_list);
@@ -601,19 +804,97 @@ loop_out:
 	/* If the add or delete fails, it won't get marked as sync'd
 	 * and will be tried again in the next sync action.
 	 * Do the deletes first in case we're in an overflow state and
-	 * they can clear room for some new filters
+	 * they can clear room for some new filters.
+	 *
+	 * Each is pipelined in windows: post a window's worth of
+	 * commands without waiting, ring the doorbell once, then
+	 * collect the completions, so a burst costs one adminq round
+	 * trip per window instead of one per filter.
 	 */
-	list_for_each_entry_safe(sync_item, spos, &sync_del_list, list) {
-		(void)ionic_lif_filter_del(lif, &sync_item->f.cmd);
+	while (!list_empty(&sync_del_list)) {
+		struct sync_item *batch[IONIC_RX_FILTER_SYNC_WINDOW];
+		int n = 0, i;
+
+		while (n < IONIC_RX_FILTER_SYNC_WINDOW &&
+		       !list_empty(&sync_del_list)) {
+			bool post;
+
+			sync_item = list_first_entry(&sync_del_list,
+						     struct sync_item, list);
+			list_del(&sync_item->list);
+
+			sync_item->err = ionic_lif_filter_del_prepare(lif,
+							&sync_item->ctx,
+							&sync_item->f.cmd,
+							&post);
+			if (sync_item->err || !post) {
+				devm_kfree(dev, sync_item);
+				continue;
+			}
 
-		list_del(&sync_item->list);
-		devm_kfree(dev, sync_item);
+			sync_item->err = ionic_adminq_post_nowait(lif,
+							&sync_item->ctx);
+			batch[n++] = sync_item;
+		}
+
+		ionic_adminq_kick(lif);
+
+		for (i = 0; i < n; i++) {
+			sync_item = batch[i];
+			sync_item->err = ionic_adminq_wait(lif,
+							   &sync_item->ctx,
+							   sync_item->err,
+							   false);
+			(void)ionic_lif_filter_del_finish(lif, &sync_item->ctx,
+							  sync_item->err);
+			devm_kfree(dev, sync_item);
+		}
 	}
 
-	list_for_each_entry_safe(sync_item, spos, &sync_add_list, list) {
-		(void)ionic_lif_filter_add(lif, &sync_item->f.cmd);
+	while (!list_empty(&sync_add_list)) {
+		struct sync_item *batch[IONIC_RX_FILTER_SYNC_WINDOW];
+		int n = 0, i;
+
+		while (n < IONIC_RX_FILTER_SYNC_WINDOW &&
+		       !list_empty(&sync_add_list)) {
+			int err;
+
+			sync_item = list_first_entry(&sync_add_list,
+						     struct sync_item, list);
+			list_del(&sync_item->list);
+
+			err = ionic_lif_filter_add_prepare(lif,
+							   &sync_item->ctx,
+							   &sync_item->f.cmd);
+			if (err == -ENOSPC) {
+				/* skip the command but run the
+				 * bookkeeping for the overflow state
+				 */
+				(void)ionic_lif_filter_add_finish(lif,
+							&sync_item->ctx, err);
+				devm_kfree(dev, sync_item);
+				continue;
+			} else if (err) {
+				devm_kfree(dev, sync_item);
+				continue;
+			}
 
-		list_del(&sync_item->list);
-		devm_kfree(dev, sync_item);
+			sync_item->err = ionic_adminq_post_nowait(lif,
+							&sync_item->ctx);
+			batch[n++] = sync_item;
+		}
+
+		ionic_adminq_kick(lif);
+
+		for (i = 0; i < n; i++) {
+			sync_item = batch[i];
+			sync_item->err = ionic_adminq_wait(lif,
+							   &sync_item->ctx,
+							   sync_item->err,
+							   false);
+			(void)ionic_lif_filter_add_finish(lif, &sync_item->ctx,
+							  sync_item->err);
+			devm_kfree(dev, sync_item);
+		}
 	}
 }
@@ -4,6 +4,8 @@
 #ifndef _IONIC_RX_FILTER_H_
 #define _IONIC_RX_FILTER_H_
 
+#include <linux/rhashtable.h>
+
 #define IONIC_RXQ_INDEX_ANY		(0xFFFF)
 
 enum ionic_filter_state {
@@ -12,14 +14,23 @@ enum ionic_filter_state {
 	IONIC_FILTER_STATE_OLD,
 };
 
+/* canonical match key: unused fields stay zero for the given match type */
+struct ionic_rx_filter_key {
+	u16 match;
+	u16 vlan;
+	u8 addr[ETH_ALEN];
+};
+
 struct ionic_rx_filter {
 	u32 flow_id;
 	u32 filter_id;
 	u16 rxq_index;
 	enum ionic_filter_state state;
 	struct ionic_rx_filter_add_cmd cmd;
-	struct hlist_node by_hash;
+	struct ionic_rx_filter_key key;
+	struct rhash_head node;
 	struct hlist_node by_id;
+	struct rcu_head rcu;
 };
 
 #define IONIC_RX_FILTER_HASH_BITS	10
@@ -27,7 +38,7 @@ struct ionic_rx_filter {
 #define IONIC_RX_FILTER_HLISTS_MASK	(IONIC_RX_FILTER_HLISTS - 1)
 struct ionic_rx_filters {
 	spinlock_t lock;				    /* filter list lock */
-	struct hlist_head by_hash[IONIC_RX_FILTER_HLISTS];  /* by skb hash */
+	struct rhashtable table;			    /* by match key */
 	struct hlist_head by_id[IONIC_RX_FILTER_HLISTS];    /* by filter_id */
 };
 
@@ -43,6 +54,7 @@ struct ionic_rx_filter *ionic_rx_filter_by_addr(struct ionic_lif *lif, const u8
 struct ionic_rx_filter *ionic_rx_filter_rxsteer(struct ionic_lif *lif);
 void ionic_rx_filter_sync(struct ionic_lif *lif);
 int ionic_lif_list_addr(struct ionic_lif *lif, const u8 *addr, bool mode);
+int ionic_lif_list_vlan(struct ionic_lif *lif, const u16 vid, bool mode);
 int ionic_rx_filters_need_sync(struct ionic_lif *lif);
 int ionic_lif_vlan_add(struct ionic_lif *lif, const u16 vid);
 int ionic_lif_vlan_del(struct ionic_lif *lif, const u16 vid);
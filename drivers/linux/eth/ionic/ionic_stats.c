@@ -3,6 +3,7 @@
 
 #include <linux/kernel.h>
 #include <linux/mutex.h>
+#include <linux/vmalloc.h>
 #include "ionic.h"
 #include "ionic_lif.h"
 #include "ionic_stats.h"
@@ -163,6 +164,7 @@ static const struct ionic_stat_desc ionic_tx_stats_desc[] = {
 	IONIC_TX_STAT_DESC(tso_bytes),
 	IONIC_TX_STAT_DESC(hwstamp_valid),
 	IONIC_TX_STAT_DESC(hwstamp_invalid),
+	IONIC_TX_STAT_DESC(xdp_frames),
 #ifdef IONIC_DEBUG_STATS
 	IONIC_TX_STAT_DESC(vlan_inserted),
 	IONIC_TX_STAT_DESC(frags),
@@ -193,6 +195,11 @@ static const struct ionic_stat_desc ionic_rx_stats_desc[] = {
 	IONIC_RX_STAT_DESC(buf_exhausted),
 	IONIC_RX_STAT_DESC(buf_not_reusable),
 	IONIC_RX_STAT_DESC(buf_reused),
+	IONIC_RX_STAT_DESC(xdp_drop),
+	IONIC_RX_STAT_DESC(xdp_aborted),
+	IONIC_RX_STAT_DESC(xdp_pass),
+	IONIC_RX_STAT_DESC(xdp_tx),
+	IONIC_RX_STAT_DESC(xdp_redirect),
 };
 
 #ifdef IONIC_DEBUG_STATS
@@ -263,6 +270,7 @@ static void ionic_add_lif_rxq_stats(struct ionic_lif *lif, int q_num,
 }
 
 static void ionic_get_lif_stats(struct ionic_lif *lif,
+				struct ionic_lif_stats *ls,
 				struct ionic_lif_sw_stats *stats)
 {
 	struct rtnl_link_stats64 ns;
@@ -281,7 +289,7 @@ static void ionic_get_lif_stats(struct ionic_lif *lif,
 	if (lif->hwstamp_rxq)
 		ionic_add_lif_rxq_stats(lif, lif->hwstamp_rxq->q.index, stats);
 
-	ionic_get_stats64(lif->netdev, &ns);
+	ionic_fill_stats64(ls, &ns);
 	stats->hw_tx_dropped = ns.tx_dropped;
 	stats->hw_rx_dropped = ns.rx_dropped;
 	stats->hw_rx_over_errors = ns.rx_over_errors;
@@ -289,7 +297,17 @@ static void ionic_get_lif_stats(struct ionic_lif *lif,
 	stats->hw_tx_aborted_errors = ns.tx_aborted_errors;
 }
 
-static u64 ionic_sw_stats_get_count(struct ionic_lif *lif)
+static bool ionic_sw_dbg_stats_on(struct ionic_lif *lif)
+{
+#ifdef IONIC_DEBUG_STATS
+	return test_bit(IONIC_LIF_F_UP, lif->state) &&
+	       test_bit(IONIC_LIF_F_SW_DEBUG_STATS, lif->state);
+#else
+	return false;
+#endif
+}
+
+static u64 ionic_sw_stats_count(struct ionic_lif *lif)
 {
 	u64 total = 0, tx_queues = MAX_Q(lif), rx_queues = MAX_Q(lif);
 
@@ -331,6 +349,295 @@ static u64 ionic_sw_stats_get_count(struct ionic_lif *lif)
 	return total;
 }
 
+/* Pregenerated ethtool stats layout.
+ *
+ * The set of stats only changes with the queue count, the hwstamp
+ * queues, and the debug-stats state, so the string table and the
+ * source of each value can be computed once and reused: a scrape is
+ * then one memcpy for the strings and one offset-indexed gather loop
+ * for the values, instead of thousands of snprintf calls per scrape.
+ * Each gather entry names its base structure by id rather than by
+ * cached pointer, so a queue reconfigure can't leave the list
+ * pointing at freed qcqs.
+ */
+enum ionic_stat_gather_base {
+	IONIC_STAT_BASE_LIF_SW,
+	IONIC_STAT_BASE_PORT,
+	IONIC_STAT_BASE_MGMT_PORT,
+	IONIC_STAT_BASE_TXQ_STATS,
+	IONIC_STAT_BASE_RXQ_STATS,
+#ifdef IONIC_DEBUG_STATS
+	IONIC_STAT_BASE_TXQ_Q,
+	IONIC_STAT_BASE_TXQ_CQ,
+	IONIC_STAT_BASE_TXQ_INTR,
+	IONIC_STAT_BASE_TXQ_NAPI,
+	IONIC_STAT_BASE_RXQ_CQ,
+	IONIC_STAT_BASE_RXQ_INTR,
+	IONIC_STAT_BASE_RXQ_NAPI,
+#endif
+};
+
+struct ionic_stat_gather {
+	u16 base;
+	u16 qi;
+	u32 off;
+};
+
+struct ionic_stats_layout {
+	u64 count;
+	u8 *strings;
+	struct ionic_stat_gather *gather;
+
+	/* the shape the layout was built for */
+	u32 max_q;
+	bool hwstamp_txq;
+	bool hwstamp_rxq;
+	bool dbg;
+};
+
+static struct ionic_stat_gather *
+ionic_stats_layout_tx(struct ionic_lif *lif, struct ionic_stat_gather *g,
+		      u8 **buf, int q_num)
+{
+	int i;
+
+	for (i = 0; i < IONIC_NUM_TX_STATS; i++) {
+		ethtool_sprintf(buf, "tx_%d_%s", q_num,
+				ionic_tx_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_TXQ_STATS;
+		g->qi = q_num;
+		g->off = ionic_tx_stats_desc[i].offset;
+		g++;
+	}
+
+#ifdef IONIC_DEBUG_STATS
+	if (!ionic_sw_dbg_stats_on(lif))
+		return g;
+
+	for (i = 0; i < IONIC_NUM_TX_Q_STATS; i++) {
+		ethtool_sprintf(buf, "txq_%d_%s", q_num,
+				ionic_txq_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_TXQ_Q;
+		g->qi = q_num;
+		g->off = ionic_txq_stats_desc[i].offset;
+		g++;
+	}
+	for (i = 0; i < IONIC_NUM_DBG_CQ_STATS; i++) {
+		ethtool_sprintf(buf, "txq_%d_cq_%s", q_num,
+				ionic_dbg_cq_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_TXQ_CQ;
+		g->qi = q_num;
+		g->off = ionic_dbg_cq_stats_desc[i].offset;
+		g++;
+	}
+	for (i = 0; i < IONIC_NUM_DBG_INTR_STATS; i++) {
+		ethtool_sprintf(buf, "txq_%d_intr_%s", q_num,
+				ionic_dbg_intr_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_TXQ_INTR;
+		g->qi = q_num;
+		g->off = ionic_dbg_intr_stats_desc[i].offset;
+		g++;
+	}
+	for (i = 0; i < IONIC_NUM_DBG_NAPI_STATS; i++) {
+		ethtool_sprintf(buf, "txq_%d_napi_%s", q_num,
+				ionic_dbg_napi_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_TXQ_NAPI;
+		g->qi = q_num;
+		g->off = ionic_dbg_napi_stats_desc[i].offset;
+		g++;
+	}
+	for (i = 0; i < IONIC_MAX_NUM_NAPI_CNTR; i++) {
+		ethtool_sprintf(buf, "txq_%d_napi_work_done_%d", q_num, i);
+		g->base = IONIC_STAT_BASE_TXQ_NAPI;
+		g->qi = q_num;
+		g->off = offsetof(struct ionic_napi_stats, work_done_cntr) +
+			 i * sizeof(u64);
+		g++;
+	}
+	for (i = 0; i < IONIC_MAX_NUM_SG_CNTR; i++) {
+		ethtool_sprintf(buf, "txq_%d_sg_cntr_%d", q_num, i);
+		g->base = IONIC_STAT_BASE_TXQ_STATS;
+		g->qi = q_num;
+		g->off = offsetof(struct ionic_tx_stats, sg_cntr) +
+			 i * sizeof(u64);
+		g++;
+	}
+#endif
+
+	return g;
+}
+
+static struct ionic_stat_gather *
+ionic_stats_layout_rx(struct ionic_lif *lif, struct ionic_stat_gather *g,
+		      u8 **buf, int q_num)
+{
+	int i;
+
+	for (i = 0; i < IONIC_NUM_RX_STATS; i++) {
+		ethtool_sprintf(buf, "rx_%d_%s", q_num,
+				ionic_rx_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_RXQ_STATS;
+		g->qi = q_num;
+		g->off = ionic_rx_stats_desc[i].offset;
+		g++;
+	}
+
+#ifdef IONIC_DEBUG_STATS
+	if (!ionic_sw_dbg_stats_on(lif))
+		return g;
+
+	for (i = 0; i < IONIC_NUM_DBG_CQ_STATS; i++) {
+		ethtool_sprintf(buf, "rxq_%d_cq_%s", q_num,
+				ionic_dbg_cq_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_RXQ_CQ;
+		g->qi = q_num;
+		g->off = ionic_dbg_cq_stats_desc[i].offset;
+		g++;
+	}
+	for (i = 0; i < IONIC_NUM_DBG_INTR_STATS; i++) {
+		ethtool_sprintf(buf, "rxq_%d_intr_%s", q_num,
+				ionic_dbg_intr_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_RXQ_INTR;
+		g->qi = q_num;
+		g->off = ionic_dbg_intr_stats_desc[i].offset;
+		g++;
+	}
+	for (i = 0; i < IONIC_NUM_DBG_NAPI_STATS; i++) {
+		ethtool_sprintf(buf, "rxq_%d_napi_%s", q_num,
+				ionic_dbg_napi_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_RXQ_NAPI;
+		g->qi = q_num;
+		g->off = ionic_dbg_napi_stats_desc[i].offset;
+		g++;
+	}
+	for (i = 0; i < IONIC_MAX_NUM_NAPI_CNTR; i++) {
+		ethtool_sprintf(buf, "rxq_%d_napi_work_done_%d", q_num, i);
+		g->base = IONIC_STAT_BASE_RXQ_NAPI;
+		g->qi = q_num;
+		g->off = offsetof(struct ionic_napi_stats, work_done_cntr) +
+			 i * sizeof(u64);
+		g++;
+	}
+#endif
+
+	return g;
+}
+
+void ionic_stats_layout_free(struct ionic_lif *lif)
+{
+	struct ionic_stats_layout *sl = lif->stats_layout;
+
+	if (!sl)
+		return;
+
+	lif->stats_layout = NULL;
+	vfree(sl->strings);
+	vfree(sl->gather);
+	kfree(sl);
+}
+
+static void ionic_stats_layout_build(struct ionic_lif *lif)
+{
+	struct ionic_stats_layout *sl;
+	struct ionic_stat_gather *g;
+	int i, q_num;
+	u64 count;
+	u8 *buf;
+
+	ionic_stats_layout_free(lif);
+
+	count = ionic_sw_stats_count(lif);
+
+	sl = kzalloc(sizeof(*sl), GFP_KERNEL);
+	if (!sl)
+		return;
+
+	sl->strings = vzalloc(count * ETH_GSTRING_LEN);
+	sl->gather = vzalloc(count * sizeof(*sl->gather));
+	if (!sl->strings || !sl->gather) {
+		vfree(sl->strings);
+		vfree(sl->gather);
+		kfree(sl);
+		return;
+	}
+
+	sl->count = count;
+	sl->max_q = MAX_Q(lif);
+	sl->hwstamp_txq = !!lif->hwstamp_txq;
+	sl->hwstamp_rxq = !!lif->hwstamp_rxq;
+	sl->dbg = ionic_sw_dbg_stats_on(lif);
+
+	buf = sl->strings;
+	g = sl->gather;
+
+	for (i = 0; i < IONIC_NUM_LIF_STATS; i++) {
+		ethtool_sprintf(&buf, ionic_lif_stats_desc[i].name);
+		g->base = IONIC_STAT_BASE_LIF_SW;
+		g->off = ionic_lif_stats_desc[i].offset;
+		g++;
+	}
+
+	if (lif->ionic->is_mgmt_nic) {
+		for (i = 0; i < IONIC_NUM_MGMT_PORT_STATS; i++) {
+			ethtool_sprintf(&buf,
+					ionic_mgmt_port_stats_desc[i].name);
+			g->base = IONIC_STAT_BASE_MGMT_PORT;
+			g->off = ionic_mgmt_port_stats_desc[i].offset;
+			g++;
+		}
+	} else {
+		for (i = 0; i < IONIC_NUM_PORT_STATS; i++) {
+			ethtool_sprintf(&buf, ionic_port_stats_desc[i].name);
+			g->base = IONIC_STAT_BASE_PORT;
+			g->off = ionic_port_stats_desc[i].offset;
+			g++;
+		}
+	}
+
+	for (q_num = 0; q_num < MAX_Q(lif); q_num++)
+		g = ionic_stats_layout_tx(lif, g, &buf, q_num);
+
+	if (lif->hwstamp_txq)
+		g = ionic_stats_layout_tx(lif, g, &buf,
+					  lif->hwstamp_txq->q.index);
+
+	for (q_num = 0; q_num < MAX_Q(lif); q_num++)
+		g = ionic_stats_layout_rx(lif, g, &buf, q_num);
+
+	if (lif->hwstamp_rxq)
+		g = ionic_stats_layout_rx(lif, g, &buf,
+					  lif->hwstamp_rxq->q.index);
+
+	WARN_ON_ONCE(g != sl->gather + count);
+
+	lif->stats_layout = sl;
+}
+
+static bool ionic_stats_layout_valid(struct ionic_lif *lif)
+{
+	struct ionic_stats_layout *sl = lif->stats_layout;
+
+	return sl &&
+	       sl->max_q == MAX_Q(lif) &&
+	       sl->hwstamp_txq == !!lif->hwstamp_txq &&
+	       sl->hwstamp_rxq == !!lif->hwstamp_rxq &&
+	       sl->dbg == ionic_sw_dbg_stats_on(lif);
+}
+
+static u64 ionic_sw_stats_get_count(struct ionic_lif *lif)
+{
+	/* the sset count is fetched ahead of each strings/values
+	 * scrape, so this is the spot to refresh the layout
+	 */
+	if (!ionic_stats_layout_valid(lif))
+		ionic_stats_layout_build(lif);
+
+	if (lif->stats_layout)
+		return lif->stats_layout->count;
+
+	return ionic_sw_stats_count(lif);
+}
+
 static void ionic_sw_stats_get_tx_strings(struct ionic_lif *lif, u8 **buf,
 					  int q_num)
 {
@@ -396,6 +703,14 @@ static void ionic_sw_stats_get_strings(struct ionic_lif *lif, u8 **buf)
 {
 	int i, q_num;
 
+	if (ionic_stats_layout_valid(lif)) {
+		struct ionic_stats_layout *sl = lif->stats_layout;
+
+		memcpy(*buf, sl->strings, sl->count * ETH_GSTRING_LEN);
+		*buf += sl->count * ETH_GSTRING_LEN;
+		return;
+	}
+
 	for (i = 0; i < IONIC_NUM_LIF_STATS; i++)
 		ethtool_sprintf(buf, ionic_lif_stats_desc[i].name);
 
@@ -517,14 +832,106 @@ static void ionic_sw_stats_get_rxq_values(struct ionic_lif *lif, u64 **buf,
 #endif
 }
 
+static void ionic_sw_stats_gather(struct ionic_lif *lif,
+				  struct ionic_lif_sw_stats *lif_stats,
+				  struct ionic_port_stats *port_stats,
+				  struct ionic_mgmt_port_stats *mgmt_stats,
+				  u64 *buf)
+{
+	struct ionic_stats_layout *sl = lif->stats_layout;
+	const struct ionic_stat_gather *g = sl->gather;
+	const void *base;
+	u64 n;
+
+	for (n = sl->count; n; n--, g++, buf++) {
+		switch (g->base) {
+		case IONIC_STAT_BASE_LIF_SW:
+			base = lif_stats;
+			break;
+		case IONIC_STAT_BASE_PORT:
+			*buf = le64_to_cpu(*(__le64 *)((u8 *)port_stats +
+						       g->off));
+			continue;
+		case IONIC_STAT_BASE_MGMT_PORT:
+			*buf = le64_to_cpu(*(__le64 *)((u8 *)mgmt_stats +
+						       g->off));
+			continue;
+		case IONIC_STAT_BASE_TXQ_STATS:
+			base = &lif->txqstats[g->qi];
+			break;
+		case IONIC_STAT_BASE_RXQ_STATS:
+			base = &lif->rxqstats[g->qi];
+			break;
+#ifdef IONIC_DEBUG_STATS
+		case IONIC_STAT_BASE_TXQ_Q:
+			base = &lif->txqcqs[g->qi]->q;
+			break;
+		case IONIC_STAT_BASE_TXQ_CQ:
+			base = &lif->txqcqs[g->qi]->cq;
+			break;
+		case IONIC_STAT_BASE_TXQ_INTR:
+			base = &lif->txqcqs[g->qi]->intr;
+			break;
+		case IONIC_STAT_BASE_TXQ_NAPI:
+			base = &lif->txqcqs[g->qi]->napi_stats;
+			break;
+		case IONIC_STAT_BASE_RXQ_CQ:
+			base = &lif->rxqcqs[g->qi]->cq;
+			break;
+		case IONIC_STAT_BASE_RXQ_INTR:
+			base = &lif->rxqcqs[g->qi]->intr;
+			break;
+		case IONIC_STAT_BASE_RXQ_NAPI:
+			base = &lif->rxqcqs[g->qi]->napi_stats;
+			break;
+#endif
+		default:
+			*buf = 0;
+			continue;
+		}
+		*buf = *(const u64 *)((const u8 *)base + g->off);
+	}
+}
+
 static void ionic_sw_stats_get_values(struct ionic_lif *lif, u64 **buf)
 {
+	struct ionic_port_info *port_info = lif->ionic->idev.port_info;
+	struct ionic_stats_snap *snap = lif->stats_snap;
 	struct ionic_mgmt_port_stats *mgmt_stats;
 	struct ionic_port_stats *port_stats;
 	struct ionic_lif_sw_stats lif_stats;
+	struct ionic_lif_stats *lf_stats;
 	int i, q_num;
 
-	ionic_get_lif_stats(lif, &lif_stats);
+	/* Copy each fw-updated stats page in a single pass and report from
+	 * the snapshot, so the values in one scrape are consistent with
+	 * each other even as the fw DMAs updates into the live pages.
+	 */
+	if (snap) {
+		memcpy(&snap->lif, &lif->info->stats, sizeof(snap->lif));
+		if (lif->ionic->is_mgmt_nic)
+			memcpy(&snap->mgmt, &port_info->mgmt_stats,
+			       sizeof(snap->mgmt));
+		else
+			memcpy(&snap->port, &port_info->stats,
+			       sizeof(snap->port));
+		lf_stats = &snap->lif;
+		mgmt_stats = &snap->mgmt;
+		port_stats = &snap->port;
+	} else {
+		lf_stats = &lif->info->stats;
+		mgmt_stats = &port_info->mgmt_stats;
+		port_stats = &port_info->stats;
+	}
+
+	ionic_get_lif_stats(lif, lf_stats, &lif_stats);
+
+	if (ionic_stats_layout_valid(lif)) {
+		ionic_sw_stats_gather(lif, &lif_stats, port_stats,
+				      mgmt_stats, *buf);
+		*buf += lif->stats_layout->count;
+		return;
+	}
 
 	for (i = 0; i < IONIC_NUM_LIF_STATS; i++) {
 		**buf = IONIC_READ_STAT64(&lif_stats, &ionic_lif_stats_desc[i]);
@@ -532,14 +939,12 @@ static void ionic_sw_stats_get_values(struct ionic_lif *lif, u64 **buf)
 	}
 
 	if (lif->ionic->is_mgmt_nic) {
-		mgmt_stats = &lif->ionic->idev.port_info->mgmt_stats;
 		for (i = 0; i < IONIC_NUM_MGMT_PORT_STATS; i++) {
 			**buf = IONIC_READ_STAT_LE64(mgmt_stats,
 						&ionic_mgmt_port_stats_desc[i]);
 			(*buf)++;
 		}
 	} else {
-		port_stats = &lif->ionic->idev.port_info->stats;
 		for (i = 0; i < IONIC_NUM_PORT_STATS; i++) {
 			**buf = IONIC_READ_STAT_LE64(port_stats,
 						     &ionic_port_stats_desc[i]);
@@ -50,6 +50,8 @@ struct ionic_stats_group_intf {
 extern const struct ionic_stats_group_intf ionic_stats_groups[];
 extern const int ionic_num_stats_grps;
 
+void ionic_stats_layout_free(struct ionic_lif *lif);
+
 #define IONIC_READ_STAT64(base_ptr, desc_ptr) \
 	(*((u64 *)(((u8 *)(base_ptr)) + (desc_ptr)->offset)))
 
@@ -0,0 +1,191 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright(c) 2017 - 2022 Pensando Systems, Inc */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ionic
+
+#if !defined(_IONIC_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _IONIC_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+/* Queue-shaped events share one template: queue name plus the ring
+ * indices at the time of the event.
+ */
+DECLARE_EVENT_CLASS(ionic_q_template,
+
+	TP_PROTO(struct ionic_queue *q),
+
+	TP_ARGS(q),
+
+	TP_STRUCT__entry(
+		__string(name, q->name)
+		__field(u32, index)
+		__field(u16, head)
+		__field(u16, tail)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, q->name);
+		__entry->index = q->index;
+		__entry->head = q->head_idx;
+		__entry->tail = q->tail_idx;
+	),
+
+	TP_printk("q %s index %u head %u tail %u",
+		  __get_str(name), __entry->index,
+		  __entry->head, __entry->tail)
+);
+
+DEFINE_EVENT(ionic_q_template, ionic_q_post,
+	TP_PROTO(struct ionic_queue *q),
+	TP_ARGS(q)
+);
+
+DEFINE_EVENT(ionic_q_template, ionic_dbell_ring,
+	TP_PROTO(struct ionic_queue *q),
+	TP_ARGS(q)
+);
+
+TRACE_EVENT(ionic_cq_service,
+
+	TP_PROTO(struct ionic_queue *q, unsigned int work_done),
+
+	TP_ARGS(q, work_done),
+
+	TP_STRUCT__entry(
+		__string(name, q->name)
+		__field(u32, index)
+		__field(u32, work_done)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, q->name);
+		__entry->index = q->index;
+		__entry->work_done = work_done;
+	),
+
+	TP_printk("q %s index %u work_done %u",
+		  __get_str(name), __entry->index, __entry->work_done)
+);
+
+TRACE_EVENT(ionic_napi_poll,
+
+	TP_PROTO(struct ionic_queue *q, int budget),
+
+	TP_ARGS(q, budget),
+
+	TP_STRUCT__entry(
+		__string(name, q->name)
+		__field(u32, index)
+		__field(int, budget)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, q->name);
+		__entry->index = q->index;
+		__entry->budget = budget;
+	),
+
+	TP_printk("q %s index %u budget %d",
+		  __get_str(name), __entry->index, __entry->budget)
+);
+
+TRACE_EVENT(ionic_napi_poll_done,
+
+	TP_PROTO(struct ionic_queue *q, unsigned int work_done),
+
+	TP_ARGS(q, work_done),
+
+	TP_STRUCT__entry(
+		__string(name, q->name)
+		__field(u32, index)
+		__field(u32, work_done)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, q->name);
+		__entry->index = q->index;
+		__entry->work_done = work_done;
+	),
+
+	TP_printk("q %s index %u work_done %u",
+		  __get_str(name), __entry->index, __entry->work_done)
+);
+
+TRACE_EVENT(ionic_adminq_post,
+
+	TP_PROTO(struct ionic_lif *lif, u8 opcode),
+
+	TP_ARGS(lif, opcode),
+
+	TP_STRUCT__entry(
+		__string(name, lif->name)
+		__field(u8, opcode)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, lif->name);
+		__entry->opcode = opcode;
+	),
+
+	TP_printk("lif %s opcode %u", __get_str(name), __entry->opcode)
+);
+
+TRACE_EVENT(ionic_adminq_comp,
+
+	TP_PROTO(struct ionic_lif *lif, u8 opcode, u8 status),
+
+	TP_ARGS(lif, opcode, status),
+
+	TP_STRUCT__entry(
+		__string(name, lif->name)
+		__field(u8, opcode)
+		__field(u8, status)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, lif->name);
+		__entry->opcode = opcode;
+		__entry->status = status;
+	),
+
+	TP_printk("lif %s opcode %u status %u",
+		  __get_str(name), __entry->opcode, __entry->status)
+);
+
+DECLARE_EVENT_CLASS(ionic_fw_template,
+
+	TP_PROTO(struct ionic_lif *lif),
+
+	TP_ARGS(lif),
+
+	TP_STRUCT__entry(
+		__string(name, lif->name)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, lif->name);
+	),
+
+	TP_printk("lif %s", __get_str(name))
+);
+
+DEFINE_EVENT(ionic_fw_template, ionic_fw_down,
+	TP_PROTO(struct ionic_lif *lif),
+	TP_ARGS(lif)
+);
+
+DEFINE_EVENT(ionic_fw_template, ionic_fw_up,
+	TP_PROTO(struct ionic_lif *lif),
+	TP_ARGS(lif)
+);
+
+#endif /* _IONIC_TRACE_H_ */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE ionic_trace
+#include <trace/define_trace.h>
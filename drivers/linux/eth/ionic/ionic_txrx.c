@@ -10,6 +10,41 @@
 #include "ionic.h"
 #include "ionic_lif.h"
 #include "ionic_txrx.h"
+#include "ionic_trace.h"
+
+#ifdef HAVE_PAGE_POOL
+#include <net/page_pool.h>
+#endif
+#ifdef HAVE_XDP_SUPPORT
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
+#include <net/xdp.h>
+#ifdef HAVE_XSK_BUFF_POOL
+#include <net/xdp_sock_drv.h>
+#include <net/xsk_buff_pool.h>
+#endif
+#endif
+
+DEFINE_STATIC_KEY_FALSE(ionic_hwstamp_key);
+
+static dma_addr_t ionic_tx_map_single(struct ionic_queue *q,
+				      void *data, size_t len);
+
+static void ionic_tx_clean(struct ionic_queue *q,
+			   struct ionic_desc_info *desc_info,
+			   struct ionic_cq_info *cq_info,
+			   void *cb_arg);
+
+static int ionic_maybe_stop_tx(struct ionic_queue *q, int ndescs);
+
+static void ionic_tx_zc_flush(struct ionic_queue *q);
+
+static void ionic_rx_clean(struct ionic_queue *q,
+			   struct ionic_desc_info *desc_info,
+			   struct ionic_cq_info *cq_info,
+			   struct ionic_rxq_comp *comp,
+			   void *cb_arg);
 
 static inline void ionic_txq_post(struct ionic_queue *q, bool ring_dbell,
 				  ionic_desc_cb cb_func, void *cb_arg)
@@ -50,6 +85,7 @@ bool ionic_txq_poke_doorbell(struct ionic_queue *q)
 	if (dif > q->dbell_deadline) {
 		ionic_dbell_ring(q->lif->kern_dbpage, q->hw_type,
 				 q->dbval | q->head_idx);
+		trace_ionic_dbell_ring(q);
 
 		q->dbell_jiffies = now;
 	}
@@ -75,6 +111,7 @@ bool ionic_rxq_poke_doorbell(struct ionic_queue *q)
 	if (dif > q->dbell_deadline) {
 		ionic_dbell_ring(q->lif->kern_dbpage, q->hw_type,
 				 q->dbval | q->head_idx);
+		trace_ionic_dbell_ring(q);
 
 		q->dbell_jiffies = now;
 
@@ -93,6 +130,19 @@ static inline struct netdev_queue *q_to_ndq(struct ionic_queue *q)
 	return netdev_get_tx_queue(q->lif->netdev, q->index);
 }
 
+/* Commit descriptor contents in one shot.  The CMB rings are mapped
+ * write-combining: pushing the whole line with 64-bit writes lets it
+ * leave the CPU as a single posted PCIe write, and the fence flushes
+ * the WC buffer so the line is on the wire ahead of the doorbell.
+ */
+static inline void ionic_write_cmb_desc(struct ionic_queue *q,
+					void __iomem *cmb_desc,
+					void *desc)
+{
+	__iowrite64_copy(cmb_desc, desc, q->desc_size / sizeof(u64));
+	wmb();
+}
+
 static inline void *ionic_rx_buf_va(struct ionic_buf_info *buf_info)
 {
 	return page_address(buf_info->page) + buf_info->page_offset;
@@ -108,6 +158,7 @@ static inline unsigned int ionic_rx_buf_size(struct ionic_buf_info *buf_info)
 	return IONIC_PAGE_SIZE - buf_info->page_offset;
 }
 
+#ifndef HAVE_PAGE_POOL
 static bool ionic_rx_cache_put(struct ionic_queue *q,
 			       struct ionic_buf_info *buf_info)
 {
@@ -179,7 +230,52 @@ static void ionic_rx_cache_drain(struct ionic_queue *q)
 	stats->cache_put = 0;
 	stats->cache_full = 0;
 }
+#endif /* !HAVE_PAGE_POOL */
+
+#ifdef HAVE_PAGE_POOL
+static void ionic_rx_buf_complete(struct ionic_queue *q,
+				  struct ionic_buf_info *buf_info, u32 used)
+{
+#ifndef HAVE_SKB_MARK_FOR_RECYCLE
+	/* the skb can't hand pages back to the pool on these kernels,
+	 * so unmap the page here and let the stack free it normally
+	 */
+	page_pool_release_page(q->page_pool, buf_info->page);
+#endif
+	buf_info->page = NULL;
+}
+
+static inline int ionic_rx_page_alloc(struct ionic_queue *q,
+				      struct ionic_buf_info *buf_info)
+{
+	struct ionic_rx_stats *stats = q_to_rx_stats(q);
+	struct page *page;
+
+	page = page_pool_dev_alloc_pages(q->page_pool);
+	if (unlikely(!page)) {
+		net_err_ratelimited("%s: %s page alloc failed\n",
+				    q->lif->netdev->name, q->name);
+		stats->alloc_err++;
+		return -ENOMEM;
+	}
+
+	buf_info->dma_addr = page_pool_get_dma_addr(page);
+	buf_info->page = page;
+	buf_info->page_offset = 0;
+
+	return 0;
+}
 
+static inline void ionic_rx_page_free(struct ionic_queue *q,
+				      struct ionic_buf_info *buf_info)
+{
+	if (!buf_info->page)
+		return;
+
+	page_pool_put_full_page(q->page_pool, buf_info->page, false);
+	buf_info->page = NULL;
+}
+#else /* HAVE_PAGE_POOL */
 static bool ionic_rx_buf_reuse(struct ionic_queue *q,
 			       struct ionic_buf_info *buf_info, u32 used)
 {
@@ -287,6 +383,7 @@ static inline void ionic_rx_page_free(struct ionic_queue *q,
 	__free_pages(buf_info->page, IONIC_PAGE_ORDER);
 	buf_info->page = NULL;
 }
+#endif /* HAVE_PAGE_POOL */
 
 static void ionic_rx_add_skb_frag(struct ionic_queue *q,
 				  struct sk_buff *skb,
@@ -326,71 +423,699 @@ static struct sk_buff *ionic_rx_build_skb(struct ionic_queue *q,
 	if (unlikely(!buf_info->page))
 		return NULL;
 
-	prefetchw(buf_info->page);
+	prefetchw(buf_info->page);
+
+	len = le16_to_cpu(comp->len);
+
+	if (len <= q->rx_copybreak) {
+		head_len = len;
+	} else {
+		u16 sync_len;
+
+		/* Header-split: find where the protocol headers end and
+		 * pull only those into the skb head, so the stack never
+		 * has to touch payload cachelines; the payload stays
+		 * behind in the page frags.
+		 */
+		sync_len = min_t(u16, len, IONIC_RX_MAX_HEADER_LEN);
+		dma_sync_single_for_cpu(dev, ionic_rx_buf_pa(buf_info),
+					sync_len, DMA_FROM_DEVICE);
+		head_len = eth_get_headlen(netdev, ionic_rx_buf_va(buf_info),
+					   sync_len);
+	}
+
+	skb = napi_alloc_skb(&q_to_qcq(q)->napi, head_len);
+	if (unlikely(!skb)) {
+		net_warn_ratelimited("%s: SKB alloc failed on %s!\n",
+				     netdev->name, q->name);
+		stats->alloc_err++;
+		return NULL;
+	}
+
+#ifdef HAVE_SKB_MARK_FOR_RECYCLE
+	skb_mark_for_recycle(skb);
+#endif
+	copy_len = ALIGN(head_len, sizeof(long)); /* for better memcpy performance */
+	dma_sync_single_for_cpu(dev, ionic_rx_buf_pa(buf_info), copy_len, DMA_FROM_DEVICE);
+	skb_copy_to_linear_data(skb, ionic_rx_buf_va(buf_info), copy_len);
+	skb_put(skb, head_len);
+
+	if (len > head_len) {
+		len -= head_len;
+		frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info) - head_len);
+		len -= frag_len;
+		ionic_rx_add_skb_frag(q, skb, buf_info, head_len, frag_len);
+		buf_info++;
+		for (i = 0; i < comp->num_sg_elems; i++) {
+			if (len == 0)
+				goto err_out;
+			if (unlikely(!buf_info->page))
+				goto err_out;
+			frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info));
+			len -= frag_len;
+			ionic_rx_add_skb_frag(q, skb, buf_info, 0, frag_len);
+			buf_info++;
+		}
+	} else {
+		dma_sync_single_for_device(dev,
+					   ionic_rx_buf_pa(buf_info),
+					   len, DMA_FROM_DEVICE);
+	}
+
+	skb->protocol = eth_type_trans(skb, q->lif->netdev);
+
+	return skb;
+
+err_out:
+	if (skb)
+		dev_kfree_skb(skb);
+	return NULL;
+}
+
+/* GRO-frags mode: hand the page frags straight to GRO on napi's cached
+ * skb rather than building one per packet.  GRO pulls the headers out of
+ * the first frag itself, so there's no copy into a linear area and no
+ * skb allocation per segment.
+ */
+static struct sk_buff *ionic_rx_build_skb_frags(struct ionic_queue *q,
+						struct ionic_desc_info *desc_info,
+						struct ionic_rxq_comp *comp)
+{
+	struct napi_struct *napi = &q_to_qcq(q)->napi;
+	struct ionic_buf_info *buf_info;
+	struct ionic_rx_stats *stats;
+	struct sk_buff *skb;
+	unsigned int i;
+	u16 frag_len;
+	u16 len;
+
+	stats = q_to_rx_stats(q);
+
+	buf_info = &desc_info->bufs[0];
+	if (unlikely(!buf_info->page))
+		return NULL;
+
+	prefetchw(buf_info->page);
+
+	skb = napi_get_frags(napi);
+	if (unlikely(!skb)) {
+		net_warn_ratelimited("%s: SKB alloc failed on %s!\n",
+				     q->lif->netdev->name, q->name);
+		stats->alloc_err++;
+		return NULL;
+	}
+
+#ifdef HAVE_SKB_MARK_FOR_RECYCLE
+	skb_mark_for_recycle(skb);
+#endif
+	len = le16_to_cpu(comp->len);
+	frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info));
+	len -= frag_len;
+	ionic_rx_add_skb_frag(q, skb, buf_info, 0, frag_len);
+	buf_info++;
+	for (i = 0; i < comp->num_sg_elems; i++) {
+		if (len == 0)
+			break;
+		if (unlikely(!buf_info->page))
+			goto err_out;
+		frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info));
+		len -= frag_len;
+		ionic_rx_add_skb_frag(q, skb, buf_info, 0, frag_len);
+		buf_info++;
+	}
+
+	return skb;
+
+err_out:
+	napi_free_frags(napi);
+	return NULL;
+}
+
+#ifdef HAVE_PAGE_POOL
+/* Multi-buffer frames: build the skb head in place over the first DMA
+ * buffer instead of allocating one and copying the headers into it.
+ * ionic_rx_fill() reserved tailroom in the first buffer for the skb
+ * shared info, so the whole page becomes the head.
+ */
+static struct sk_buff *ionic_rx_build_skb_inplace(struct ionic_queue *q,
+						  struct ionic_desc_info *desc_info,
+						  struct ionic_rxq_comp *comp)
+{
+	struct ionic_buf_info *buf_info;
+	struct ionic_rx_stats *stats;
+	struct sk_buff *skb;
+	unsigned int i;
+	u16 head_len;
+	u16 frag_len;
+	u16 len;
+
+	stats = q_to_rx_stats(q);
+
+	buf_info = &desc_info->bufs[0];
+	if (unlikely(!buf_info->page))
+		return NULL;
+
+	len = le16_to_cpu(comp->len);
+	head_len = min_t(u16, len, ionic_rx_buf_size(buf_info) -
+			 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)));
+
+	dma_sync_single_for_cpu(q->dev, ionic_rx_buf_pa(buf_info),
+				head_len, DMA_FROM_DEVICE);
+
+	skb = build_skb(page_address(buf_info->page), IONIC_PAGE_SIZE);
+	if (unlikely(!skb)) {
+		net_warn_ratelimited("%s: SKB alloc failed on %s!\n",
+				     q->lif->netdev->name, q->name);
+		stats->alloc_err++;
+		return NULL;
+	}
+
+#ifdef HAVE_SKB_MARK_FOR_RECYCLE
+	skb_mark_for_recycle(skb);
+#endif
+	skb_reserve(skb, buf_info->page_offset);
+	skb_put(skb, head_len);
+	len -= head_len;
+
+	/* the head owns the first page now, not the frag list */
+	ionic_rx_buf_complete(q, buf_info, head_len);
+	buf_info++;
+	for (i = 0; i < comp->num_sg_elems; i++) {
+		if (len == 0)
+			break;
+		if (unlikely(!buf_info->page))
+			goto err_out;
+		frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info));
+		len -= frag_len;
+		ionic_rx_add_skb_frag(q, skb, buf_info, 0, frag_len);
+		buf_info++;
+	}
+
+	skb->protocol = eth_type_trans(skb, q->lif->netdev);
+
+	return skb;
+
+err_out:
+	dev_kfree_skb(skb);
+	return NULL;
+}
+#endif /* HAVE_PAGE_POOL */
+
+#ifdef HAVE_XDP_SUPPORT
+static void ionic_xdp_tx_desc_clean(struct ionic_queue *q,
+				    struct ionic_desc_info *desc_info)
+{
+	struct ionic_buf_info *buf_info = desc_info->bufs;
+	struct device *dev = q->dev;
+
+	if (!desc_info->nbufs)
+		return;
+
+#ifdef HAVE_PAGE_POOL
+	if (desc_info->act == XDP_TX) {
+		/* dma still belongs to the rx page_pool, return the page whole */
+		page_pool_put_full_page(q->partner->page_pool,
+					buf_info->page, false);
+	} else {
+		dma_unmap_single(dev, buf_info->dma_addr,
+				 buf_info->len, DMA_TO_DEVICE);
+	}
+#else
+	dma_unmap_single(dev, buf_info->dma_addr,
+			 buf_info->len, DMA_TO_DEVICE);
+	if (desc_info->act == XDP_TX)
+		__free_pages(buf_info->page, IONIC_PAGE_ORDER);
+#endif
+	buf_info->page = NULL;
+
+	if (desc_info->act == XDP_REDIRECT)
+		xdp_return_frame(desc_info->xdpf);
+
+	desc_info->nbufs = 0;
+	desc_info->xdpf = NULL;
+	desc_info->act = 0;
+}
+
+static int ionic_xdp_post_frame(struct ionic_queue *q, struct xdp_frame *frame,
+				enum xdp_action act, struct page *page, int off,
+				bool ring_doorbell)
+{
+	struct ionic_desc_info *desc_info;
+	struct ionic_buf_info *buf_info;
+	struct ionic_tx_stats *stats;
+	struct ionic_txq_desc *desc;
+	size_t len = frame->len;
+	dma_addr_t dma_addr;
+	u64 cmd;
+
+	desc_info = &q->info[q->head_idx];
+	desc = desc_info->txq_desc;
+	buf_info = desc_info->bufs;
+	stats = q_to_tx_stats(q);
+
+#ifdef HAVE_PAGE_POOL
+	if (act == XDP_TX) {
+		/* the page is already mapped by the rx page_pool */
+		dma_addr = page_pool_get_dma_addr(page) +
+			   (frame->data - page_address(page));
+		dma_sync_single_for_device(q->dev, dma_addr, len,
+					   DMA_TO_DEVICE);
+	} else {
+		dma_addr = ionic_tx_map_single(q, frame->data, len);
+		if (unlikely(!dma_addr))
+			return -EIO;
+	}
+#else
+	dma_addr = ionic_tx_map_single(q, frame->data, len);
+	if (unlikely(!dma_addr))
+		return -EIO;
+#endif
+	buf_info->dma_addr = dma_addr;
+	buf_info->len = len;
+	buf_info->page = page;
+	buf_info->page_offset = off;
+
+	desc_info->nbufs = 1;
+	desc_info->xdpf = frame;
+	desc_info->act = act;
+
+	cmd = encode_txq_desc_cmd(IONIC_TXQ_DESC_OPCODE_CSUM_NONE,
+				  0, 0, buf_info->dma_addr);
+	desc->cmd = cpu_to_le64(cmd);
+	desc->len = cpu_to_le16(len);
+
+	if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
+		ionic_write_cmb_desc(q, desc_info->cmb_desc, desc);
+
+	stats->xdp_frames++;
+	stats->pkts++;
+	stats->bytes += len;
+
+	ionic_txq_post(q, ring_doorbell, ionic_tx_clean, NULL);
+
+	return 0;
+}
+
+int ionic_xdp_xmit(struct net_device *netdev, int n,
+		   struct xdp_frame **xdp_frames, u32 flags)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	struct ionic_queue *txq;
+	struct netdev_queue *nq;
+	int nxmit;
+	int space;
+	int cpu;
+	int qi;
+
+	if (unlikely(!test_bit(IONIC_LIF_F_UP, lif->state)))
+		return -ENETDOWN;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	/* AdminQ is assumed on cpu 0, while we attempt to affinitize the
+	 * TxRx queue pairs 0..n-1 on cpus 1..n.  We try to keep with that
+	 * affinitization here, but of course irqbalance and friends might
+	 * have juggled things anyway, so we have to check for the 0 case.
+	 */
+	cpu = smp_processor_id();
+	qi = cpu ? (cpu - 1) % lif->nxqs : cpu;
+
+	txq = &lif->xdpqcqs[qi]->q;
+	nq = netdev_get_tx_queue(netdev, txq->index);
+	__netif_tx_lock(nq, cpu);
+
+	space = min_t(int, n, ionic_q_space_avail(txq));
+	for (nxmit = 0; nxmit < space ; nxmit++) {
+		if (ionic_xdp_post_frame(txq, xdp_frames[nxmit],
+					 XDP_REDIRECT,
+					 virt_to_page(xdp_frames[nxmit]->data),
+					 0, false)) {
+			nxmit--;
+			break;
+		}
+	}
+
+	if (flags & XDP_XMIT_FLUSH)
+		ionic_dbell_ring(lif->kern_dbpage, txq->hw_type,
+				 txq->dbval | txq->head_idx);
+
+	ionic_maybe_stop_tx(txq, 4);
+	__netif_tx_unlock(nq);
+
+	return nxmit;
+}
+
+static bool ionic_run_xdp(struct ionic_rx_stats *stats,
+			  struct net_device *netdev,
+			  struct bpf_prog *xdp_prog,
+			  struct ionic_queue *rxq,
+			  struct ionic_buf_info *buf_info,
+			  int len)
+{
+	u32 xdp_action = XDP_ABORTED;
+	struct xdp_buff xdp_buf;
+	struct ionic_queue *txq;
+	struct netdev_queue *nq;
+	struct xdp_frame *xdpf;
+	int err = 0;
+
+	xdp_init_buff(&xdp_buf, IONIC_PAGE_SIZE, rxq->xdp_rxq_info);
+	xdp_prepare_buff(&xdp_buf, ionic_rx_buf_va(buf_info),
+			 XDP_PACKET_HEADROOM, len, false);
+
+	dma_sync_single_range_for_cpu(rxq->dev, ionic_rx_buf_pa(buf_info),
+				      XDP_PACKET_HEADROOM, len,
+				      DMA_FROM_DEVICE);
+
+	prefetchw(&xdp_buf.data_hard_start);
+
+	xdp_action = bpf_prog_run_xdp(xdp_prog, &xdp_buf);
+
+	switch (xdp_action) {
+	case XDP_PASS:
+		stats->xdp_pass++;
+		return false;  /* false = we didn't consume the packet */
+
+	case XDP_DROP:
+		ionic_rx_page_free(rxq, buf_info);
+		stats->xdp_drop++;
+		break;
+
+	case XDP_TX:
+		xdpf = xdp_convert_buff_to_frame(&xdp_buf);
+		if (unlikely(!xdpf))
+			goto out_xdp_abort;
+
+		txq = rxq->partner;
+		nq = netdev_get_tx_queue(netdev, txq->index);
+		__netif_tx_lock(nq, smp_processor_id());
+
+		if (unlikely(!ionic_q_has_space(txq, 1))) {
+			__netif_tx_unlock(nq);
+			goto out_xdp_abort;
+		}
+
+#ifndef HAVE_PAGE_POOL
+		dma_unmap_page(rxq->dev, buf_info->dma_addr,
+			       IONIC_PAGE_SIZE, DMA_FROM_DEVICE);
+
+#endif
+		err = ionic_xdp_post_frame(txq, xdpf, XDP_TX,
+					   buf_info->page,
+					   buf_info->page_offset,
+					   true);
+		__netif_tx_unlock(nq);
+		if (err) {
+			netdev_dbg(netdev, "tx ionic_xdp_post_frame err %d\n", err);
+			goto out_xdp_abort;
+		}
+		buf_info->page = NULL;
+		stats->xdp_tx++;
+
+		/* the Tx completion will free the buffers */
+		break;
+
+	case XDP_REDIRECT:
+#ifndef HAVE_PAGE_POOL
+		/* unmap the pages before handing them to a different device */
+		dma_unmap_page(rxq->dev, buf_info->dma_addr,
+			       IONIC_PAGE_SIZE, DMA_FROM_DEVICE);
+
+#endif
+		err = xdp_do_redirect(netdev, &xdp_buf, xdp_prog);
+		if (err) {
+			netdev_dbg(netdev, "xdp_do_redirect err %d\n", err);
+			goto out_xdp_abort;
+		}
+		buf_info->page = NULL;
+		rxq->xdp_flush = true;
+		stats->xdp_redirect++;
+		break;
+
+	default:
+		goto out_xdp_abort;
+	}
+
+	return true;
+
+out_xdp_abort:
+	trace_xdp_exception(netdev, xdp_prog, xdp_action);
+	ionic_rx_page_free(rxq, buf_info);
+	stats->xdp_aborted++;
+
+	return true;
+}
+
+#ifdef HAVE_XSK_BUFF_POOL
+static void ionic_rx_fill_zc(struct ionic_queue *q)
+{
+	struct ionic_desc_info *desc_info;
+	unsigned int fill_threshold;
+	struct ionic_rxq_desc *desc;
+	struct xdp_buff *xdp_buf;
+	unsigned int n_fill;
+	unsigned int i;
+
+	n_fill = ionic_q_space_avail(q);
+
+	fill_threshold = min_t(unsigned int, q->lif->rx_fill_threshold,
+			       q->num_descs / IONIC_RX_FILL_DIV);
+	if (n_fill < fill_threshold)
+		return;
+
+	for (i = n_fill; i; i--) {
+		xdp_buf = xsk_buff_alloc(q->xsk_pool);
+		if (!xdp_buf)
+			break;
+
+		desc_info = &q->info[q->head_idx];
+		desc = desc_info->desc;
+		desc->addr = cpu_to_le64(xsk_buff_xdp_get_dma(xdp_buf));
+		desc->len = cpu_to_le16(xsk_pool_get_rx_frame_size(q->xsk_pool));
+		desc->opcode = IONIC_RXQ_DESC_OPCODE_SIMPLE;
+		desc_info->nbufs = 1;
+		desc_info->xsk_buf = xdp_buf;
+
+		if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
+			ionic_write_cmb_desc(q, desc_info->cmb_desc, desc);
+
+		ionic_rxq_post(q, false, ionic_rx_clean, NULL);
+	}
+
+	if (xsk_uses_need_wakeup(q->xsk_pool)) {
+		if (i)
+			xsk_set_rx_need_wakeup(q->xsk_pool);
+		else
+			xsk_clear_rx_need_wakeup(q->xsk_pool);
+	}
+
+	if (i == n_fill)
+		return;
+
+	ionic_dbell_ring(q->lif->kern_dbpage, q->hw_type,
+			 q->dbval | q->head_idx);
+	trace_ionic_dbell_ring(q);
+
+	q->dbell_deadline = IONIC_RX_MIN_DOORBELL_DEADLINE;
+	q->dbell_jiffies = jiffies;
+
+	ionic_napi_deadline_set(q_to_qcq(q)->napi_qcq);
+}
+
+static void ionic_rx_clean_zc(struct ionic_queue *q,
+			      struct ionic_desc_info *desc_info,
+			      struct ionic_cq_info *cq_info)
+{
+	struct net_device *netdev = q->lif->netdev;
+	struct ionic_qcq *qcq = q_to_qcq(q);
+	struct ionic_rx_stats *stats;
+	struct ionic_rxq_comp *comp;
+	struct bpf_prog *xdp_prog;
+	struct xdp_buff *xdp_buf;
+	struct sk_buff *skb;
+	u32 xdp_action;
+	u16 len;
+
+	comp = cq_info->cq_desc + qcq->cq.desc_size - sizeof(*comp);
+
+	stats = q_to_rx_stats(q);
+
+	xdp_buf = desc_info->xsk_buf;
+	desc_info->xsk_buf = NULL;
+	if (unlikely(!xdp_buf))
+		return;
+
+	if (comp->status) {
+		stats->dropped++;
+		xsk_buff_free(xdp_buf);
+		return;
+	}
+
+	len = le16_to_cpu(comp->len);
+	stats->pkts++;
+	stats->bytes += len;
+
+	xdp_buf->data_end = xdp_buf->data + len;
+	xsk_buff_dma_sync_for_cpu(xdp_buf, q->xsk_pool);
+
+	xdp_prog = READ_ONCE(q->xdp_prog);
+	if (!xdp_prog)
+		goto out_pass;
+
+	xdp_action = bpf_prog_run_xdp(xdp_prog, xdp_buf);
+
+	switch (xdp_action) {
+	case XDP_PASS:
+		goto out_pass;
+
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(netdev, xdp_buf, xdp_prog)) {
+			xsk_buff_free(xdp_buf);
+			stats->xdp_aborted++;
+			return;
+		}
+		q->xdp_flush = true;
+		stats->xdp_redirect++;
+		return;
+
+	case XDP_DROP:
+		xsk_buff_free(xdp_buf);
+		stats->xdp_drop++;
+		return;
+
+	default:
+		/* no XDP_TX from a zero-copy buffer */
+		trace_xdp_exception(netdev, xdp_prog, xdp_action);
+		xsk_buff_free(xdp_buf);
+		stats->xdp_aborted++;
+		return;
+	}
+
+out_pass:
+	/* the umem buffer must go straight back to the pool,
+	 * so packets for the stack are copied out to an skb
+	 */
+	skb = napi_alloc_skb(&qcq->napi, len);
+	if (unlikely(!skb)) {
+		xsk_buff_free(xdp_buf);
+		stats->alloc_err++;
+		return;
+	}
+
+	skb_put_data(skb, xdp_buf->data, len);
+	xsk_buff_free(xdp_buf);
+
+	skb->protocol = eth_type_trans(skb, netdev);
+	skb_record_rx_queue(skb, q->index);
+	stats->xdp_pass++;
+
+	napi_gro_receive(&qcq->napi, skb);
+}
+
+static void ionic_xdp_xmit_zc(struct ionic_queue *q, int budget)
+{
+	struct xsk_buff_pool *pool = q->xsk_pool;
+	struct ionic_desc_info *desc_info;
+	struct ionic_txq_desc *desc;
+	struct xdp_desc xdp_desc;
+	dma_addr_t dma_addr;
+	int nxmit = 0;
+	u64 cmd;
+
+	while (nxmit < budget && ionic_q_has_space(q, 1)) {
+		if (!xsk_tx_peek_desc(pool, &xdp_desc))
+			break;
+
+		dma_addr = xsk_buff_raw_get_dma(pool, xdp_desc.addr);
+		xsk_buff_raw_dma_sync_for_device(pool, dma_addr, xdp_desc.len);
+
+		desc_info = &q->info[q->head_idx];
+		desc = desc_info->txq_desc;
+		desc_info->nbufs = 1;
+		desc_info->bufs[0].dma_addr = dma_addr;
+		desc_info->bufs[0].len = xdp_desc.len;
+		desc_info->bufs[0].page = NULL;
 
-	len = le16_to_cpu(comp->len);
-	head_len = min_t(u16, q->lif->rx_copybreak, len);
+		cmd = encode_txq_desc_cmd(IONIC_TXQ_DESC_OPCODE_CSUM_NONE,
+					  0, 0, dma_addr);
+		desc->cmd = cpu_to_le64(cmd);
+		desc->len = cpu_to_le16(xdp_desc.len);
 
-	skb = napi_alloc_skb(&q_to_qcq(q)->napi, head_len);
-	if (unlikely(!skb)) {
-		net_warn_ratelimited("%s: SKB alloc failed on %s!\n",
-				     netdev->name, q->name);
-		stats->alloc_err++;
-		return NULL;
+		if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
+			ionic_write_cmb_desc(q, desc_info->cmb_desc, desc);
+
+		ionic_txq_post(q, false, ionic_tx_clean, NULL);
+		nxmit++;
 	}
 
-	copy_len = ALIGN(head_len, sizeof(long)); /* for better memcpy performance */
-	dma_sync_single_for_cpu(dev, ionic_rx_buf_pa(buf_info), copy_len, DMA_FROM_DEVICE);
-	skb_copy_to_linear_data(skb, ionic_rx_buf_va(buf_info), copy_len);
-	skb_put(skb, head_len);
+	if (nxmit) {
+		ionic_dbell_ring(q->lif->kern_dbpage, q->hw_type,
+				 q->dbval | q->head_idx);
+		xsk_tx_release(pool);
+	}
+}
 
-	if (len > head_len) {
-		len -= head_len;
-		frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info) - head_len);
-		len -= frag_len;
-		ionic_rx_add_skb_frag(q, skb, buf_info, head_len, frag_len);
-		buf_info++;
-		for (i = 0; i < comp->num_sg_elems; i++) {
-			if (len == 0)
-				goto err_out;
-			if (unlikely(!buf_info->page))
-				goto err_out;
-			frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info));
-			len -= frag_len;
-			ionic_rx_add_skb_frag(q, skb, buf_info, 0, frag_len);
-			buf_info++;
-		}
-	} else {
-		dma_sync_single_for_device(dev,
-					   ionic_rx_buf_pa(buf_info),
-					   len, DMA_FROM_DEVICE);
+static void ionic_xsk_tx_service(struct ionic_queue *q)
+{
+	if (q->xsk_frames_done) {
+		xsk_tx_completed(q->xsk_pool, q->xsk_frames_done);
+		q->xsk_frames_done = 0;
 	}
 
-	skb->protocol = eth_type_trans(skb, q->lif->netdev);
+	if (xsk_uses_need_wakeup(q->xsk_pool))
+		xsk_set_tx_need_wakeup(q->xsk_pool);
 
-	return skb;
+	ionic_xdp_xmit_zc(q, IONIC_TX_BUDGET_DEFAULT);
+}
+#endif /* HAVE_XSK_BUFF_POOL */
+#endif /* HAVE_XDP_SUPPORT */
 
-err_out:
-	if (skb)
-		dev_kfree_skb(skb);
-	return NULL;
+static void ionic_rx_copybreak_update(struct ionic_queue *q, u16 len)
+{
+	u32 avg = q->rx_pkt_len_avg;
+
+	/* EWMA of recent packet sizes, weighted about 8 packets deep */
+	avg += ((int)len - (int)avg) >> 3;
+	q->rx_pkt_len_avg = avg;
+
+	/* Queues dominated by large frames stop copying into the skb
+	 * head, queues that fall back to small frames resume; the
+	 * lif-wide copybreak set through ethtool stays the ceiling.
+	 */
+	if (avg > 2 * q->lif->rx_copybreak)
+		q->rx_copybreak = min_t(u32, IONIC_RX_COPYBREAK_MIN,
+					q->lif->rx_copybreak);
+	else if (avg < q->lif->rx_copybreak)
+		q->rx_copybreak = q->lif->rx_copybreak;
 }
 
 static void ionic_rx_clean(struct ionic_queue *q,
 			   struct ionic_desc_info *desc_info,
 			   struct ionic_cq_info *cq_info,
+			   struct ionic_rxq_comp *comp,
 			   void *cb_arg)
 {
 	struct net_device *netdev = q->lif->netdev;
 	struct ionic_qcq *qcq = q_to_qcq(q);
+#ifdef HAVE_XDP_SUPPORT
+	struct bpf_prog *xdp_prog;
+#endif
 	struct ionic_rx_stats *stats;
-	struct ionic_rxq_comp *comp;
 	struct sk_buff *skb;
+	bool use_frags;
 #ifdef CSUM_DEBUG
 	__sum16 csum;
 #endif
 
-	comp = cq_info->cq_desc + qcq->cq.desc_size - sizeof(*comp);
+#ifdef HAVE_XSK_BUFF_POOL
+	if (q->xsk_pool) {
+		ionic_rx_clean_zc(q, desc_info, cq_info);
+		return;
+	}
+#endif
+
+	DEBUG_STATS_DESC_COMP(qcq, desc_info);
 
 	stats = q_to_rx_stats(q);
 
@@ -410,14 +1135,43 @@ static void ionic_rx_clean(struct ionic_queue *q,
 	stats->pkts++;
 	stats->bytes += le16_to_cpu(comp->len);
 
-	skb = ionic_rx_build_skb(q, desc_info, comp);
+#ifdef HAVE_XDP_SUPPORT
+	xdp_prog = READ_ONCE(q->xdp_prog);
+	if (xdp_prog) {
+		if (ionic_run_xdp(stats, netdev, xdp_prog, q,
+				  desc_info->bufs, le16_to_cpu(comp->len)))
+			return;
+
+		/* XDP_PASS - continue to the skb path, with the buffer
+		 * offset skipping over the headroom the program saw
+		 */
+		desc_info->bufs[0].page_offset += XDP_PACKET_HEADROOM;
+	}
+#endif
+
+	ionic_rx_copybreak_update(q, le16_to_cpu(comp->len));
+
+	/* Frames that fit under the copybreak are cheaper to copy into
+	 * a linear skb than to run through the frag machinery.
+	 */
+	use_frags = q->rx_gro_frags &&
+		    le16_to_cpu(comp->len) > q->rx_copybreak;
+	if (use_frags)
+		skb = ionic_rx_build_skb_frags(q, desc_info, comp);
+#ifdef HAVE_PAGE_POOL
+	else if (q->rx_inplace && le16_to_cpu(comp->len) > q->rx_copybreak)
+		skb = ionic_rx_build_skb_inplace(q, desc_info, comp);
+#endif
+	else
+		skb = ionic_rx_build_skb(q, desc_info, comp);
 	if (unlikely(!skb)) {
 		stats->dropped++;
 		return;
 	}
 
 #ifdef CSUM_DEBUG
-	csum = ip_compute_csum(skb->data, skb->len);
+	if (!use_frags)
+		csum = ip_compute_csum(skb->data, skb->len);
 #endif
 
 	skb_record_rx_queue(skb, q->index);
@@ -447,7 +1201,7 @@ static void ionic_rx_clean(struct ionic_queue *q,
 		stats->csum_complete++;
 #endif
 #ifdef CSUM_DEBUG
-		if (skb->csum != (u16)~csum)
+		if (!use_frags && skb->csum != (u16)~csum)
 			netdev_warn(netdev, "Rx CSUM incorrect. Want 0x%04x got 0x%04x, protocol 0x%04x\n",
 				    (u16)~csum, skb->csum,
 				    htons(skb->protocol));
@@ -472,7 +1226,8 @@ static void ionic_rx_clean(struct ionic_queue *q,
 #endif
 	}
 
-	if (unlikely(q->features & IONIC_RXQ_F_HWSTAMP)) {
+	if (static_branch_unlikely(&ionic_hwstamp_key) &&
+	    (q->features & IONIC_RXQ_F_HWSTAMP)) {
 		__le64 *cq_desc_hwstamp;
 		u64 hwstamp;
 
@@ -485,14 +1240,65 @@ static void ionic_rx_clean(struct ionic_queue *q,
 		hwstamp = le64_to_cpu(*cq_desc_hwstamp);
 
 		if (hwstamp != IONIC_HWSTAMP_INVALID) {
-			skb_hwtstamps(skb)->hwtstamp = ionic_lif_phc_ktime(q->lif, hwstamp);
+			skb_hwtstamps(skb)->hwtstamp =
+				ionic_lif_phc_snap_ktime(&qcq->phc_snap,
+							 hwstamp);
 			stats->hwstamp_valid++;
 		} else {
 			stats->hwstamp_invalid++;
 		}
 	}
 
-	napi_gro_receive(&qcq->napi, skb);
+	if (use_frags)
+		napi_gro_frags(&qcq->napi);
+	else
+		napi_gro_receive(&qcq->napi, skb);
+}
+
+/* Decode a batch completion: one cq descriptor summarizing up to
+ * IONIC_RXQ_COMP_BATCH_MAX consecutive small packets, with per-packet
+ * lengths packed in the record.  The device only batches packets that
+ * carry no offload metadata, so each is cleaned through the normal path
+ * with a synthesized plain completion.
+ */
+static bool ionic_rx_service_batch(struct ionic_cq *cq,
+				   struct ionic_cq_info *cq_info)
+{
+	struct ionic_rxq_comp_batch *batch;
+	struct ionic_queue *q = cq->bound_q;
+	struct ionic_desc_info *desc_info;
+	struct ionic_rxq_comp comp = {};
+	unsigned int i, npkts;
+
+	batch = cq_info->cq_desc + cq->desc_size - sizeof(*batch);
+
+	/* check for empty queue */
+	if (q->tail_idx == q->head_idx)
+		return false;
+
+	if (q->tail_idx != le16_to_cpu(batch->comp_index))
+		return false;
+
+	npkts = min_t(unsigned int, batch->num_pkts,
+		      IONIC_RXQ_COMP_BATCH_MAX);
+	comp.status = batch->status;
+
+	for (i = 0; i < npkts && q->tail_idx != q->head_idx; i++) {
+		comp.comp_index = cpu_to_le16(q->tail_idx);
+		comp.len = cpu_to_le16(le16_to_cpu(batch->pkt[i]) &
+				       IONIC_RXQ_COMP_BATCH_LEN_MASK);
+
+		desc_info = &q->info[q->tail_idx];
+		q->tail_idx = (q->tail_idx + 1) & (q->num_descs - 1);
+
+		ionic_rx_clean(q, desc_info, cq_info, &comp,
+			       desc_info->cb_arg);
+
+		desc_info->cb = NULL;
+		desc_info->cb_arg = NULL;
+	}
+
+	return true;
 }
 
 bool ionic_rx_service(struct ionic_cq *cq, struct ionic_cq_info *cq_info)
@@ -506,6 +1312,10 @@ bool ionic_rx_service(struct ionic_cq *cq, struct ionic_cq_info *cq_info)
 	if (!color_match(comp->pkt_type_color, cq->done_color))
 		return false;
 
+	if ((comp->pkt_type_color & IONIC_RXQ_COMP_PKT_TYPE_MASK) ==
+	    IONIC_PKT_TYPE_BATCH)
+		return ionic_rx_service_batch(cq, cq_info);
+
 	/* check for empty queue */
 	if (q->tail_idx == q->head_idx)
 		return false;
@@ -517,7 +1327,7 @@ bool ionic_rx_service(struct ionic_cq *cq, struct ionic_cq_info *cq_info)
 	q->tail_idx = (q->tail_idx + 1) & (q->num_descs - 1);
 
 	/* clean the related q entry, only one per qc completion */
-	ionic_rx_clean(q, desc_info, cq_info, desc_info->cb_arg);
+	ionic_rx_clean(q, desc_info, cq_info, comp, desc_info->cb_arg);
 
 	desc_info->cb = NULL;
 	desc_info->cb_arg = NULL;
@@ -534,91 +1344,146 @@ void ionic_rx_fill(struct ionic_queue *q)
 	struct ionic_buf_info *buf_info;
 	unsigned int fill_threshold;
 	struct ionic_rxq_desc *desc;
+	unsigned int headroom = 0;
+	unsigned int tailroom = 0;
 	unsigned int remain_len;
 	unsigned int frag_len;
 	unsigned int nfrags;
 	unsigned int n_fill;
+	unsigned int burst;
+	bool stop = false;
 	unsigned int len;
 	unsigned int i;
 	unsigned int j;
 
+#ifdef HAVE_XSK_BUFF_POOL
+	if (q->xsk_pool) {
+		ionic_rx_fill_zc(q);
+		return;
+	}
+#endif
+
 	n_fill = ionic_q_space_avail(q);
 
-	fill_threshold = min_t(unsigned int, rx_fill_threshold,
+	fill_threshold = min_t(unsigned int, q->lif->rx_fill_threshold,
 			       q->num_descs / IONIC_RX_FILL_DIV);
 	if (n_fill < fill_threshold)
 		return;
 
 	len = netdev->mtu + ETH_HLEN + VLAN_HLEN;
 
-	for (i = n_fill; i; i--) {
-		nfrags = 0;
-		remain_len = len;
-		desc_info = &q->info[q->head_idx];
-		desc = desc_info->desc;
-		buf_info = &desc_info->bufs[0];
+#ifdef HAVE_XDP_SUPPORT
+	/* leave headroom in the first buffer for an attached XDP program */
+	if (q->xdp_rxq_info)
+		headroom = XDP_PACKET_HEADROOM;
+#endif
+
+#ifdef HAVE_PAGE_POOL
+	/* Frames that span several buffers get their skb head built in
+	 * place over the first buffer, so reserve tailroom there for the
+	 * skb shared info; the displaced bytes just shift into the sg
+	 * buffers.
+	 */
+	if (len > IONIC_PAGE_SIZE - headroom)
+		tailroom = SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+	q->rx_inplace = tailroom != 0;
+#endif
+
+	while (n_fill && !stop) {
+		burst = min_t(unsigned int, n_fill, IONIC_RX_FILL_BURST);
 
-		if (!buf_info->page) { /* alloc a new buffer? */
-			if (unlikely(ionic_rx_page_alloc(q, buf_info))) {
-				desc->addr = 0;
-				desc->len = 0;
-				return;
+		for (i = burst; i; i--) {
+			nfrags = 0;
+			remain_len = len;
+			desc_info = &q->info[q->head_idx];
+
+			/* warm up the lines for the next descriptor while
+			 * this one is being built
+			 */
+			if (i > 1) {
+				struct ionic_desc_info *next_info;
+
+				next_info = &q->info[(q->head_idx + 1) &
+						     (q->num_descs - 1)];
+				prefetchw(next_info->desc);
+				prefetchw(&next_info->bufs[0]);
 			}
-		}
 
-		/* fill main descriptor - buf[0] */
-		desc->addr = cpu_to_le64(ionic_rx_buf_pa(buf_info));
-		frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info));
-		desc->len = cpu_to_le16(frag_len);
-		remain_len -= frag_len;
-		buf_info++;
-		nfrags++;
+			desc = desc_info->desc;
+			buf_info = &desc_info->bufs[0];
 
-		/* fill sg descriptors - buf[1..n] */
-		sg_desc = desc_info->sg_desc;
-		for (j = 0; remain_len > 0 && j < q->max_sg_elems; j++) {
-			sg_elem = &sg_desc->elems[j];
-			if (!buf_info->page) { /* alloc a new sg buffer? */
+			if (!buf_info->page) { /* alloc a new buffer? */
 				if (unlikely(ionic_rx_page_alloc(q, buf_info))) {
-					sg_elem->addr = 0;
-					sg_elem->len = 0;
-					return;
+					desc->addr = 0;
+					desc->len = 0;
+					stop = true;
+					break;
 				}
 			}
 
-			sg_elem->addr = cpu_to_le64(ionic_rx_buf_pa(buf_info));
-			frag_len = min_t(u16, remain_len, ionic_rx_buf_size(buf_info));
-			sg_elem->len = cpu_to_le16(frag_len);
+			/* fill main descriptor - buf[0] */
+			desc->addr = cpu_to_le64(ionic_rx_buf_pa(buf_info) + headroom);
+			frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info) -
+					 headroom - tailroom);
+			desc->len = cpu_to_le16(frag_len);
 			remain_len -= frag_len;
 			buf_info++;
 			nfrags++;
-		}
 
-		/* clear end sg element as a sentinel */
-		if (j < q->max_sg_elems) {
-			sg_elem = &sg_desc->elems[j];
-			memset(sg_elem, 0, sizeof(*sg_elem));
-		}
+			/* fill sg descriptors - buf[1..n] */
+			sg_desc = desc_info->sg_desc;
+			for (j = 0; remain_len > 0 && j < q->max_sg_elems; j++) {
+				sg_elem = &sg_desc->elems[j];
+				if (!buf_info->page) { /* alloc a new sg buffer? */
+					if (unlikely(ionic_rx_page_alloc(q, buf_info))) {
+						sg_elem->addr = 0;
+						sg_elem->len = 0;
+						stop = true;
+						break;
+					}
+				}
 
-		desc->opcode = (nfrags > 1) ? IONIC_RXQ_DESC_OPCODE_SG :
-						 IONIC_RXQ_DESC_OPCODE_SIMPLE;
-		desc_info->nbufs = nfrags;
+				sg_elem->addr = cpu_to_le64(ionic_rx_buf_pa(buf_info));
+				frag_len = min_t(u16, remain_len, ionic_rx_buf_size(buf_info));
+				sg_elem->len = cpu_to_le16(frag_len);
+				remain_len -= frag_len;
+				buf_info++;
+				nfrags++;
+			}
 
-		/* commit descriptor contents in one shot */
-		if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
-			memcpy_toio(desc_info->cmb_desc, desc, q->desc_size);
+			if (stop)
+				break;
 
-		ionic_rxq_post(q, false, ionic_rx_clean, NULL);
-	}
+			/* clear end sg element as a sentinel */
+			if (j < q->max_sg_elems) {
+				sg_elem = &sg_desc->elems[j];
+				memset(sg_elem, 0, sizeof(*sg_elem));
+			}
 
-	ionic_dbell_ring(q->lif->kern_dbpage, q->hw_type,
-			 q->dbval | q->head_idx);
+			desc->opcode = (nfrags > 1) ? IONIC_RXQ_DESC_OPCODE_SG :
+							 IONIC_RXQ_DESC_OPCODE_SIMPLE;
+			desc_info->nbufs = nfrags;
+
+			if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
+				ionic_write_cmb_desc(q, desc_info->cmb_desc, desc);
+
+			ionic_rxq_post(q, false, ionic_rx_clean, NULL);
+		}
+
+		n_fill -= burst - i;
+
+		/* exactly one doorbell per burst of descriptors */
+		if (burst != i) {
+			ionic_dbell_ring(q->lif->kern_dbpage, q->hw_type,
+					 q->dbval | q->head_idx);
+			trace_ionic_dbell_ring(q);
+			q->dbell_jiffies = jiffies;
+		}
+	}
 
 	q->dbell_deadline = IONIC_RX_MIN_DOORBELL_DEADLINE;
-	q->dbell_jiffies = jiffies;
 
-	mod_timer(&q_to_qcq(q)->napi_qcq->napi_deadline,
-		  jiffies + IONIC_NAPI_DEADLINE);
+	ionic_napi_deadline_set(q_to_qcq(q)->napi_qcq);
 }
 
 void ionic_rx_empty(struct ionic_queue *q)
@@ -635,6 +1500,13 @@ void ionic_rx_empty(struct ionic_queue *q)
 				ionic_rx_page_free(q, buf_info);
 		}
 
+#ifdef HAVE_XSK_BUFF_POOL
+		if (desc_info->xsk_buf) {
+			xsk_buff_free(desc_info->xsk_buf);
+			desc_info->xsk_buf = NULL;
+		}
+#endif
+
 		desc_info->nbufs = 0;
 		desc_info->cb = NULL;
 		desc_info->cb_arg = NULL;
@@ -643,7 +1515,9 @@ void ionic_rx_empty(struct ionic_queue *q)
 	q->head_idx = 0;
 	q->tail_idx = 0;
 
+#ifndef HAVE_PAGE_POOL
 	ionic_rx_cache_drain(q);
+#endif
 }
 
 static void ionic_dim_update(struct ionic_qcq *qcq, int napi_mode)
@@ -693,22 +1567,57 @@ int ionic_tx_napi(struct napi_struct *napi, int budget)
 	lif = cq->bound_q->lif;
 	idev = &lif->ionic->idev;
 
+	trace_ionic_napi_poll(&qcq->q, budget);
+
+	DEBUG_STATS_NAPI_ENTER(qcq);
+
 	work_done = ionic_cq_service(cq, budget,
 				     ionic_tx_service, NULL, NULL);
+	ionic_tx_zc_flush(cq->bound_q);
+
+	if (qcq->poll_mode) {
+		/* Dedicated polling: claim a full budget so napi stays
+		 * scheduled and keeps spinning on the ring; the interrupt
+		 * was never unmasked, so there's nothing to re-arm.
+		 */
+		if (!work_done)
+			ionic_txq_poke_doorbell(&qcq->q);
+		DEBUG_STATS_NAPI_POLL(qcq, work_done);
+		trace_ionic_napi_poll_done(&qcq->q, work_done);
+		return budget;
+	}
 
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		flags |= IONIC_INTR_CRED_UNMASK;
 		cq->bound_intr->rearm_count++;
 	}
 
-	if (work_done || flags) {
+	if (work_done < budget && !(flags & IONIC_INTR_CRED_UNMASK)) {
+		/* Busy-poll round: the interrupt stays masked and we'll be
+		 * polled again, so skip the dim sample and the credits MMIO
+		 * and let the poll that re-arms settle the account.
+		 */
+		qcq->cred_defer += work_done;
+	} else if (work_done || flags) {
 		flags |= IONIC_INTR_CRED_RESET_COALESCE;
 		if (!lif->ionic->neth_eqs) {
 			if (flags & IONIC_INTR_CRED_UNMASK)
 				ionic_dim_update(qcq, IONIC_LIF_F_TX_DIM_INTR);
-			ionic_intr_credits(idev->intr_ctrl,
-					   cq->bound_intr->index,
-					   work_done, flags);
+			if (!(flags & IONIC_INTR_CRED_UNMASK) &&
+			    idev->intr_credits)
+				/* full-budget poll: return credits with a
+				 * plain store, the register write can wait
+				 * for the poll that re-arms
+				 */
+				ionic_intr_credits_dma(
+					&idev->intr_credits[cq->bound_intr->index],
+					work_done + qcq->cred_defer);
+			else
+				ionic_intr_credits(idev->intr_ctrl,
+						   cq->bound_intr->index,
+						   work_done + qcq->cred_defer,
+						   flags);
+			qcq->cred_defer = 0;
 		} else {
 			if (!qcq->armed) {
 				qcq->armed = true;
@@ -722,10 +1631,12 @@ int ionic_tx_napi(struct napi_struct *napi, int budget)
 	}
 
 	if (!work_done && ionic_txq_poke_doorbell(&qcq->q))
-		mod_timer(&qcq->napi_deadline, jiffies + IONIC_NAPI_DEADLINE);
+		ionic_napi_deadline_set(qcq);
 
 	DEBUG_STATS_NAPI_POLL(qcq, work_done);
 
+	trace_ionic_napi_poll_done(&qcq->q, work_done);
+
 	return work_done;
 }
 
@@ -742,24 +1653,78 @@ int ionic_rx_napi(struct napi_struct *napi, int budget)
 	lif = cq->bound_q->lif;
 	idev = &lif->ionic->idev;
 
+	trace_ionic_napi_poll(&qcq->q, budget);
+
+	DEBUG_STATS_NAPI_ENTER(qcq);
+
+	if (static_branch_unlikely(&ionic_hwstamp_key) &&
+	    (cq->bound_q->features & IONIC_RXQ_F_HWSTAMP))
+		ionic_lif_phc_snap(lif, &qcq->phc_snap);
+
+#ifdef HAVE_XDP_SUPPORT
+	if (lif->xdpqcqs && lif->xdpqcqs[cq->bound_q->index]) {
+		struct ionic_qcq *xdpqcq = lif->xdpqcqs[cq->bound_q->index];
+
+		ionic_cq_service(&xdpqcq->cq, IONIC_TX_BUDGET_DEFAULT,
+				 ionic_tx_service, NULL, NULL);
+#ifdef HAVE_XSK_BUFF_POOL
+		if (xdpqcq->q.xsk_pool)
+			ionic_xsk_tx_service(&xdpqcq->q);
+#endif
+	}
+#endif
+
 	work_done = ionic_cq_service(cq, budget,
 				     ionic_rx_service, NULL, NULL);
 
 	ionic_rx_fill(cq->bound_q);
 
+#ifdef HAVE_XDP_SUPPORT
+	if (cq->bound_q->xdp_flush) {
+		xdp_do_flush_map();
+		cq->bound_q->xdp_flush = false;
+	}
+#endif
+
+	if (qcq->poll_mode) {
+		if (!work_done)
+			ionic_rxq_poke_doorbell(&qcq->q);
+		DEBUG_STATS_NAPI_POLL(qcq, work_done);
+		trace_ionic_napi_poll_done(&qcq->q, work_done);
+		return budget;
+	}
+
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		flags |= IONIC_INTR_CRED_UNMASK;
 		cq->bound_intr->rearm_count++;
 	}
 
-	if (work_done || flags) {
+	if (work_done < budget && !(flags & IONIC_INTR_CRED_UNMASK)) {
+		/* Busy-poll round: the interrupt stays masked and we'll be
+		 * polled again, so skip the dim sample and the credits MMIO
+		 * and let the poll that re-arms settle the account.
+		 */
+		qcq->cred_defer += work_done;
+	} else if (work_done || flags) {
 		flags |= IONIC_INTR_CRED_RESET_COALESCE;
 		if (!lif->ionic->neth_eqs) {
 			if (flags & IONIC_INTR_CRED_UNMASK)
 				ionic_dim_update(qcq, IONIC_LIF_F_RX_DIM_INTR);
-			ionic_intr_credits(idev->intr_ctrl,
-					   cq->bound_intr->index,
-					   work_done, flags);
+			if (!(flags & IONIC_INTR_CRED_UNMASK) &&
+			    idev->intr_credits)
+				/* full-budget poll: return credits with a
+				 * plain store, the register write can wait
+				 * for the poll that re-arms
+				 */
+				ionic_intr_credits_dma(
+					&idev->intr_credits[cq->bound_intr->index],
+					work_done + qcq->cred_defer);
+			else
+				ionic_intr_credits(idev->intr_ctrl,
+						   cq->bound_intr->index,
+						   work_done + qcq->cred_defer,
+						   flags);
+			qcq->cred_defer = 0;
 		} else {
 			if (!qcq->armed) {
 				qcq->armed = true;
@@ -773,10 +1738,12 @@ int ionic_rx_napi(struct napi_struct *napi, int budget)
 	}
 
 	if (!work_done && ionic_rxq_poke_doorbell(&qcq->q))
-		mod_timer(&qcq->napi_deadline, jiffies + IONIC_NAPI_DEADLINE);
+		ionic_napi_deadline_set(qcq);
 
 	DEBUG_STATS_NAPI_POLL(qcq, work_done);
 
+	trace_ionic_napi_poll_done(&qcq->q, work_done);
+
 	return work_done;
 }
 
@@ -799,27 +1766,85 @@ int ionic_txrx_napi(struct napi_struct *napi, int budget)
 	txqcq = lif->txqcqs[qi];
 	txcq = &lif->txqcqs[qi]->cq;
 
-	tx_work_done = ionic_cq_service(txcq, tx_budget,
+	trace_ionic_napi_poll(&rxqcq->q, budget);
+
+	DEBUG_STATS_NAPI_ENTER(rxqcq);
+
+	if (static_branch_unlikely(&ionic_hwstamp_key) &&
+	    (rxcq->bound_q->features & IONIC_RXQ_F_HWSTAMP))
+		ionic_lif_phc_snap(lif, &rxqcq->phc_snap);
+
+	tx_work_done = ionic_cq_service(txcq, lif->tx_budget,
 					ionic_tx_service, NULL, NULL);
+	ionic_tx_zc_flush(txcq->bound_q);
+
+#ifdef HAVE_XDP_SUPPORT
+	if (lif->xdpqcqs && lif->xdpqcqs[qi]) {
+		tx_work_done += ionic_cq_service(&lif->xdpqcqs[qi]->cq,
+						 lif->tx_budget,
+						 ionic_tx_service, NULL, NULL);
+#ifdef HAVE_XSK_BUFF_POOL
+		if (lif->xdpqcqs[qi]->q.xsk_pool)
+			ionic_xsk_tx_service(&lif->xdpqcqs[qi]->q);
+#endif
+	}
+#endif
 
 	rx_work_done = ionic_cq_service(rxcq, budget,
 					ionic_rx_service, NULL, NULL);
 
 	ionic_rx_fill(rxcq->bound_q);
 
+#ifdef HAVE_XDP_SUPPORT
+	if (rxcq->bound_q->xdp_flush) {
+		xdp_do_flush_map();
+		rxcq->bound_q->xdp_flush = false;
+	}
+#endif
+
+	if (rxqcq->poll_mode) {
+		if (!rx_work_done)
+			ionic_rxq_poke_doorbell(&rxqcq->q);
+		if (!tx_work_done)
+			ionic_txq_poke_doorbell(&txqcq->q);
+		DEBUG_STATS_NAPI_POLL(rxqcq, rx_work_done);
+		DEBUG_STATS_NAPI_POLL(txqcq, tx_work_done);
+		trace_ionic_napi_poll_done(&rxqcq->q, rx_work_done + tx_work_done);
+		return budget;
+	}
+
 	if (rx_work_done < budget && napi_complete_done(napi, rx_work_done)) {
 		flags |= IONIC_INTR_CRED_UNMASK;
 		rxcq->bound_intr->rearm_count++;
 	}
 
-	if (rx_work_done || flags) {
+	if (rx_work_done < budget && !(flags & IONIC_INTR_CRED_UNMASK)) {
+		/* Busy-poll round: the interrupt stays masked and we'll be
+		 * polled again, so skip the dim sample and the credits MMIO
+		 * and let the poll that re-arms settle the account.
+		 */
+		rxqcq->cred_defer += tx_work_done + rx_work_done;
+	} else if (rx_work_done || flags) {
 		flags |= IONIC_INTR_CRED_RESET_COALESCE;
 		if (!lif->ionic->neth_eqs) {
 			if (flags & IONIC_INTR_CRED_UNMASK)
 				ionic_dim_update(rxqcq, 0);
-			ionic_intr_credits(idev->intr_ctrl,
-					   rxcq->bound_intr->index,
-					   tx_work_done + rx_work_done, flags);
+			if (!(flags & IONIC_INTR_CRED_UNMASK) &&
+			    idev->intr_credits)
+				/* full-budget poll: return credits with a
+				 * plain store, the register write can wait
+				 * for the poll that re-arms
+				 */
+				ionic_intr_credits_dma(
+					&idev->intr_credits[rxcq->bound_intr->index],
+					tx_work_done + rx_work_done +
+					rxqcq->cred_defer);
+			else
+				ionic_intr_credits(idev->intr_ctrl,
+						   rxcq->bound_intr->index,
+						   tx_work_done + rx_work_done +
+						   rxqcq->cred_defer, flags);
+			rxqcq->cred_defer = 0;
 		} else {
 			u64 dbr;
 
@@ -850,7 +1875,9 @@ int ionic_txrx_napi(struct napi_struct *napi, int budget)
 	if (!tx_work_done && ionic_txq_poke_doorbell(&txqcq->q))
 		resched = true;
 	if (resched)
-		mod_timer(&rxqcq->napi_deadline, jiffies + IONIC_NAPI_DEADLINE);
+		ionic_napi_deadline_set(rxqcq);
+
+	trace_ionic_napi_poll_done(&rxqcq->q, rx_work_done + tx_work_done);
 
 	return rx_work_done;
 }
@@ -889,6 +1916,148 @@ static dma_addr_t ionic_tx_map_frag(struct ionic_queue *q,
 	return dma_addr;
 }
 
+/* An SG element's len field is only 16 bits wide */
+#define IONIC_TX_MAX_SG_ELEM_LEN	U16_MAX
+
+/* Does the next frag physically continue a run of run_len bytes that
+ * starts at frag?  Restricted to frags of the same compound page so
+ * that the run can be covered by a single dma mapping.
+ */
+static bool ionic_tx_frag_extends(const skb_frag_t *frag, size_t run_len,
+				  const skb_frag_t *next)
+{
+	struct page *next_page = skb_frag_page(next);
+	struct page *page = skb_frag_page(frag);
+
+	if (compound_head(next_page) != compound_head(page))
+		return false;
+
+	return page_to_phys(next_page) + skb_frag_off(next) ==
+	       page_to_phys(page) + skb_frag_off(frag) + run_len;
+}
+
+/* Count the SG elements the frag list really needs once adjacent frags
+ * of the same compound page are folded together - common with large
+ * socket sends chopped into page frags from one higher-order buffer.
+ * Must mirror the merging done in ionic_tx_map_skb().
+ */
+static int ionic_tx_frag_runs(struct sk_buff *skb)
+{
+	unsigned int nfrags = skb_shinfo(skb)->nr_frags;
+	skb_frag_t *frag = skb_shinfo(skb)->frags;
+	unsigned int frag_idx = 0;
+	int runs = 0;
+
+	while (frag_idx < nfrags) {
+		const skb_frag_t *first = frag;
+		size_t len = skb_frag_size(frag);
+
+		while (frag_idx + 1 < nfrags &&
+		       len + skb_frag_size(frag + 1) <= IONIC_TX_MAX_SG_ELEM_LEN &&
+		       ionic_tx_frag_extends(first, len, frag + 1)) {
+			frag++;
+			frag_idx++;
+			len += skb_frag_size(frag);
+		}
+
+		runs++;
+		frag++;
+		frag_idx++;
+	}
+
+	return runs;
+}
+
+/* Batched mapping for iommu-translated devices: gather the head and
+ * the frag runs into one scatterlist and dma_map_sg() it, so the whole
+ * skb costs a single IOVA allocator transaction instead of one per
+ * buffer.  The mapped segments are laid back into buf_info elements;
+ * the tx descriptor builders treat bufs[] as a byte stream, so the
+ * repartitioning the iommu may do when it merges entries is harmless.
+ */
+static int ionic_tx_map_skb_sg(struct ionic_queue *q, struct sk_buff *skb,
+			       struct ionic_desc_info *desc_info)
+{
+	struct ionic_buf_info *buf_info = desc_info->bufs;
+	struct ionic_tx_stats *stats = q_to_tx_stats(q);
+	struct scatterlist *sgl, *sg;
+	struct device *dev = q->dev;
+	unsigned int nents, dnents;
+	unsigned int nbufs = 0;
+	unsigned int frag_idx;
+	unsigned int nfrags;
+	skb_frag_t *frag;
+	int i;
+
+	sgl = q->tx_sgl + (desc_info - q->info) * IONIC_MAX_FRAGS;
+	sg_init_table(sgl, IONIC_MAX_FRAGS);
+
+	sg = sgl;
+	sg_set_buf(sg, skb->data, skb_headlen(skb));
+	nents = 1;
+
+	frag = skb_shinfo(skb)->frags;
+	nfrags = skb_shinfo(skb)->nr_frags;
+	for (frag_idx = 0; frag_idx < nfrags; frag_idx++, frag++) {
+		const skb_frag_t *first = frag;
+		size_t len = skb_frag_size(frag);
+
+		/* same run folding as the unbatched path below */
+		while (frag_idx + 1 < nfrags &&
+		       len + skb_frag_size(frag + 1) <= IONIC_TX_MAX_SG_ELEM_LEN &&
+		       ionic_tx_frag_extends(first, len, frag + 1)) {
+			frag++;
+			frag_idx++;
+			len += skb_frag_size(frag);
+		}
+
+		sg = sg_next(sg);
+		sg_set_page(sg, skb_frag_page(first), len, skb_frag_off(first));
+		nents++;
+	}
+	sg_mark_end(sg);
+
+	dnents = dma_map_sg(dev, sgl, nents, DMA_TO_DEVICE);
+	if (!dnents) {
+		net_warn_ratelimited("%s: DMA sg map failed on %s!\n",
+				     q->lif->netdev->name, q->name);
+		stats->dma_map_err++;
+		return -EIO;
+	}
+
+	/* lay the mapped segments into descriptor elements, splitting
+	 * any segment the 16-bit element len field can't cover
+	 */
+	for_each_sg(sgl, sg, dnents, i) {
+		dma_addr_t dma_addr = sg_dma_address(sg);
+		unsigned int dma_len = sg_dma_len(sg);
+
+		while (dma_len) {
+			unsigned int elen = min_t(unsigned int, dma_len,
+						  IONIC_TX_MAX_SG_ELEM_LEN);
+
+			if (nbufs == IONIC_MAX_FRAGS)
+				goto dma_fail;
+			buf_info->dma_addr = dma_addr;
+			buf_info->len = elen;
+			buf_info++;
+			nbufs++;
+			dma_addr += elen;
+			dma_len -= elen;
+		}
+	}
+
+	desc_info->nbufs = nbufs;
+	desc_info->sg_nents = nents;
+
+	return 0;
+
+dma_fail:
+	dma_unmap_sg(dev, sgl, nents, DMA_TO_DEVICE);
+	stats->dma_map_err++;
+	return -EIO;
+}
+
 static int ionic_tx_map_skb(struct ionic_queue *q, struct sk_buff *skb,
 			    struct ionic_desc_info *desc_info)
 {
@@ -897,8 +2066,12 @@ static int ionic_tx_map_skb(struct ionic_queue *q, struct sk_buff *skb,
 	struct device *dev = q->dev;
 	dma_addr_t dma_addr;
 	unsigned int nfrags;
+	unsigned int nbufs;
+	unsigned int frag_idx;
 	skb_frag_t *frag;
-	int frag_idx;
+
+	if (q->tx_sgl)
+		return ionic_tx_map_skb_sg(q, skb, desc_info);
 
 	dma_addr = ionic_tx_map_single(q, skb->data, skb_headlen(skb));
 	if (dma_mapping_error(dev, dma_addr)) {
@@ -909,32 +2082,50 @@ static int ionic_tx_map_skb(struct ionic_queue *q, struct sk_buff *skb,
 	buf_info->len = skb_headlen(skb);
 	buf_info++;
 
+	nbufs = 0;
 	frag = skb_shinfo(skb)->frags;
 	nfrags = skb_shinfo(skb)->nr_frags;
 	for (frag_idx = 0; frag_idx < nfrags; frag_idx++, frag++) {
-		dma_addr = ionic_tx_map_frag(q, frag, 0, skb_frag_size(frag));
+		const skb_frag_t *first = frag;
+		size_t len = skb_frag_size(frag);
+
+		/* Fold in any following frags that physically continue
+		 * this one within the same compound page; one mapping
+		 * and one SG element then cover the whole run.
+		 */
+		while (frag_idx + 1 < nfrags &&
+		       len + skb_frag_size(frag + 1) <= IONIC_TX_MAX_SG_ELEM_LEN &&
+		       ionic_tx_frag_extends(first, len, frag + 1)) {
+			frag++;
+			frag_idx++;
+			len += skb_frag_size(frag);
+		}
+
+		dma_addr = ionic_tx_map_frag(q, first, 0, len);
 		if (dma_mapping_error(dev, dma_addr)) {
 			stats->dma_map_err++;
 			goto dma_fail;
 		}
 		buf_info->dma_addr = dma_addr;
-		buf_info->len = skb_frag_size(frag);
+		buf_info->len = len;
 		buf_info++;
+		nbufs++;
 	}
 
-	desc_info->nbufs = 1 + nfrags;
+	desc_info->nbufs = 1 + nbufs;
 
 	return 0;
 
 dma_fail:
 	/* unwind the frag mappings and the head mapping */
-	while (frag_idx > 0) {
-		frag_idx--;
+	while (nbufs > 0) {
+		nbufs--;
 		buf_info--;
 		dma_unmap_page(dev, buf_info->dma_addr,
 			       buf_info->len, DMA_TO_DEVICE);
 	}
-	dma_unmap_single(dev, buf_info->dma_addr, buf_info->len, DMA_TO_DEVICE);
+	dma_unmap_single(dev, desc_info->bufs[0].dma_addr,
+			 desc_info->bufs[0].len, DMA_TO_DEVICE);
 	return -EIO;
 }
 
@@ -948,6 +2139,16 @@ static void ionic_tx_desc_unmap_bufs(struct ionic_queue *q,
 	if (!desc_info->nbufs)
 		return;
 
+	if (desc_info->sg_nents) {
+		/* bulk release of the one IOVA range covering the skb */
+		dma_unmap_sg(dev, q->tx_sgl +
+			     (desc_info - q->info) * IONIC_MAX_FRAGS,
+			     desc_info->sg_nents, DMA_TO_DEVICE);
+		desc_info->sg_nents = 0;
+		desc_info->nbufs = 0;
+		return;
+	}
+
 	dma_unmap_single(dev, (dma_addr_t)buf_info->dma_addr,
 			 buf_info->len, DMA_TO_DEVICE);
 	buf_info++;
@@ -968,6 +2169,32 @@ static void ionic_tx_clean(struct ionic_queue *q,
 	struct sk_buff *skb = cb_arg;
 	u16 qi;
 
+	DEBUG_STATS_DESC_COMP(qcq, desc_info);
+
+#ifdef HAVE_XSK_BUFF_POOL
+	if (q->xsk_pool) {
+		/* pool-managed DMA, nothing to unmap; the frame is
+		 * returned to the umem in batch from napi context
+		 */
+		q->xsk_frames_done++;
+		desc_info->nbufs = 0;
+		stats->clean++;
+		return;
+	}
+#endif
+
+#ifdef HAVE_XDP_SUPPORT
+	if (desc_info->xdpf) {
+		ionic_xdp_tx_desc_clean(q, desc_info);
+		stats->clean++;
+
+		if (unlikely(__netif_subqueue_stopped(q->lif->netdev, q->index)))
+			netif_wake_subqueue(q->lif->netdev, q->index);
+
+		return;
+	}
+#endif
+
 	ionic_tx_desc_unmap_bufs(q, desc_info);
 
 	if (!skb)
@@ -975,7 +2202,8 @@ static void ionic_tx_clean(struct ionic_queue *q,
 
 	qi = skb_get_queue_mapping(skb);
 
-	if (unlikely(q->features & IONIC_TXQ_F_HWSTAMP)) {
+	if (static_branch_unlikely(&ionic_hwstamp_key) &&
+	    (q->features & IONIC_TXQ_F_HWSTAMP)) {
 		if (cq_info) {
 			struct skb_shared_hwtstamps hwts = {};
 			__le64 *cq_desc_hwstamp;
@@ -1009,7 +2237,46 @@ static void ionic_tx_clean(struct ionic_queue *q,
 	desc_info->bytes = skb->len;
 	stats->clean++;
 
-	dev_consume_skb_any(skb);
+	/* Hold zerocopy skbs on a queue-order list and free them
+	 * together at the end of the poll, so the error-queue
+	 * notifications for contiguous ranges coalesce before the
+	 * sender wakes to read them.
+	 */
+	if (cq_info && skb_zcopy(skb)) {
+		skb->next = NULL;
+		if (q->zc_tail)
+			q->zc_tail->next = skb;
+		else
+			q->zc_head = skb;
+		q->zc_tail = skb;
+		return;
+	}
+
+	/* cq_info is only NULL outside of napi context, e.g. when the
+	 * queues are being emptied; in napi the skbs go through the
+	 * percpu cache and get freed in bulk at the end of the poll
+	 */
+	napi_consume_skb(skb, cq_info ? 1 : 0);
+}
+
+/* Release the zerocopy skbs deferred by ionic_tx_clean(), in the order
+ * they completed.  Called at the end of every pass over the tx cq.
+ */
+static void ionic_tx_zc_flush(struct ionic_queue *q)
+{
+	struct sk_buff *skb, *next;
+
+	if (likely(!q->zc_head))
+		return;
+
+	for (skb = q->zc_head; skb; skb = next) {
+		next = skb->next;
+		skb->next = NULL;
+		napi_consume_skb(skb, 1);
+	}
+
+	q->zc_head = NULL;
+	q->zc_tail = NULL;
 }
 
 bool ionic_tx_service(struct ionic_cq *cq, struct ionic_cq_info *cq_info)
@@ -1058,6 +2325,7 @@ void ionic_tx_flush(struct ionic_cq *cq)
 
 	work_done = ionic_cq_service(cq, cq->num_descs,
 				     ionic_tx_service, NULL, NULL);
+	ionic_tx_zc_flush(cq->bound_q);
 
 	if (work_done && !cq->lif->ionic->neth_eqs)
 		ionic_intr_credits(idev->intr_ctrl, cq->bound_intr->index,
@@ -1087,6 +2355,10 @@ void ionic_tx_empty(struct ionic_queue *q)
 #ifdef IONIC_SUPPORTS_BQL
 	if (pkts && bytes && !unlikely(q->features & IONIC_TXQ_F_HWSTAMP))
 		netdev_tx_completed_queue(q_to_ndq(q), pkts, bytes);
+
+	/* the ring is empty now, restart the BQL accounting cleanly */
+	if (!unlikely(q->features & IONIC_TXQ_F_HWSTAMP))
+		netdev_tx_reset_queue(q_to_ndq(q));
 #endif
 }
 
@@ -1163,9 +2435,8 @@ static void ionic_tx_tso_post(struct ionic_queue *q,
 	desc->hdr_len = cpu_to_le16(hdrlen);
 	desc->mss = cpu_to_le16(mss);
 
-	/* commit descriptor contents in one shot */
 	if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
-		memcpy_toio(desc_info->cmb_desc, desc, q->desc_size);
+		ionic_write_cmb_desc(q, desc_info->cmb_desc, desc);
 
 	if (start) {
 		skb_tx_timestamp(skb);
@@ -1175,7 +2446,11 @@ static void ionic_tx_tso_post(struct ionic_queue *q,
 #endif
 		ionic_txq_post(q, false, ionic_tx_clean, skb);
 	} else {
+#ifdef HAVE_SKB_XMIT_MORE
+		ionic_txq_post(q, done && !netdev_xmit_more(), NULL, NULL);
+#else
 		ionic_txq_post(q, done, NULL, NULL);
+#endif
 	}
 }
 
@@ -1305,6 +2580,12 @@ static int ionic_tx_tso(struct ionic_queue *q, struct sk_buff *skb)
 		/* Buffer information is stored with the first tso descriptor */
 		desc_info = &q->info[q->head_idx];
 		desc_info->nbufs = 0;
+
+		/* warm the next descriptor pair while the segment math runs */
+		if (!done) {
+			prefetchw(desc_info->txq_desc);
+			prefetchw(desc_info->txq_sg_desc);
+		}
 	}
 
 	stats->pkts += DIV_ROUND_UP(len - hdrlen, mss);
@@ -1315,6 +2596,13 @@ static int ionic_tx_tso(struct ionic_queue *q, struct sk_buff *skb)
 	return 0;
 }
 
+/* Note: a flow-keyed cache of these offload decisions has been
+ * considered and rejected.  The csum placement comes straight from
+ * skb fields the stack has already computed - there is no header
+ * parse here to skip - and a cache keyed on skb->hash would corrupt
+ * packets on a hash collision unless the key included the very
+ * fields it was meant to avoid reading.
+ */
 static void ionic_tx_calc_csum(struct ionic_queue *q, struct sk_buff *skb,
 			       struct ionic_desc_info *desc_info)
 {
@@ -1335,7 +2623,7 @@ static void ionic_tx_calc_csum(struct ionic_queue *q, struct sk_buff *skb,
 	flags |= encap ? IONIC_TXQ_DESC_FLAG_ENCAP : 0;
 
 	cmd = encode_txq_desc_cmd(IONIC_TXQ_DESC_OPCODE_CSUM_PARTIAL,
-				  flags, skb_shinfo(skb)->nr_frags,
+				  flags, desc_info->nbufs - 1,
 				  buf_info->dma_addr);
 	desc->cmd = cpu_to_le64(cmd);
 	desc->len = cpu_to_le16(buf_info->len);
@@ -1348,9 +2636,8 @@ static void ionic_tx_calc_csum(struct ionic_queue *q, struct sk_buff *skb,
 	desc->csum_start = cpu_to_le16(skb_checksum_start_offset(skb));
 	desc->csum_offset = cpu_to_le16(skb->csum_offset);
 
-	/* commit descriptor contents in one shot */
 	if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
-		memcpy_toio(desc_info->cmb_desc, desc, q->desc_size);
+		ionic_write_cmb_desc(q, desc_info->cmb_desc, desc);
 
 #ifdef IONIC_DEBUG_STATS
 #ifdef HAVE_CSUM_NOT_INET
@@ -1382,7 +2669,7 @@ static void ionic_tx_calc_no_csum(struct ionic_queue *q, struct sk_buff *skb,
 	flags |= encap ? IONIC_TXQ_DESC_FLAG_ENCAP : 0;
 
 	cmd = encode_txq_desc_cmd(IONIC_TXQ_DESC_OPCODE_CSUM_NONE,
-				  flags, skb_shinfo(skb)->nr_frags,
+				  flags, desc_info->nbufs - 1,
 				  buf_info->dma_addr);
 	desc->cmd = cpu_to_le64(cmd);
 	desc->len = cpu_to_le16(buf_info->len);
@@ -1393,9 +2680,8 @@ static void ionic_tx_calc_no_csum(struct ionic_queue *q, struct sk_buff *skb,
 #endif
 	}
 
-	/* commit descriptor contents in one shot */
 	if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
-		memcpy_toio(desc_info->cmb_desc, desc, q->desc_size);
+		ionic_write_cmb_desc(q, desc_info->cmb_desc, desc);
 
 #ifdef IONIC_DEBUG_STATS
 	stats->csum_none++;
@@ -1413,7 +2699,7 @@ static void ionic_tx_skb_frags(struct ionic_queue *q, struct sk_buff *skb,
 #endif
 	unsigned int i;
 
-	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++, buf_info++, elem++) {
+	for (i = 0; i < desc_info->nbufs - 1; i++, buf_info++, elem++) {
 		elem->addr = cpu_to_le64(buf_info->dma_addr);
 		elem->len = cpu_to_le16(buf_info->len);
 	}
@@ -1473,6 +2759,13 @@ static int ionic_tx_descs_needed(struct ionic_queue *q, struct sk_buff *skb)
 	if (skb_shinfo(skb)->nr_frags <= q->max_sg_elems)
 		return ndescs;
 
+	/* Adjacent frags from one compound page map as a single SG
+	 * element, so count the merged runs before giving up on the
+	 * frag list.
+	 */
+	if (ionic_tx_frag_runs(skb) <= q->max_sg_elems)
+		return ndescs;
+
 	/* Too many frags, so linearize */
 	err = skb_linearize(skb);
 	if (err)
@@ -1546,6 +2839,7 @@ netdev_tx_t ionic_start_xmit(struct sk_buff *skb, struct net_device *netdev)
 	u16 queue_index = skb_get_queue_mapping(skb);
 	struct ionic_lif *lif = netdev_priv(netdev);
 	struct ionic_queue *q;
+	bool xmit_more;
 	int ndescs;
 	int err;
 
@@ -1555,7 +2849,8 @@ netdev_tx_t ionic_start_xmit(struct sk_buff *skb, struct net_device *netdev)
 	}
 
 #if IS_ENABLED(CONFIG_PTP_1588_CLOCK)
-	if (unlikely(skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP))
+	if (static_branch_unlikely(&ionic_hwstamp_key) &&
+	    (skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP))
 		if (lif->hwstamp_txq && lif->phc->ts_config_tx_mode)
 			return ionic_start_hwstamp_xmit(skb, netdev);
 #endif
@@ -1571,6 +2866,8 @@ netdev_tx_t ionic_start_xmit(struct sk_buff *skb, struct net_device *netdev)
 	if (unlikely(ionic_maybe_stop_tx(q, ndescs)))
 		return NETDEV_TX_BUSY;
 
+	xmit_more = netdev_xmit_more();
+
 	if (skb_is_gso(skb))
 		err = ionic_tx_tso(q, skb);
 	else
@@ -1583,7 +2880,22 @@ netdev_tx_t ionic_start_xmit(struct sk_buff *skb, struct net_device *netdev)
 	 * Since our SG lists per descriptor take care of most of the possible
 	 * fragmentation, we don't need to have many descriptors available.
 	 */
-	ionic_maybe_stop_tx(q, 4);
+	if (ionic_maybe_stop_tx(q, 4)) {
+		/* The stack holds the rest of the burst until the queue is
+		 * awakened, so don't leave the deferred work stranded.
+		 */
+		if (xmit_more) {
+			ionic_dbell_ring(lif->kern_dbpage, q->hw_type,
+					 q->dbval | q->head_idx);
+			trace_ionic_dbell_ring(q);
+			q->dbell_jiffies = jiffies;
+		}
+	} else if (xmit_more && q_to_qcq(q)->napi_qcq) {
+		/* The doorbell is deferred to the end of the burst; backstop
+		 * it with the napi deadline in case the train stalls.
+		 */
+		ionic_napi_deadline_set(q_to_qcq(q)->napi_qcq);
+	}
 
 	return NETDEV_TX_OK;
 
@@ -4,6 +4,11 @@
 #ifndef _IONIC_TXRX_H_
 #define _IONIC_TXRX_H_
 
+/* patched in only while a queue somewhere has hw timestamping enabled,
+ * so the per-packet tx/rx clean paths carry no branch for it otherwise
+ */
+DECLARE_STATIC_KEY_FALSE(ionic_hwstamp_key);
+
 void ionic_rx_flush(struct ionic_cq *cq);
 void ionic_tx_flush(struct ionic_cq *cq);
 
@@ -18,4 +23,9 @@ netdev_tx_t ionic_start_xmit(struct sk_buff *skb, struct net_device *netdev);
 bool ionic_rx_service(struct ionic_cq *cq, struct ionic_cq_info *cq_info);
 bool ionic_tx_service(struct ionic_cq *cq, struct ionic_cq_info *cq_info);
 
+#ifdef HAVE_XDP_SUPPORT
+int ionic_xdp_xmit(struct net_device *netdev, int n, struct xdp_frame **xdp,
+		   u32 flags);
+#endif
+
 #endif /* _IONIC_TXRX_H_ */
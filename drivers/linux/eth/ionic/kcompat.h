@@ -5654,8 +5654,33 @@ static inline bool pci_ari_enabled(struct pci_bus *bus)
 #else
 #define HAVE_NDO_DFLT_BRIDGE_GETLINK_VLAN_SUPPORT
 #define HAVE_VF_STATS
+#define HAVE_PROBE_PREFER_ASYNCHRONOUS
 #endif /* 4.2.0 */
 
+/*****************************************************************************/
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(4,3,0))
+/* protect against a likely backport */
+#ifndef DEFINE_STATIC_KEY_FALSE
+/* Without the jump label api, fall back to an atomic count tested with
+ * a plain conditional; the hot path pays the load on these old kernels,
+ * while newer kernels patch the branch out entirely.
+ */
+struct _kc_static_key_false {
+	atomic_t enabled;
+};
+#define DEFINE_STATIC_KEY_FALSE(name) \
+	struct _kc_static_key_false name = { .enabled = ATOMIC_INIT(0) }
+#define DECLARE_STATIC_KEY_FALSE(name) \
+	extern struct _kc_static_key_false name
+#define static_branch_unlikely(key) \
+	unlikely(atomic_read(&(key)->enabled) > 0)
+#define static_branch_inc(key)		atomic_inc(&(key)->enabled)
+#define static_branch_dec(key)		atomic_dec(&(key)->enabled)
+#endif /* DEFINE_STATIC_KEY_FALSE */
+#else /* 4.3.0 */
+#include <linux/jump_label.h>
+#endif /* 4.3.0 */
+
 /*****************************************************************************/
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(4,4,0))
 #if (RHEL_RELEASE_CODE && RHEL_RELEASE_CODE >= RHEL_RELEASE_VERSION(7,3))
@@ -6070,6 +6095,11 @@ static inline void __page_frag_cache_drain(struct page *page,
 #define from_timer(var, callback_timer, timer_fieldname) \
 	container_of(callback_timer, typeof(*var), timer_fieldname)
 
+/* no MSG_ZEROCOPY before 4.14, so never a ubuf_info to look at */
+#ifndef skb_zcopy
+#define skb_zcopy(skb)	(NULL)
+#endif
+
 #ifndef xdp_do_flush_map
 #define xdp_do_flush_map() do {} while (0)
 #endif
@@ -6578,6 +6608,7 @@ ptp_read_system_postts(struct ptp_system_timestamp __always_unused *sts)
 #define HAVE_NDO_BRIDGE_SETLINK_EXTACK
 #define HAVE_DMA_ALLOC_COHERENT_ZEROES_MEM
 #define HAVE_GENEVE_TYPE
+#define HAVE_DEVICE_IOMMU_MAPPED
 #endif /* 5.0.0 */
 
 /*****************************************************************************/
@@ -6651,6 +6682,7 @@ _kc_devlink_port_attrs_set(struct devlink_port *devlink_port,
 #else /* >= 5.2.0 */
 #define SPIN_UNLOCK_IMPLIES_MMIOWB
 #define HAVE_NETDEV_XMIT_MORE
+#define HAVE_NDO_SELECT_QUEUE_FALLBACK_REMOVED
 #endif /* 5.2.0 */
 
  /*****************************************************************************/
@@ -6686,6 +6718,10 @@ devlink_flash_update_status_notify(struct devlink __always_unused *devlink,
 #define DEVLINK_INFO_VERSION_GENERIC_FW        "fw"
 #define DEVLINK_INFO_VERSION_GENERIC_ASIC_ID   "asic.id"
 #define DEVLINK_INFO_VERSION_GENERIC_ASIC_REV  "asic.rev"
+
+#if !(RHEL_RELEASE_CODE && (RHEL_RELEASE_CODE >= RHEL_RELEASE_VERSION(8,2)))
+#define skb_frag_off(frag)	((frag)->page_offset)
+#endif
 #endif /* 5.4.0 */
 
 /*****************************************************************************/
@@ -6726,10 +6762,15 @@ devlink_flash_update_status_notify(struct devlink __always_unused *devlink,
 
 #else
 #define HAVE_DEVLINK_UPDATE_PARAMS
+/* health reporter api with the settled create() signature */
+#define HAVE_DEVLINK_HEALTH
+#define HAVE_XSK_BUFF_POOL
+#define HAVE_PAGE_POOL
 #endif /* 5.10.0 */
 
 /*****************************************************************************/
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5,11,0))
+#define HAVE_XDP_RXQ_INFO_REG_3_PARAMS
 
 #if (RHEL_RELEASE_CODE && (RHEL_RELEASE_CODE >= RHEL_RELEASE_VERSION(8,5)))
 #define HAVE_DEVLINK_PREFETCH_FW
@@ -6753,6 +6794,9 @@ static inline bool dev_page_is_reusable(struct page *page)
 		      !page_is_pfmemalloc(page));
 }
 #endif
+#else
+/* dev_set_threaded() is exported for drivers */
+#define HAVE_NETDEV_THREADED
 #endif /* 5.12.0 */
 
 /*****************************************************************************/
@@ -6762,6 +6806,12 @@ void _kc_ethtool_sprintf(u8 **data, const char *fmt, ...);
 #define ethtool_sprintf _kc_ethtool_sprintf
 #endif /* 5.13.0 */
 
+/*****************************************************************************/
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,14,0))
+#else
+#define HAVE_SKB_MARK_FOR_RECYCLE
+#endif /* 5.14.0 */
+
 /*****************************************************************************/
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5,15,0))
 #if (!RHEL_RELEASE_CODE || (RHEL_RELEASE_CODE && \
@@ -6801,6 +6851,17 @@ static inline struct devlink *_kc_devlink_alloc(const struct devlink_ops *ops,
 
 #endif /* 5.15.0 */
 
+/*****************************************************************************/
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,16,0))
+#else
+
+#if IS_ENABLED(CONFIG_NET_DEVLINK)
+/* params registered before devlink_register publish automatically */
+#define HAVE_DEVLINK_PARAMS
+#endif /* CONFIG_NET_DEVLINK */
+
+#endif /* 5.16.0 */
+
 /*****************************************************************************/
 #if (KERNEL_VERSION(5, 17, 0) > LINUX_VERSION_CODE)
 #else
@@ -23,6 +23,8 @@
 #include <linux/stringify.h>
 #include <linux/slab.h>
 #include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 #include "mdev_drv.h"
 
 #define DEVINFO_SIZE            0x1000
@@ -49,12 +51,14 @@ struct mdev_dev {
 	struct platform_device *pdev;
 	struct list_head node;
 	mdev_type_t type;
+	bool claimed;		/* slot reserved, attach in flight or done */
 	platform_rsrc_func_t platform_rsrc;
 	attach_func_t attach;
 	detach_func_t detach;
 };
 
 LIST_HEAD(mdev_list);
+static DEFINE_MUTEX(mdev_lock);	/* protects mdev_list slot claims */
 
 static struct class *mdev_class;
 static dev_t mdev_dev;
@@ -72,6 +76,7 @@ struct uio_pdrv_genirq_platdata {
 	spinlock_t lock;
 	unsigned long flags;
 	struct platform_device *pdev;
+	u8 memtype[MAX_UIO_MAPS];
 };
 
 /* Bits in uio_pdrv_genirq_platdata.flags */
@@ -79,6 +84,60 @@ enum {
 	UIO_IRQ_DISABLED = 0,
 };
 
+/*
+ * Per-region mmap memory type, declared by the platform resource
+ * flags: IORESOURCE_CACHEABLE marks dram-backed regions that want
+ * normal cached mappings, IORESOURCE_PREFETCH marks posted-write
+ * windows (doorbells) that want write-combining, and everything
+ * else stays strongly ordered device memory as before.
+ */
+enum mdev_uio_memtype {
+	MDEV_UIO_MEM_DEVICE = 0,
+	MDEV_UIO_MEM_WC,
+	MDEV_UIO_MEM_CACHED,
+};
+
+static u8 mdev_uio_res_memtype(const struct resource *r)
+{
+	if (r->flags & IORESOURCE_CACHEABLE)
+		return MDEV_UIO_MEM_CACHED;
+	if (r->flags & IORESOURCE_PREFETCH)
+		return MDEV_UIO_MEM_WC;
+	return MDEV_UIO_MEM_DEVICE;
+}
+
+static int mdev_uio_pdrv_genirq_mmap(struct uio_info *info,
+				     struct vm_area_struct *vma)
+{
+	struct uio_pdrv_genirq_platdata *priv = info->priv;
+	unsigned long mi = vma->vm_pgoff;
+	struct uio_mem *mem;
+
+	if (mi >= MAX_UIO_MAPS)
+		return -EINVAL;
+	mem = &info->mem[mi];
+	if (mem->size == 0 ||
+	    vma->vm_end - vma->vm_start > PAGE_ALIGN(mem->size))
+		return -EINVAL;
+
+	switch (priv->memtype[mi]) {
+	case MDEV_UIO_MEM_CACHED:
+		/* normal memory, keep the default cached attributes */
+		break;
+	case MDEV_UIO_MEM_WC:
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+		break;
+	default:
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+		break;
+	}
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       mem->addr >> PAGE_SHIFT,
+			       vma->vm_end - vma->vm_start,
+			       vma->vm_page_prot);
+}
+
 static int uio_pdrv_genirq_open(struct uio_info *info, struct inode *inode)
 {
 	return 0;
@@ -194,7 +253,7 @@ static int mdev_uio_pdrv_genirq_probe(struct platform_device *pdev)
 	for (i = 0; i < pdev->num_resources; ++i) {
 		struct resource *r = &pdev->resource[i];
 
-		if (r->flags != IORESOURCE_MEM)
+		if (!(r->flags & IORESOURCE_MEM))
 			continue;
 
 		if (uiomem >= &uioinfo->mem[MAX_UIO_MAPS]) {
@@ -208,6 +267,8 @@ static int mdev_uio_pdrv_genirq_probe(struct platform_device *pdev)
 		uiomem->addr = r->start & PAGE_MASK;
 		uiomem->offs = (r->start & (PAGE_SIZE - 1));
 		uiomem->size = PAGE_ALIGN(resource_size(r));
+		priv->memtype[uiomem - &uioinfo->mem[0]] =
+			mdev_uio_res_memtype(r);
 		dev_info(&pdev->dev, "resource %d size %llu", i, uiomem->size);
 		uiomem->name = r->name;
 		++uiomem;
@@ -231,6 +292,7 @@ static int mdev_uio_pdrv_genirq_probe(struct platform_device *pdev)
 	uioinfo->irqcontrol = uio_pdrv_genirq_irqcontrol;
 	uioinfo->open = uio_pdrv_genirq_open;
 	uioinfo->release = uio_pdrv_genirq_release;
+	uioinfo->mmap = mdev_uio_pdrv_genirq_mmap;
 	uioinfo->priv = priv;
 
 	ret = uio_register_device(&pdev->dev, priv->uioinfo);
@@ -269,8 +331,8 @@ static int mdev_get_mnet_platform_rsrc(struct mdev_dev *mdev,
 				       struct mdev_create_req *req)
 {
 	struct resource mnet_resource[] = {
-		{ /*devinfo*/
-			.flags    = IORESOURCE_MEM,
+		{ /*devinfo, dram-backed: map cached*/
+			.flags    = IORESOURCE_MEM | IORESOURCE_CACHEABLE,
 			.start    = req->regs_pa,
 			.end      = req->regs_pa + DEVINFO_SIZE - 1
 		}, {/*drvcfg/intr_ctrl*/
@@ -281,8 +343,8 @@ static int mdev_get_mnet_platform_rsrc(struct mdev_dev *mdev,
 			.flags    = IORESOURCE_MEM,
 			.start    = req->msixcfg_pa,
 			.end      = req->msixcfg_pa + MSIXCFG_SIZE - 1
-		}, {/*doorbell*/
-			.flags    = IORESOURCE_MEM,
+		}, {/*doorbell, posted writes: map write-combining*/
+			.flags    = IORESOURCE_MEM | IORESOURCE_PREFETCH,
 			.start    = req->doorbell_pa,
 			.end      = req->doorbell_pa + DOORBELL_PG_SIZE - 1
 		}, {/*tstamp*/
@@ -301,8 +363,8 @@ static int mdev_get_mcrypt_platform_rsrc(struct mdev_dev *mdev,
 					 struct mdev_create_req *req)
 {
 	struct resource mcrypt_resource[] = {
-		{ /*devinfo*/
-			.flags    = IORESOURCE_MEM,
+		{ /*devinfo, dram-backed: map cached*/
+			.flags    = IORESOURCE_MEM | IORESOURCE_CACHEABLE,
 			.start    = req->regs_pa,
 			.end      = req->regs_pa + DEVINFO_SIZE - 1
 		}, {/*drvcfg/intr_ctrl*/
@@ -313,8 +375,8 @@ static int mdev_get_mcrypt_platform_rsrc(struct mdev_dev *mdev,
 			.flags    = IORESOURCE_MEM,
 			.start    = req->msixcfg_pa,
 			.end      = req->msixcfg_pa + MSIXCFG_SIZE - 1
-		}, {/*doorbell*/
-			.flags    = IORESOURCE_MEM,
+		}, {/*doorbell, posted writes: map write-combining*/
+			.flags    = IORESOURCE_MEM | IORESOURCE_PREFETCH,
 			.start    = req->doorbell_pa,
 			.end      = req->doorbell_pa + DOORBELL_PG_SIZE - 1
 		}
@@ -395,6 +457,7 @@ static int mdev_detach_one(struct mdev_dev *mdev)
 
 	//devm_kfree(mdev_device, mdev->pdev->name);
 	mdev->pdev = NULL;
+	mdev->claimed = false;
 
 	return 0;
 }
@@ -410,10 +473,126 @@ static inline bool mdev_ioctl_matches(struct mdev_dev *mdev, uint32_t cmd)
 	return false;
 }
 
+/*
+ * Reserve a free slot for this create and bind its attach/detach
+ * ops.  Called with mdev_lock held; the caller runs the attach
+ * itself (possibly from a worker) and must drop the claim if the
+ * attach fails.  Returns NULL with *status set when no attach
+ * should run: 0 if the name already exists (quietly ignored, as
+ * ever), -errno otherwise.
+ */
+static struct mdev_dev *mdev_claim_slot(uint32_t cmd,
+					struct mdev_create_req *req,
+					int *status)
+{
+	struct mdev_dev *mdev;
+
+	*status = 0;
+
+	/* scan the list to see if it already exists,
+	 * and if so, quietly ignore this request
+	 */
+	list_for_each_entry(mdev, &mdev_list, node) {
+		if (mdev->pdev &&
+		    !strncmp(mdev->pdev->name, req->name, MDEV_NAME_LEN))
+			return NULL;
+	}
+
+	/* find the first useful empty slot */
+	list_for_each_entry(mdev, &mdev_list, node) {
+		if (mdev->pdev || mdev->claimed ||
+		    !mdev_ioctl_matches(mdev, cmd))
+			continue;
+
+		if (req->is_uio_dev) {
+			mdev->attach = mdev_uio_pdrv_genirq_probe;
+			mdev->detach = mdev_uio_pdrv_genirq_remove;
+		} else if (mdev->type == MDEV_TYPE_MNET) {
+			mdev->attach = ionic_probe;
+			mdev->detach = ionic_remove;
+		} else {
+			*status = -EINVAL;
+			return NULL;
+		}
+
+		mdev->claimed = true;
+		return mdev;
+	}
+
+	*status = -EDQUOT;
+	return NULL;
+}
+
+struct mdev_batch_work {
+	struct work_struct work;
+	struct mdev_dev *mdev;
+	struct mdev_create_req req;
+	int status;
+};
+
+static void mdev_batch_attach_work(struct work_struct *work)
+{
+	struct mdev_batch_work *bw =
+		container_of(work, struct mdev_batch_work, work);
+
+	bw->status = mdev_attach_one(bw->mdev, &bw->req);
+	if (bw->status)
+		bw->mdev->claimed = false;
+}
+
+/*
+ * Claim a slot for every entry up front, then let the probes run
+ * concurrently on the unbound workqueue; each slot is distinct so
+ * the workers share no state.  flush_work() is the reap: it
+ * returns when that instance's probe has finished, and the
+ * per-entry result goes back to the caller in status[].
+ */
+static long mdev_create_batch(struct mdev_batch_req *batch)
+{
+	struct mdev_batch_work *works;
+	long ret = 0;
+	uint32_t i;
+
+	if (batch->count > MDEV_BATCH_MAX ||
+	    (batch->type != MDEV_CREATE_MNET &&
+	     batch->type != MDEV_CREATE_MCRYPT))
+		return -EINVAL;
+
+	works = kcalloc(MDEV_BATCH_MAX, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return -ENOMEM;
+
+	mutex_lock(&mdev_lock);
+	for (i = 0; i < batch->count; i++) {
+		dev_info(mdev_device, "Creating %s %s\n", batch->req[i].name,
+			 batch->req[i].is_uio_dev ? "(UIO)" : "");
+
+		works[i].mdev = mdev_claim_slot(batch->type, &batch->req[i],
+						&works[i].status);
+		if (!works[i].mdev)
+			continue;
+
+		works[i].req = batch->req[i];
+		INIT_WORK(&works[i].work, mdev_batch_attach_work);
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+
+	for (i = 0; i < batch->count; i++) {
+		if (works[i].mdev)
+			flush_work(&works[i].work);
+		batch->status[i] = works[i].status;
+	}
+	mutex_unlock(&mdev_lock);
+
+	kfree(works);
+	return ret;
+}
+
 static long mdev_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 {
 	void __user *argp = (void __user *)arg;
 	char name[MDEV_NAME_LEN+1] = {0};
+	struct mdev_batch_req *batch;
 	struct mdev_create_req req;
 	struct mdev_dev *mdev;
 	int ret = -EDQUOT;
@@ -429,34 +608,33 @@ static long mdev_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 		dev_info(mdev_device, "Creating %s %s\n",
 			 req.name, req.is_uio_dev ? "(UIO)" : "");
 
-		/* scan the list to see if it already exists,
-		 * and if so, quietly ignore this request
-		 */
-		list_for_each_entry(mdev, &mdev_list, node) {
-			if (mdev->pdev &&
-			    !strncmp(mdev->pdev->name, req.name, MDEV_NAME_LEN))
-				return 0;
+		mutex_lock(&mdev_lock);
+		mdev = mdev_claim_slot(cmd, &req, &ret);
+		if (mdev) {
+			ret = mdev_attach_one(mdev, &req);
+			if (ret)
+				mdev->claimed = false;
 		}
+		mutex_unlock(&mdev_lock);
+		break;
 
-		/* find the first useful empty slot */
-		list_for_each_entry(mdev, &mdev_list, node) {
-			if (mdev->pdev || !mdev_ioctl_matches(mdev, cmd))
-				continue;
-
-			if (req.is_uio_dev) {
-				mdev->attach = mdev_uio_pdrv_genirq_probe;
-				mdev->detach = mdev_uio_pdrv_genirq_remove;
-			} else if (mdev->type == MDEV_TYPE_MNET) {
-				mdev->attach = ionic_probe;
-				mdev->detach = ionic_remove;
-			} else {
-				ret = -EINVAL;
-				break;
-			}
-
-			ret = mdev_attach_one(mdev, &req);
+	case MDEV_CREATE_BATCH:
+		batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+		if (!batch) {
+			ret = -ENOMEM;
 			break;
 		}
+		if (copy_from_user(batch, argp, sizeof(*batch))) {
+			dev_err(mdev_device, "copy_from_user failed\n");
+			kfree(batch);
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = mdev_create_batch(batch);
+		if (ret == 0 && copy_to_user(argp, batch, sizeof(*batch)))
+			ret = -EFAULT;
+		kfree(batch);
 		break;
 
 	case MDEV_DESTROY:
@@ -466,6 +644,7 @@ static long mdev_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		dev_info(mdev_device, "Removing %s\n", name);
+		mutex_lock(&mdev_lock);
 		list_for_each_entry(mdev, &mdev_list, node) {
 			if (!mdev->pdev ||
 			    strncmp(mdev->pdev->name, name, MDEV_NAME_LEN))
@@ -474,6 +653,7 @@ static long mdev_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 			ret = mdev_detach_one(mdev);
 			break;
 		}
+		mutex_unlock(&mdev_lock);
 		break;
 
 	default:
@@ -40,8 +40,19 @@ struct mdev_create_req {
 	char name[MDEV_NAME_LEN];
 };
 
+/* batch create: probes for all entries run concurrently */
+#define MDEV_BATCH_MAX      16
+
+struct mdev_batch_req {
+	uint32_t count;			/* in: valid entries in req[] */
+	uint32_t type;			/* in: MDEV_CREATE_MNET or _MCRYPT */
+	int32_t status[MDEV_BATCH_MAX];	/* out: 0 or -errno per entry */
+	struct mdev_create_req req[MDEV_BATCH_MAX];
+};
+
 #define MDEV_CREATE_MNET 	_IOWR('Q', 11, struct mdev_create_req)
 #define MDEV_DESTROY		_IOW('Q',  12, const char*)
 #define MDEV_CREATE_MCRYPT 	_IOWR('Q', 13, struct mdev_create_req)
+#define MDEV_CREATE_BATCH 	_IOWR('Q', 14, struct mdev_batch_req)
 
 #endif /* _MDEV_DRV_H */
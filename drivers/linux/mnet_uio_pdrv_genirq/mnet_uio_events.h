@@ -0,0 +1,58 @@
+#ifndef _MNET_UIO_EVENTS_H
+#define _MNET_UIO_EVENTS_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * Aggregated interrupt signaling for the mnet uio devices.
+ *
+ * A dataplane polling many uio devices pays a wakeup and a read()
+ * per interrupt per device.  Instead it can open
+ * /dev/MNET_UIO_EVENTS_NAME, register one eventfd with
+ * MNET_UIO_EVT_SETFD, and bind each uio device to a slot id with
+ * MNET_UIO_EVT_SETBIND.  Bound device interrupts mark their slot
+ * and signal the one eventfd; after a single eventfd wakeup, one
+ * read() on this device returns a mnet_uio_evt_rec for every
+ * device that fired with the interrupt count since the last read.
+ * Devices left unbound keep the classic per-device uio read()
+ * semantics, and interrupt re-enable still goes through each uio
+ * device's irqcontrol as before.
+ */
+
+#define MNET_UIO_EVENTS_NAME	"mnet-uio-events"
+#define MNET_UIO_MAX_EVENTS	64
+#define MNET_UIO_EVT_NAME_LEN	32
+
+struct mnet_uio_evt_bind {
+	char name[MNET_UIO_EVT_NAME_LEN];	/* platform device name */
+	__s32 id;				/* slot id, or -1 to unbind */
+};
+
+/* one per fired device, returned by read() */
+struct mnet_uio_evt_rec {
+	__u32 id;
+	__u32 count;				/* irqs since last read */
+};
+
+/*
+ * NIC-style interrupt moderation for a bound device.  Instead of
+ * masking and signaling on the first interrupt, the handler leaves
+ * the irq enabled and accumulates events until "events" have
+ * arrived or "usecs" have passed since the first, then masks the
+ * irq and signals once with the accumulated count.  The irq stays
+ * masked until userspace re-arms it through the device's uio
+ * irqcontrol write, as ever.  events 0 or 1 with usecs 0 disables
+ * moderation.
+ */
+struct mnet_uio_evt_coal {
+	char name[MNET_UIO_EVT_NAME_LEN];	/* platform device name */
+	__u32 usecs;				/* max signal delay */
+	__u32 events;				/* max events per signal */
+};
+
+#define MNET_UIO_EVT_SETFD	_IOW('Q', 21, __s32)
+#define MNET_UIO_EVT_SETBIND	_IOW('Q', 22, struct mnet_uio_evt_bind)
+#define MNET_UIO_EVT_SETCOAL	_IOW('Q', 23, struct mnet_uio_evt_coal)
+
+#endif /* _MNET_UIO_EVENTS_H */
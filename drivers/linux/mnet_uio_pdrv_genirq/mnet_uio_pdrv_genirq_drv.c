@@ -24,11 +24,20 @@
 #include <linux/pm_runtime.h>
 #include <linux/slab.h>
 #include <linux/mm.h>
+#include <linux/eventfd.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include <linux/list.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
 
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/of_address.h>
 
+#include "mnet_uio_events.h"
+
 #define DRIVER_NAME "uio_pdrv_genirq"
 
 struct uio_pdrv_genirq_platdata {
@@ -36,7 +45,57 @@ struct uio_pdrv_genirq_platdata {
 	spinlock_t lock;
 	unsigned long flags;
 	struct platform_device *pdev;
+	struct list_head node;
+	int evt_id;		/* event group slot, -1 = unbound */
+	u32 coal_usecs;		/* moderation window, 0 = none */
+	u32 coal_events;	/* moderation event limit, 0/1 = none */
+	u32 coal_pending;	/* events accumulated this window */
+	struct hrtimer coal_timer;
+	u8 memtype[MAX_UIO_MAPS];
+};
+
+/*
+ * Per-region mmap memory type, declared by the platform resource
+ * flags: IORESOURCE_CACHEABLE marks dram-backed regions (descriptor
+ * rings, device info) that want normal cached mappings,
+ * IORESOURCE_PREFETCH marks posted-write windows (doorbells, cmb)
+ * that want write-combining, and everything else stays strongly
+ * ordered device memory as before.
+ */
+enum mnet_uio_memtype {
+	MNET_UIO_MEM_DEVICE = 0,
+	MNET_UIO_MEM_WC,
+	MNET_UIO_MEM_CACHED,
+};
+
+static u8 mnet_uio_res_memtype(const struct resource *r)
+{
+	if (r->flags & IORESOURCE_CACHEABLE)
+		return MNET_UIO_MEM_CACHED;
+	if (r->flags & IORESOURCE_PREFETCH)
+		return MNET_UIO_MEM_WC;
+	return MNET_UIO_MEM_DEVICE;
+}
+
+/*
+ * Aggregated event group (see mnet_uio_events.h).  One eventfd and
+ * one fired set shared by all bound devices: the irq handler marks
+ * the device's slot and signals the eventfd, and a single read on
+ * the misc device drains every fired slot with its count.
+ */
+struct mnet_uio_evt_group {
+	spinlock_t lock;
+	struct eventfd_ctx *efd;
+	DECLARE_BITMAP(fired, MNET_UIO_MAX_EVENTS);
+	u32 count[MNET_UIO_MAX_EVENTS];
+	struct uio_pdrv_genirq_platdata *dev[MNET_UIO_MAX_EVENTS];
+};
+
+static struct mnet_uio_evt_group evt_group = {
+	.lock = __SPIN_LOCK_UNLOCKED(evt_group.lock),
 };
+static LIST_HEAD(mnet_uio_pdrv_list);
+static DEFINE_SPINLOCK(mnet_uio_pdrv_list_lock);
 
 /* Bits in uio_pdrv_genirq_platdata.flags */
 enum {
@@ -61,9 +120,87 @@ static int uio_pdrv_genirq_release(struct uio_info *info, struct inode *inode)
 	return 0;
 }
 
+/* mark a bound device's slot and signal the group eventfd */
+static void mnet_uio_evt_mark(struct uio_pdrv_genirq_platdata *priv, u32 n)
+{
+	struct mnet_uio_evt_group *g = &evt_group;
+	unsigned long flags;
+	int id;
+
+	id = READ_ONCE(priv->evt_id);
+	if (id < 0)
+		return;
+
+	spin_lock_irqsave(&g->lock, flags);
+	g->count[id] += n;
+	__set_bit(id, g->fired);
+	if (g->efd)
+		eventfd_signal(g->efd, 1);
+	spin_unlock_irqrestore(&g->lock, flags);
+}
+
+/*
+ * Close a moderation window: mask the irq until userspace re-arms
+ * it through irqcontrol, then signal once with everything that
+ * accumulated.  Called from the irq handler when the event limit
+ * trips and from the window timer; the two can race, so whoever
+ * finds coal_pending already drained does nothing.
+ */
+static void mnet_uio_coal_fire(struct uio_pdrv_genirq_platdata *priv)
+{
+	unsigned long flags;
+	u32 n;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	n = priv->coal_pending;
+	priv->coal_pending = 0;
+	if (n && !__test_and_set_bit(UIO_IRQ_DISABLED, &priv->flags))
+		disable_irq_nosync(priv->uioinfo->irq);
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	if (n)
+		mnet_uio_evt_mark(priv, n);
+}
+
+static enum hrtimer_restart mnet_uio_coal_timer(struct hrtimer *timer)
+{
+	struct uio_pdrv_genirq_platdata *priv =
+		container_of(timer, struct uio_pdrv_genirq_platdata, coal_timer);
+
+	mnet_uio_coal_fire(priv);
+	return HRTIMER_NORESTART;
+}
+
 static irqreturn_t uio_pdrv_genirq_handler(int irq, struct uio_info *dev_info)
 {
 	struct uio_pdrv_genirq_platdata *priv = dev_info->priv;
+	bool fire = false;
+
+	/*
+	 * A bound device with moderation configured leaves the irq
+	 * enabled and accumulates until the event limit or the window
+	 * timer closes the burst; only then is the irq masked and the
+	 * group signaled, with the count, by mnet_uio_coal_fire().
+	 */
+	if (READ_ONCE(priv->evt_id) >= 0 &&
+	    (priv->coal_events > 1 || priv->coal_usecs)) {
+		spin_lock(&priv->lock);
+		priv->coal_pending++;
+		if (priv->coal_events && priv->coal_pending >= priv->coal_events)
+			fire = true;
+		else if (priv->coal_pending == 1 && priv->coal_usecs)
+			hrtimer_start(&priv->coal_timer,
+				      ns_to_ktime((u64)priv->coal_usecs *
+						  NSEC_PER_USEC),
+				      HRTIMER_MODE_REL);
+		spin_unlock(&priv->lock);
+
+		if (fire) {
+			hrtimer_try_to_cancel(&priv->coal_timer);
+			mnet_uio_coal_fire(priv);
+		}
+		return IRQ_HANDLED;
+	}
 
 	/* Just disable the interrupt in the interrupt controller, and
 	 * remember the state so we can allow user space to enable it later.
@@ -74,6 +211,9 @@ static irqreturn_t uio_pdrv_genirq_handler(int irq, struct uio_info *dev_info)
 		disable_irq_nosync(irq);
 	spin_unlock(&priv->lock);
 
+	/* bound devices also mark the event group and signal its eventfd */
+	mnet_uio_evt_mark(priv, 1);
+
 	return IRQ_HANDLED;
 }
 
@@ -103,11 +243,223 @@ static int uio_pdrv_genirq_irqcontrol(struct uio_info *dev_info, s32 irq_on)
 	return 0;
 }
 
+static int uio_pdrv_genirq_mmap(struct uio_info *info,
+				struct vm_area_struct *vma)
+{
+	struct uio_pdrv_genirq_platdata *priv = info->priv;
+	unsigned long mi = vma->vm_pgoff;
+	struct uio_mem *mem;
+
+	if (mi >= MAX_UIO_MAPS)
+		return -EINVAL;
+	mem = &info->mem[mi];
+	if (mem->size == 0 ||
+	    vma->vm_end - vma->vm_start > PAGE_ALIGN(mem->size))
+		return -EINVAL;
+
+	switch (priv->memtype[mi]) {
+	case MNET_UIO_MEM_CACHED:
+		/* normal memory, keep the default cached attributes */
+		break;
+	case MNET_UIO_MEM_WC:
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+		break;
+	default:
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+		break;
+	}
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       mem->addr >> PAGE_SHIFT,
+			       vma->vm_end - vma->vm_start,
+			       vma->vm_page_prot);
+}
+
+/*
+ * One read drains the whole fired set: a mnet_uio_evt_rec per
+ * device that interrupted since the last read.  Slots that don't
+ * fit in the caller's buffer stay marked for the next read.
+ * Returns 0 when nothing is pending; the eventfd is the wakeup.
+ */
+static ssize_t mnet_uio_evt_read(struct file *f, char __user *buf,
+				 size_t len, loff_t *off)
+{
+	struct mnet_uio_evt_rec recs[MNET_UIO_MAX_EVENTS];
+	struct mnet_uio_evt_group *g = &evt_group;
+	unsigned long flags;
+	size_t nmax = len / sizeof(recs[0]);
+	int id, n = 0;
+
+	if (nmax == 0)
+		return -EINVAL;
+
+	spin_lock_irqsave(&g->lock, flags);
+	for_each_set_bit(id, g->fired, MNET_UIO_MAX_EVENTS) {
+		if (n == nmax)
+			break;
+		recs[n].id = id;
+		recs[n].count = g->count[id];
+		g->count[id] = 0;
+		__clear_bit(id, g->fired);
+		n++;
+	}
+	spin_unlock_irqrestore(&g->lock, flags);
+
+	if (copy_to_user(buf, recs, n * sizeof(recs[0])))
+		return -EFAULT;
+
+	return n * sizeof(recs[0]);
+}
+
+static int mnet_uio_evt_setfd(s32 fd)
+{
+	struct mnet_uio_evt_group *g = &evt_group;
+	struct eventfd_ctx *efd = NULL, *old;
+	unsigned long flags;
+
+	if (fd >= 0) {
+		efd = eventfd_ctx_fdget(fd);
+		if (IS_ERR(efd))
+			return PTR_ERR(efd);
+	}
+
+	spin_lock_irqsave(&g->lock, flags);
+	old = g->efd;
+	g->efd = efd;
+	spin_unlock_irqrestore(&g->lock, flags);
+
+	if (old)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
+static struct uio_pdrv_genirq_platdata *mnet_uio_find_dev(char *name)
+{
+	struct uio_pdrv_genirq_platdata *priv, *found = NULL;
+	unsigned long flags;
+
+	name[MNET_UIO_EVT_NAME_LEN - 1] = '\0';
+
+	spin_lock_irqsave(&mnet_uio_pdrv_list_lock, flags);
+	list_for_each_entry(priv, &mnet_uio_pdrv_list, node) {
+		if (!strcmp(priv->pdev->name, name)) {
+			found = priv;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&mnet_uio_pdrv_list_lock, flags);
+
+	return found;
+}
+
+static int mnet_uio_evt_setbind(struct mnet_uio_evt_bind *bind)
+{
+	struct mnet_uio_evt_group *g = &evt_group;
+	struct uio_pdrv_genirq_platdata *found;
+	unsigned long flags;
+	int ret = 0;
+
+	if (bind->id >= MNET_UIO_MAX_EVENTS)
+		return -EINVAL;
+
+	found = mnet_uio_find_dev(bind->name);
+	if (!found)
+		return -ENODEV;
+
+	spin_lock_irqsave(&g->lock, flags);
+	if (bind->id < 0) {
+		/* unbind, back to classic per-device semantics */
+		if (found->evt_id >= 0) {
+			g->dev[found->evt_id] = NULL;
+			WRITE_ONCE(found->evt_id, -1);
+		}
+	} else if (g->dev[bind->id]) {
+		ret = -EBUSY;
+	} else {
+		g->dev[bind->id] = found;
+		WRITE_ONCE(found->evt_id, bind->id);
+	}
+	spin_unlock_irqrestore(&g->lock, flags);
+
+	return ret;
+}
+
+static int mnet_uio_evt_setcoal(struct mnet_uio_evt_coal *coal)
+{
+	struct uio_pdrv_genirq_platdata *found;
+	unsigned long flags;
+
+	found = mnet_uio_find_dev(coal->name);
+	if (!found)
+		return -ENODEV;
+
+	spin_lock_irqsave(&found->lock, flags);
+	found->coal_usecs = coal->usecs;
+	found->coal_events = coal->events;
+	spin_unlock_irqrestore(&found->lock, flags);
+
+	/* flush any open window under the old settings */
+	hrtimer_try_to_cancel(&found->coal_timer);
+	mnet_uio_coal_fire(found);
+
+	return 0;
+}
+
+static long mnet_uio_evt_ioctl(struct file *f, unsigned int cmd,
+			       unsigned long arg)
+{
+	void __user *argp = (void __user *)arg;
+	struct mnet_uio_evt_bind bind;
+	struct mnet_uio_evt_coal coal;
+	s32 fd;
+
+	switch (cmd) {
+	case MNET_UIO_EVT_SETFD:
+		if (copy_from_user(&fd, argp, sizeof(fd)))
+			return -EFAULT;
+		return mnet_uio_evt_setfd(fd);
+
+	case MNET_UIO_EVT_SETBIND:
+		if (copy_from_user(&bind, argp, sizeof(bind)))
+			return -EFAULT;
+		return mnet_uio_evt_setbind(&bind);
+
+	case MNET_UIO_EVT_SETCOAL:
+		if (copy_from_user(&coal, argp, sizeof(coal)))
+			return -EFAULT;
+		return mnet_uio_evt_setcoal(&coal);
+
+	default:
+		return -EINVAL;
+	}
+}
+
+static int mnet_uio_evt_release(struct inode *inode, struct file *f)
+{
+	/* drop the eventfd; device bindings persist across opens */
+	return mnet_uio_evt_setfd(-1);
+}
+
+static const struct file_operations mnet_uio_evt_fops = {
+	.owner = THIS_MODULE,
+	.read = mnet_uio_evt_read,
+	.unlocked_ioctl = mnet_uio_evt_ioctl,
+	.release = mnet_uio_evt_release,
+};
+
+static struct miscdevice mnet_uio_evt_miscdev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = MNET_UIO_EVENTS_NAME,
+	.fops = &mnet_uio_evt_fops,
+};
+
 int mnet_uio_pdrv_genirq_probe(struct platform_device *pdev)
 {
 	struct uio_info *uioinfo = dev_get_platdata(&pdev->dev);
 	struct uio_pdrv_genirq_platdata *priv;
 	struct uio_mem *uiomem;
+	unsigned long flags;
 	int ret = -EINVAL;
 	int i;
 
@@ -145,6 +497,9 @@ int mnet_uio_pdrv_genirq_probe(struct platform_device *pdev)
 	spin_lock_init(&priv->lock);
 	priv->flags = 0; /* interrupt is enabled to begin with */
 	priv->pdev = pdev;
+	priv->evt_id = -1;
+	hrtimer_init(&priv->coal_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	priv->coal_timer.function = mnet_uio_coal_timer;
 
 	if (!uioinfo->irq) {
 		ret = platform_get_irq(pdev, 0);
@@ -162,7 +517,7 @@ int mnet_uio_pdrv_genirq_probe(struct platform_device *pdev)
 	for (i = 0; i < pdev->num_resources; ++i) {
 		struct resource *r = &pdev->resource[i];
 
-		if (r->flags != IORESOURCE_MEM)
+		if (!(r->flags & IORESOURCE_MEM))
 			continue;
 
 		if (uiomem >= &uioinfo->mem[MAX_UIO_MAPS]) {
@@ -176,6 +531,8 @@ int mnet_uio_pdrv_genirq_probe(struct platform_device *pdev)
 		uiomem->addr = r->start & PAGE_MASK;
 		uiomem->offs = (r->start & (PAGE_SIZE - 1));
 		uiomem->size = PAGE_ALIGN(resource_size(r));
+		priv->memtype[uiomem - &uioinfo->mem[0]] =
+			mnet_uio_res_memtype(r);
 #if 1
 		dev_info(&pdev->dev, "resource %d size %llu", i, uiomem->size);
 		uiomem->name = r->name;
@@ -201,6 +558,7 @@ int mnet_uio_pdrv_genirq_probe(struct platform_device *pdev)
 	uioinfo->irqcontrol = uio_pdrv_genirq_irqcontrol;
 	uioinfo->open = uio_pdrv_genirq_open;
 	uioinfo->release = uio_pdrv_genirq_release;
+	uioinfo->mmap = uio_pdrv_genirq_mmap;
 	uioinfo->priv = priv;
 
 	/* Enable Runtime PM for this device:
@@ -217,6 +575,10 @@ int mnet_uio_pdrv_genirq_probe(struct platform_device *pdev)
 		return ret;
 	}
 
+	spin_lock_irqsave(&mnet_uio_pdrv_list_lock, flags);
+	list_add_tail(&priv->node, &mnet_uio_pdrv_list);
+	spin_unlock_irqrestore(&mnet_uio_pdrv_list_lock, flags);
+
 	platform_set_drvdata(pdev, priv);
 	return 0;
 }
@@ -224,6 +586,24 @@ int mnet_uio_pdrv_genirq_probe(struct platform_device *pdev)
 int mnet_uio_pdrv_genirq_remove(struct platform_device *pdev)
 {
 	struct uio_pdrv_genirq_platdata *priv = platform_get_drvdata(pdev);
+	struct mnet_uio_evt_group *g = &evt_group;
+	unsigned long flags;
+
+	/* unbind from the event group before the handler goes away */
+	spin_lock_irqsave(&g->lock, flags);
+	if (priv->evt_id >= 0) {
+		g->dev[priv->evt_id] = NULL;
+		__clear_bit(priv->evt_id, g->fired);
+		g->count[priv->evt_id] = 0;
+		WRITE_ONCE(priv->evt_id, -1);
+	}
+	spin_unlock_irqrestore(&g->lock, flags);
+
+	spin_lock_irqsave(&mnet_uio_pdrv_list_lock, flags);
+	list_del(&priv->node);
+	spin_unlock_irqrestore(&mnet_uio_pdrv_list_lock, flags);
+
+	hrtimer_cancel(&priv->coal_timer);
 
 	uio_unregister_device(priv->uioinfo);
 	// pm_runtime_disable(&pdev->dev);
@@ -285,6 +665,20 @@ module_platform_driver(uio_pdrv_genirq);
 EXPORT_SYMBOL(mnet_uio_pdrv_genirq_probe);
 EXPORT_SYMBOL(mnet_uio_pdrv_genirq_remove);
 
+static int __init mnet_uio_pdrv_genirq_init(void)
+{
+	return misc_register(&mnet_uio_evt_miscdev);
+}
+
+static void __exit mnet_uio_pdrv_genirq_exit(void)
+{
+	mnet_uio_evt_setfd(-1);
+	misc_deregister(&mnet_uio_evt_miscdev);
+}
+
+module_init(mnet_uio_pdrv_genirq_init);
+module_exit(mnet_uio_pdrv_genirq_exit);
+
 MODULE_AUTHOR("Magnus Damm");
 MODULE_DESCRIPTION("Userspace I/O platform driver with generic IRQ handling");
 MODULE_LICENSE("GPL v2");
@@ -49,6 +49,16 @@ void kpcimgr_cpu_holding_pen(kstate_t *ks)
 	ks->uart_addr = (void *) PEN_UART;
 	if (ks->debug)
 		_uart_write((void *) PEN_UART, 'C');
+
+	/*
+	 * We are already executing from the persistent image, but a
+	 * checksum mismatch against the install-time value means the
+	 * image was corrupted and servicing transactions with it is
+	 * worse than complaining first.
+	 */
+	if (ks->code_csum && kpcimgr_code_csum_check(ks) != 0)
+		kpr_err("relocated code image fails checksum, expect trouble\n");
+
 	kpcimgr_init_poll(ks);
 
 	kpr_err("%s with EL%ld on cpu%d\n", __func__, read_el(), cpuid());
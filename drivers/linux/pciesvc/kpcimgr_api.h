@@ -37,6 +37,7 @@
 #define K_ENTRY_CMD_READ 8
 #define K_ENTRY_CMD_WRITE 9
 #define K_ENTRY_GET_VERSION 10
+#define K_ENTRY_CODE_CSUM 11
 #define K_NUM_ENTRIES 16
 
 struct kpcimgr_entry_points_t {
@@ -105,7 +106,11 @@ struct kpcimgr_state_t {
 	int ncalls;
 	int ind_intr, not_intr, event_intr;
 
-	int unused1[7];	/* was version=2 code_offsets[], keep evq* compat */
+	/* adaptive poll pacing (reuses old version=2 slots, keep evq* compat) */
+	int poll_hint;	/* suggested usecs until next poll call, 0 = immediate */
+	int poll_idle;	/* consecutive empty poll calls, saturating */
+	int code_csum;	/* install-time fletcher32 of relocated code image */
+	int unused1[4];	/* was version=2 code_offsets[], keep evq* compat */
 
 	/* Event queue handling */
 	int evq_head, evq_tail;
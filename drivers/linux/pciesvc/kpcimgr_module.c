@@ -38,6 +38,7 @@ extern int kpcimgr_not_intr(void *, int);
 extern void kpcimgr_undefined_entry(void);
 extern int pciesvc_sysfs_cmd_read(void *, char *, int *);
 extern int pciesvc_sysfs_cmd_write(void *, char *, size_t, int *);
+extern int kpcimgr_code_csum_check(void *);
 
 extern int pciesvc_version_major;
 extern int pciesvc_version_minor;
@@ -68,6 +69,9 @@ static int __init pciesvc_dev_init(void)
 	ep.entry_point[K_ENTRY_CMD_READ] = pciesvc_sysfs_cmd_read;
 	ep.entry_point[K_ENTRY_CMD_WRITE] = pciesvc_sysfs_cmd_write;
 	ep.entry_point[K_ENTRY_GET_VERSION] = kpcimgr_version_fn;
+	/* lets the manager validate an installed image and map it
+	 * directly instead of recopying the code at activation */
+	ep.entry_point[K_ENTRY_CODE_CSUM] = kpcimgr_code_csum_check;
 
 	/* call to Pensando SOC driver to copy the code to persistent memory */
 	ret = kpcimgr_module_register(THIS_MODULE, &ep, relocate);
@@ -19,9 +19,61 @@
  * operation of the pciesvc library code.
  */
 
+void *kpcimgr_va_get(unsigned long pa, unsigned long sz);
+
+/*
+ * Checksum of the relocated code image in persistent memory.  The
+ * library is built position independent, so "relocation" is a plain
+ * copy and the installed image is ready to run as-is; the checksum
+ * lets activation paths validate an already-installed image instead
+ * of recopying it, and catches persistent memory corruption before
+ * we service transactions from it.  Fletcher32 over the code only
+ * (data follows pciesvc_end and mutates at runtime).
+ */
+unsigned int kpcimgr_code_csum(kstate_t *ks)
+{
+	const unsigned char *p;
+	unsigned int s1 = 0xffff, s2 = 0xffff;
+	unsigned long n, size = ks->code_size;
+
+	if (size == 0 || size > KSTATE_CODE_SIZE)
+		return 0;
+
+	p = kpcimgr_va_get(ks->shmembase + KSTATE_CODE_OFFSET, size);
+	for (n = 0; n < size; n++) {
+		s1 += p[n];
+		s2 += s1;
+		if ((n & 0x3ff) == 0x3ff) {
+			s1 %= 65535;
+			s2 %= 65535;
+		}
+	}
+	s1 %= 65535;
+	s2 %= 65535;
+	return (s2 << 16) | s1;
+}
+
+/*
+ * Validate the installed image against the checksum recorded at
+ * install time.  Exported as an entry point so the manager can map
+ * a previously installed image directly when it still validates.
+ * Returns 0 if the image matches.
+ */
+int kpcimgr_code_csum_check(kstate_t *ks)
+{
+	set_kstate(ks);
+	if (!ks->have_persistent_mem || ks->code_csum == 0)
+		return -1;
+	return kpcimgr_code_csum(ks) == (unsigned int)ks->code_csum ? 0 : -1;
+}
+
 void kpcimgr_init_fn(kstate_t *ks)
 {
 	set_kstate(ks);
+
+	/* record the install-time checksum of the relocated image */
+	if (ks->have_persistent_mem && ks->code_csum == 0)
+		ks->code_csum = kpcimgr_code_csum(ks);
 }
 
 void kpcimgr_version_fn(char **version)
@@ -88,12 +140,31 @@ void kpcimgr_init_poll(kstate_t *ks)
 	pciesvc_init(&p);
 }
 
+/*
+ * Adaptive poll pacing.  While transactions are being serviced we
+ * spin through the quiet gaps so a burst (enumeration, config
+ * cycles) is handled at spin latency; when idle we publish a
+ * progressively larger sleep hint in ks->poll_hint for the polling
+ * thread, backing off to the slow cadence.  The first event snaps
+ * the hint back to zero (poll again immediately).
+ */
+#define POLL_TICKS_PER_US	200
+#define POLL_SPIN_US		100	/* keep spinning this long after work */
+#define POLL_BACKOFF_START_US	50	/* first idle sleep hint */
+#define POLL_BACKOFF_LIMIT_US	10000	/* slow cadence when long idle */
+#define POLL_BACKOFF_MAX	8	/* idle calls to reach slow cadence */
+
 /*
  * Main poll function
  *
  * Essentially a wrapper for pciesvc_poll() that
  * updates statistics, does some error checking,
  * and outputs some debugging information.
+ *
+ * The polling thread may read ks->poll_hint after each call to
+ * pace itself: zero means work is flowing, call again immediately;
+ * otherwise it holds the suggested sleep in usecs.  Callers that
+ * poll at a fixed cadence are unaffected.
  */
 void kpcimgr_poll(kstate_t *ks, int index, int phase)
 {
@@ -138,7 +209,13 @@ void kpcimgr_poll(kstate_t *ks, int index, int phase)
 
 	for (i=0; i<10; i++) {
 
-		result = pciesvc_poll(0);
+		/*
+		 * The pciesvc entry points are re-entrant per port, so
+		 * each active port can be serviced from its own thread
+		 * or interrupt vector; this context services the port
+		 * it was initialized for.
+		 */
+		result = pciesvc_poll(ks->active_port);
 		/*
 		 * return value:
 		 *  1: valid pending and handled
@@ -156,6 +233,38 @@ void kpcimgr_poll(kstate_t *ks, int index, int phase)
 
 		ks->trace_data[phase][NUM_PENDINGS]++;
 	}
+
+	if (i > 0 && result != -1) {
+		/*
+		 * Work was found, so more is likely on the way; spin
+		 * through the quiet gap instead of paying the poll
+		 * cadence per transaction.  Each new event restarts
+		 * the spin window.
+		 */
+		long deadline = read_sysreg(cntvct_el0) +
+			POLL_SPIN_US * POLL_TICKS_PER_US;
+
+		while (read_sysreg(cntvct_el0) < deadline) {
+			result = pciesvc_poll(ks->active_port);
+			if (result == -1)
+				break;
+			if (result == 1) {
+				deadline = read_sysreg(cntvct_el0) +
+					POLL_SPIN_US * POLL_TICKS_PER_US;
+				ks->trace_data[phase][NUM_PENDINGS]++;
+			}
+		}
+		ks->poll_idle = 0;
+		ks->poll_hint = 0;	/* snap back to immediate polls */
+	} else {
+		/* idle, progressively back off to the slow cadence */
+		if (ks->poll_idle < POLL_BACKOFF_MAX)
+			ks->poll_idle++;
+		ks->poll_hint = POLL_BACKOFF_START_US << ks->poll_idle;
+		if (ks->poll_hint > POLL_BACKOFF_LIMIT_US)
+			ks->poll_hint = POLL_BACKOFF_LIMIT_US;
+	}
+
 	kpcimgr_report_stats(ks, phase, 0, 0);
 }
 
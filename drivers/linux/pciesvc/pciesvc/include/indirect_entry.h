@@ -28,13 +28,26 @@ typedef enum {
 
 #define INDIRECT_TLPSZ          64
 
+/*
+ * Handling decodes the raw tlp then consults the aux info in a
+ * dependent read chain, so keep rtlp and info adjacent up front
+ * where they share cachelines; the completion bookkeeping below
+ * is touched later, after decode.
+ */
 typedef struct indirect_entry_s {
+    u_int8_t rtlp[INDIRECT_TLPSZ];
+    tlpauxinfo_t info;
     u_int32_t port;
     pciecpl_t cpl;                      /* PCIECPL_* completion type */
     u_int32_t completed:1;              /* completion has been delivered */
+    /*
+     * Completion response staged in place.  Handlers deposit the
+     * read payload in data[]; rspctrl follows contiguously so the
+     * hardware write-back issues straight from data[] with no
+     * intermediate copy.
+     */
     u_int32_t data[4];
-    u_int8_t rtlp[INDIRECT_TLPSZ];
-    tlpauxinfo_t info;
+    u_int32_t rspctrl;
 } indirect_entry_t;
 
 #endif /* __INDIRECT_ENTRY_H__ */
@@ -53,4 +53,53 @@ PCIEMGR_STATS_DEF(ind_unknown)
 
 PCIEMGR_STATS_DEF(healthlog)
 
+/* add new entries at the end to preserve offsets in shared memory */
+PCIEMGR_STATS_DEF(ind_burst)
+PCIEMGR_STATS_DEF(not_dupcfgwr)
+PCIEMGR_STATS_DEF(not_budget)
+
+/*
+ * Service latency histograms, log2 cycle-count buckets
+ * (bucket n counts transactions serviced in [2^n, 2^(n+1)) cycles,
+ * last bucket is unbounded).
+ */
+#define ind_latency_stats ind_lat0
+PCIEMGR_STATS_DEF(ind_lat0)
+PCIEMGR_STATS_DEF(ind_lat1)
+PCIEMGR_STATS_DEF(ind_lat2)
+PCIEMGR_STATS_DEF(ind_lat3)
+PCIEMGR_STATS_DEF(ind_lat4)
+PCIEMGR_STATS_DEF(ind_lat5)
+PCIEMGR_STATS_DEF(ind_lat6)
+PCIEMGR_STATS_DEF(ind_lat7)
+PCIEMGR_STATS_DEF(ind_lat8)
+PCIEMGR_STATS_DEF(ind_lat9)
+PCIEMGR_STATS_DEF(ind_lat10)
+PCIEMGR_STATS_DEF(ind_lat11)
+PCIEMGR_STATS_DEF(ind_lat12)
+PCIEMGR_STATS_DEF(ind_lat13)
+PCIEMGR_STATS_DEF(ind_lat14)
+PCIEMGR_STATS_DEF(ind_lat15)
+
+#define not_latency_stats not_lat0
+PCIEMGR_STATS_DEF(not_lat0)
+PCIEMGR_STATS_DEF(not_lat1)
+PCIEMGR_STATS_DEF(not_lat2)
+PCIEMGR_STATS_DEF(not_lat3)
+PCIEMGR_STATS_DEF(not_lat4)
+PCIEMGR_STATS_DEF(not_lat5)
+PCIEMGR_STATS_DEF(not_lat6)
+PCIEMGR_STATS_DEF(not_lat7)
+PCIEMGR_STATS_DEF(not_lat8)
+PCIEMGR_STATS_DEF(not_lat9)
+PCIEMGR_STATS_DEF(not_lat10)
+PCIEMGR_STATS_DEF(not_lat11)
+PCIEMGR_STATS_DEF(not_lat12)
+PCIEMGR_STATS_DEF(not_lat13)
+PCIEMGR_STATS_DEF(not_lat14)
+PCIEMGR_STATS_DEF(not_lat15)
+
+/* ring occupancy reached capacity, hw may be dropping entries */
+PCIEMGR_STATS_DEF(not_full)
+
 #undef PCIEMGR_STATS_DEF
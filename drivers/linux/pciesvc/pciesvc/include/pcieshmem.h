@@ -46,6 +46,7 @@ typedef enum pciehw_barhnd_e {
     PCIEHW_BARHND_NONE,
     PCIEHW_BARHND_SERIAL,
     PCIEHW_BARHND_VIRTIO,
+    PCIEHW_BARHND_HOSTWIN,
 } pciehw_barhnd_t;
 
 typedef union pciehwbar_u {
@@ -121,6 +122,15 @@ typedef union pciehwdev_u {
         u_int32_t pmtb;                 /* pmt base  for cfg */
         u_int32_t pmtc;                 /* pmt count for cfg */
         ovrdintr_t ovrdintr[NOVRDINTR]; /* override intr resources */
+        u_int16_t sriovpendctrl;        /* deferred sriov ctrl request */
+        u_int16_t sriovpendnumvfs;      /* deferred sriov numvfs request */
+        u_int8_t sriovbusy:1;           /* sriov ctrl change in progress */
+        u_int8_t sriovpend:1;           /* deferred sriov request valid */
+        u_int8_t vpdcapvalid:1;         /* vpdcap computed */
+        u_int16_t vpdcap;               /* cached vpd capability offset */
+        u_int8_t intrmodevalid:1;       /* intr mode shadow is current */
+        u_int8_t intrmodelegacy:1;      /* last fwcfg mode applied */
+        u_int8_t intrmodefmask:1;       /* last function mask applied */
     };
     u_int8_t _pad[4096];
 } pciehwdev_t;
@@ -129,6 +139,8 @@ typedef union pciehw_port_u {
     struct {
         u_int8_t secbus;                /* bridge secondary bus */
         pciemgr_stats_t stats;
+        u_int32_t portcfghdr[16];       /* shadow of port config header */
+        u_int32_t portcfgvalid;         /* bitmap of valid portcfghdr dws */
     };
     u_int8_t _pad[1024];
 } pciehw_port_t;
@@ -137,6 +149,8 @@ typedef union pciehw_sprt_u {
     struct {
         prt_t prt;                      /* shadow copy of prt */
         u_int16_t next;                 /* next link for chained prts */
+        u_int8_t isfree:1;              /* entry is on a buddy free list */
+        u_int8_t freeorder:5;           /* free block size (log2) if isfree */
     };
     u_int8_t _pad[32];
 } pciehw_sprt_t;
@@ -156,6 +170,11 @@ typedef union pciehw_spmt_u {
         u_int64_t vf0base:52;           /* sriov vf0 resource base address */
         u_int64_t pmtstart:6;           /* sriov vf0 addr mask start */
         u_int16_t next;                 /* next link for chained pmts */
+        u_int8_t isfree:1;              /* entry is on a buddy free list */
+        u_int8_t freeorder:5;           /* free block size (log2) if isfree */
+        u_int16_t ownext;               /* next link for owner index list */
+        u_int8_t hnd;                   /* bar handler, copy of bar hnd */
+        u_int8_t hndvalid:1;            /* hnd set at bar load */
     };
     u_int8_t _pad[128];
 } pciehw_spmt_t;
@@ -165,11 +184,88 @@ typedef struct pciehw_sromsk_s {
     u_int32_t count;
 } pciehw_sromsk_t;
 
+/* config read cache entries, power of 2 */
+#define PCIEHW_NCFGRDCACHE 256
+
+typedef struct pciehw_cfgrdent_s {
+    u_int32_t gen;                      /* cfgrdcachegen when inserted */
+    pciehwdevh_t hwdevh;                /* device of cached read */
+    u_int16_t addr;                     /* config space offset */
+    u_int8_t size;                      /* access size in bytes */
+    u_int8_t valid;                     /* entry is valid */
+    u_int32_t data;                     /* cached read data */
+} pciehw_cfgrdent_t;
+
+/* host window log ring records, power of 2 */
+#define PCIEHW_NHOSTWINLOG 256
+
+typedef union pciehw_hostwinlog_u {
+    struct {
+        u_int32_t seq;                  /* record sequence number */
+        u_int8_t pri;                   /* PCIESVC_LOGPRI_* */
+        char msg[120];                  /* nul-terminated message text */
+    };
+    u_int8_t _pad[128];
+} pciehw_hostwinlog_t;
+
+/* bdf lookup map entries, power of 2 */
+#define PCIEHW_NBDFMAP 4096
+
+typedef struct pciehw_bdfent_s {
+    u_int32_t gen;                      /* bdfmapgen when inserted */
+    pciehwdevh_t hwdevh;                /* device handle, 0=no device */
+    u_int16_t bdf;                      /* host bdf, verified on lookup */
+    u_int8_t port;                      /* pcie port, verified on lookup */
+    u_int8_t valid;                     /* entry is valid */
+} pciehw_bdfent_t;
+
+/*
+ * Shared memory command ring.  Commands execute in place in the
+ * slot--no staging copies.  The producer claims sequence cmdpi+1,
+ * fills slot->cmd, and publishes by stamping slot->seq with the
+ * sequence; pciesvc executes the command during event-loop polls
+ * and publishes the response in slot->res by stamping slot->cplseq.
+ * Producers must wait for cmdringvalid before posting.
+ * Slot payloads are sized for pciesvc_cmd_t/pciesvc_cmdres_t.
+ */
+#define PCIEHW_NCMDRING 16              /* ring slots, power of 2 */
+
+typedef struct pciehw_cmdslot_s {
+    u_int32_t seq;                      /* producer seq, 0 = never posted */
+    u_int32_t cplseq;                   /* == seq when response is valid */
+    u_int32_t cmd[16];                  /* command, in place */
+    u_int32_t res[16];                  /* response, in place */
+} pciehw_cmdslot_t;
+
+/*
+ * Split spmt sw transaction counters.  The in-entry swrd/swwr
+ * counters made the handlers dirty pciehw_spmt_t on every serviced
+ * transaction, false-sharing the read-mostly entry state with the
+ * other core.  New service code counts here instead (cacheline-
+ * aligned, entries frozen at their pre-split values); the spmt
+ * entry stays clean on the hot path.
+ */
+typedef struct pciehw_spmtctr_s {
+    u_int64_t swrd;                     /* reads  handled by sw (not/ind) */
+    u_int64_t swwr;                     /* writes handled by sw (not/ind) */
+} pciehw_spmtctr_t;
+
+/*
+ * Kexec handoff dirty summary.  Write paths that leave multi-step
+ * state in flight mark the affected device or pmt range here and
+ * clear the mark when the update completes.  The restore in the
+ * new kernel revalidates only what is still marked, so a clean
+ * handoff resumes with near-zero work instead of full-image
+ * processing.
+ */
+#define PCIEHW_DIRTYMAPSZ ((PCIEHW_NDEVS + 31) / 32)
+
 #define PCIEHW_MAGIC    0x706d656d      /* 'pmem' */
 #define PCIEHW_VERSION  0x1
 
 #define PCIEHW_VPDSZ    1024
 #define PCIEHW_SERIALSZ 1024
+#define PCIEHW_SERIALBULKSZ 4096
 
 typedef struct pciehw_shmem_s {
     u_int32_t magic;                    /* PCIEHW_MAGIC when initialized */
@@ -179,6 +275,7 @@ typedef struct pciehw_shmem_s {
     u_int32_t skip_notify:1;            /* notify skips if ring full */
     u_int32_t pmtpri:1;                 /* support pmt pri */
     u_int32_t evregistered:1;           /* event handler registered flag */
+    u_int32_t pmtbuddy:1;               /* support pmt buddy free lists */
     u_int32_t allocdev;
     u_int32_t allocpmt_high;            /* high priority pmt free sequential */
     u_int32_t allocprt;                 /* prt free sequential */
@@ -198,6 +295,37 @@ typedef struct pciehw_shmem_s {
     u_int32_t freepmt_low;              /* low priority pmt free list */
     u_int32_t allocpmt_vf0adj;          /* low pri vf0 adjust (never freed) */
     u_int32_t freeprt_slab;             /* prt free slab adjacent */
+    u_int32_t freepmt_order_high[PMT_NORDERS]; /* high pri buddy free lists */
+    u_int32_t freepmt_order_low[PMT_NORDERS];  /* low pri buddy free lists */
+    u_int32_t reservepmt_vf0adj;        /* vf0adj reservation base, 0=unknown */
+    u_int32_t spmtownervalid;           /* spmtowner index lists are valid */
+    u_int32_t spmtowner[PCIEHW_NDEVS];  /* per-dev owned pmt list heads */
+    u_int32_t cfgrdcachevalid;          /* cfgrdcache is initialized */
+    u_int32_t cfgrdcachegen;            /* cfgrdcache generation */
+    pciehw_cfgrdent_t cfgrdcache[PCIEHW_NCFGRDCACHE]; /* config read cache */
+    u_int32_t spmtctrvalid;             /* spmtctr is initialized */
+    pciehw_spmtctr_t spmtctr[PCIEHW_NPMT] __attribute__((aligned(64)));
+    u_int32_t cmdringvalid;             /* cmdring is initialized */
+    u_int32_t cmdpi;                    /* cmdring producer sequence */
+    u_int32_t cmdci;                    /* cmdring consumer sequence */
+    pciehw_cmdslot_t cmdring[PCIEHW_NCMDRING] __attribute__((aligned(64)));
+    u_int32_t handoffvalid;             /* handoff summary is initialized */
+    u_int32_t devdirty[PCIEHW_DIRTYMAPSZ]; /* devs with updates in flight */
+    u_int32_t pmtdirtyb;                /* pmt dirty range begin */
+    u_int32_t pmtdirtyc;                /* pmt dirty range count, 0=clean */
+    u_int32_t prtbuddy;                 /* support prt buddy free lists */
+    u_int32_t freeprt_order[PRT_NORDERS]; /* prt buddy free lists */
+    u_int32_t reserveprt;               /* reserved region base, grows down */
+    u_int32_t serialbulk;               /* bulk console ring is initialized */
+    u_int32_t serialbulkpi;             /* bulk console producer index */
+    u_int32_t serialbulkci;             /* bulk console consumer index */
+    u_int8_t serialbulkbuf[PCIEHW_SERIALBULKSZ]; /* bulk console data */
+    u_int32_t bdfmapvalid;              /* bdfmap is initialized */
+    u_int32_t bdfmapgen;                /* bdfmap generation */
+    pciehw_bdfent_t bdfmap[PCIEHW_NBDFMAP]; /* host bdf -> hwdevh map */
+    u_int32_t hostwinvalid;             /* host window log is initialized */
+    u_int32_t hostwinlogpi;             /* host window log producer index */
+    pciehw_hostwinlog_t hostwinlog[PCIEHW_NHOSTWINLOG]; /* log ring */
 } pciehw_shmem_t;
 
 #ifdef __cplusplus
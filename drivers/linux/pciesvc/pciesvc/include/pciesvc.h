@@ -22,7 +22,7 @@ extern "C" {
 #include "pciesvc_cmd.h"
 
 #define PCIESVC_VERSION_MAJ     3
-#define PCIESVC_VERSION_MIN     1
+#define PCIESVC_VERSION_MIN     2
 
 typedef struct pciesvc_params_v0_s {
     int         port;                   /* port to config */
@@ -36,6 +36,7 @@ typedef struct pciesvc_params_v0_s {
     uint32_t    ind_msgdata;            /* ind_intr=1: intr msg data */
     uint64_t    not_msgaddr;            /* not_intr=1: intr msg addr */
     uint32_t    not_msgdata;            /* not_intr=1: intr msg addr */
+    uint32_t    not_ring_depth;         /* notify ring entries, 0=keep */
 } pciesvc_params_v0_t;
 
 typedef struct pciesvc_params_s {
@@ -70,6 +71,7 @@ int pciesvc_notify_intr(const int port);
 
 int pciesvc_cmd_read(char *buf, const long int off, const size_t count);
 int pciesvc_cmd_write(const char *buf, const long int off, const size_t count);
+int pciesvc_cmd_poll(void);
 
 extern int pciesvc_version_major;
 extern int pciesvc_version_minor;
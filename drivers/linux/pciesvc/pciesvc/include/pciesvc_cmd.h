@@ -16,11 +16,13 @@ extern "C" {
 typedef enum pciesvc_cmdcode_e {
     PCIESVC_CMD_NOP                     = 0,
     PCIESVC_CMD_SET_LOG_LEVEL           = 1,
+    PCIESVC_CMD_BENCH_NOTIFY            = 2,
 } pciesvc_cmdcode_t;
 
 typedef enum pciesvc_cmdstatus_e {
     PCIESVC_CMDSTATUS_SUCCESS           = 0,
     PCIESVC_CMDSTATUS_UNKNOWN_CMD       = 1,
+    PCIESVC_CMDSTATUS_INVALID_ARG       = 2,
 } pciesvc_cmdstatus_t;
 
 typedef struct pciesvc_cmd_nop_s {
@@ -41,11 +43,35 @@ typedef struct pciesvc_cmdres_set_log_level_s {
     uint32_t old_level;
 } pciesvc_cmdres_set_log_level_t;
 
+/*
+ * Drive a synthetic config tlp through the notify handler "count"
+ * times, measuring service latency and updating the port latency
+ * histograms.  The tlp is supplied raw in ring format (see
+ * notify_entry.h), so entries recorded from a live enumeration can
+ * be replayed; write tlps mutate device state exactly as the
+ * original host access would.
+ */
+typedef struct pciesvc_cmd_bench_notify_s {
+    uint32_t cmd;
+    uint32_t port;
+    uint32_t count;
+    uint8_t rtlp[48];           /* NOTIFY_TLPSZ */
+} pciesvc_cmd_bench_notify_t;
+
+typedef struct pciesvc_cmdres_bench_notify_s {
+    uint32_t status;
+    uint32_t count;             /* transactions serviced */
+    uint64_t cycles;            /* total elapsed, timer ticks */
+    uint32_t mincyc;            /* fastest single transaction */
+    uint32_t maxcyc;            /* slowest single transaction */
+} pciesvc_cmdres_bench_notify_t;
+
 typedef union pciesvc_cmd_u {
     uint32_t words[16];
     uint8_t cmd;
     pciesvc_cmd_nop_t nop;
     pciesvc_cmd_set_log_level_t set_log_level;
+    pciesvc_cmd_bench_notify_t bench_notify;
 } pciesvc_cmd_t;
 
 typedef union pciesvc_cmdres_u {
@@ -53,6 +79,7 @@ typedef union pciesvc_cmdres_u {
     uint8_t status;
     pciesvc_cmdres_nop_t nop;
     pciesvc_cmdres_set_log_level_t set_log_level;
+    pciesvc_cmdres_bench_notify_t bench_notify;
 } pciesvc_cmdres_t;
 
 #ifdef __cplusplus
@@ -22,6 +22,7 @@ typedef enum pciesvc_event_e {
     PCIESVC_EV_QFULL,
     PCIESVC_EV_MGMTCHG,
     PCIESVC_EV_LOGMSG,
+    PCIESVC_EV_LOGBIN,
 } pciesvc_event_t;
 
 typedef struct pciesvc_memrw_notify_s {
@@ -62,6 +63,24 @@ typedef struct pciesvc_logmsg_s {
     char msg[80];               /* log string, NULL-terminated */
 } pciesvc_logmsg_t;
 
+/*
+ * Binary log record: a format id plus raw args, formatted offline
+ * by tools/logbin_decode using pciesvc_logfmt_defs.h.
+ */
+typedef enum pciesvc_logfmt_e {
+#define PCIESVC_LOGFMT_DEF(id, fmt) id,
+#include "pciesvc_logfmt_defs.h"
+    PCIESVC_LOGFMT_COUNT
+} pciesvc_logfmt_t;
+
+#define PCIESVC_LOGBIN_NARGS 5
+
+typedef struct pciesvc_logbin_s {
+    pciesvc_logpri_t pri;       /* log priority LOGPRI_ */
+    u_int32_t fmtid;            /* format id LOGFMT_* */
+    u_int64_t args[PCIESVC_LOGBIN_NARGS];   /* raw format args */
+} pciesvc_logbin_t;
+
 typedef struct pciesvc_eventdata_s {
     pciesvc_event_t evtype;     /* PCIESVC_EV_* */
     u_int8_t port;              /* PCIe port */
@@ -71,6 +90,7 @@ typedef struct pciesvc_eventdata_s {
         pciesvc_sriov_numvfs_t sriov_numvfs;    /* EV_SRIOV_NUMVFS */
         pciesvc_reset_t reset;                  /* EV_RESET */
         pciesvc_logmsg_t logmsg;                /* EV_LOGMSG */
+        pciesvc_logbin_t logbin;                /* EV_LOGBIN */
     };
 } pciesvc_eventdata_t;
 
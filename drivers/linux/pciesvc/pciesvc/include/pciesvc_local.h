@@ -33,6 +33,15 @@ u_int16_t pciehwdev_get_hostbdf(const pciehwdev_t *phwdev);
 
 void pciehw_sriov_ctrl(pciehwdev_t *phwdev,
                        const u_int16_t ctrl, const u_int16_t numvfs);
+void pciehw_sriov_resume(pciehwdev_t *phwdev);
+
+union pciehw_spmt_u; typedef union pciehw_spmt_u pciehw_spmt_t;
+int pciehw_pmt_foreach_dev(const pciehwdevh_t hwdevh,
+                           void (*cb)(int pmti,
+                                      pciehw_spmt_t *spmt, void *arg),
+                           void *arg);
+void pciehw_pmt_index_inval(void);
+void pciehw_pmt_reorder_idle(void);
 
 struct pmt_s; typedef struct pmt_s pmt_t;
 int pmt_reserve_vf0adj(const int n);
@@ -52,6 +61,7 @@ void pmt_entry_dec(const pmt_entry_t *pmte, pmt_datamask_t *dm);
 union prt_u; typedef union prt_u prt_t;
 int prt_alloc(const int n);
 void prt_free(const int prtbase, const int prtcount);
+int prt_reserve(const int n);
 void prt_get(const int prti, prt_t *prt);
 void prt_set(const int prti, const prt_t *prt);
 
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2022, Pensando Systems Inc.
+ */
+
+#ifndef PCIESVC_LOGFMT_DEF
+#define PCIESVC_LOGFMT_DEF(id, fmt)
+#endif
+
+/*
+ * Format strings for binary log records (PCIESVC_EV_LOGBIN).
+ * The hot path stores only the format id and raw args;
+ * tools/logbin_decode formats these offline.  All args are
+ * passed as u_int64_t so formats use %l conversions.
+ *
+ * Add new entries at the end to keep format ids stable.
+ */
+
+PCIESVC_LOGFMT_DEF(PCIESVC_LOGFMT_NONE,
+    "none\n")
+PCIESVC_LOGFMT_DEF(PCIESVC_LOGFMT_CFGRD_IND,
+    "cfgrd_indirect: hwdevh %lu vfid %lu rd 0x%lx sz %lu data 0x%lx\n")
+PCIESVC_LOGFMT_DEF(PCIESVC_LOGFMT_CFGWR_IND,
+    "cfgwr_indirect: hwdevh %lu vfid %lu wr 0x%lx sz %lu data 0x%lx\n")
+
+#undef PCIESVC_LOGFMT_DEF
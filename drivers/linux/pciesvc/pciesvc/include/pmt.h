@@ -26,6 +26,9 @@ extern "C" {
 #define PMT_NWORDS      5
 #define PMR_NWORDS      4
 
+/* pmt buddy allocator free list orders, 2^(PMT_NORDERS-1) = PMT_COUNT */
+#define PMT_NORDERS     11
+
 /* terminator index for chained pmts */
 #define PMT_INVALID     ((u_int16_t)-1)
 
@@ -23,6 +23,9 @@ extern "C" {
 #define PRT_COUNT       4096
 #define PRT_NWORDS      3
 
+/* prt buddy allocator free list orders, 2^(PRT_NORDERS-1) = PRT_COUNT */
+#define PRT_NORDERS     13
+
 /* terminator index for chained prts */
 #define PRT_INVALID     ((u_int16_t)-1)
 
@@ -22,11 +22,33 @@ typedef struct serial_state {
     u_int32_t gen;              /* generation number */
     u_int32_t gen_ack;          /* generation number ack */
     u_int32_t breakreq;         /* break request */
-    u_int32_t _unused[11];
+    /* bulk console mode (reuses old _unused slots, keep memq compat) */
+    u_int32_t bulk_caps;        /* bulk streams the device offers */
+    u_int32_t bulk_en;          /* bulk streams enabled by the host */
+    u_int32_t _unused[9];
     memq_t txq;                 /* txq from device thr */
     memq_t rxq;                 /* rxq to   device rbr */
 } serial_state_t;
 
+/*
+ * Bulk console mode.  The device advertises streams in bulk_caps;
+ * an aware host enables them through the register window above the
+ * 16550 registers in the serial bar and then drains console data
+ * from the shmem ring (pciehw_shmem_t serialbulk*) eight bytes per
+ * transaction instead of one trapped LSR/RBR pair per byte.  The
+ * producer appends at serialbulkpi and notifies once per batch on
+ * the console interrupt; hosts that never touch the window keep the
+ * 16550 emulation unchanged.
+ */
+#define SERIAL_BULK_MAGIC       0x626c6b00      /* "blk" */
+#define SERIAL_BULK_NONE        0x0
+#define SERIAL_BULK_RX          0x1     /* device-to-host console stream */
+
+#define SERIAL_BULK_CAPS_REG    0x08    /* ro: magic | offered streams */
+#define SERIAL_BULK_EN_REG      0x0c    /* rw: streams enabled by host */
+#define SERIAL_BULK_AVAIL_REG   0x10    /* ro: rx ring bytes ready */
+#define SERIAL_BULK_DATA_REG    0x18    /* ro: next 8 rx stream bytes */
+
 typedef struct serial_uart_state {
     union {
         serial_state_t serial_state;
@@ -196,6 +196,18 @@ struct virtio_ident_reg {
     uint16_t min_qlen;
 };
 
+/*
+ * Doorbell coalescing state, shared with the device backend.
+ * One bit per notify slot, set by pciesvc when the guest rings the
+ * doorbell.  Only the 0 -> 1 transition generates a notify event;
+ * repeat rings while the bit is set are coalesced.  The backend
+ * clears each bit before scanning the queue it covers, so a ring
+ * that arrives mid-scan raises a fresh event.
+ */
+struct virtio_dbell_reg {
+    uint32_t dbell_dirty[VIRTIO_PCI_QUEUE_SELECT_COUNT / 32];
+};
+
 struct virtio_dev_regs {
     union {
         struct virtio_pci_common_cfg cmn_cfg;
@@ -207,7 +219,10 @@ struct virtio_dev_regs {
         uint8_t part1[256];
     };
     union {
-        struct virtio_ident_reg ident;
+        struct {
+            struct virtio_ident_reg ident;
+            struct virtio_dbell_reg dbell_reg;
+        } __attribute__((packed));
         uint8_t part2[512];
     };
     union {
@@ -9,6 +9,7 @@
 #include "notify.h"
 #include "serial.h"
 #include "virtio.h"
+#include "hostwin.h"
 #include "pmt.h"
 
 static pciehwbar_t *
@@ -143,8 +144,24 @@ pciehw_barrd_indirect(const int port, indirect_entry_t *ientry)
 {
     const tlpauxinfo_t *info = &ientry->info;
     const pciehw_spmt_t *spmt = pciesvc_spmt_get(info->pmti);
-    pciehwdev_t *phwdev = pciehwdev_get(spmt->owner);
-    const pciehwbar_t *phwbar = pciehw_bar_get(phwdev, spmt->cfgidx);
+    pciehwdev_t *phwdev;
+    const pciehwbar_t *phwbar;
+
+    /*
+     * The bar handler is precomputed in the spmt at bar load time
+     * so plain bars (doorbells, interrupt control) complete here
+     * without the owner device and bar lookups.  Entries loaded
+     * before the handler was recorded take the lookup path below.
+     */
+    if (spmt->hndvalid && spmt->hnd == PCIEHW_BARHND_NONE) {
+        pciesvc_mem_rd(info->direct_addr, ientry->data, info->direct_size);
+        pciesvc_spmt_put(spmt, CLEAN);
+        pciehw_indirect_complete(ientry);
+        return;
+    }
+
+    phwdev = pciehwdev_get(spmt->owner);
+    phwbar = pciehw_bar_get(phwdev, spmt->cfgidx);
 
     switch (phwbar->hnd) {
 
@@ -178,6 +195,16 @@ pciehw_barrd_indirect(const int port, indirect_entry_t *ientry)
         break;
     }
 
+    case PCIEHW_BARHND_HOSTWIN: {
+        pcie_stlp_t stlpbuf, *stlp = &stlpbuf;
+        u_int64_t baroff;
+
+        pcietlp_decode(stlp, ientry->rtlp, sizeof(ientry->rtlp));
+        baroff = stlp->addr - phwbar->addr;
+        ientry->data[0] = hostwin_barrd(phwdev, baroff, info->direct_size);
+        break;
+    }
+
     default: {
         u_int64_t pa = info->direct_addr;
         size_t sz = info->direct_size;
@@ -197,12 +224,23 @@ pciehw_barwr_indirect(const int port, indirect_entry_t *ientry)
 {
     const tlpauxinfo_t *info = &ientry->info;
     const pciehw_spmt_t *spmt = pciesvc_spmt_get(info->pmti);
-    pciehwdev_t *phwdev = pciehwdev_get(spmt->owner);
-    const pciehwbar_t *phwbar = pciehw_bar_get(phwdev, spmt->cfgidx);
+    pciehwdev_t *phwdev;
+    const pciehwbar_t *phwbar;
     pcie_stlp_t stlpbuf, *stlp = &stlpbuf;
 
     pcietlp_decode(stlp, ientry->rtlp, sizeof(ientry->rtlp));
 
+    /* precomputed handler, as in pciehw_barrd_indirect above */
+    if (spmt->hndvalid && spmt->hnd == PCIEHW_BARHND_NONE) {
+        pciesvc_mem_wr(info->direct_addr, &stlp->data, info->direct_size);
+        pciesvc_spmt_put(spmt, CLEAN);
+        pciehw_indirect_complete(ientry);
+        return;
+    }
+
+    phwdev = pciehwdev_get(spmt->owner);
+    phwbar = pciehw_bar_get(phwdev, spmt->cfgidx);
+
     switch (phwbar->hnd) {
 
     case PCIEHW_BARHND_SERIAL: {
@@ -229,6 +267,10 @@ pciehw_barwr_indirect(const int port, indirect_entry_t *ientry)
         break;
     }
 
+    case PCIEHW_BARHND_HOSTWIN:
+        /* read-only window, drop host writes */
+        break;
+
     default: {
         u_int64_t pa = info->direct_addr;
         size_t sz = info->direct_size;
@@ -93,6 +93,208 @@ cfgpa_to_hwdevh(const u_int64_t cfgpa)
     return 0;
 }
 
+/*****************************************************************
+ * bdf lookup map
+ *
+ * "cfgpa" resolves the target only when the hw routed the
+ * transaction into the device cfgcur region.  With indirect_catchall
+ * a transaction whose cfg pmt entries aren't loaded yet (common
+ * while enumeration reassigns buses) lands in zerospa and resolves
+ * to the unused handle 0 even though the accurate stlp->bdf names
+ * one of our devices, and resolving by bdf used to mean walking the
+ * device tree comparing host bdfs, O(ndevs) per transaction with
+ * 255 vfs plus bridges.  Keep a direct-map bdf->hwdevh table in
+ * shmem instead:  lookups hash port/bdf, misses walk the port's
+ * device tree once and insert the answer (handle 0 included, so
+ * enumeration probes of absent bdfs stay O(1) too).  Bus assignment
+ * and bridge secbus updates invalidate the whole map by bumping the
+ * generation--bdfs change rarely once enumeration settles.
+ */
+
+static pciehw_bdfent_t *
+bdfmap_ent(const int port, const u_int16_t bdf)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    const u_int32_t h = ((port << 8) ^ bdf ^ (bdf >> 12)) &
+        (PCIEHW_NBDFMAP - 1);
+
+    if (!pshmem->bdfmapvalid) {
+        /* first use (or new shmem from older fw), reset the map */
+        pciesvc_memset(pshmem->bdfmap, 0, sizeof(pshmem->bdfmap));
+        pshmem->bdfmapgen = 0;
+        pshmem->bdfmapvalid = 1;
+    }
+    return &pshmem->bdfmap[h];
+}
+
+void
+pciehw_bdfmap_inval(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    if (pshmem->bdfmapvalid) {
+        pshmem->bdfmapgen++;
+    }
+}
+
+static pciehwdevh_t
+bdfmap_search(pciehwdevh_t hwdevh, const u_int16_t bdf)
+{
+    while (hwdevh) {
+        pciehwdev_t *phwdev = pciehwdev_get(hwdevh);
+        const pciehwdevh_t childh = phwdev->childh;
+        const pciehwdevh_t peerh = phwdev->peerh;
+        const u_int16_t hostbdf = pciehwdev_get_hostbdf(phwdev);
+        pciehwdevh_t founddevh;
+
+        pciehwdev_put(phwdev, CLEAN);
+
+        if (hostbdf == bdf) return hwdevh;
+        founddevh = bdfmap_search(childh, bdf);
+        if (founddevh) return founddevh;
+        hwdevh = peerh;
+    }
+    return 0;
+}
+
+/*
+ * Last-resolved device, per port.  An enumeration burst resolves the
+ * same bdf thousands of times in a row, so keep the most recent
+ * answer in local memory in front of the shmem map--a hit costs one
+ * compare instead of a hash probe of the (uncached) shmem table.
+ * Validated against bdfmapgen, so the existing invalidation points
+ * cover it; local memory resets to invalid across kexec.
+ */
+typedef struct bdf_lastdev_s {
+    u_int32_t gen;                      /* bdfmapgen when resolved */
+    u_int16_t bdf;                      /* host bdf resolved */
+    u_int8_t valid;                     /* entry is valid */
+    pciehwdevh_t hwdevh;                /* device handle, 0=no device */
+} bdf_lastdev_t;
+
+static bdf_lastdev_t bdf_lastdev[PCIEHW_NPORTS];
+
+static pciehwdevh_t
+bdf_to_hwdevh(const int port, const u_int16_t bdf)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    bdf_lastdev_t *last = &bdf_lastdev[port];
+    pciehw_bdfent_t *ent;
+    pciehwdevh_t hwdevh;
+
+    ent = bdfmap_ent(port, bdf);        /* also inits bdfmapgen on first use */
+
+    if (last->valid &&
+        last->gen == pshmem->bdfmapgen &&
+        last->bdf == bdf) {
+        return last->hwdevh;
+    }
+
+    if (ent->valid &&
+        ent->gen == pshmem->bdfmapgen &&
+        ent->port == port &&
+        ent->bdf == bdf) {
+        hwdevh = ent->hwdevh;
+    } else {
+        hwdevh = bdfmap_search(pshmem->rooth[port], bdf);
+
+        ent->gen = pshmem->bdfmapgen;
+        ent->hwdevh = hwdevh;
+        ent->bdf = bdf;
+        ent->port = port;
+        ent->valid = 1;
+    }
+
+    last->gen = pshmem->bdfmapgen;
+    last->hwdevh = hwdevh;
+    last->bdf = bdf;
+    last->valid = 1;
+    return hwdevh;
+}
+
+/*****************************************************************
+ * config read cache
+ *
+ * Host enumeration hammers reads of registers that never change
+ * after bring-up (vendor/device id, capability chains).  Cache
+ * the results of indirect reads so repeat reads skip the cfgspace
+ * machinery and handler dispatch.  Only reads with no read handler
+ * of registers with a zero write-mask (host read-only) are cached;
+ * those registers can change only on sw reset paths.  Config
+ * writes and resets invalidate the whole cache by bumping the
+ * generation--writes are rare compared to enumeration reads.
+ */
+
+static pciehw_cfgrdent_t *
+cfg_cache_ent(const pciehwdevh_t hwdevh, const u_int16_t addr)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    const u_int32_t h = ((hwdevh << 4) ^ (addr >> 2)) &
+        (PCIEHW_NCFGRDCACHE - 1);
+
+    if (!pshmem->cfgrdcachevalid) {
+        /* first use (or new shmem from older fw), reset the cache */
+        pciesvc_memset(pshmem->cfgrdcache, 0, sizeof(pshmem->cfgrdcache));
+        pshmem->cfgrdcachegen = 0;
+        pshmem->cfgrdcachevalid = 1;
+    }
+    return &pshmem->cfgrdcache[h];
+}
+
+static int
+cfg_cache_lookup(const pciehwdevh_t hwdevh,
+                 const u_int16_t addr, const u_int8_t size,
+                 u_int32_t *valp)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    pciehw_cfgrdent_t *ent = cfg_cache_ent(hwdevh, addr);
+
+    if (ent->valid &&
+        ent->gen == pshmem->cfgrdcachegen &&
+        ent->hwdevh == hwdevh &&
+        ent->addr == addr &&
+        ent->size == size) {
+        *valp = ent->data;
+        return 1;
+    }
+    return 0;
+}
+
+static void
+cfg_cache_insert(const pciehwdevh_t hwdevh,
+                 const u_int16_t addr, const u_int8_t size,
+                 const u_int32_t val)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    pciehw_cfgrdent_t *ent = cfg_cache_ent(hwdevh, addr);
+
+    /*
+     * The cache is shared across ports and each port may be serviced
+     * from its own context.  Clear valid first and publish it last
+     * so a concurrent lookup sees the old entry, a miss, or the
+     * complete new entry--never a torn one.
+     */
+    ent->valid = 0;
+    pciesvc_mem_barrier();
+    ent->gen = pshmem->cfgrdcachegen;
+    ent->hwdevh = hwdevh;
+    ent->addr = addr;
+    ent->size = size;
+    ent->data = val;
+    pciesvc_mem_barrier();
+    ent->valid = 1;
+}
+
+static void
+cfg_cache_inval(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    if (pshmem->cfgrdcachevalid) {
+        pshmem->cfgrdcachegen++;
+    }
+}
+
 void
 pciehw_cfg_load(pciehwdev_t *phwdev)
 {
@@ -417,6 +619,7 @@ pciehw_capture_bus(pciehwdev_t *phwdev, const u_int8_t bus, const int load)
                                          bdf_to_fnc(phwdev->bdf));
         if (phwdev->bdf != newbdf) {
             phwdev->bdf = newbdf;
+            pciehw_bdfmap_inval();
             /* event for mgmteth bdf change */
             if (phwdev->type == PCIEHDEVICE_MGMTETH) {
                 pciehw_mgmtchg_event(phwdev);
@@ -459,7 +662,14 @@ pciehw_bridge_secbus(pciehwdev_t *phwdev)
      * some systems (UCS bios) don't set bridge pribus
      * during the initial bus scan, so we get the
      * secbus of the hwbridge as a reliable bus.
+     *
+     * A write to our bridge bus registers means the host is
+     * assigning buses and likely just renumbered the hw bridge
+     * behind our back, so drop the port config shadow first.
+     * Host bdfs shift with the bus numbers, drop those too.
      */
+    portcfg_shadow_inval(phwdev->port);
+    pciehw_bdfmap_inval();
     portcfg_read_bus(phwdev->port, NULL, &hwbus, NULL);
 
     pciesvc_cfgspace_get(phwdev->hwdevh, &cs);
@@ -549,18 +759,34 @@ pciehw_cfgwr_msix(const handler_ctx_t *hctx)
     pciesvc_cfgspace_put(&cs, CLEAN);
 
     pciehw_intr_config(phwdev, legacy, fmask);
-    pciehwdev_put(phwdev, CLEAN);
+    pciehwdev_put(phwdev, DIRTY); /* intr mode shadow */
 }
 
 static void
 pciehw_cfgwr_vpd(const handler_ctx_t *hctx)
 {
     cfgspace_t cs;
+    pciehwdev_t *phwdev;
     u_int16_t vpdcap, addr, f;
     u_int32_t data;
 
     pciesvc_cfgspace_get(hctx->hwdevh, &cs);
-    vpdcap = cfgspace_findcap(&cs, PCI_CAP_ID_VPD);
+
+    /*
+     * The capability offset is fixed when the config space is built
+     * at device-add time.  Cache it on first access so monitoring
+     * agents polling vpd don't pay a capability list walk per access.
+     */
+    phwdev = pciehwdev_get(hctx->hwdevh);
+    if (!phwdev->vpdcapvalid) {
+        phwdev->vpdcap = cfgspace_findcap(&cs, PCI_CAP_ID_VPD);
+        phwdev->vpdcapvalid = 1;
+        vpdcap = phwdev->vpdcap;
+        pciehwdev_put(phwdev, DIRTY);
+    } else {
+        vpdcap = phwdev->vpdcap;
+        pciehwdev_put(phwdev, CLEAN);
+    }
     addr = cfgspace_readw(&cs, vpdcap + PCI_VPD_ADDR);
     f = addr & PCI_VPD_ADDR_F;
     addr &= PCI_VPD_ADDR_MASK;
@@ -767,20 +993,83 @@ void
 pciehw_sriov_ctrl(pciehwdev_t *phwdev,
                   const u_int16_t ctrl, const u_int16_t numvfs)
 {
-    if (phwdev->sriovctrl != ctrl) {
+    u_int16_t nctrl = ctrl;
+    u_int16_t nnumvfs = numvfs;
+
+    /*
+     * The vf reset loop services live transactions between batches
+     * (see pciehw_reset_vfs), so another sriov ctrl write can arrive
+     * while one is still being applied.  Defer it here; the top-level
+     * call below applies the latest deferred request when the current
+     * pass completes.
+     */
+    if (phwdev->sriovbusy) {
+        phwdev->sriovpendctrl = nctrl;
+        phwdev->sriovpendnumvfs = nnumvfs;
+        phwdev->sriovpend = 1;
+        return;
+    }
+
+    phwdev->sriovbusy = 1;
+    pciesvc_devdirty_set(phwdev->hwdevh);
+    for (;;) {
+        if (phwdev->sriovctrl != nctrl) {
 #ifdef __aarch64__
-        pciesvc_loginfo("%s "
-                        "sriov_ctrl 0x%04x vfe%c mse%c ari%c numvfs %d\n",
-                        pciehwdev_get_name(phwdev),
-                        ctrl,
-                        ctrl & PCI_SRIOV_CTRL_VFE ? '+' : '-',
-                        ctrl & PCI_SRIOV_CTRL_MSE ? '+' : '-',
-                        ctrl & PCI_SRIOV_CTRL_ARI ? '+' : '-',
-                        numvfs);
+            pciesvc_loginfo("%s "
+                            "sriov_ctrl 0x%04x vfe%c mse%c ari%c numvfs %d\n",
+                            pciehwdev_get_name(phwdev),
+                            nctrl,
+                            nctrl & PCI_SRIOV_CTRL_VFE ? '+' : '-',
+                            nctrl & PCI_SRIOV_CTRL_MSE ? '+' : '-',
+                            nctrl & PCI_SRIOV_CTRL_ARI ? '+' : '-',
+                            nnumvfs);
 #endif
-        pciehw_sriov_ctrl_numvfs(phwdev, ctrl, numvfs);
-        phwdev->sriovctrl = ctrl;
+            pciehw_sriov_ctrl_numvfs(phwdev, nctrl, nnumvfs);
+            phwdev->sriovctrl = nctrl;
+        }
+        if (!phwdev->sriovpend) break;
+        phwdev->sriovpend = 0;
+        nctrl = phwdev->sriovpendctrl;
+        nnumvfs = phwdev->sriovpendnumvfs;
+    }
+    phwdev->sriovbusy = 0;
+    pciesvc_devdirty_clr(phwdev->hwdevh);
+}
+
+/*
+ * Kexec handoff restore: complete an sriov ctrl change a previous
+ * service instance left in flight.  The target ctrl value lives in
+ * config space (the host's last write); sriovctrl records only the
+ * last fully-applied value, so re-running the apply path converges
+ * the two (or no-ops if the change completed before the handoff).
+ */
+void
+pciehw_sriov_resume(pciehwdev_t *phwdev)
+{
+    cfgspace_t cs;
+    u_int16_t sriovcap, sriovctrl, numvfs;
+
+    if (!phwdev->sriovbusy) return;
+
+    pciesvc_cfgspace_get(phwdev->hwdevh, &cs);
+    sriovcap = cfgspace_findextcap(&cs, PCI_EXT_CAP_ID_SRIOV);
+    if (sriovcap == 0) {
+        pciesvc_cfgspace_put(&cs, CLEAN);
+        phwdev->sriovbusy = 0;
+        return;
     }
+    sriovctrl = cfgspace_readw(&cs, sriovcap + PCI_SRIOV_CTRL);
+    numvfs = cfgspace_readw(&cs, sriovcap + PCI_SRIOV_NUM_VF);
+    if (numvfs > phwdev->totalvfs) numvfs = phwdev->totalvfs;
+    pciesvc_cfgspace_put(&cs, CLEAN);
+
+    phwdev->sriovbusy = 0;
+    if (phwdev->sriovpend) {
+        phwdev->sriovpend = 0;
+        sriovctrl = phwdev->sriovpendctrl;
+        numvfs = phwdev->sriovpendnumvfs;
+    }
+    pciehw_sriov_ctrl(phwdev, sriovctrl, numvfs);
 }
 
 static void
@@ -842,7 +1131,7 @@ pciehw_cfgwr_sriov_bars(const handler_ctx_t *hctx)
  * cfg handlers
  */
 
-static void
+static pciehw_cfghnd_t
 pciehw_cfgrd_handler(handler_ctx_t *hctx)
 {
     const u_int16_t reg = hctx->stlp.addr;
@@ -862,6 +1151,7 @@ pciehw_cfgrd_handler(handler_ctx_t *hctx)
         pciehw_cfgrd_delay(hctx);
         break;
     }
+    return hnd;
 }
 
 static void
@@ -927,6 +1217,10 @@ pciehw_cfgrd_notify(const int port, notify_entry_t *nentry)
     hctx.nentry = nentry;
     hctx.hwdevh = cfgpa_to_hwdevh(nentry->info.direct_addr);
     pcietlp_decode(&hctx.stlp, nentry->rtlp, sizeof(nentry->rtlp));
+    if (hctx.hwdevh == 0) {
+        /* catchall cfgpa, try the accurate bdf from the tlp */
+        hctx.hwdevh = bdf_to_hwdevh(port, hctx.stlp.bdf);
+    }
 
     pciehw_cfgrd_handler(&hctx);
 }
@@ -941,8 +1235,13 @@ pciehw_cfgwr_notify(const int port, notify_entry_t *nentry)
     hctx.nentry = nentry;
     hctx.hwdevh = cfgpa_to_hwdevh(nentry->info.direct_addr);
     pcietlp_decode(&hctx.stlp, nentry->rtlp, sizeof(nentry->rtlp));
+    if (hctx.hwdevh == 0) {
+        /* catchall cfgpa, try the accurate bdf from the tlp */
+        hctx.hwdevh = bdf_to_hwdevh(port, hctx.stlp.bdf);
+    }
 
     pciehw_cfgwr_handler(&hctx);
+    cfg_cache_inval();
 }
 
 /*****************************************************************
@@ -952,14 +1251,30 @@ pciehw_cfgwr_notify(const int port, notify_entry_t *nentry)
 void
 pciehw_cfgrd_indirect(const int port, indirect_entry_t *ientry)
 {
+    pciehw_cfghnd_t hnd;
     handler_ctx_t hctx;
     cfgspace_t cs;
+    int readonly;
 
     pciesvc_memset(&hctx, 0, sizeof(hctx));
     hctx.port = port;
     hctx.ientry = ientry;
     hctx.hwdevh = cfgpa_to_hwdevh(ientry->info.direct_addr);
     pcietlp_decode(&hctx.stlp, ientry->rtlp, sizeof(ientry->rtlp));
+    if (hctx.hwdevh == 0) {
+        /* catchall cfgpa, try the accurate bdf from the tlp */
+        hctx.hwdevh = bdf_to_hwdevh(port, hctx.stlp.bdf);
+    }
+
+    /*
+     * Cached reads have no read handler, complete them here.
+     */
+    if (cfg_cache_lookup(hctx.hwdevh, hctx.stlp.addr, hctx.stlp.size,
+                         &hctx.retval)) {
+        ientry->data[0] = hctx.retval;
+        pciehw_indirect_complete(ientry);
+        return;
+    }
 
     /*
      * For indirect reads read the current value at target addr
@@ -968,19 +1283,23 @@ pciehw_cfgrd_indirect(const int port, indirect_entry_t *ientry)
      */
     pciesvc_cfgspace_get(hctx.hwdevh, &cs);
     cfgspace_read(&cs, hctx.stlp.addr, hctx.stlp.size, &hctx.retval);
+    readonly = cfgspace_readonly(&cs, hctx.stlp.addr, hctx.stlp.size);
     pciesvc_cfgspace_put(&cs, CLEAN);
 
-    pciehw_cfgrd_handler(&hctx);
+    hnd = pciehw_cfgrd_handler(&hctx);
 
     ientry->data[0] = hctx.retval;
     pciehw_indirect_complete(ientry);
 
-#ifdef PCIEMGR_DEBUG
-    pciesvc_logdebug("cfgrd_indirect: "
-                     "hwdevh %d vfid %d rd 0x%lx sz %d data 0x%x\n",
-                     hctx.hwdevh, ientry->info.vfid,
-                     hctx.stlp.addr, hctx.stlp.size, ientry->data[0]);
-#endif
+    /* insert after completing so the host isn't waiting on it */
+    if (hnd == PCIEHW_CFGHND_NONE && readonly) {
+        cfg_cache_insert(hctx.hwdevh, hctx.stlp.addr, hctx.stlp.size,
+                         hctx.retval);
+    }
+
+    pciesvc_logbin(PCIESVC_LOGPRI_DEBUG, PCIESVC_LOGFMT_CFGRD_IND,
+                   hctx.hwdevh, ientry->info.vfid,
+                   hctx.stlp.addr, hctx.stlp.size, ientry->data[0]);
 }
 
 void
@@ -995,13 +1314,14 @@ pciehw_cfgwr_indirect(const int port, indirect_entry_t *ientry)
     hctx.ientry = ientry;
     hctx.hwdevh = cfgpa_to_hwdevh(ientry->info.direct_addr);
     pcietlp_decode(&hctx.stlp, ientry->rtlp, sizeof(ientry->rtlp));
+    if (hctx.hwdevh == 0) {
+        /* catchall cfgpa, try the accurate bdf from the tlp */
+        hctx.hwdevh = bdf_to_hwdevh(port, hctx.stlp.bdf);
+    }
 
-#ifdef PCIEMGR_DEBUG
-    pciesvc_logdebug("cfgwr_indirect: "
-                     "hwdevh %d vfid %d wr 0x%lx sz %d data 0x%lx\n",
-                     hctx.hwdevh, ientry->info.vfid,
-                     hctx.stlp.addr, hctx.stlp.size, hctx.stlp.data);
-#endif
+    pciesvc_logbin(PCIESVC_LOGPRI_DEBUG, PCIESVC_LOGFMT_CFGWR_IND,
+                   hctx.hwdevh, ientry->info.vfid,
+                   hctx.stlp.addr, hctx.stlp.size, hctx.stlp.data);
 
     /*
      * For indirect writes, write the data first,
@@ -1016,6 +1336,7 @@ pciehw_cfgwr_indirect(const int port, indirect_entry_t *ientry)
     }
     pciehw_cfgwr_handler(&hctx);
     pciehw_indirect_complete(ientry);
+    cfg_cache_inval();
 }
 
 /*****************************************************************
@@ -1035,6 +1356,8 @@ pciehw_cfg_reset(pciehwdev_t *phwdev, const pciesvc_rsttype_t rsttype)
      * reset cfg space
      */
     pciesvc_memcpy_toio(cs.cur, cs.rst, cfgsz);
+    /* reset rewrites read-only registers, drop any cached reads */
+    cfg_cache_inval();
 
     /* Read reset value for cmd */
     cmd = cfgspace_readw(&cs, PCI_COMMAND);
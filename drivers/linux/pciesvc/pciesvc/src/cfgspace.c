@@ -16,7 +16,11 @@
  * actual representation of config space for devices exposed across
  * the PCIe bus to the host.  PCIe config space is little-endian.
  * These functions are implemented to be endian-agnostic to run on
- * either big- or little-endian cpus.
+ * either big- or little-endian cpus.  Naturally-aligned accesses
+ * take a wide load/store fast path through the le conversions,
+ * unaligned accesses fall back to assembling bytes.  These run on
+ * the indirect path where tlp handling latency counts against the
+ * host PCIe completion timeout.
  */
 
 static inline u_int8_t
@@ -30,6 +34,9 @@ _cfgspace_getw_fld(u_int8_t *fld, const u_int16_t offset)
 {
     u_int16_t val;
 
+    if (((uintptr_t)(fld + offset) & 0x1) == 0) {
+        return pciesvc_le16toh(*(u_int16_t *)(fld + offset));
+    }
     val = (((u_int16_t)fld[offset + 1] << 8) |
            ((u_int16_t)fld[offset + 0] << 0));
     return val;
@@ -40,6 +47,9 @@ _cfgspace_getd_fld(u_int8_t *fld, const u_int16_t offset)
 {
     u_int32_t val;
 
+    if (((uintptr_t)(fld + offset) & 0x3) == 0) {
+        return pciesvc_le32toh(*(u_int32_t *)(fld + offset));
+    }
     val = (((u_int32_t)fld[offset + 3] << 24) |
            ((u_int32_t)fld[offset + 2] << 16) |
            ((u_int32_t)fld[offset + 1] <<  8) |
@@ -56,6 +66,10 @@ _cfgspace_setb_fld(u_int8_t *fld, const u_int16_t offset, const u_int8_t val)
 static inline void
 _cfgspace_setw_fld(u_int8_t *fld, const u_int16_t offset, const u_int16_t val)
 {
+    if (((uintptr_t)(fld + offset) & 0x1) == 0) {
+        *(u_int16_t *)(fld + offset) = pciesvc_htole16(val);
+        return;
+    }
     fld[offset + 0] = val;
     fld[offset + 1] = val >> 8;
 }
@@ -63,6 +77,10 @@ _cfgspace_setw_fld(u_int8_t *fld, const u_int16_t offset, const u_int16_t val)
 static inline void
 _cfgspace_setd_fld(u_int8_t *fld, const u_int16_t offset, const u_int32_t val)
 {
+    if (((uintptr_t)(fld + offset) & 0x3) == 0) {
+        *(u_int32_t *)(fld + offset) = pciesvc_htole32(val);
+        return;
+    }
     fld[offset + 0] = val;
     fld[offset + 1] = val >> 8;
     fld[offset + 2] = val >> 16;
@@ -281,6 +299,26 @@ cfgspace_writed(cfgspace_t *cs, const u_int16_t offset, const u_int32_t val)
     cfgspace_setd_cur(cs, offset, nval);
 }
 
+/*
+ * Return 1 if the register bytes at [offset, offset+size) are
+ * host read-only, i.e. the write-mask covering them is all 0's.
+ * These registers can only change on sw reset paths.
+ */
+int
+cfgspace_readonly(cfgspace_t *cs, const u_int16_t offset, const u_int8_t size)
+{
+    u_int8_t msk = 0;
+    int i;
+
+    if (offset + size > cfgspace_size(cs)) {
+        return 0;
+    }
+    for (i = 0; i < size; i++) {
+        msk |= cfgspace_getb_msk(cs, offset + i);
+    }
+    return msk == 0;
+}
+
 int
 cfgspace_write(cfgspace_t *cs,
                const u_int16_t offset,
@@ -43,6 +43,7 @@ cfgspace_size(cfgspace_t *cs)
 #define cfgspace_writew         _pciesvc_cfgspace_writew
 #define cfgspace_writed         _pciesvc_cfgspace_writed
 #define cfgspace_write          _pciesvc_cfgspace_write
+#define cfgspace_readonly       _pciesvc_cfgspace_readonly
 
 /*
  * Access specific config space registers.
@@ -87,6 +88,10 @@ int cfgspace_write(cfgspace_t *cs,
                    const u_int8_t size,
                    const u_int32_t val);
 
+int cfgspace_readonly(cfgspace_t *cs,
+                      const u_int16_t offset,
+                      const u_int8_t size);
+
 #ifdef __cplusplus
 }
 #endif
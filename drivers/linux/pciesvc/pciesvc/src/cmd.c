@@ -4,9 +4,14 @@
  */
 
 #include "pciesvc_impl.h"
+#include "pcietlp.h"
+#include "notify.h"
 
 static pciesvc_cmdres_t resbuf;
 
+/* bound bench work per command so the event loop isn't starved */
+#define BENCH_NOTIFY_MAXCOUNT   (1 << 16)
+
 static int
 cmd_nop(const pciesvc_cmd_nop_t *cmd,
         pciesvc_cmdres_nop_t *res)
@@ -25,6 +30,91 @@ cmd_set_log_level(const pciesvc_cmd_set_log_level_t *cmd,
     return 0;
 }
 
+/*
+ * Transaction latency benchmark.  Replays the supplied config tlp
+ * through the notify dispatch path and reports round-trip min/max
+ * and total elapsed ticks; per-transaction times also land in the
+ * port's not_lat* histogram so builds can be compared with the
+ * existing stats reporting.  Bar tlps are rejected: their dispatch
+ * needs live aux info from the pmt that can't be synthesized here.
+ */
+static int
+cmd_bench_notify(const pciesvc_cmd_bench_notify_t *cmd,
+                 pciesvc_cmdres_bench_notify_t *res)
+{
+    const pcie_tlp_common_hdr_t *hdr = (void *)cmd->rtlp;
+    notify_entry_t nentry;
+    pciehw_port_t *p;
+    u_int64_t start;
+    u_int32_t i, count;
+
+    if (cmd->port >= PCIEHW_NPORTS) {
+        res->status = PCIESVC_CMDSTATUS_INVALID_ARG;
+        return 0;
+    }
+    switch (hdr->type) {
+    case PCIE_TLP_TYPE_CFGRD0:
+    case PCIE_TLP_TYPE_CFGRD1:
+    case PCIE_TLP_TYPE_CFGWR0:
+    case PCIE_TLP_TYPE_CFGWR1:
+        break;
+    default:
+        res->status = PCIESVC_CMDSTATUS_INVALID_ARG;
+        return 0;
+    }
+    count = cmd->count;
+    if (count == 0) count = 1;
+    if (count > BENCH_NOTIFY_MAXCOUNT) count = BENCH_NOTIFY_MAXCOUNT;
+
+    res->mincyc = (u_int32_t)-1;
+    p = pciesvc_port_get(cmd->port);
+    start = pciesvc_cycles();
+    for (i = 0; i < count; i++) {
+        const u_int64_t t0 = pciesvc_cycles();
+        u_int64_t dt;
+
+        pciesvc_memset(&nentry, 0, sizeof(nentry));
+        pciesvc_memcpy(nentry.rtlp, cmd->rtlp, NOTIFY_TLPSZ);
+        pciehw_notify_inject(cmd->port, &nentry);
+
+        dt = pciesvc_cycles() - t0;
+        if (dt < res->mincyc) res->mincyc = dt;
+        if (dt > res->maxcyc) res->maxcyc = dt;
+        (&p->stats.not_latency_stats)[pciesvc_lat_bucket(dt)]++;
+    }
+    res->cycles = pciesvc_cycles() - start;
+    pciesvc_port_put(p, DIRTY);
+
+    res->count = count;
+    res->status = PCIESVC_CMDSTATUS_SUCCESS;
+    return 0;
+}
+
+static int
+cmd_exec(const pciesvc_cmd_t *cmd, pciesvc_cmdres_t *res)
+{
+    int r;
+
+    pciesvc_memset(res, 0, sizeof(*res));
+
+    switch (cmd->cmd) {
+    case PCIESVC_CMD_NOP:
+        r = cmd_nop(&cmd->nop, &res->nop);
+        break;
+    case PCIESVC_CMD_SET_LOG_LEVEL:
+        r = cmd_set_log_level(&cmd->set_log_level, &res->set_log_level);
+        break;
+    case PCIESVC_CMD_BENCH_NOTIFY:
+        r = cmd_bench_notify(&cmd->bench_notify, &res->bench_notify);
+        break;
+    default:
+        res->status = PCIESVC_CMDSTATUS_UNKNOWN_CMD;
+        r = 0;  /* cmd "succeeded" */
+        break;
+    }
+    return r;
+}
+
 int
 pciesvc_cmd_read(char *buf, const long int off, const size_t count)
 {
@@ -47,7 +137,6 @@ int
 pciesvc_cmd_write(const char *buf, const long int off, const size_t count)
 {
     pciesvc_cmd_t *cmd;
-    pciesvc_cmdres_t *res = &resbuf;
     int r;
 
     if (off != 0 || count < sizeof(pciesvc_cmd_t)) {
@@ -55,20 +144,57 @@ pciesvc_cmd_write(const char *buf, const long int off, const size_t count)
     }
 
     cmd = (pciesvc_cmd_t *)buf;
-    pciesvc_memset(res, 0, sizeof(*res));
+    r = cmd_exec(cmd, &resbuf);
 
-    switch (cmd->cmd) {
-    case PCIESVC_CMD_NOP:
-        r = cmd_nop(&cmd->nop, &res->nop);
-        break;
-    case PCIESVC_CMD_SET_LOG_LEVEL:
-        r = cmd_set_log_level(&cmd->set_log_level, &res->set_log_level);
-        break;
-    default:
-        res->status = PCIESVC_CMDSTATUS_UNKNOWN_CMD;
-        r = 0;  /* cmd_write "succeeded" */
-        break;
+    return r < 0 ? r : count;
+}
+
+/*
+ * Shared memory command ring (pciehw_shmem_t cmdring).  Commands
+ * execute in place in the slot: the producer fills slot->cmd and
+ * publishes by stamping slot->seq with its claimed sequence, we
+ * execute here during event-loop polls and publish the response in
+ * slot->res by stamping slot->cplseq.  No staging copies, and the
+ * ring lets orchestration post a burst of commands without waiting
+ * for each response.
+ */
+int
+pciesvc_cmd_poll(void)
+{
+    static int busy;
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    int worked = 0;
+
+    if (busy) return 0;
+    busy = 1;
+
+    if (!pshmem->cmdringvalid) {
+        /* first use, reset the ring; producers wait for valid */
+        pciesvc_memset(pshmem->cmdring, 0, sizeof(pshmem->cmdring));
+        pshmem->cmdpi = 0;
+        pshmem->cmdci = 0;
+        pciesvc_mem_barrier();
+        pshmem->cmdringvalid = 1;
+        busy = 0;
+        return 0;
     }
 
-    return r < 0 ? r : count;
+    while ((int)(pshmem->cmdpi - pshmem->cmdci) > 0) {
+        const u_int32_t seq = pshmem->cmdci + 1;
+        pciehw_cmdslot_t *slot =
+            &pshmem->cmdring[seq & (PCIEHW_NCMDRING - 1)];
+
+        if (slot->seq != seq) break; /* claimed but not yet published */
+        pciesvc_mem_barrier();       /* read payload after seq check */
+
+        cmd_exec((pciesvc_cmd_t *)slot->cmd, (pciesvc_cmdres_t *)slot->res);
+
+        pciesvc_mem_barrier();       /* response lands before cplseq */
+        slot->cplseq = seq;
+        pshmem->cmdci = seq;
+        worked = 1;
+    }
+
+    busy = 0;
+    return worked;
 }
@@ -11,6 +11,9 @@
 #define HDRT_STRIDE     ASIC_(PXB_CSR_DHS_ITR_PCIHDRT_ENTRY_BYTE_SIZE)
 #define HDRT_NWORDS     3
 
+/* ecc lives in word 2, bits 70-77 of the entry */
+#define HDRT_W2_ECC_MASK (0xffu << 6)
+
 static int
 hdrt_size(void)
 {
@@ -30,15 +33,39 @@ hdrt_set(const u_int32_t lif, const hdrt_t *hdrt)
     pciesvc_reg_wr32w(hdrt_addr(lif), (u_int32_t *)hdrt, HDRT_NWORDS);
 }
 
+/*
+ * Return 1 if the entry in hw already holds this value.
+ * The ecc byte is hw-maintained so ignore it in the compare.
+ */
+static int
+hdrt_match(const u_int32_t lif, const hdrt_t *hdrt)
+{
+    const u_int32_t *w = (const u_int32_t *)hdrt;
+    u_int32_t cur[HDRT_NWORDS];
+
+    pciesvc_reg_rd32w(hdrt_addr(lif), cur, HDRT_NWORDS);
+    return (cur[0] == w[0] &&
+            cur[1] == w[1] &&
+            ((cur[2] ^ w[2]) & ~HDRT_W2_ECC_MASK) == 0);
+}
+
+/*
+ * Set a range of entries to the same value.  Writes are posted so
+ * issue the whole range back-to-back, then fence once with a
+ * readback of the last entry written.
+ */
 static void
-hdrt_set_itr(const u_int32_t lif, const u_int16_t bdf)
+hdrt_set_range(const u_int32_t lifb, const u_int32_t lifc, const hdrt_t *hdrt)
 {
-    hdrt_t h = { 0 };
+    u_int32_t fence[HDRT_NWORDS];
+    u_int32_t lif;
 
-    h.valid = 1;
-    h.bdf = bdf;
-    h.attr2_1_rd = 0x1; /* reads get Relaxed Ordering */
-    hdrt_set(lif, &h);
+    for (lif = lifb; lif < lifb + lifc; lif++) {
+        pciesvc_reg_wr32w(hdrt_addr(lif), (u_int32_t *)hdrt, HDRT_NWORDS);
+    }
+    if (lifc) {
+        pciesvc_reg_rd32w(hdrt_addr(lifb + lifc - 1), fence, HDRT_NWORDS);
+    }
 }
 
 /******************************************************************
@@ -50,10 +77,28 @@ pciehw_hdrt_load(const u_int32_t lifb,
                  const u_int32_t lifc,
                  const u_int16_t bdf)
 {
-    u_int32_t lif;
+    hdrt_t h = { 0 };
 
-    for (lif = lifb; lif < lifb + lifc; lif++) {
-        hdrt_set_itr(lif, bdf);
+    h.valid = 1;
+    h.bdf = bdf;
+    h.attr2_1_rd = 0x1; /* reads get Relaxed Ordering */
+
+    /*
+     * Every lif in the range loads the same entry value.  If the
+     * first entry already matches we are re-loading a table the hw
+     * retained across a warm restart (kexec); compare the rest and
+     * skip clean entries rather than rewriting the whole range.
+     */
+    if (lifc && hdrt_match(lifb, &h)) {
+        u_int32_t lif;
+
+        for (lif = lifb + 1; lif < lifb + lifc; lif++) {
+            if (!hdrt_match(lif, &h)) {
+                hdrt_set(lif, &h);
+            }
+        }
+    } else {
+        hdrt_set_range(lifb, lifc, &h);
     }
     return 0;
 }
@@ -62,10 +107,7 @@ int
 pciehw_hdrt_unload(const u_int32_t lifb, const u_int32_t lifc)
 {
     const hdrt_t h0 = { 0 };
-    u_int32_t lif;
 
-    for (lif = lifb; lif < lifb + lifc; lif++) {
-        hdrt_set(lif, &h0);
-    }
+    hdrt_set_range(lifb, lifc, &h0);
     return 0;
 }
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2022, Pensando Systems Inc.
+ */
+
+#include "pciesvc_impl.h"
+#include "hostwin.h"
+
+/*
+ * Read-only host window serving the log ring and per-port stats,
+ * layout described in hostwin.h.  The log records and stats live in
+ * shmem so they survive kexec with the rest of the service state;
+ * the header is synthesized per read from the layout constants.
+ */
+
+static void
+hostwin_init(pciehw_shmem_t *pshmem)
+{
+    if (!pshmem->hostwinvalid) {
+        /* first use (or new shmem from older fw), reset the ring */
+        pciesvc_memset(pshmem->hostwinlog, 0, sizeof(pshmem->hostwinlog));
+        pshmem->hostwinlogpi = 0;
+        pshmem->hostwinvalid = 1;
+    }
+}
+
+void
+hostwin_log(const int pri, const char *msg)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    pciehw_hostwinlog_t *ent;
+    u_int32_t pi;
+    int i;
+
+    hostwin_init(pshmem);
+
+    pi = pshmem->hostwinlogpi;
+    ent = &pshmem->hostwinlog[pi & (PCIEHW_NHOSTWINLOG - 1)];
+
+    ent->seq = pi;
+    ent->pri = pri;
+    for (i = 0; i < (int)sizeof(ent->msg) - 1 && msg[i]; i++) {
+        ent->msg[i] = msg[i];
+    }
+    ent->msg[i] = '\0';
+
+    pciesvc_mem_barrier(); /* record lands before the index names it */
+    pshmem->hostwinlogpi = pi + 1;
+}
+
+static u_int8_t
+hostwin_getbyte(pciehw_shmem_t *pshmem, const u_int64_t off)
+{
+    if (off < sizeof(hostwin_hdr_t)) {
+        hostwin_hdr_t hdr = {
+            .magic = HOSTWIN_MAGIC,
+            .version = HOSTWIN_VERSION,
+            .log_off = HOSTWIN_LOG_OFF,
+            .log_recsz = HOSTWIN_LOG_RECSZ,
+            .log_nrec = PCIEHW_NHOSTWINLOG,
+            .log_pi = pshmem->hostwinlogpi,
+            .stats_off = HOSTWIN_STATS_OFF,
+            .stats_stride = HOSTWIN_STATS_STRIDE,
+            .nports = PCIEHW_NPORTS,
+        };
+        return ((u_int8_t *)&hdr)[off];
+    }
+    if (off >= HOSTWIN_LOG_OFF && off < HOSTWIN_STATS_OFF) {
+        const u_int8_t *log = (const u_int8_t *)pshmem->hostwinlog;
+        return log[off - HOSTWIN_LOG_OFF];
+    }
+    if (off >= HOSTWIN_STATS_OFF && off < HOSTWIN_SIZE) {
+        const u_int64_t statsoff = off - HOSTWIN_STATS_OFF;
+        const int port = statsoff / HOSTWIN_STATS_STRIDE;
+        const u_int64_t portoff = statsoff % HOSTWIN_STATS_STRIDE;
+
+        if (portoff < sizeof(pciemgr_stats_t)) {
+            const u_int8_t *stats =
+                (const u_int8_t *)&pshmem->port[port].stats;
+            return stats[portoff];
+        }
+    }
+    return 0;
+}
+
+u_int64_t
+hostwin_barrd(pciehwdev_t *phwdev,
+              const u_int64_t baroff, const size_t size)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    u_int64_t val = 0;
+    size_t i;
+
+    if (size > sizeof(val) || baroff + size > HOSTWIN_SIZE) {
+        return ~0ULL;
+    }
+
+    hostwin_init(pshmem);
+
+    /* byte-wise gather, reads can straddle the region boundaries */
+    for (i = 0; i < size; i++) {
+        val |= (u_int64_t)hostwin_getbyte(pshmem, baroff + i) << (i * 8);
+    }
+    return val;
+}
@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2022, Pensando Systems Inc.
+ */
+
+#ifndef __HOSTWIN_H__
+#define __HOSTWIN_H__
+
+/*
+ * Read-only host window bar layout.  A bar page range with
+ * hnd=PCIEHW_BARHND_HOSTWIN serves this layout so host agents can
+ * tail the pciesvc log ring and the per-port stats counters without
+ * any command round trips:
+ *
+ *   0x0000  window header (hostwin_hdr_t)
+ *   0x1000  log ring records (PCIEHW_NHOSTWINLOG * 128 bytes)
+ *   0x9000  port 0 stats (pciemgr_stats_t), one page per port
+ *   ...
+ *
+ * The header carries the layout constants and the log producer
+ * index, so readers poll only the header page to find new records.
+ */
+
+#define HOSTWIN_MAGIC           0x50535643      /* "PSVC" */
+#define HOSTWIN_VERSION         1
+
+#define HOSTWIN_LOG_OFF         0x1000
+#define HOSTWIN_LOG_RECSZ       sizeof(pciehw_hostwinlog_t)
+#define HOSTWIN_LOG_SZ          (PCIEHW_NHOSTWINLOG * HOSTWIN_LOG_RECSZ)
+#define HOSTWIN_STATS_OFF       (HOSTWIN_LOG_OFF + HOSTWIN_LOG_SZ)
+#define HOSTWIN_STATS_STRIDE    0x1000
+#define HOSTWIN_SIZE            (HOSTWIN_STATS_OFF + \
+                                 PCIEHW_NPORTS * HOSTWIN_STATS_STRIDE)
+
+typedef struct hostwin_hdr_s {
+    u_int32_t magic;                    /* HOSTWIN_MAGIC */
+    u_int32_t version;                  /* HOSTWIN_VERSION */
+    u_int32_t log_off;                  /* offset of log ring */
+    u_int32_t log_recsz;                /* bytes per log record */
+    u_int32_t log_nrec;                 /* records in log ring */
+    u_int32_t log_pi;                   /* log producer index */
+    u_int32_t stats_off;                /* offset of port 0 stats */
+    u_int32_t stats_stride;             /* bytes between port stats */
+    u_int32_t nports;                   /* number of stats blocks */
+} hostwin_hdr_t;
+
+void
+hostwin_log(const int pri, const char *msg);
+
+u_int64_t
+hostwin_barrd(pciehwdev_t *phwdev,
+              const u_int64_t baroff, const size_t size);
+
+#endif /* __HOSTWIN_H__ */
@@ -13,11 +13,7 @@ intr_config(const u_int32_t intrb,
             const int legacy,
             const int fmask)
 {
-    u_int32_t intr;
-
-    for (intr = intrb; intr < intrb + intrc; intr++) {
-        intr_fwcfg_mode(intr, legacy, fmask);
-    }
+    intr_fwcfg_mode_range(intrb, intrc, legacy, fmask);
 }
 
 void
@@ -25,6 +21,20 @@ pciehw_intr_config(pciehwdev_t *phwdev, const int legacy, const int fmask)
 {
     int i;
 
+    /*
+     * Guest OSes rewrite the msix control word many times while
+     * setting up vectors (enable and maskall toggles, intx fallback),
+     * and every rewrite lands here with a full read-modify-write
+     * pass over all the device's intr resources.  Shadow the last
+     * mode applied and absorb the repeats; the reset path
+     * invalidates the shadow when it reprograms fwcfg underneath us.
+     */
+    if (phwdev->intrmodevalid &&
+        phwdev->intrmodelegacy == legacy &&
+        phwdev->intrmodefmask == fmask) {
+        return;
+    }
+
     if (phwdev->novrdintr) {
         for (i = 0; i < phwdev->novrdintr; i++) {
             const u_int32_t intrb = phwdev->ovrdintr[i].intrb;
@@ -35,4 +45,8 @@ pciehw_intr_config(pciehwdev_t *phwdev, const int legacy, const int fmask)
     } else {
         intr_config(phwdev->intrb, phwdev->intrc, legacy, fmask);
     }
+
+    phwdev->intrmodevalid = 1;
+    phwdev->intrmodelegacy = legacy;
+    phwdev->intrmodefmask = fmask;
 }
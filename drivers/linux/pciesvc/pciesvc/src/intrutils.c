@@ -32,6 +32,13 @@
 
 #define NWORDS(a)               (sizeof(a) / sizeof(u_int32_t))
 
+/*
+ * The assert, msixcfg, and fwcfg register groups are dense so a
+ * contiguous intr resource range maps to a contiguous register
+ * range and coalesces into wide writes of a few entries per run.
+ */
+#define INTR_RANGE_RUN          8 /* max entries per coalesced write */
+
 static u_int64_t
 intr_msixcfg_addr(const int intrb)
 {
@@ -68,6 +75,26 @@ intr_drvcfg_mask(const int intr, const int on)
     return omask;
 }
 
+/*
+ * Set the drvcfg_mask for a range of interrupt resources.
+ * The drvcfg entries are strided so the writes are issued
+ * individually, but posted; a single readback at the end
+ * fences the whole range.
+ */
+void
+intr_drvcfg_mask_range(const int intrb, const int intrc, const int on)
+{
+    int intr;
+
+    if (intrc <= 0) return;
+    for (intr = intrb; intr < intrb + intrc; intr++) {
+        pciesvc_reg_wr32(intr_drvcfg_addr(intr) +
+                         offsetof(intr_drvcfg_t, mask), on);
+    }
+    (void)pciesvc_reg_rd32(intr_drvcfg_addr(intrb + intrc - 1) +
+                           offsetof(intr_drvcfg_t, mask));
+}
+
 static void
 intr_msixcfg(const int intr,
              const u_int64_t msgaddr, const u_int32_t msgdata, const int vctrl)
@@ -111,6 +138,26 @@ intr_assert(const int intr)
     pciesvc_reg_wr32(pa, data);
 }
 
+/*
+ * Assert a contiguous range of interrupt resources.  The assert
+ * registers are dense so runs of entries go out as wide writes.
+ */
+void
+intr_assert_range(const int intrb, const int intrc)
+{
+    u_int32_t w[INTR_RANGE_RUN];
+    int intr, n, i;
+
+    for (i = 0; i < INTR_RANGE_RUN; i++) {
+        w[i] = intr_assert_data();
+    }
+    for (intr = intrb; intr < intrb + intrc; intr += n) {
+        n = intrb + intrc - intr;
+        if (n > INTR_RANGE_RUN) n = INTR_RANGE_RUN;
+        pciesvc_reg_wr32w(intr_assert_addr(intr), w, n);
+    }
+}
+
 /*
  * Change the mode of the interrupt between legacy and msi mode.
  *
@@ -123,19 +170,52 @@ intr_assert(const int intr)
 void
 intr_fwcfg_mode(const int intr, const int legacy, const int fmask)
 {
-    const u_int64_t pa = intr_fwcfg_addr(intr);
-    intr_fwcfg_t v;
-
-    /* mask via function_mask while making changes */
-    intr_fwcfg_set_function_mask(intr, 1);
-    {
-        pciesvc_reg_rd32w(pa, v.w, NWORDS(v.w));
-        v.legacy = legacy;
-        pciesvc_reg_wr32w(pa, v.w, NWORDS(v.w));
-    }
-    if (!fmask) {
-        intr_fwcfg_set_function_mask(intr, fmask);
+    intr_fwcfg_mode_range(intr, 1, legacy, fmask);
+}
+
+/*
+ * Change the mode of a range of interrupts, coalescing the
+ * config read-modify-write into runs of entries.  The
+ * function_mask set/clear writes stay per-entry to preserve
+ * the masked-while-changing sequence above.
+ */
+void
+intr_fwcfg_mode_range(const int intrb, const int intrc,
+                      const int legacy, const int fmask)
+{
+    u_int32_t w[2 * INTR_RANGE_RUN];
+    pciesvc_regwb_t wb;
+    int intr, n, i;
+
+    pciesvc_regwb_init(&wb);
+    for (intr = intrb; intr < intrb + intrc; intr += n) {
+        n = intrb + intrc - intr;
+        if (n > INTR_RANGE_RUN) n = INTR_RANGE_RUN;
+
+        /* mask via function_mask while making changes */
+        for (i = 0; i < n; i++) {
+            pciesvc_regwb_wr32(&wb, intr_fwcfg_addr(intr + i), 1);
+        }
+        /* masks land before the config changes they cover */
+        pciesvc_regwb_flush(&wb);
+        pciesvc_reg_rd32w(intr_fwcfg_addr(intr), w, n * 2);
+        for (i = 0; i < n; i++) {
+            intr_fwcfg_t v;
+
+            v.w[0] = w[i * 2];
+            v.w[1] = w[i * 2 + 1];
+            v.legacy = legacy;
+            w[i * 2] = v.w[0];
+            w[i * 2 + 1] = v.w[1];
+        }
+        pciesvc_reg_wr32w(intr_fwcfg_addr(intr), w, n * 2);
+        if (!fmask) {
+            for (i = 0; i < n; i++) {
+                pciesvc_regwb_wr32(&wb, intr_fwcfg_addr(intr + i), fmask);
+            }
+        }
     }
+    pciesvc_regwb_flush(&wb);
 }
 
 /*****************************************************************
@@ -176,6 +256,25 @@ intr_deassert(const int intr)
     intr_pba_clear(intr);
 }
 
+/*
+ * Deassert a contiguous range of interrupt resources.  Each
+ * entry needs a read-modify-write of its own credits register
+ * so there is nothing to coalesce, but the writes are posted
+ * and the trailing entry read fences the whole range.
+ */
+void
+intr_deassert_range(const int intrb, const int intrc)
+{
+    int intr;
+
+    if (intrc <= 0) return;
+    for (intr = intrb; intr < intrb + intrc; intr++) {
+        intr_pba_clear(intr);
+    }
+    (void)pciesvc_reg_rd32(intr_drvcfg_addr(intrb + intrc - 1) +
+                           offsetof(intr_drvcfg_t, int_credits));
+}
+
 /*****************
  * msixcfg
  */
@@ -185,20 +284,21 @@ intr_deassert(const int intr)
  * owned by the host OS and the behavior, including these reset values,
  * are specified by the PCIe spec.
  */
-static void
-reset_msixcfg(const int intr)
-{
-    /* clear msg addr/data, vector_ctrl mask=1 */
-    intr_msixcfg(intr, 0, 0, 1);
-}
-
 static void
 intr_reset_msixcfg(const int intrb, const int intrc)
 {
-    int intr;
+    /* clear msg addr/data, vector_ctrl mask=1, per entry */
+    u_int32_t w[4 * INTR_RANGE_RUN];
+    int intr, n, i;
 
-    for (intr = intrb; intr < intrb + intrc; intr++) {
-        reset_msixcfg(intr);
+    pciesvc_memset(w, 0, sizeof(w));
+    for (i = 0; i < INTR_RANGE_RUN; i++) {
+        w[i * 4 + 3] = 1;       /* vector_ctrl mask=1 */
+    }
+    for (intr = intrb; intr < intrb + intrc; intr += n) {
+        n = intrb + intrc - intr;
+        if (n > INTR_RANGE_RUN) n = INTR_RANGE_RUN;
+        pciesvc_reg_wr32w(intr_msixcfg_addr(intr), w, n * 4);
     }
 }
 
@@ -209,21 +309,11 @@ intr_reset_msixcfg(const int intrb, const int intrc)
 /*
  * Reset the interrupt "mode" to "legacy".
  */
-static void
-reset_mode(const int intr)
-{
-    /* reset to legacy mode, no fmask (CMD.int_disable == 0) */
-    intr_fwcfg_mode(intr, 1, 0);
-}
-
 static void
 intr_reset_mode(const int intrb, const int intrc)
 {
-    int intr;
-
-    for (intr = intrb; intr < intrb + intrc; intr++) {
-        reset_mode(intr);
-    }
+    /* reset to legacy mode, no fmask (CMD.int_disable == 0) */
+    intr_fwcfg_mode_range(intrb, intrc, 1, 0);
 }
 
 /*****************
@@ -64,6 +64,10 @@ typedef union intr_state_s {
 #define intr_deassert           _pciesvc_intr_deassert
 #define intr_drvcfg_mask        _pciesvc_intr_drvcfg_mask
 #define intr_fwcfg_mode         _pciesvc_intr_fwcfg_mode
+#define intr_assert_range       _pciesvc_intr_assert_range
+#define intr_deassert_range     _pciesvc_intr_deassert_range
+#define intr_drvcfg_mask_range  _pciesvc_intr_drvcfg_mask_range
+#define intr_fwcfg_mode_range   _pciesvc_intr_fwcfg_mode_range
 #define intr_reset_pci          _pciesvc_intr_reset_pci
 
 void intr_assert(const int intr);
@@ -71,6 +75,17 @@ void intr_deassert(const int intr);
 int intr_drvcfg_mask(const int intr, const int on);
 void intr_fwcfg_mode(const int intr, const int legacy, const int fmask);
 
+/*
+ * Range operations cover a contiguous block of intr resources,
+ * coalescing writes where the register group is dense and using
+ * a single trailing readback to fence the posted writes.
+ */
+void intr_assert_range(const int intrb, const int intrc);
+void intr_deassert_range(const int intrb, const int intrc);
+void intr_drvcfg_mask_range(const int intrb, const int intrc, const int on);
+void intr_fwcfg_mode_range(const int intrb, const int intrc,
+                           const int legacy, const int fmask);
+
 /*
  * intr_reset_pci() - reset the pcie managed register groups to default values,
  *                    use for pcie block resets (FLR, bus reset).
@@ -5,6 +5,7 @@
 
 #include "pciesvc_impl.h"
 #include "log.h"
+#include "hostwin.h"
 
 #ifdef PCIESVC_SYSTEM_EXTERN
 
@@ -21,6 +22,8 @@ logv(pciesvc_logpri_t pri, const char *fmt, va_list ap)
 
     pciesvc_vsnprintf(buf, sizeof(buf), fmt, ap);
 
+    hostwin_log(pri, buf);
+
     pciesvc_memset(&evd, 0, sizeof(evd));
     evd.evtype = PCIESVC_EV_LOGMSG;
     logmsg = &evd.logmsg;
@@ -69,6 +72,36 @@ pciesvc_logerror(const char *fmt, ...)
     va_end(ap);
 }
 
+/*
+ * Binary log record for hot paths: store the format id and raw
+ * args, no % formatting here.  Decode offline with
+ * tools/logbin_decode using pciesvc_logfmt_defs.h.
+ */
+void
+pciesvc_logbin(pciesvc_logpri_t pri, pciesvc_logfmt_t fmtid,
+               u_int64_t a0, u_int64_t a1, u_int64_t a2,
+               u_int64_t a3, u_int64_t a4)
+{
+    pciesvc_eventdata_t evd;
+    pciesvc_logbin_t *logbin;
+
+    if (pri < pciesvc_log_level) {
+        return;
+    }
+
+    pciesvc_memset(&evd, 0, sizeof(evd));
+    evd.evtype = PCIESVC_EV_LOGBIN;
+    logbin = &evd.logbin;
+    logbin->pri = pri;
+    logbin->fmtid = fmtid;
+    logbin->args[0] = a0;
+    logbin->args[1] = a1;
+    logbin->args[2] = a2;
+    logbin->args[3] = a3;
+    logbin->args[4] = a4;
+    pciesvc_event_handler(&evd, sizeof(evd));
+}
+
 void
 pciesvc_loglocal(const char *fmt, ...)
 {
@@ -78,6 +111,7 @@ pciesvc_loglocal(const char *fmt, ...)
     va_start(ap, fmt);
     pciesvc_vsnprintf(buf, sizeof(buf), fmt, ap);
     va_end(ap);
+    hostwin_log(PCIESVC_LOGPRI_INFO, buf);
     pciesvc_log(buf);
 }
 
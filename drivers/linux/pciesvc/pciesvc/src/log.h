@@ -25,6 +25,9 @@ void pciesvc_logwarn(const char *fmt, ...)
     __attribute__((format (printf, 1, 2)));
 void pciesvc_logerror(const char *fmt, ...)
     __attribute__((format (printf, 1, 2)));
+void pciesvc_logbin(pciesvc_logpri_t pri, pciesvc_logfmt_t fmtid,
+                    u_int64_t a0, u_int64_t a1, u_int64_t a2,
+                    u_int64_t a3, u_int64_t a4);
 
 #endif
 
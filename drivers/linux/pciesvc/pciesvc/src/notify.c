@@ -6,6 +6,7 @@
 #include "pciesvc_impl.h"
 #include "pcietlp.h"
 #include "req_int.h"
+#include "indirect.h"
 #include "notify.h"
 
 #define NOTIFY_EN               PXB_(CFG_TGT_NOTIFY_EN)
@@ -108,8 +109,56 @@ notify_ring_inc(const int idx, const int inc, const u_int32_t ring_mask)
     return (idx + inc) & ring_mask;
 }
 
+/* max ring drain passes per invocation, leftover entries re-raise */
+#define NOTIFY_DRAIN_PASSES     4
+
+/*
+ * Max entries serviced per polled invocation.  A notify flood can
+ * queue thousands of entries; without a budget one pciesvc_poll call
+ * drains them all and starves the rest of the polling context for
+ * milliseconds.  Leftover entries carry over to the next poll via
+ * the re-raised doorbell.
+ */
+#define NOTIFY_BUDGET           64
+
+/*
+ * Poll for indirect work every this many notify entries (power of 2).
+ * Indirect transactions hold host completions (cfg reads/writes stall
+ * the issuing core until answered) so they get priority service
+ * rather than waiting out a bulk notify drain.
+ */
+#define NOTIFY_IND_INTERLEAVE   16
+
+/*
+ * Return 1 if this entry is a config write identical to the
+ * previous entry (same target register, byte enables, and data,
+ * ignoring the transaction tag).  The hw updates config space
+ * before notifying, so by the time we process any entry of such
+ * a run the handler reads the same final register value and
+ * repeats the same work; dispatching once per run is equivalent.
+ * Guest boots hammer registers like the command register this way.
+ */
+static int
+notify_duplicate_cfgwr(const notify_entry_t *nentry,
+                       const notify_entry_t *prev)
+{
+    const pcie_tlp_cfg_t *a = (void *)nentry->rtlp;
+    const pcie_tlp_cfg_t *b = (void *)prev->rtlp;
+    const u_int32_t *adata = (void *)&nentry->rtlp[12];
+    const u_int32_t *bdata = (void *)&prev->rtlp[12];
+
+    return (a->type == b->type &&
+            a->bdf == b->bdf &&
+            a->reg == b->reg &&
+            a->extreg == b->extreg &&
+            a->fbe == b->fbe &&
+            a->lbe == b->lbe &&
+            *adata == *bdata);
+}
+
 static void
-handle_notify(const int port, pciehw_port_t *p, notify_entry_t *nentry)
+handle_notify(const int port, pciehw_port_t *p, notify_entry_t *nentry,
+              notify_entry_t *prev, int *prevvalid)
 {
     const tlpauxinfo_t *info = &nentry->info;
 
@@ -120,9 +169,12 @@ handle_notify(const int port, pciehw_port_t *p, notify_entry_t *nentry)
      * If info->indirect_reason != 0 then perhaps
      * this is an exception or error.  Track reason code stats.
      */
+    const int wasvalid = *prevvalid;
+
+    *prevvalid = 0;
     if (info->indirect_reason == 0) {
         const u_int32_t pmti = info->pmti;
-        pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
+        pciehw_spmtctr_t *ctr = pciesvc_spmtctr_get(pmti);
         const pcie_tlp_common_hdr_t *hdr = (void *)nentry->rtlp;
         const u_int8_t tlp_type = hdr->type;
 
@@ -130,42 +182,47 @@ handle_notify(const int port, pciehw_port_t *p, notify_entry_t *nentry)
         case PCIE_TLP_TYPE_CFGRD0:
         case PCIE_TLP_TYPE_CFGRD1:
             pciehw_cfgrd_notify(port, nentry);
-            spmt->swrd++;
+            ctr->swrd++;
             p->stats.not_cfgrd++;
             break;
         case PCIE_TLP_TYPE_CFGWR0:
         case PCIE_TLP_TYPE_CFGWR1:
-            pciehw_cfgwr_notify(port, nentry);
-            spmt->swwr++;
+            if (wasvalid && notify_duplicate_cfgwr(nentry, prev)) {
+                p->stats.not_dupcfgwr++;
+            } else {
+                pciehw_cfgwr_notify(port, nentry);
+            }
+            pciesvc_memcpy(prev, nentry, sizeof(*prev));
+            *prevvalid = 1;
+            ctr->swwr++;
             p->stats.not_cfgwr++;
             break;
         case PCIE_TLP_TYPE_MEMRD:
         case PCIE_TLP_TYPE_MEMRD64:
             pciehw_barrd_notify(port, nentry);
-            spmt->swrd++;
+            ctr->swrd++;
             p->stats.not_memrd++;
             break;
         case PCIE_TLP_TYPE_MEMWR:
         case PCIE_TLP_TYPE_MEMWR64:
             pciehw_barwr_notify(port, nentry);
-            spmt->swwr++;
+            ctr->swwr++;
             p->stats.not_memwr++;
             break;
         case PCIE_TLP_TYPE_IORD:
             pciehw_barrd_notify(port, nentry);
-            spmt->swrd++;
+            ctr->swrd++;
             p->stats.not_iord++;
             break;
         case PCIE_TLP_TYPE_IOWR:
             pciehw_barwr_notify(port, nentry);
-            spmt->swwr++;
+            ctr->swwr++;
             p->stats.not_iowr++;
             break;
         default:
             p->stats.not_unknown++;
             break;
         }
-        pciesvc_spmt_put(spmt, DIRTY);
     } else {
         uint64_t *notify_reasons = &p->stats.notify_reason_stats;
         notify_reasons[info->indirect_reason]++;
@@ -187,14 +244,66 @@ pciehw_notify_intr_init(const int port, u_int64_t msgaddr, u_int32_t msgdata)
                         msgaddr, msgdata | MSGDATA_ADD_PORT);
 }
 
+/*
+ * Negotiate a deeper notify ring.  The ring memory is the fixed
+ * notify_area carve-out, so depth can grow up to the entries that
+ * fit there; fw typically programs a smaller initial size.  The
+ * size register and the shmem ring mask are global across ports.
+ * The pi/ci index math changes with the mask, so resize requires an
+ * empty ring; this runs from pciesvc_init before transactions are
+ * flowing, ahead of any cached copy of the mask.
+ */
+int
+pciehw_notify_ring_resize(const int port, const u_int32_t depth)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    const u_int32_t maxdepth = PCIEHW_NOTIFYSZ / sizeof(notify_entry_t);
+    int pi, ci;
+
+    if (depth < 2 || depth > maxdepth || (depth & (depth - 1))) {
+        pciesvc_logerror("notify_ring_resize: bad depth %u (max %u)\n",
+                         depth, maxdepth);
+        return -1;
+    }
+    if (depth == pshmem->notify_ring_mask + 1) {
+        return 0;               /* already this deep */
+    }
+
+    notify_get_pici(port, &pi, &ci);
+    if (pi != ci) {
+        pciesvc_logwarn("notify_ring_resize: ring not empty, keeping %u\n",
+                        pshmem->notify_ring_mask + 1);
+        return -1;
+    }
+
+    pciesvc_reg_wr32(NOTIFY_RING_SIZE, depth);
+    pshmem->notify_ring_mask = depth - 1;
+    pciesvc_loginfo("notify ring resized to %u entries\n", depth);
+    return 0;
+}
+
 static int
 pciehw_notify_handle(const int port, const int polled)
 {
-    pciehw_port_t *p = pciesvc_port_get(port);
+    static int busy[PCIEHW_NPORTS];
+    pciehw_port_t *p;
     const u_int32_t ring_mask = pciesvc_notify_ring_mask(port);
-    int r, pi, ci, i, endidx;
+    notify_entry_t prevbuf;
+    int prevvalid;
+    int r, pi, ci, i, endidx, passes;
+    int budget = polled ? NOTIFY_BUDGET : -1;
+    int worked = 0;
     u_int32_t pici_delta;
 
+    /*
+     * No reentry from transaction polls interleaved in long handlers.
+     * Per-port so concurrent servicing contexts for different ports
+     * don't stall each other.
+     */
+    if (busy[port]) return 0;
+    busy[port] = 1;
+
+    p = pciesvc_port_get(port);
     p->stats.not_intr++;
     if (polled) p->stats.not_polled++;
 
@@ -204,36 +313,85 @@ pciehw_notify_handle(const int port, const int polled)
         r = 0; /* not our intr */
         goto out;
     }
+    r = 1; /* handled intr */
 
-    pici_delta = notify_pici_delta(pi, ci, ring_mask);
+    /*
+     * Drain the ring, then check for entries that arrived while
+     * we were processing and drain those too, so a busy ring
+     * doesn't pay an interrupt round trip per batch.  Bounded so
+     * a continuous stream can't pin us here; leftover entries
+     * raise a new interrupt (or get picked up by the next poll).
+     */
+    for (passes = 0; passes < NOTIFY_DRAIN_PASSES; passes++) {
+        pici_delta = notify_pici_delta(pi, ci, ring_mask);
 
-    p->stats.not_cnt += pici_delta;
-    if (pici_delta > p->stats.not_max) {
-        p->stats.not_max = pici_delta;
-    }
+        p->stats.not_cnt += pici_delta;
+        if (pici_delta > p->stats.not_max) {
+            p->stats.not_max = pici_delta;
+        }
+        /* occupancy high-watermark hit capacity, size the ring up */
+        if (pici_delta >= ring_mask) {
+            p->stats.not_full++;
+        }
 
-    endidx = notify_ring_inc(pi, 1, ring_mask);
-    for (i = notify_ring_inc(ci, 1, ring_mask);
-         i != endidx;
-         i = notify_ring_inc(i, 1, ring_mask)) {
-        notify_entry_t *nentry;
+        prevvalid = 0;
+        endidx = notify_ring_inc(pi, 1, ring_mask);
+        for (i = notify_ring_inc(ci, 1, ring_mask);
+             i != endidx;
+             i = notify_ring_inc(i, 1, ring_mask)) {
+            notify_entry_t *nentry;
+            const u_int64_t t0 = pciesvc_cycles();
+
+            nentry = pciesvc_notify_ring_get(port, i);
+            /*
+             * Start the next entry's line fill now; an entry is one
+             * cacheline (tlp + aux info) so one hint covers it.
+             * Past the producer this prefetches a stale entry,
+             * which is harmless.
+             */
+            pciesvc_prefetch_rd(
+                pciesvc_notify_ring_get(port,
+                                        notify_ring_inc(i, 1, ring_mask)));
+            handle_notify(port, p, nentry, &prevbuf, &prevvalid);
+            pciesvc_notify_ring_put(nentry);
+
+            /* log2 service latency histogram */
+            (&p->stats.not_latency_stats)
+                [pciesvc_lat_bucket(pciesvc_cycles() - t0)]++;
+
+            /* return some slots occasionally while processing */
+            if ((i & 0xff) == 0) {
+                notify_set_ci(port, i);
+            }
+
+            /* priority service for host-blocking indirect work */
+            if ((++worked & (NOTIFY_IND_INTERLEAVE - 1)) == 0) {
+                pciehw_indirect_poll(port);
+            }
+
+            /*
+             * Budget exhausted.  Return ci for what we consumed and
+             * re-raise our doorbell so the next poll resumes here;
+             * keeps event-loop latency bounded under a notify flood.
+             */
+            if (budget > 0 && --budget == 0) {
+                notify_set_ci(port, i);
+                pciesvc_notify_intr_dest_wr(port, 1);
+                p->stats.not_budget++;
+                goto out;
+            }
+        }
 
-        nentry = pciesvc_notify_ring_get(port, i);
-        handle_notify(port, p, nentry);
-        pciesvc_notify_ring_put(nentry);
+        /* we consumed these, adjust ci */
+        notify_set_ci(port, pi);
 
-        /* return some slots occasionally while processing */
-        if ((i & 0xff) == 0) {
-            notify_set_ci(port, i);
-        }
+        notify_get_masked_pici(port, &pi, &ci, ring_mask);
+        if (ci == pi) break;
     }
 
-    /* we consumed these, adjust ci */
-    notify_set_ci(port, pi);
-    r = 1; /* handled intr */
-
  out:
     pciesvc_port_put(p, DIRTY);
+    busy[port] = 0;
     return r;
 }
 
@@ -243,6 +401,27 @@ pciehw_notify_intr(const int port)
     return pciehw_notify_handle(port, 0);
 }
 
+/*
+ * Bench/replay entry: dispatch a synthetic entry through the same
+ * path as ring entries.  The caller supplies the entry (e.g. one
+ * recorded from a live enumeration); write tlps mutate device state
+ * exactly as the original host access would.
+ */
+int
+pciehw_notify_inject(const int port, notify_entry_t *nentry)
+{
+    pciehw_port_t *p;
+    notify_entry_t prevbuf;
+    int prevvalid = 0;
+
+    if (port < 0 || port >= PCIEHW_NPORTS) return -1;
+
+    p = pciesvc_port_get(port);
+    handle_notify(port, p, nentry, &prevbuf, &prevvalid);
+    pciesvc_port_put(p, DIRTY);
+    return 0;
+}
+
 /*
  * Arrange to have the notify interrupt written to memory,
  * then we can poll memory locations to see if there is work to do.
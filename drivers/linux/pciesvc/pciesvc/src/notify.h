@@ -13,5 +13,7 @@ int pciehw_notify_poll(const int port);
 int pciehw_notify_intr_init(const int port,
                             u_int64_t msgaddr, u_int32_t msgdata);
 int pciehw_notify_intr(const int port);
+int pciehw_notify_inject(const int port, notify_entry_t *nentry);
+int pciehw_notify_ring_resize(const int port, const u_int32_t depth);
 
 #endif /* __NOTIFY_H__ */
@@ -4,8 +4,10 @@
  */
 
 #include "pciesvc_impl.h"
+#include "pciesvc_local.h"
 #include "indirect.h"
 #include "notify.h"
+#include "portcfg.h"
 
 int pciesvc_version_major = PCIESVC_VERSION_MAJ;
 int pciesvc_version_minor = PCIESVC_VERSION_MIN;
@@ -26,10 +28,71 @@ typedef struct pciesvc_lparams_s {
     uint32_t    ind_msgdata;            /* ind_intr=1: intr msg data */
     uint64_t    not_msgaddr;            /* not_intr=1: intr msg addr */
     uint32_t    not_msgdata;            /* not_intr=1: intr msg addr */
+    uint32_t    not_ring_depth;         /* notify ring entries, 0=keep */
 } pciesvc_lparams_t;
 
 static pciesvc_lparams_t lparams[PCIEHW_NPORTS];
 
+/*
+ * Kexec handoff restore.  The dirty summary in shmem marks the
+ * devices and pmt range a previous service instance had multi-step
+ * updates in flight on; revalidate only those, so a clean handoff
+ * costs a few memory reads instead of full-image processing.
+ */
+static void
+pciesvc_handoff_restore(const int port)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    u_int32_t i, pmti;
+
+    if (!pshmem->handoffvalid) {
+        /* first use (or new shmem from older fw), reset the summary */
+        pciesvc_memset(pshmem->devdirty, 0, sizeof(pshmem->devdirty));
+        pshmem->pmtdirtyb = 0;
+        pshmem->pmtdirtyc = 0;
+        pciesvc_mem_barrier();
+        pshmem->handoffvalid = 1;
+        return;
+    }
+
+    /* reinstall pmt entries a previous service left mid-commit */
+    if (pshmem->pmtdirtyc &&
+        pshmem->pmtdirtyb + pshmem->pmtdirtyc <= PCIEHW_NPMT) {
+        const u_int32_t pmtb = pshmem->pmtdirtyb;
+        const u_int32_t pmtc = pshmem->pmtdirtyc;
+
+        for (pmti = pmtb; pmti < pmtb + pmtc; pmti++) {
+            pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
+
+            if (spmt->loaded) {
+                pmt_set(pmti, &spmt->pmt);
+            }
+            pciesvc_spmt_put(spmt, CLEAN);
+        }
+    }
+    pciesvc_pmtdirty_clear();
+
+    /* finish sriov ctrl changes left in flight on this port */
+    for (i = 0; i < PCIEHW_DIRTYMAPSZ; i++) {
+        u_int32_t w = pshmem->devdirty[i];
+
+        while (w) {
+            const int bit = pciesvc_ffs(w) - 1;
+            const pciehwdevh_t hwdevh = (i << 5) + bit;
+            pciehwdev_t *phwdev = pciehwdev_get(hwdevh);
+
+            w &= ~(1u << bit);
+            if (phwdev->port != port) {
+                pciehwdev_put(phwdev, CLEAN);
+                continue;
+            }
+            pciehw_sriov_resume(phwdev);
+            pciehwdev_put(phwdev, DIRTY);
+            pciesvc_devdirty_clr(hwdevh);
+        }
+    }
+}
+
 static pciesvc_lparams_t *
 params_v0_to_lparams(pciesvc_params_v0_t *p)
 {
@@ -84,6 +147,7 @@ params_v0_to_lparams(pciesvc_params_v0_t *p)
     lp->ind_msgdata = p->ind_msgdata;
     lp->not_msgaddr = p->not_msgaddr;
     lp->not_msgdata = p->not_msgdata;
+    lp->not_ring_depth = p->not_ring_depth;
     lp->valid = 1;
     return lp;
 }
@@ -135,11 +199,25 @@ pciesvc_init(pciesvc_params_t *params)
     lp = params_to_lparams(params);
     if (lp == NULL) goto err_out;
 
+    /* host may have reprogrammed the port while we weren't running */
+    portcfg_shadow_inval(lp->port);
+    pciehw_bdfmap_inval();
+
+    /* complete updates a previous service instance left in flight */
+    pciesvc_handoff_restore(lp->port);
+
+    /* deeper notify ring if requested; keep the fw size on failure */
+    if (lp->not_ring_depth) {
+        pciehw_notify_ring_resize(lp->port, lp->not_ring_depth);
+    }
+
     if (lp->ind_poll) {
         if ((r = pciesvc_indirect_poll_init(lp->port)) < 0) {
             pciesvc_loglocal("indirect_poll_init failed: %d\n", r);
             goto err_out;
         }
+        /* prime the doorbell; work may predate doorbell steering */
+        pciesvc_indirect_intr_dest_wr(lp->port, 1);
     } else if (lp->ind_intr) {
         if ((r = pciesvc_indirect_intr_init(lp->port,
                                             lp->ind_msgaddr,
@@ -154,6 +232,8 @@ pciesvc_init(pciesvc_params_t *params)
             pciesvc_loglocal("indirect_poll_init failed: %d\n", r);
             goto err_out;
         }
+        /* prime the doorbell; work may predate doorbell steering */
+        pciesvc_notify_intr_dest_wr(lp->port, 1);
     } else if (lp->not_intr) {
         if ((r = pciesvc_notify_intr_init(lp->port,
                                           lp->not_msgaddr,
@@ -199,18 +279,48 @@ int
 pciesvc_poll(const int port)
 {
     pciesvc_lparams_t *lp;
+    int ind_db, not_db;
     int ind_poll = 0;
     int not_poll = 0;
+    int cmd_poll = 0;
 
     if (port < 0 || port >= PCIEHW_NPORTS) return -1;
 
     lp = &lparams[port];
     if (!lp->valid) return -1;
 
-    ind_poll = pciesvc_indirect_poll(lp->port);
-    not_poll = pciesvc_notify_poll(lp->port);
+    /*
+     * In poll mode the request interrupts are steered to memory
+     * doorbells (the *_intr_dest words in pciehw_mem_t), so check
+     * those first and an idle poll costs two memory reads instead
+     * of two uncached register reads.  Consume every raised doorbell
+     * up front with a single fence, then service; hw raises a
+     * doorbell again for work that arrives while we drain.
+     */
+    ind_db = lp->ind_poll ? (pciesvc_indirect_intr_dest_rd(port) != 0) : 1;
+    not_db = lp->not_poll ? (pciesvc_notify_intr_dest_rd(port) != 0) : 1;
+
+    if (lp->ind_poll && ind_db) {
+        pciesvc_indirect_intr_dest_wr(port, 0);
+    }
+    if (lp->not_poll && not_db) {
+        pciesvc_notify_intr_dest_wr(port, 0);
+    }
+    if ((lp->ind_poll && ind_db) || (lp->not_poll && not_db)) {
+        pciesvc_mem_barrier();
+    }
+
+    if (ind_db) ind_poll = pciesvc_indirect_poll(lp->port);
+    if (not_db) not_poll = pciesvc_notify_poll(lp->port);
+
+    cmd_poll = pciesvc_cmd_poll();
+
+    if (!ind_poll && !not_poll && !cmd_poll) {
+        /* idle, spend the slack on tcam reordering */
+        pciehw_pmt_reorder_idle();
+    }
 
-    return (ind_poll || not_poll);
+    return (ind_poll || not_poll || cmd_poll);
 }
 
 void
@@ -37,6 +37,7 @@ void pciehw_barwr_notify(const int port, notify_entry_t *nentry);
 
 enum pciesvc_rsttype_e; typedef enum pciesvc_rsttype_e pciesvc_rsttype_t;
 void pciehw_cfg_reset(pciehwdev_t *phwdev, const pciesvc_rsttype_t rsttype);
+void pciehw_bdfmap_inval(void);
 
 u_int64_t pciehw_bar_getsize(pciehwbar_t *phwbar);
 void pciehw_bar_setaddr(pciehwbar_t *phwbar, const u_int64_t addr);
@@ -86,6 +87,82 @@ pciesvc_reg_wr64(const uint64_t pa, const uint64_t val)
     pciesvc_reg_wr32w(pa, w, 2);
 }
 
+/*
+ * Register write buffer.  Queue register writes locally, then flush
+ * them as a run of posted writes completed by a single readback of
+ * the last register written, so a multi-register update pays one
+ * ordering stall instead of one per access.  Writes are issued in
+ * queue order; a read of a queued register (read-after-write hazard)
+ * drains the buffer first so it observes program order.
+ */
+#define PCIESVC_REGWB_NENTRIES  32
+
+typedef struct pciesvc_regwb_s {
+    int count;
+    struct {
+        uint64_t pa;
+        uint32_t val;
+    } ent[PCIESVC_REGWB_NENTRIES];
+} pciesvc_regwb_t;
+
+static inline void
+pciesvc_regwb_init(pciesvc_regwb_t *wb)
+{
+    wb->count = 0;
+}
+
+static inline void
+pciesvc_regwb_flush(pciesvc_regwb_t *wb)
+{
+    int i;
+
+    if (wb->count == 0) return;
+    for (i = 0; i < wb->count; i++) {
+        pciesvc_reg_wr32(wb->ent[i].pa, wb->ent[i].val);
+    }
+    /* one fence for the run: readback of the last write */
+    (void)pciesvc_reg_rd32(wb->ent[wb->count - 1].pa);
+    wb->count = 0;
+}
+
+static inline void
+pciesvc_regwb_wr32(pciesvc_regwb_t *wb,
+                   const uint64_t pa, const uint32_t val)
+{
+    if (wb->count == PCIESVC_REGWB_NENTRIES) {
+        pciesvc_regwb_flush(wb);
+    }
+    wb->ent[wb->count].pa = pa;
+    wb->ent[wb->count].val = val;
+    wb->count++;
+}
+
+static inline void
+pciesvc_regwb_wr32w(pciesvc_regwb_t *wb,
+                    const uint64_t pa, const uint32_t *w, const uint32_t nw)
+{
+    int i;
+
+    for (i = 0; i < nw; i++) {
+        pciesvc_regwb_wr32(wb, pa + (i * 4), w[i]);
+    }
+}
+
+static inline uint32_t
+pciesvc_regwb_rd32(pciesvc_regwb_t *wb, const uint64_t pa)
+{
+    int i;
+
+    /* read-after-write hazard: drain queued writes first */
+    for (i = 0; i < wb->count; i++) {
+        if (wb->ent[i].pa == pa) {
+            pciesvc_regwb_flush(wb);
+            break;
+        }
+    }
+    return pciesvc_reg_rd32(pa);
+}
+
 static inline uint64_t
 pciesvc_indirect_intr_dest_pa(const int port)
 {
@@ -114,6 +191,38 @@ pciesvc_notify_intr_dest_pa(const int port)
     return intr_dest_pa[port];
 }
 
+static inline uint32_t
+pciesvc_indirect_intr_dest_rd(const int port)
+{
+    pciehw_mem_t *phwmem = pciesvc_hwmem_get();
+
+    return phwmem->indirect_intr_dest[port];
+}
+
+static inline void
+pciesvc_indirect_intr_dest_wr(const int port, const uint32_t val)
+{
+    pciehw_mem_t *phwmem = pciesvc_hwmem_get();
+
+    phwmem->indirect_intr_dest[port] = val;
+}
+
+static inline uint32_t
+pciesvc_notify_intr_dest_rd(const int port)
+{
+    pciehw_mem_t *phwmem = pciesvc_hwmem_get();
+
+    return phwmem->notify_intr_dest[port];
+}
+
+static inline void
+pciesvc_notify_intr_dest_wr(const int port, const uint32_t val)
+{
+    pciehw_mem_t *phwmem = pciesvc_hwmem_get();
+
+    phwmem->notify_intr_dest[port] = val;
+}
+
 static inline uint64_t
 pciesvc_cfgcur_pa(void)
 {
@@ -138,6 +247,18 @@ pciesvc_notify_ring_mask(const int port)
     return ring_mask;
 }
 
+/*
+ * Hint the cpu to start fetching addr.  Transaction handling is a
+ * chain of dependent reads, so starting the next ring entry's line
+ * fill while the current one is serviced hides most of the miss
+ * latency.  Compiles to prfm on arm64, a no-op where unsupported.
+ */
+static inline void
+pciesvc_prefetch_rd(const void *addr)
+{
+    __builtin_prefetch(addr, 0 /* read */, 0 /* low temporal reuse */);
+}
+
 static inline notify_entry_t *
 pciesvc_notify_ring_get(const int port, const int idx)
 {
@@ -209,6 +330,119 @@ pciesvc_spmt_get(const int idx)
     return &pshmem->spmt[idx];
 }
 
+/* service latency histogram buckets (pciemgr_stats *_lat0..15) */
+#define PCIESVC_NLATBKT 16
+
+static inline uint64_t
+pciesvc_cycles(void)
+{
+#ifdef __aarch64__
+    uint64_t t;
+
+    asm volatile("mrs %0, cntvct_el0" : "=r" (t));
+    return t;
+#else
+    return 0;
+#endif
+}
+
+static inline int
+pciesvc_lat_bucket(const uint64_t cycles)
+{
+    uint64_t v = cycles;
+    int b = 0;
+
+    while (v > 1 && b < PCIESVC_NLATBKT - 1) {
+        v >>= 1;
+        b++;
+    }
+    return b;
+}
+
+/*
+ * Kexec handoff dirty summary (see pcieshmem.h).  Set marks before
+ * starting a multi-step update, clear them after the update lands;
+ * pciesvc_init in the next kernel revalidates only what is marked.
+ */
+static inline void
+pciesvc_handoff_init(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    if (!pshmem->handoffvalid) {
+        /* first use (or new shmem from older fw), reset the summary */
+        pciesvc_memset(pshmem->devdirty, 0, sizeof(pshmem->devdirty));
+        pshmem->pmtdirtyb = 0;
+        pshmem->pmtdirtyc = 0;
+        pciesvc_mem_barrier();
+        pshmem->handoffvalid = 1;
+    }
+}
+
+static inline void
+pciesvc_devdirty_set(const pciehwdevh_t hwdevh)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    pciesvc_handoff_init();
+    pshmem->devdirty[hwdevh >> 5] |= 1u << (hwdevh & 31);
+    pciesvc_mem_barrier(); /* mark lands before the work it covers */
+}
+
+static inline void
+pciesvc_devdirty_clr(const pciehwdevh_t hwdevh)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    pciesvc_mem_barrier(); /* work lands before the mark clears */
+    pshmem->devdirty[hwdevh >> 5] &= ~(1u << (hwdevh & 31));
+}
+
+static inline void
+pciesvc_pmtdirty_mark(const u_int32_t pmtb, const u_int32_t pmtc)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    pciesvc_handoff_init();
+    if (pshmem->pmtdirtyc == 0) {
+        pshmem->pmtdirtyb = pmtb;
+        pshmem->pmtdirtyc = pmtc;
+    } else {
+        /* widen the existing range to cover this one */
+        const u_int32_t b =
+            pshmem->pmtdirtyb < pmtb ? pshmem->pmtdirtyb : pmtb;
+        const u_int32_t e1 = pshmem->pmtdirtyb + pshmem->pmtdirtyc;
+        const u_int32_t e2 = pmtb + pmtc;
+
+        pshmem->pmtdirtyb = b;
+        pshmem->pmtdirtyc = (e1 > e2 ? e1 : e2) - b;
+    }
+    pciesvc_mem_barrier(); /* mark lands before the work it covers */
+}
+
+static inline void
+pciesvc_pmtdirty_clear(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    pciesvc_mem_barrier(); /* work lands before the mark clears */
+    pshmem->pmtdirtyb = 0;
+    pshmem->pmtdirtyc = 0;
+}
+
+static inline pciehw_spmtctr_t *
+pciesvc_spmtctr_get(const int idx)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    if (!pshmem->spmtctrvalid) {
+        /* first use (or new shmem from older fw), reset the counters */
+        pciesvc_memset(pshmem->spmtctr, 0, sizeof(pshmem->spmtctr));
+        pshmem->spmtctrvalid = 1;
+    }
+    return &pshmem->spmtctr[idx];
+}
+
 static inline void
 pciesvc_spmt_put(const pciehw_spmt_t *spmt, const int dirty)
 {
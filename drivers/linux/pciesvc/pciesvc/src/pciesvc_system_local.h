@@ -47,6 +47,8 @@
 #define pciesvc_be16toh         be16toh
 #define pciesvc_htole32         htole32
 #define pciesvc_le32toh         le32toh
+#define pciesvc_htole16         htole16
+#define pciesvc_le16toh         le16toh
 
 #define pciesvc_loglocal        pciesys_loginfo
 
@@ -70,6 +72,25 @@
         pciesys_logerror(args); \
     } } while(0)
 
+/* local builds have cheap formatting, expand binary logs inline */
+static inline const char *
+pciesvc_logfmt_str(const int fmtid)
+{
+    switch (fmtid) {
+#define PCIESVC_LOGFMT_DEF(id, fmt) case id: return fmt;
+#include "pciesvc_logfmt_defs.h"
+    default: break;
+    }
+    return "unknown fmtid\n";
+}
+
+#define pciesvc_logbin(pri, fmtid, a0, a1, a2, a3, a4) do { \
+    if ((pri) >= pciesvc_log_level) { \
+        pciesys_loginfo(pciesvc_logfmt_str(fmtid), \
+                        (u_int64_t)(a0), (u_int64_t)(a1), (u_int64_t)(a2), \
+                        (u_int64_t)(a3), (u_int64_t)(a4)); \
+    } } while(0)
+
 typedef union {
     u_int32_t l;
     u_int16_t h[2];
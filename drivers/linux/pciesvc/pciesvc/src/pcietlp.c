@@ -326,329 +326,145 @@ decode_mem64_hdr(pcie_stlp_t *stlp, const void *rtlp)
 }
 
 /******************************************************************
- * CFG
+ * tlp attributes
+ *
+ * Decode dispatches on the raw tlp fmt/type byte through
+ * tlp_attrtab, encode on the stlp type through tlp_enctab.
+ * The tables hold precomputed header sizes and layout attributes
+ * so both paths run the same short sequence for every transaction
+ * type instead of per-type parse chains, which keeps the hot
+ * decode path branch-predictable under mixed traffic.  The tables
+ * hold attributes only, no pointers, so the module stays free of
+ * absolute relocations (see tools/reloc_check).
  */
 
-static int
-encode_cfgrd(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 12;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("cfgrd: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-    if (stlp->size > 4) {
-        return pcietlp_set_error("cfgrd: size %d > 4", stlp->size);
-    }
-
-    encode_cfg_hdr(stlp, PCIE_TLP_TYPE_CFGRD0, rtlp);
-    return tlpsz;
-}
-
-static int
-decode_cfgrd(pcie_stlp_t *stlp, const void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 12;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("cfgrd: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-
-    decode_cfg_hdr(stlp, rtlp);
-    return tlpsz;
-}
+#define TLP_ATTR_VALID   0x01   /* recognized transaction type */
+#define TLP_ATTR_CFG     0x02   /* cfg header, bdf/reg target */
+#define TLP_ATTR_ADDR64  0x04   /* 4dw header, 64-bit address */
+#define TLP_ATTR_DATA    0x08   /* carries write data */
+#define TLP_ATTR_VARLEN  0x10   /* data length from header */
+
+typedef struct tlp_attr_s {
+    u_int8_t stlp_type;         /* PCIE_STLP_* */
+    u_int8_t hdrsz;             /* header size in bytes */
+    u_int8_t attr;              /* TLP_ATTR_* */
+} tlp_attr_t;
+
+/* decode attributes, indexed by the raw tlp fmt/type byte */
+static const tlp_attr_t tlp_attrtab[256] = {
+    [PCIE_TLP_TYPE_MEMRD] = {
+        PCIE_STLP_MEMRD, 12,
+        TLP_ATTR_VALID },
+    [PCIE_TLP_TYPE_MEMRD64] = {
+        PCIE_STLP_MEMRD64, 16,
+        TLP_ATTR_VALID | TLP_ATTR_ADDR64 },
+    [PCIE_TLP_TYPE_MEMWR] = {
+        PCIE_STLP_MEMWR, 12,
+        TLP_ATTR_VALID | TLP_ATTR_DATA | TLP_ATTR_VARLEN },
+    [PCIE_TLP_TYPE_MEMWR64] = {
+        PCIE_STLP_MEMWR64, 16,
+        TLP_ATTR_VALID | TLP_ATTR_ADDR64 | TLP_ATTR_DATA | TLP_ATTR_VARLEN },
+    [PCIE_TLP_TYPE_IORD] = {
+        PCIE_STLP_IORD, 12,
+        TLP_ATTR_VALID },
+    [PCIE_TLP_TYPE_IOWR] = {
+        PCIE_STLP_IOWR, 12,
+        TLP_ATTR_VALID | TLP_ATTR_DATA },
+    [PCIE_TLP_TYPE_CFGRD0] = {
+        PCIE_STLP_CFGRD, 12,
+        TLP_ATTR_VALID | TLP_ATTR_CFG },
+    [PCIE_TLP_TYPE_CFGWR0] = {
+        PCIE_STLP_CFGWR, 12,
+        TLP_ATTR_VALID | TLP_ATTR_CFG | TLP_ATTR_DATA },
+    [PCIE_TLP_TYPE_CFGRD1] = {
+        PCIE_STLP_CFGRD1, 12,
+        TLP_ATTR_VALID | TLP_ATTR_CFG },
+    [PCIE_TLP_TYPE_CFGWR1] = {
+        PCIE_STLP_CFGWR1, 12,
+        TLP_ATTR_VALID | TLP_ATTR_CFG | TLP_ATTR_DATA },
+};
+
+typedef struct tlp_enc_s {
+    u_int8_t tlp_type;          /* PCIE_TLP_TYPE_* for the header */
+    u_int8_t hdrsz;             /* header size in bytes */
+    u_int8_t maxsz;             /* max stlp->size, 0 = unlimited */
+    u_int8_t attr;              /* TLP_ATTR_* */
+} tlp_enc_t;
+
+/* encode templates, indexed by the stlp type */
+static const tlp_enc_t tlp_enctab[PCIE_STLP_MSGD + 1] = {
+    [PCIE_STLP_CFGRD] = {
+        PCIE_TLP_TYPE_CFGRD0, 12, 4,
+        TLP_ATTR_VALID | TLP_ATTR_CFG },
+    [PCIE_STLP_CFGWR] = {
+        PCIE_TLP_TYPE_CFGWR0, 12, 4,
+        TLP_ATTR_VALID | TLP_ATTR_CFG | TLP_ATTR_DATA },
+    [PCIE_STLP_MEMRD] = {
+        PCIE_TLP_TYPE_MEMRD, 12, 0,
+        TLP_ATTR_VALID },
+    [PCIE_STLP_MEMWR] = {
+        PCIE_TLP_TYPE_MEMWR, 12, 8,
+        TLP_ATTR_VALID | TLP_ATTR_DATA | TLP_ATTR_VARLEN },
+    [PCIE_STLP_MEMRD64] = {
+        PCIE_TLP_TYPE_MEMRD64, 16, 0,
+        TLP_ATTR_VALID | TLP_ATTR_ADDR64 },
+    [PCIE_STLP_MEMWR64] = {
+        PCIE_TLP_TYPE_MEMWR64, 16, 8,
+        TLP_ATTR_VALID | TLP_ATTR_ADDR64 | TLP_ATTR_DATA | TLP_ATTR_VARLEN },
+    [PCIE_STLP_IORD] = {
+        PCIE_TLP_TYPE_IORD, 12, 4,
+        TLP_ATTR_VALID },
+    [PCIE_STLP_IOWR] = {
+        PCIE_TLP_TYPE_IOWR, 12, 4,
+        TLP_ATTR_VALID | TLP_ATTR_DATA },
+};
 
 /******************************************************************/
 
-static int
-encode_cfgwr(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 16;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("cfgwr: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-
-    encode_cfg_hdr(stlp, PCIE_TLP_TYPE_CFGWR0, rtlp);
-    encode_data32(stlp, rtlp + 12);
-    return tlpsz;
-}
-
-static int
-decode_cfgwr(pcie_stlp_t *stlp, const void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 16;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("cfgwr: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-
-    decode_cfg_hdr(stlp, rtlp);
-    decode_data32(stlp, rtlp + 12);
-    return tlpsz;
-}
-
-/******************************************************************
- * MEM
- */
-
-static int
-encode_memrd(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 12;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("memrd: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-
-    encode_mem32_hdr(stlp, PCIE_TLP_TYPE_MEMRD, rtlp);
-    encode_data(stlp, rtlp + 12);
-    return tlpsz;
-}
-
-static int
-decode_memrd(pcie_stlp_t *stlp, const void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 12;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("memrd: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-
-    decode_mem32_hdr(stlp, rtlp);
-    return tlpsz;
-}
-
-/******************************************************************/
-
-static int
-encode_memwr(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 12 + stlp_dw(stlp) * 4;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("memwr: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-    if (stlp->size > 8) {
-        /* stlp data is only 8 bytes */
-        return pcietlp_set_error("memwr: size %d > 8", stlp->size);
-    }
-
-    encode_mem32_hdr(stlp, PCIE_TLP_TYPE_MEMWR, rtlp);
-    encode_data(stlp, rtlp + 12);
-    return tlpsz;
-}
-
-static int
-decode_memwr(pcie_stlp_t *stlp, const void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 12;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("memwr: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-
-    decode_mem32_hdr(stlp, rtlp);
-
-    if (rtlpsz < tlpsz + stlp->size) {
-        return pcietlp_set_error("memwr: rtlpsz want %d got %ld",
-                                 tlpsz + stlp->size, rtlpsz);
-    }
-
-    decode_data(stlp, rtlp + 12);
-    return tlpsz + stlp->size;
-}
-
-/******************************************************************
- * MEM 64
- */
-
-static int
-encode_memrd64(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 16;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("memrd64: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-
-    encode_mem64_hdr(stlp, PCIE_TLP_TYPE_MEMRD64, rtlp);
-    return tlpsz;
-}
-
-static int
-decode_memrd64(pcie_stlp_t *stlp, const void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 16;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("memrd64: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-
-    decode_mem64_hdr(stlp, rtlp);
-    return tlpsz;
-}
-
-/******************************************************************/
-
-static int
-encode_memwr64(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 16 + stlp_dw(stlp) * 4;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("memwr64: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-    if (stlp->size > 8) {
-        /* stlp data is only 8 bytes */
-        return pcietlp_set_error("memwr64: size %d > 8", stlp->size);
-    }
-
-    encode_mem64_hdr(stlp, PCIE_TLP_TYPE_MEMWR64, rtlp);
-    encode_data(stlp, rtlp + 16);
-    return tlpsz;
-}
-
-static int
-decode_memwr64(pcie_stlp_t *stlp, const void *rtlp, const size_t rtlpsz)
+int
+pcietlp_encode(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
 {
-    const int tlpsz = 16;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("memwr64: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
+    const tlp_enc_t *enc;
+    int n;
 
-    decode_mem64_hdr(stlp, rtlp);
+    pciesvc_memset(rtlp, 0, rtlpsz);
+    pcietlp_clr_error();
 
-    if (rtlpsz < tlpsz + stlp->size) {
-        return pcietlp_set_error("memwr64: rtlpsz want %d got %ld",
-                                 tlpsz + stlp->size, rtlpsz);
+    if (stlp->type > PCIE_STLP_MSGD ||
+        !(tlp_enctab[stlp->type].attr & TLP_ATTR_VALID)) {
+        pcietlp_set_error("encode: unhandled type 0x%x", stlp->type);
+        return -1;
     }
+    enc = &tlp_enctab[stlp->type];
 
-    decode_data(stlp, rtlp + 16);
-    return tlpsz + stlp->size;
-}
-
-/******************************************************************
- * IO
- */
-
-static int
-encode_iord(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 12;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("iord: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
+    n = enc->hdrsz;
+    if (enc->attr & TLP_ATTR_DATA) {
+        n += (enc->attr & TLP_ATTR_VARLEN) ? stlp_dw(stlp) * 4 : 4;
     }
-    if (stlp->size > 4) {
-        return pcietlp_set_error("iord: size %d > 4", stlp->size);
+    if (rtlpsz < n) {
+        return pcietlp_set_error("encode: type 0x%x rtlpsz want %d got %ld",
+                                 stlp->type, n, rtlpsz);
     }
-
-    encode_mem32_hdr(stlp, PCIE_TLP_TYPE_IORD, rtlp);
-    return tlpsz;
-}
-
-static int
-decode_iord(pcie_stlp_t *stlp, const void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 12;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("iord: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-
-    decode_mem32_hdr(stlp, rtlp);
-    return tlpsz;
-}
-
-/******************************************************************/
-
-static int
-encode_iowr(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 16;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("iowr: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
-    }
-    if (stlp->size > 4) {
-        return pcietlp_set_error("iowr: size %d > 4", stlp->size);
+    if (enc->maxsz && stlp->size > enc->maxsz) {
+        return pcietlp_set_error("encode: type 0x%x size %d > %d",
+                                 stlp->type, stlp->size, enc->maxsz);
     }
 
-    encode_mem32_hdr(stlp, PCIE_TLP_TYPE_IOWR, rtlp);
-    encode_data(stlp, rtlp + 12);
-    return tlpsz;
-}
-
-static int
-decode_iowr(pcie_stlp_t *stlp, const void *rtlp, const size_t rtlpsz)
-{
-    const int tlpsz = 16;
-
-    if (rtlpsz < tlpsz) {
-        return pcietlp_set_error("iowr: rtlpsz want %d got %ld",
-                                 tlpsz, rtlpsz);
+    if (enc->attr & TLP_ATTR_CFG) {
+        encode_cfg_hdr(stlp, enc->tlp_type, rtlp);
+    } else if (enc->attr & TLP_ATTR_ADDR64) {
+        encode_mem64_hdr(stlp, enc->tlp_type, rtlp);
+    } else {
+        encode_mem32_hdr(stlp, enc->tlp_type, rtlp);
     }
 
-    decode_mem32_hdr(stlp, rtlp);
-    decode_data(stlp, rtlp + 12);
-    return tlpsz;
-}
-
-/******************************************************************/
-
-int
-pcietlp_encode(const pcie_stlp_t *stlp, void *rtlp, const size_t rtlpsz)
-{
-    int n;
-
-    pciesvc_memset(rtlp, 0, rtlpsz);
-    pcietlp_clr_error();
-    switch (stlp->type) {
-    case PCIE_STLP_CFGRD:
-        n = encode_cfgrd(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_STLP_CFGWR:
-        n = encode_cfgwr(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_STLP_MEMRD:
-        n = encode_memrd(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_STLP_MEMWR:
-        n = encode_memwr(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_STLP_MEMRD64:
-        n = encode_memrd64(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_STLP_MEMWR64:
-        n = encode_memwr64(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_STLP_IORD:
-        n = encode_iord(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_STLP_IOWR:
-        n = encode_iowr(stlp, rtlp, rtlpsz);
-        break;
-    default:
-        pcietlp_set_error("encode: unhandled type 0x%x", stlp->type);
-        n = -1;
-        break;
+    if (enc->attr & TLP_ATTR_DATA) {
+        if (enc->attr & TLP_ATTR_VARLEN) {
+            encode_data(stlp, rtlp + enc->hdrsz);
+        } else {
+            /* cfg/io writes are a single dw with byte enables */
+            encode_data32(stlp, rtlp + enc->hdrsz);
+        }
     }
     return pcietlp_is_error() ? -1 : n;
 }
@@ -657,54 +473,48 @@ int
 pcietlp_decode(pcie_stlp_t *stlp, const void *rtlp, const size_t rtlpsz)
 {
     const pcie_tlp_common_hdr_t *hdr = rtlp;
+    const tlp_attr_t *attr = &tlp_attrtab[hdr->type];
     int n;
 
     pcietlp_clr_error();
-    switch (hdr->type) {
-    case PCIE_TLP_TYPE_MEMRD:
-        stlp->type = PCIE_STLP_MEMRD;
-        n = decode_memrd(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_TLP_TYPE_MEMRD64:
-        stlp->type = PCIE_STLP_MEMRD64;
-        n = decode_memrd64(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_TLP_TYPE_MEMWR:
-        stlp->type = PCIE_STLP_MEMWR;
-        n = decode_memwr(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_TLP_TYPE_MEMWR64:
-        stlp->type = PCIE_STLP_MEMWR64;
-        n = decode_memwr64(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_TLP_TYPE_IORD:
-        stlp->type = PCIE_STLP_IORD;
-        n = decode_iord(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_TLP_TYPE_IOWR:
-        stlp->type = PCIE_STLP_IOWR;
-        n = decode_iowr(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_TLP_TYPE_CFGRD0:
-        stlp->type = PCIE_STLP_CFGRD;
-        n = decode_cfgrd(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_TLP_TYPE_CFGWR0:
-        stlp->type = PCIE_STLP_CFGWR;
-        n = decode_cfgwr(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_TLP_TYPE_CFGRD1:
-        stlp->type = PCIE_STLP_CFGRD1;
-        n = decode_cfgrd(stlp, rtlp, rtlpsz);
-        break;
-    case PCIE_TLP_TYPE_CFGWR1:
-        stlp->type = PCIE_STLP_CFGWR1;
-        n = decode_cfgwr(stlp, rtlp, rtlpsz);
-        break;
-    default:
+
+    if (!(attr->attr & TLP_ATTR_VALID)) {
         pcietlp_set_error("decode: unhandled type 0x%x\n", hdr->type);
-        n = -1;
-        break;
+        return -1;
+    }
+
+    n = attr->hdrsz;
+    if ((attr->attr & TLP_ATTR_DATA) && !(attr->attr & TLP_ATTR_VARLEN)) {
+        n += 4;
+    }
+    if (rtlpsz < n) {
+        return pcietlp_set_error("decode: type 0x%x rtlpsz want %d got %ld",
+                                 hdr->type, n, rtlpsz);
+    }
+
+    stlp->type = attr->stlp_type;
+    if (attr->attr & TLP_ATTR_CFG) {
+        decode_cfg_hdr(stlp, rtlp);
+    } else if (attr->attr & TLP_ATTR_ADDR64) {
+        decode_mem64_hdr(stlp, rtlp);
+    } else {
+        decode_mem32_hdr(stlp, rtlp);
+    }
+
+    if (attr->attr & TLP_ATTR_DATA) {
+        if (attr->attr & TLP_ATTR_VARLEN) {
+            /* data length comes from the decoded header */
+            if (rtlpsz < n + stlp->size) {
+                return pcietlp_set_error(
+                    "decode: type 0x%x rtlpsz want %d got %ld",
+                    hdr->type, n + stlp->size, rtlpsz);
+            }
+            decode_data(stlp, rtlp + attr->hdrsz);
+            n += stlp->size;
+        } else {
+            /* cfg/io writes are a single dw with byte enables */
+            decode_data32(stlp, rtlp + attr->hdrsz);
+        }
     }
     return pcietlp_is_error() ? -1 : n;
 }
@@ -50,22 +50,231 @@ pmr_addr(const int pmti)
     return PMR_BASE + (pmti * PMR_STRIDE);
 }
 
+/******************************************************************
+ * buddy free lists
+ *
+ * Freed pmts go on per-size free lists rather than the old
+ * single-entry free list so multi-entry allocations can be
+ * satisfied from freed space.  Free blocks are power-of-2 sized
+ * and aligned to their size, and a freed block merges with its
+ * free "buddy" to rebuild larger blocks, so tcam entries freed
+ * by sriov vf config cycles don't fragment into singles.
+ */
+
+static void pmt_buddy_free(const int pri, int pmti, int order);
+
+/* ceil(log2(n)) */
 static int
-pmt_alloc_high(const int n)
+pmt_order(const int n)
+{
+    return pciesvc_ffs((int)roundup_power2(n)) - 1;
+}
+
+static u_int32_t *
+pmt_buddy_head(const int pri, const int order)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    pciesvc_assert(order >= 0 && order < PMT_NORDERS);
+    return (pri == PMTPRI_HIGH ?
+            &pshmem->freepmt_order_high[order] :
+            &pshmem->freepmt_order_low[order]);
+}
+
+/*
+ * Lazy init of the buddy free lists, on first use after hwinit
+ * or after a live upgrade from fw with single-entry free lists.
+ * Any entries on the old single-entry free lists migrate to the
+ * order-0 lists (and coalesce if adjacent).
+ */
+static void
+pmt_buddy_init(void)
 {
     pciehw_shmem_t *pshmem = pciesvc_shmem_get();
     pciehw_spmt_t *spmt;
-    int pmti = -1;
+    int o, pmti;
+
+    if (pshmem->pmtbuddy) return;
+
+    for (o = 0; o < PMT_NORDERS; o++) {
+        pshmem->freepmt_order_high[o] = PMT_INVALID;
+        pshmem->freepmt_order_low[o] = PMT_INVALID;
+    }
+    pshmem->reservepmt_vf0adj = 0;
+    pshmem->pmtbuddy = 1;
+
+    if (!pshmem->pmtpri) return;
 
-    if (n == 1 && pshmem->freepmt_high != PMT_INVALID) {
-        /* alloc a single entry from free list */
+    while (pshmem->freepmt_high != PMT_INVALID) {
         pmti = pshmem->freepmt_high;
         spmt = pciesvc_spmt_get(pmti);
         pshmem->freepmt_high = spmt->next;
         spmt->next = PMT_INVALID;
-        pciesvc_spmt_put(spmt, DIRTY);
-    } else if (pshmem->allocpmt_high + n <= pshmem->allocpmt_low) {
-        /* alloc multiple entries from sequential block */
+        pciesvc_spmt_put(spmt, DIRTY); /* next */
+        pmt_buddy_free(PMTPRI_HIGH, pmti, 0);
+    }
+    while (pshmem->freepmt_low != PMT_INVALID) {
+        pmti = pshmem->freepmt_low;
+        spmt = pciesvc_spmt_get(pmti);
+        pshmem->freepmt_low = spmt->next;
+        spmt->next = PMT_INVALID;
+        pciesvc_spmt_put(spmt, DIRTY); /* next */
+        pmt_buddy_free(PMTPRI_LOW, pmti, 0);
+    }
+}
+
+static void
+pmt_buddy_push(const int pri, const int pmti, const int order)
+{
+    u_int32_t *head = pmt_buddy_head(pri, order);
+    pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
+
+    spmt->next = *head;
+    spmt->isfree = 1;
+    spmt->freeorder = order;
+    pciesvc_spmt_put(spmt, DIRTY); /* next, isfree, freeorder */
+    *head = pmti;
+}
+
+static int
+pmt_buddy_pop(const int pri, const int order)
+{
+    u_int32_t *head = pmt_buddy_head(pri, order);
+    pciehw_spmt_t *spmt;
+    int pmti;
+
+    if (*head == PMT_INVALID) return -1;
+
+    pmti = *head;
+    spmt = pciesvc_spmt_get(pmti);
+    *head = spmt->next;
+    spmt->next = PMT_INVALID;
+    spmt->isfree = 0;
+    spmt->freeorder = 0;
+    pciesvc_spmt_put(spmt, DIRTY); /* next, isfree, freeorder */
+    return pmti;
+}
+
+static void
+pmt_buddy_unlink(const int pri, const int pmti, const int order)
+{
+    u_int32_t *head = pmt_buddy_head(pri, order);
+    pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
+    int i;
+
+    if (*head == pmti) {
+        *head = spmt->next;
+    } else {
+        /* singly-linked list, walk for the link to unlink.
+         * lists are short and this runs only on free/coalesce. */
+        i = *head;
+        while (i != PMT_INVALID) {
+            pciehw_spmt_t *pspmt = pciesvc_spmt_get(i);
+
+            if (pspmt->next == pmti) {
+                pspmt->next = spmt->next;
+                pciesvc_spmt_put(pspmt, DIRTY); /* next */
+                break;
+            }
+            i = pspmt->next;
+            pciesvc_spmt_put(pspmt, CLEAN);
+        }
+        pciesvc_assert(i != PMT_INVALID);
+    }
+    spmt->next = PMT_INVALID;
+    spmt->isfree = 0;
+    spmt->freeorder = 0;
+    pciesvc_spmt_put(spmt, DIRTY); /* next, isfree, freeorder */
+}
+
+/* block [pmti, pmti + 2^order) lies entirely inside pri's alloc region */
+static int
+pmt_buddy_in_region(const int pri, const int pmti, const int order)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    if (pmti < 0) return 0;
+    if (pri == PMTPRI_HIGH) {
+        return pmti + (1 << order) <= pshmem->allocpmt_high;
+    }
+    return (pmti >= pshmem->allocpmt_low &&
+            pmti + (1 << order) <= pmt_count());
+}
+
+/*
+ * Free an aligned block, merging with its free buddy
+ * to rebuild larger blocks where possible.
+ */
+static void
+pmt_buddy_free(const int pri, int pmti, int order)
+{
+    while (order + 1 < PMT_NORDERS) {
+        const int buddy = pmti ^ (1 << order);
+        pciehw_spmt_t *bspmt;
+        int merge;
+
+        if (!pmt_buddy_in_region(pri, buddy, order)) break;
+        bspmt = pciesvc_spmt_get(buddy);
+        merge = bspmt->isfree && bspmt->freeorder == order;
+        pciesvc_spmt_put(bspmt, CLEAN);
+        if (!merge) break;
+
+        pmt_buddy_unlink(pri, buddy, order);
+        if (buddy < pmti) pmti = buddy;
+        order++;
+    }
+    pmt_buddy_push(pri, pmti, order);
+}
+
+/* free an arbitrary range as aligned power-of-2 blocks */
+static void
+pmt_buddy_free_range(const int pri, int pmtb, int pmtc)
+{
+    while (pmtc > 0) {
+        const int aorder = pmtb ? pciesvc_ffs(pmtb) - 1 : PMT_NORDERS - 1;
+        const int sorder = pciesvc_ffs((int)rounddn_power2(pmtc)) - 1;
+        const int order = aorder < sorder ? aorder : sorder;
+
+        pmt_buddy_free(pri, pmtb, order);
+        pmtb += 1 << order;
+        pmtc -= 1 << order;
+    }
+}
+
+static int
+pmt_buddy_alloc(const int pri, const int n)
+{
+    const int order = pmt_order(n);
+    int o, pmti;
+
+    pmti = -1;
+    for (o = order; o < PMT_NORDERS; o++) {
+        pmti = pmt_buddy_pop(pri, o);
+        if (pmti >= 0) break;
+    }
+    if (pmti < 0) return -1;
+
+    /* split back the unused upper halves */
+    while (o > order) {
+        o--;
+        pmt_buddy_push(pri, pmti + (1 << o), o);
+    }
+    /* return the tail if n is not a power of 2 */
+    if (n < (1 << order)) {
+        pmt_buddy_free_range(pri, pmti + n, (1 << order) - n);
+    }
+    return pmti;
+}
+
+static int
+pmt_alloc_high(const int n)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    int pmti;
+
+    pmti = pmt_buddy_alloc(PMTPRI_HIGH, n);
+    if (pmti < 0 && pshmem->allocpmt_high + n <= pshmem->allocpmt_low) {
+        /* alloc entries from sequential block */
         pmti = pshmem->allocpmt_high;
         pshmem->allocpmt_high += n;
     }
@@ -76,24 +285,166 @@ static int
 pmt_alloc_low(const int n)
 {
     pciehw_shmem_t *pshmem = pciesvc_shmem_get();
-    pciehw_spmt_t *spmt;
-    int pmti = -1;
+    int pmti;
 
-    if (n == 1 && pshmem->freepmt_low != PMT_INVALID) {
-        /* alloc a single entry from free list */
-        pmti = pshmem->freepmt_low;
-        spmt = pciesvc_spmt_get(pmti);
-        pshmem->freepmt_low = spmt->next;
-        spmt->next = PMT_INVALID;
-        pciesvc_spmt_put(spmt, DIRTY);
-    } else if (pshmem->allocpmt_low - n >= pshmem->allocpmt_high) {
-        /* alloc multiple entries from sequential block */
+    pmti = pmt_buddy_alloc(PMTPRI_LOW, n);
+    if (pmti < 0 && pshmem->allocpmt_low - n >= pshmem->allocpmt_high) {
+        /* alloc entries from sequential block */
         pshmem->allocpmt_low -= n;
         pmti = pshmem->allocpmt_low;
     }
     return pmti;
 }
 
+/******************************************************************
+ * software ownership index
+ *
+ * Per-device lists of the spmt entries each device owns, so
+ * per-device lookups and bulk operations touch only the owner's
+ * entries instead of scanning the whole shadow table.  The lists
+ * live in shared memory and are rebuilt on demand from the
+ * authoritative dev/bar tables, so they survive restarts and any
+ * agent sharing the shmem sees the same index.  Anything that
+ * changes the entry population or ownership invalidates the index
+ * (alloc, free, compaction here; the control plane calls
+ * pciehw_pmt_index_inval() after re-owning entries).
+ */
+
+static void
+pmt_owner_index_inval(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    pshmem->spmtownervalid = 0;
+}
+
+/*
+ * Visit the pmt references recorded for a device in the shmem
+ * tables: the cfg space block, bar base blocks, chained pmts,
+ * and override pmts.  cb gets each (pmtb, pmtc) block.
+ */
+static void
+pmt_dev_foreach_ref(pciehwdev_t *phwdev, const pciehwdevh_t hwdevh,
+                    void (*cb)(pciehwdevh_t hwdevh,
+                               int pmtb, int pmtc, void *arg),
+                    void *arg)
+{
+    pciehw_spmt_t *spmt;
+    u_int32_t pmti;
+    int i, next;
+
+    /* cfg space block */
+    if (phwdev->pmtc) {
+        cb(hwdevh, phwdev->pmtb, phwdev->pmtc, arg);
+    }
+
+    for (i = 0; i <= PCIEHW_NBAR; i++) {
+        pciehwbar_t *phwbar =
+            i < PCIEHW_NBAR ? &phwdev->bar[i] : &phwdev->rombar;
+
+        if (!phwbar->valid) continue;
+
+        /* bar base block */
+        cb(hwdevh, phwbar->pmtb, phwbar->pmtc, arg);
+
+        /* chained pmts are singles */
+        for (pmti = phwbar->pmtb;
+             pmti < phwbar->pmtb + phwbar->pmtc; pmti++) {
+            int chain;
+
+            spmt = pciesvc_spmt_get(pmti);
+            chain = spmt->chain;
+            next = spmt->next;
+            pciesvc_spmt_put(spmt, CLEAN);
+            if (!chain) continue;
+            while (next != PMT_INVALID) {
+                cb(hwdevh, next, 1, arg);
+                spmt = pciesvc_spmt_get(next);
+                next = spmt->next;
+                pciesvc_spmt_put(spmt, CLEAN);
+            }
+        }
+
+        /* override pmts are singles */
+        if (phwbar->ovrds) {
+            next = phwbar->ovrd;
+            while (next != PMT_INVALID) {
+                cb(hwdevh, next, 1, arg);
+                spmt = pciesvc_spmt_get(next);
+                next = spmt->next;
+                pciesvc_spmt_put(spmt, CLEAN);
+            }
+        }
+    }
+}
+
+static void
+pmt_owner_push_cb(pciehwdevh_t hwdevh, int pmtb, int pmtc, void *arg)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    int pmti;
+
+    for (pmti = pmtb; pmti < pmtb + pmtc; pmti++) {
+        pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
+
+        spmt->ownext = pshmem->spmtowner[hwdevh];
+        pciesvc_spmt_put(spmt, DIRTY); /* ownext */
+        pshmem->spmtowner[hwdevh] = pmti;
+    }
+}
+
+static void
+pmt_owner_index_build(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    pciehwdevh_t hwdevh;
+
+    for (hwdevh = 0; hwdevh < PCIEHW_NDEVS; hwdevh++) {
+        pshmem->spmtowner[hwdevh] = PMT_INVALID;
+    }
+    for (hwdevh = 1; hwdevh < PCIEHW_NDEVS; hwdevh++) {
+        pciehwdev_t *phwdev = pciehwdev_get(hwdevh);
+
+        pmt_dev_foreach_ref(phwdev, hwdevh, pmt_owner_push_cb, NULL);
+        pciehwdev_put(phwdev, CLEAN);
+    }
+    pshmem->spmtownervalid = 1;
+}
+
+static void
+pmt_owner_index_check(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    if (!pshmem->spmtownervalid) {
+        pmt_owner_index_build();
+    }
+}
+
+/* find the owner's live entry whose chain link points at pmti */
+static int
+pmt_owner_find_link(const pciehwdevh_t hwdevh, const int pmti)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    int i, r = -1;
+
+    pmt_owner_index_check();
+    i = pshmem->spmtowner[hwdevh];
+    while (i != PMT_INVALID) {
+        pciehw_spmt_t *spmt = pciesvc_spmt_get(i);
+        const int next = spmt->ownext;
+        const int match = i != pmti && spmt->next == pmti;
+
+        pciesvc_spmt_put(spmt, CLEAN);
+        if (match) {
+            r = i;
+            break;
+        }
+        i = next;
+    }
+    return r;
+}
+
 static int
 pmt_alloc_vf0adj(const int n)
 {
@@ -142,24 +493,13 @@ pmt_alloc_vf0adj(const int n)
  *                 user but is low priority so entries can be overridden
  *                 by flexvf overrides in the HIGH region.
  */
-int
-pmt_alloc(const int n, const int pri)
+static int pmt_defrag(const int pri);
+
+static int
+pmt_alloc_pri(const int n, const int pri)
 {
-    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
     int pmti = -1;
 
-    pciesvc_assert(n > 0);
-    pciesvc_assert(n <= pmt_count());
-
-    if (!pshmem->pmtpri) {
-        pshmem->allocpmt_low = pmt_count();
-        pshmem->freepmt_high = PMT_INVALID;
-        pshmem->freepmt_low = PMT_INVALID;
-        pshmem->allocpmt_vf0adj = -1;
-        pshmem->freeprt_slab = PRT_INVALID;
-        pshmem->pmtpri = 1;
-    }
-
     switch (pri) {
     case PMTPRI_HIGH:
         pmti = pmt_alloc_high(n);
@@ -175,7 +515,36 @@ pmt_alloc(const int n, const int pri)
         pciesvc_assert(0);
         break;
     }
+    return pmti;
+}
 
+int
+pmt_alloc(const int n, const int pri)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    int pmti;
+
+    pciesvc_assert(n > 0);
+    pciesvc_assert(n <= pmt_count());
+
+    if (!pshmem->pmtpri) {
+        pshmem->allocpmt_low = pmt_count();
+        pshmem->freepmt_high = PMT_INVALID;
+        pshmem->freepmt_low = PMT_INVALID;
+        pshmem->allocpmt_vf0adj = -1;
+        pshmem->freeprt_slab = PRT_INVALID;
+        pshmem->pmtpri = 1;
+    }
+    pmt_buddy_init();
+
+    pmti = pmt_alloc_pri(n, pri);
+    if (pmti < 0 && pmt_defrag(pri) > 0) {
+        /* compaction reclaimed some entries, try again */
+        pmti = pmt_alloc_pri(n, pri);
+    }
+    if (pmti >= 0) {
+        pmt_owner_index_inval();
+    }
     return pmti;
 }
 
@@ -190,6 +559,8 @@ pmt_reserve_vf0adj(const int n)
     pciehw_shmem_t *pshmem = pciesvc_shmem_get();
 
     pshmem->allocpmt_vf0adj = pmt_alloc(n, PMTPRI_LOW);
+    /* remember the reservation base, it bounds low pri compaction */
+    pshmem->reservepmt_vf0adj = pshmem->allocpmt_vf0adj;
     return pshmem->allocpmt_vf0adj;
 }
 
@@ -218,27 +589,16 @@ void
 pmt_free(const int pmtb, const int pmtc)
 {
     pciehw_shmem_t *pshmem = pciesvc_shmem_get();
-    pciehw_spmt_t *spmt;
-    int pmti;
 
     assert_pmts_in_range(pmtb, pmtc);
 
+    pmt_buddy_init();
+    pmt_owner_index_inval();
+
     if (pmt_to_pri(pmtb + pmtc) == PMTPRI_HIGH) {
-        /* free high pri */
-        for (pmti = pmtb; pmti < pmtb + pmtc; pmti++) {
-            spmt = pciesvc_spmt_get(pmti);
-            spmt->next = pshmem->freepmt_high;
-            pciesvc_spmt_put(spmt, DIRTY);
-            pshmem->freepmt_high = pmti;
-        }
+        pmt_buddy_free_range(PMTPRI_HIGH, pmtb, pmtc);
     } else if (pmt_to_pri(pmtb) == PMTPRI_LOW) {
-        /* free low pri */
-        for (pmti = pmtb; pmti < pmtb + pmtc; pmti++) {
-            spmt = pciesvc_spmt_get(pmti);
-            spmt->next = pshmem->freepmt_low;
-            pciesvc_spmt_put(spmt, DIRTY);
-            pshmem->freepmt_low = pmti;
-        }
+        pmt_buddy_free_range(PMTPRI_LOW, pmtb, pmtc);
     } else {
         /* outside of both alloc ranges? */
         pciesvc_logerror("pmt_free: leak pmt %d (%d), "
@@ -289,12 +649,18 @@ pmt_get(const int pmti, pmt_t *pmt)
 void
 pmt_set(const int pmti, const pmt_t *pmt)
 {
+    pciesvc_regwb_t wb;
+
     /*
      * Set PMR entry first, then TCAM, so by the time a tcam search
      * can hit an entry the corresponding ram entry is valid too.
+     * The write buffer issues the queued words in that order and
+     * fences the whole update with a single readback.
      */
-    pmr_set_entry(pmti, &pmt->pmre);
-    pmt_set_entry(pmti, &pmt->pmte);
+    pciesvc_regwb_init(&wb);
+    pciesvc_regwb_wr32w(&wb, pmr_addr(pmti), pmt->pmre.w, PMR_NWORDS);
+    pciesvc_regwb_wr32w(&wb, pmt_addr(pmti), pmt->pmte.w, PMT_NWORDS);
+    pciesvc_regwb_flush(&wb);
 }
 
 static void
@@ -316,6 +682,485 @@ pmt_clr(const int pmti)
     pmt_clr_tcam(pmti);
 }
 
+/******************************************************************
+ * defragmenter
+ *
+ * Compact an alloc region when an allocation would otherwise fail.
+ * Live blocks slide toward the region origin in index order, which
+ * preserves their relative tcam priority and rebuilds one sequential
+ * free region at the frontier.  Entries relocate install-new-then-
+ * retire so the host translations stay live across the move.
+ *
+ * Every live entry must be reachable from the shmem tables (cfg and
+ * bar base blocks in dev[], chained pmts on spmt next, override pmts
+ * on bar ovrd), which is where the control plane records every
+ * allocation.  This is a slow path, run only from pmt_alloc() when
+ * the region is exhausted.
+ */
+
+typedef struct pmt_pick_s {
+    int lo;                     /* candidate block must be >= lo */
+    int hi;                     /* candidate block end must be <= hi */
+    int pickhi;                 /* pick highest base, else lowest */
+    int pmtb;                   /* picked block base, -1 if none */
+    int pmtc;                   /* picked block count */
+} pmt_pick_t;
+
+static void
+pmt_pick_consider_cb(pciehwdevh_t hwdevh, int pmtb, int pmtc, void *arg)
+{
+    pmt_pick_t *pick = arg;
+
+    if (pmtc <= 0) return;
+    if (pmtb < pick->lo || pmtb + pmtc > pick->hi) return;
+    if (pick->pmtb < 0 ||
+        (pick->pickhi ? pmtb > pick->pmtb : pmtb < pick->pmtb)) {
+        pick->pmtb = pmtb;
+        pick->pmtc = pmtc;
+    }
+}
+
+/* find the next live block in the pick window */
+static void
+pmt_defrag_pick(pmt_pick_t *pick)
+{
+    pciehwdevh_t hwdevh;
+
+    pick->pmtb = -1;
+    pick->pmtc = 0;
+
+    for (hwdevh = 1; hwdevh < PCIEHW_NDEVS; hwdevh++) {
+        pciehwdev_t *phwdev = pciehwdev_get(hwdevh);
+
+        pmt_dev_foreach_ref(phwdev, hwdevh, pmt_pick_consider_cb, pick);
+        pciehwdev_put(phwdev, CLEAN);
+    }
+}
+
+/* repoint all references to a block that moved src -> dst */
+static void
+pmt_retarget_block(const int src, const int dst)
+{
+    pciehwdevh_t hwdevh;
+    int i;
+
+    for (hwdevh = 1; hwdevh < PCIEHW_NDEVS; hwdevh++) {
+        pciehwdev_t *phwdev = pciehwdev_get(hwdevh);
+        int dirty = CLEAN;
+
+        if (phwdev->pmtc && phwdev->pmtb == src) {
+            phwdev->pmtb = dst;
+            dirty = DIRTY; /* pmtb */
+        }
+        for (i = 0; i <= PCIEHW_NBAR; i++) {
+            pciehwbar_t *phwbar =
+                i < PCIEHW_NBAR ? &phwdev->bar[i] : &phwdev->rombar;
+
+            if (!phwbar->valid) continue;
+            if (phwbar->pmtb == src) {
+                phwbar->pmtb = dst;
+                dirty = DIRTY; /* pmtb */
+            }
+            if (phwbar->ovrds && phwbar->ovrd == src) {
+                phwbar->ovrd = dst;
+                dirty = DIRTY; /* ovrd */
+            }
+        }
+        pciehwdev_put(phwdev, dirty);
+    }
+}
+
+static void
+pmt_move_block(const int src, const int dst, const int n)
+{
+    const int up = dst > src;
+    pciehw_spmt_t *ospmt, *nspmt;
+    int i, k, chainref;
+
+    assert_pmts_in_range(src, n);
+    assert_pmts_in_range(dst, n);
+
+    /*
+     * Only single entries are chain targets, multi-entry blocks are
+     * referenced by the dev/bar tables alone.  Find the chain link
+     * pointing at a moving single while the ownership index still
+     * reflects pre-move state; patched below after the new copy is
+     * installed.
+     */
+    chainref = -1;
+    if (n == 1) {
+        ospmt = pciesvc_spmt_get(src);
+        chainref = pmt_owner_find_link(ospmt->owner, src);
+        pciesvc_spmt_put(ospmt, CLEAN);
+    }
+
+    /*
+     * Copy the shadow entries and install the copies in hw before
+     * retiring the originals below, so the translations stay live
+     * across the move.  Old and new entries match identical TLPs so
+     * a tcam search hit on either gives the same translation.  Copy
+     * starting away from the destination end so an overlapping move
+     * doesn't overwrite entries not yet copied.
+     */
+    for (i = 0; i < n; i++) {
+        k = up ? n - 1 - i : i;
+        ospmt = pciesvc_spmt_get(src + k);
+        nspmt = pciesvc_spmt_get(dst + k);
+        pciesvc_memcpy(nspmt, ospmt, sizeof(*nspmt));
+        if (nspmt->loaded) {
+            pmt_set(dst + k, &nspmt->pmt);
+        }
+        pciesvc_spmt_put(nspmt, DIRTY); /* entire entry */
+        pciesvc_spmt_put(ospmt, CLEAN);
+    }
+
+    pmt_retarget_block(src, dst);
+    if (chainref >= 0) {
+        pciehw_spmt_t *spmt = pciesvc_spmt_get(chainref);
+
+        spmt->next = dst;
+        pciesvc_spmt_put(spmt, DIRTY); /* next */
+    }
+
+    /* retire the old slots not overlaid by the new block */
+    for (k = 0; k < n; k++) {
+        if (up ? src + k >= dst : src + k < dst + n) continue;
+        ospmt = pciesvc_spmt_get(src + k);
+        if (ospmt->loaded) {
+            pmt_clr(src + k);
+        }
+        pciesvc_memset(ospmt, 0, sizeof(*ospmt));
+        pciesvc_spmt_put(ospmt, DIRTY); /* entire entry */
+    }
+    pmt_owner_index_inval();
+}
+
+/* drop free blocks inside [lo, hi) from the buddy free lists */
+static void
+pmt_buddy_drop_range(const int pri, const int lo, const int hi)
+{
+    int o;
+
+    for (o = 0; o < PMT_NORDERS; o++) {
+        u_int32_t *head = pmt_buddy_head(pri, o);
+        int pmti = *head;
+
+        *head = PMT_INVALID;
+        while (pmti != PMT_INVALID) {
+            pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
+            const int next = spmt->next;
+
+            if (pmti >= lo && pmti < hi) {
+                /* dropped, becomes sequential alloc space */
+                pciesvc_memset(spmt, 0, sizeof(*spmt));
+                pciesvc_spmt_put(spmt, DIRTY); /* entire entry */
+            } else {
+                spmt->next = *head;
+                pciesvc_spmt_put(spmt, DIRTY); /* next */
+                *head = pmti;
+            }
+            pmti = next;
+        }
+    }
+}
+
+static int
+pmt_defrag_high(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    const int ofront = pshmem->allocpmt_high;
+    pmt_pick_t pick;
+    int dst;
+
+    /* all free entries below the frontier become sequential space */
+    pmt_buddy_drop_range(PMTPRI_HIGH, 0, ofront);
+    pshmem->freepmt_high = PMT_INVALID;
+
+    /* slide live blocks down in index order to close the holes */
+    pick.lo = 0;
+    pick.hi = ofront;
+    pick.pickhi = 0;
+    dst = 0;
+    for (;;) {
+        pmt_defrag_pick(&pick);
+        if (pick.pmtb < 0) break;
+        pciesvc_assert(pick.pmtb >= dst);
+        if (pick.pmtb != dst) {
+            pmt_move_block(pick.pmtb, dst, pick.pmtc);
+        }
+        dst += pick.pmtc;
+        pick.lo = pick.pmtb + pick.pmtc;
+    }
+    pshmem->allocpmt_high = dst;
+    return ofront - dst;
+}
+
+static int
+pmt_defrag_low(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    const int ofront = pshmem->allocpmt_low;
+    pmt_pick_t pick;
+    int lim, top, dst;
+
+    /*
+     * The vf0adj reservation carved from this region never moves.
+     * Compact only the entries below it.  If the reservation was
+     * made by older fw we don't know its base, so don't compact.
+     */
+    if (pshmem->allocpmt_vf0adj != -1) {
+        lim = pshmem->reservepmt_vf0adj;
+        if (lim == 0) return 0;
+    } else {
+        lim = pmt_count();
+    }
+
+    pmt_buddy_drop_range(PMTPRI_LOW, ofront, lim);
+    pshmem->freepmt_low = PMT_INVALID;
+
+    /* slide live blocks up in index order to close the holes */
+    pick.lo = ofront;
+    pick.hi = lim;
+    pick.pickhi = 1;
+    top = lim;
+    for (;;) {
+        pmt_defrag_pick(&pick);
+        if (pick.pmtb < 0) break;
+        pciesvc_assert(pick.pmtb + pick.pmtc <= top);
+        dst = top - pick.pmtc;
+        if (pick.pmtb != dst) {
+            pmt_move_block(pick.pmtb, dst, pick.pmtc);
+        }
+        top = dst;
+        pick.hi = pick.pmtb;
+    }
+    pshmem->allocpmt_low = top;
+    return top - ofront;
+}
+
+static int
+pmt_defrag(const int pri)
+{
+    int r = 0;
+
+    switch (pri) {
+    case PMTPRI_HIGH:
+        r = pmt_defrag_high();
+        break;
+    case PMTPRI_LOW:
+        r = pmt_defrag_low();
+        break;
+    case PMTPRI_VF0ADJ:
+        /* vf0adj region entries are never freed,
+         * but the fallback alloc comes from high pri */
+        r = pmt_defrag_high();
+        break;
+    default:
+        break;
+    }
+    if (r > 0) {
+        pciesvc_loginfo("pmt_defrag: pri %d reclaimed %d entries\n", pri, r);
+    }
+    return r;
+}
+
+/*****************************************************************
+ * hit-frequency tcam reordering
+ *
+ * Tcam match priority is positional, and allocation order alone
+ * decides placement, so the hottest bar/doorbell mappings can sit in
+ * the latest match slots on a full table.  A background pass promotes
+ * the hottest block toward the front of the high region by swapping
+ * it with the coldest same-size block in an earlier slot, using the
+ * free slots at the region frontier as scratch so every move is the
+ * defragmenter's install-then-retire relocation and translations
+ * stay live throughout.
+ *
+ * The heat signal is the spmtctr sw-handled counters--the hw doesn't
+ * report per-entry hit counts, but the sw-serviced (indirect/notify)
+ * entries are exactly the ones where match latency is visible.  Only
+ * blocks that match disjoint tlps may change relative order: cfg
+ * blocks (disjoint bdfs) and plain bar base blocks (disjoint address
+ * windows).  Overrides overlap their base bar by design, so override
+ * chains and the bars that own them keep their positions, as do
+ * chained singles.  One swap per pass, with hysteresis so blocks
+ * don't ping-pong on small differences; heat rebases every pass so
+ * old traffic ages out.
+ */
+
+#define PMT_REORDER_IDLE_POLLS  8192    /* idle polls between passes */
+#define PMT_REORDER_MIN_HITS    64      /* hot block must earn this many */
+
+static u_int64_t pmt_reorder_seen[PCIEHW_NPMT];
+
+typedef struct pmt_reorder_scan_s {
+    int lo;                     /* candidate block must be >= lo */
+    int hi;                     /* candidate block end must be <= hi */
+    int n;                      /* required block size, 0 = any */
+    int coldest;                /* pick coldest, else hottest */
+    int pmtb;                   /* picked block base, -1 if none */
+    int pmtc;                   /* picked block count */
+    u_int64_t heat;             /* picked block heat */
+} pmt_reorder_scan_t;
+
+static u_int64_t
+pmt_block_heat(const int pmtb, const int pmtc)
+{
+    u_int64_t heat = 0;
+    int i;
+
+    for (i = pmtb; i < pmtb + pmtc; i++) {
+        const pciehw_spmtctr_t *ctr = pciesvc_spmtctr_get(i);
+
+        heat += ctr->swrd + ctr->swwr - pmt_reorder_seen[i];
+    }
+    return heat;
+}
+
+static void
+pmt_reorder_consider(pmt_reorder_scan_t *scan, const int pmtb, const int pmtc)
+{
+    u_int64_t heat;
+
+    if (pmtb < scan->lo || pmtb + pmtc > scan->hi) return;
+    if (scan->n && pmtc != scan->n) return;
+
+    heat = pmt_block_heat(pmtb, pmtc);
+    if (scan->pmtb < 0 ||
+        (scan->coldest ? heat < scan->heat : heat > scan->heat)) {
+        scan->pmtb = pmtb;
+        scan->pmtc = pmtc;
+        scan->heat = heat;
+    }
+}
+
+static void
+pmt_reorder_dev_scan(pciehwdev_t *phwdev, pmt_reorder_scan_t *scan)
+{
+    u_int32_t pmti;
+    int i, chain;
+
+    /* cfg blocks match disjoint bdfs, safe to reorder */
+    if (phwdev->pmtc) {
+        pmt_reorder_consider(scan, phwdev->pmtb, phwdev->pmtc);
+    }
+
+    for (i = 0; i <= PCIEHW_NBAR; i++) {
+        pciehwbar_t *phwbar =
+            i < PCIEHW_NBAR ? &phwdev->bar[i] : &phwdev->rombar;
+
+        if (!phwbar->valid) continue;
+
+        /* overrides overlap their base bar by design, don't reorder */
+        if (phwbar->ovrds) continue;
+
+        /* chained singles keep their position too */
+        chain = 0;
+        for (pmti = phwbar->pmtb;
+             pmti < phwbar->pmtb + phwbar->pmtc; pmti++) {
+            pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
+
+            chain |= spmt->chain;
+            pciesvc_spmt_put(spmt, CLEAN);
+        }
+        if (chain) continue;
+
+        pmt_reorder_consider(scan, phwbar->pmtb, phwbar->pmtc);
+    }
+}
+
+static void
+pmt_reorder_scan(pmt_reorder_scan_t *scan)
+{
+    pciehwdevh_t hwdevh;
+
+    scan->pmtb = -1;
+    scan->pmtc = 0;
+    scan->heat = 0;
+
+    for (hwdevh = 1; hwdevh < PCIEHW_NDEVS; hwdevh++) {
+        pciehwdev_t *phwdev = pciehwdev_get(hwdevh);
+
+        pmt_reorder_dev_scan(phwdev, scan);
+        pciehwdev_put(phwdev, CLEAN);
+    }
+}
+
+/* the sw counters travel with their entries across a swap */
+static void
+pmt_reorder_swap_ctrs(const int a, const int b, const int n)
+{
+    int k;
+
+    for (k = 0; k < n; k++) {
+        pciehw_spmtctr_t *actr = pciesvc_spmtctr_get(a + k);
+        pciehw_spmtctr_t *bctr = pciesvc_spmtctr_get(b + k);
+        const pciehw_spmtctr_t tctr = *actr;
+        const u_int64_t tseen = pmt_reorder_seen[a + k];
+
+        *actr = *bctr;
+        *bctr = tctr;
+        pmt_reorder_seen[a + k] = pmt_reorder_seen[b + k];
+        pmt_reorder_seen[b + k] = tseen;
+    }
+}
+
+static void
+pmt_reorder_pass(void)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    pmt_reorder_scan_t hot, cold;
+    u_int32_t i;
+    int scratch;
+
+    if (!pshmem->pmtpri) return;
+
+    /* hottest eligible block in the high (cfg/bar) region */
+    hot.lo = 0;
+    hot.hi = pshmem->allocpmt_high;
+    hot.n = 0;
+    hot.coldest = 0;
+    pmt_reorder_scan(&hot);
+    if (hot.pmtb < 0 || hot.heat < PMT_REORDER_MIN_HITS) goto out;
+
+    /* coldest same-size block in an earlier slot */
+    cold.lo = 0;
+    cold.hi = hot.pmtb;
+    cold.n = hot.pmtc;
+    cold.coldest = 1;
+    pmt_reorder_scan(&cold);
+    if (cold.pmtb < 0 || cold.heat * 2 >= hot.heat) goto out;
+
+    /* swap through scratch slots at the region frontier */
+    scratch = pshmem->allocpmt_high;
+    if (scratch + hot.pmtc > (int)pshmem->allocpmt_low) goto out;
+
+    pmt_move_block(cold.pmtb, scratch, hot.pmtc);
+    pmt_move_block(hot.pmtb, cold.pmtb, hot.pmtc);
+    pmt_move_block(scratch, hot.pmtb, hot.pmtc);
+    pmt_reorder_swap_ctrs(cold.pmtb, hot.pmtb, hot.pmtc);
+
+    pciesvc_loginfo("pmt_reorder: block %d (%d) to slot %d\n",
+                    hot.pmtb, hot.pmtc, cold.pmtb);
+out:
+    /* rebase heat on the traffic since this pass */
+    for (i = 0; i < pshmem->allocpmt_high; i++) {
+        const pciehw_spmtctr_t *ctr = pciesvc_spmtctr_get(i);
+
+        pmt_reorder_seen[i] = ctr->swrd + ctr->swwr;
+    }
+}
+
+void
+pciehw_pmt_reorder_idle(void)
+{
+    static int idle;
+
+    if (++idle < PMT_REORDER_IDLE_POLLS) return;
+    idle = 0;
+    pmt_reorder_pass();
+}
+
 /*
  * dm->data is the entry data values
  * dm->mask is the entry mask bits,
@@ -421,27 +1266,206 @@ pmt_cfg_set_bus(pmt_t *pmt, const u_int8_t bus)
     pmr->blimit = bus + busdelta;
 }
 
+/******************************************************************
+ * batch programming
+ *
+ * Loading a bar used to program each entry separately, every word
+ * an uncached register write with implied per-entry ordering.
+ * Enabling hundreds of sriov vfs programs thousands of entries
+ * this way and the serial writes dominate enable latency.
+ *
+ * The batch api stages entry indexes and commits them in one pass
+ * over the staged set: first all the pmr entries, coalescing
+ * adjacent entries into single ranged register writes (the pmr ram
+ * is dense), then one ordering barrier, then all the pmt tcam
+ * entries.  A tcam search can't hit an entry until the final phase
+ * writes it, so the prt/pmr-before-pmt visibility rule holds for
+ * the whole batch with a single barrier rather than per entry.
+ */
+
+#define PMT_BATCH_SIZE  32      /* staged entries per commit */
+#define PMT_BATCH_RUN   8       /* max entries per coalesced pmr write */
+
+typedef struct pmt_batch_s {
+    u_int16_t pmti[PMT_BATCH_SIZE];
+    int count;
+    int clr;                    /* staging invalidations */
+} pmt_batch_t;
+
+static void
+pmt_batch_init(pmt_batch_t *b, const int clr)
+{
+    b->count = 0;
+    b->clr = clr;
+}
+
+/* commit staged entries to hardware, shadow pmt is the source */
+static void
+pmt_batch_flush(pmt_batch_t *b)
+{
+    pciehw_spmt_t *spmt;
+    int i, j;
+
+    if (b->count == 0) return;
+
+    /* phase 1: pmr entries, coalescing runs of adjacent entries */
+    for (i = 0; i < b->count; i = j) {
+        u_int32_t w[PMR_NWORDS * PMT_BATCH_RUN];
+        const int pmtb = b->pmti[i];
+
+        for (j = i; j < b->count &&
+                 j - i < PMT_BATCH_RUN &&
+                 b->pmti[j] == pmtb + (j - i); j++) {
+            spmt = pciesvc_spmt_get(b->pmti[j]);
+            pciesvc_memcpy(&w[(j - i) * PMR_NWORDS],
+                           spmt->pmt.pmre.w, PMR_NWORDS * 4);
+            pciesvc_spmt_put(spmt, CLEAN);
+        }
+        if (PMR_STRIDE == PMR_NWORDS * 4) {
+            pciesvc_reg_wr32w(pmr_addr(pmtb), w, (j - i) * PMR_NWORDS);
+        } else {
+            int k;
+
+            for (k = i; k < j; k++) {
+                pciesvc_reg_wr32w(pmr_addr(b->pmti[k]),
+                                  &w[(k - i) * PMR_NWORDS], PMR_NWORDS);
+            }
+        }
+    }
+    pciesvc_mem_barrier();
+
+    /* phase 2: pmt tcam entries, the batch becomes searchable here */
+    for (i = 0; i < b->count; i++) {
+        spmt = pciesvc_spmt_get(b->pmti[i]);
+        pmt_set_entry(b->pmti[i], &spmt->pmt.pmte);
+        pciesvc_spmt_put(spmt, CLEAN);
+    }
+    pciesvc_mem_barrier();
+
+    pciesvc_pmtdirty_clear();
+    b->count = 0;
+}
+
+/*
+ * Commit staged entry invalidations: clear all the tcam entries,
+ * then unload the prts they referenced once no search can hit them.
+ */
+static void
+pmt_batch_flush_clr(pmt_batch_t *b)
+{
+    pciehw_spmt_t *spmt;
+    int i;
+
+    if (b->count == 0) return;
+
+    for (i = 0; i < b->count; i++) {
+        pmt_clr(b->pmti[i]);
+    }
+    pciesvc_mem_barrier();
+
+    for (i = 0; i < b->count; i++) {
+        spmt = pciesvc_spmt_get(b->pmti[i]);
+        pciehw_prt_unload(spmt->pmt.pmre.bar.prtb,
+                          spmt->pmt.pmre.bar.prtc);
+        spmt->loaded = 0;
+        pciesvc_spmt_put(spmt, DIRTY); /* loaded */
+    }
+
+    pciesvc_pmtdirty_clear();
+    b->count = 0;
+}
+
+static void
+pmt_batch_commit(pmt_batch_t *b)
+{
+    if (b->clr) {
+        pmt_batch_flush_clr(b);
+    } else {
+        pmt_batch_flush(b);
+    }
+}
+
+static void
+pmt_batch_stage(pmt_batch_t *b, const int pmti)
+{
+    if (b->count == PMT_BATCH_SIZE) {
+        pmt_batch_commit(b);
+    }
+    /*
+     * Mark the handoff dirty summary at stage time so the window
+     * from shadow update to hw commit is covered; the commit clears
+     * the mark once the entries have landed in hw.
+     */
+    pciesvc_pmtdirty_mark(pmti, 1);
+    b->pmti[b->count++] = pmti;
+}
+
 /******************************************************************
  * apis
  */
 
+/*
+ * Visit all the pmt entries owned by a device.  This walks the
+ * software ownership index so only the owner's entries are
+ * touched, not the whole shadow table.  Returns the number of
+ * entries visited.
+ */
+int
+pciehw_pmt_foreach_dev(const pciehwdevh_t hwdevh,
+                       void (*cb)(int pmti, pciehw_spmt_t *spmt, void *arg),
+                       void *arg)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    int pmti, r = 0;
+
+    pciesvc_assert(hwdevh > 0 && hwdevh < PCIEHW_NDEVS);
+
+    pmt_owner_index_check();
+    pmti = pshmem->spmtowner[hwdevh];
+    while (pmti != PMT_INVALID) {
+        pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
+        const int next = spmt->ownext;
+
+        cb(pmti, spmt, arg);
+
+        pciesvc_spmt_put(spmt, DIRTY); /* cb might write */
+        pmti = next;
+        r++;
+    }
+    return r;
+}
+
+/*
+ * Invalidate the software ownership index; it rebuilds from the
+ * dev/bar tables on next use.  Call after changing entry ownership
+ * or the pmt references in the dev/bar tables.
+ */
+void
+pciehw_pmt_index_inval(void)
+{
+    pmt_owner_index_inval();
+}
+
 void
 pciehw_pmt_load_cfg(pciehwdev_t *phwdev)
 {
     if (!phwdev->cfgloaded) {
+        pmt_batch_t batch;
         u_int32_t pmti;
 
+        pmt_batch_init(&batch, 0);
         for (pmti = phwdev->pmtb; pmti < phwdev->pmtb + phwdev->pmtc; pmti++) {
             pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
             int state = CLEAN;
 
             if (!spmt->loaded) {
-                pmt_set(pmti, &spmt->pmt);
+                pmt_batch_stage(&batch, pmti);
                 spmt->loaded = 1;
                 state = DIRTY; /* loaded */
             }
             pciesvc_spmt_put(spmt, state);
         }
+        pmt_batch_commit(&batch);
         phwdev->cfgloaded = 1;
     }
 }
@@ -515,21 +1539,32 @@ pciehw_bar_foreach_pmt(pciehwbar_t *phwbar,
     }
 }
 
+typedef struct pmt_load_args_s {
+    u_int16_t bdf;
+    u_int8_t hnd;
+    pmt_batch_t *batch;
+} pmt_load_args_t;
+
 static void
-pmt_load(const int pmti, pciehw_spmt_t *spmt, const u_int16_t bdf)
+pmt_load(const int pmti, pciehw_spmt_t *spmt,
+         const u_int16_t bdf, const u_int8_t hnd, pmt_batch_t *batch)
 {
     /*
-     * Load PRT first, then load PMT so PMT tcam search hit
-     * will find valid PRT entries.
+     * Load PRT first, then stage PMT so PMT tcam search hit
+     * will find valid PRT entries once the batch commits.
      */
     pciehw_prt_load(spmt->pmt.pmre.bar.prtb, spmt->pmt.pmre.bar.prtc);
 
+    /* precompute bar handler so hot paths skip the bar lookup */
+    spmt->hnd = hnd;
+    spmt->hndvalid = 1;
+
     /* vf0 bdf was adjusted already in adjust_vf0 */
     if (!spmt->vf0) {
         /* place bus-adjusted bdf in pmt, then load in hw */
         pmt_bar_set_bdf(&spmt->pmt, bdf);
     }
-    pmt_set(pmti, &spmt->pmt);
+    pmt_batch_stage(batch, pmti);
 
     if (!spmt->loaded) {
         spmt->loaded = 1;
@@ -539,46 +1574,54 @@ pmt_load(const int pmti, pciehw_spmt_t *spmt, const u_int16_t bdf)
 static void
 pmt_load_cb(int pmti, pciehw_spmt_t *spmt, void *arg)
 {
-    const u_int16_t bdf = *(u_int16_t *)arg;
+    pmt_load_args_t *args = arg;
 
-    pmt_load(pmti, spmt, bdf);
+    pmt_load(pmti, spmt, args->bdf, args->hnd, args->batch);
 }
 
 void
 pciehw_bar_load_pmts(pciehwbar_t *phwbar)
 {
-    u_int16_t bdf = phwbar->bdf;
+    pmt_load_args_t args;
+    pmt_batch_t batch;
 
     if (!phwbar->valid) return;
-    pciehw_bar_foreach_pmt(phwbar, pmt_load_cb, &bdf);
+    pmt_batch_init(&batch, 0);
+    args.bdf = phwbar->bdf;
+    args.hnd = phwbar->hnd;
+    args.batch = &batch;
+    pciehw_bar_foreach_pmt(phwbar, pmt_load_cb, &args);
+    pmt_batch_commit(&batch);
 }
 
 static void
-pmt_unload(const int pmti, pciehw_spmt_t *spmt)
+pmt_unload(const int pmti, pciehw_spmt_t *spmt, pmt_batch_t *batch)
 {
     /*
      * Unload PMT first THEN PRT, so PMT tcam search will not hit
      * and PRT is unreferenced.  Then safe to unload PRT.
+     * The batch commit keeps this order across the staged set.
      */
     if (spmt->loaded) {
-        pmt_clr(pmti);
-        pciehw_prt_unload(spmt->pmt.pmre.bar.prtb,
-                          spmt->pmt.pmre.bar.prtc);
-        spmt->loaded = 0;
+        pmt_batch_stage(batch, pmti);
     }
 }
 
 static void
 pmt_unload_cb(int pmti, pciehw_spmt_t *spmt, void *arg)
 {
-    pmt_unload(pmti, spmt);
+    pmt_unload(pmti, spmt, arg);
 }
 
 void
 pciehw_bar_unload_pmts(pciehwbar_t *phwbar)
 {
+    pmt_batch_t batch;
+
     pciesvc_assert(phwbar->valid);
-    pciehw_bar_foreach_pmt(phwbar, pmt_unload_cb, NULL);
+    pmt_batch_init(&batch, 1);
+    pciehw_bar_foreach_pmt(phwbar, pmt_unload_cb, &batch);
+    pmt_batch_commit(&batch);
 }
 
 void
@@ -587,14 +1630,18 @@ pciehw_bar_load_ovrds(pciehwbar_t *phwbar)
     pciesvc_assert(phwbar->valid);
     if (phwbar->ovrds) {
         u_int16_t pmti = phwbar->ovrd;
+        pmt_batch_t batch;
+
+        pmt_batch_init(&batch, 0);
         while (pmti != PMT_INVALID) {
             pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
 
-            pmt_load(pmti, spmt, phwbar->bdf);
+            pmt_load(pmti, spmt, phwbar->bdf, phwbar->hnd, &batch);
 
             pmti = spmt->next;
             pciesvc_spmt_put(spmt, DIRTY); /* loaded */
         }
+        pmt_batch_commit(&batch);
     }
 }
 
@@ -604,14 +1651,18 @@ pciehw_bar_unload_ovrds(pciehwbar_t *phwbar)
     pciesvc_assert(phwbar->valid);
     if (phwbar->ovrds) {
         u_int16_t pmti = phwbar->ovrd;
+        pmt_batch_t batch;
+
+        pmt_batch_init(&batch, 1);
         while (pmti != PMT_INVALID) {
             pciehw_spmt_t *spmt = pciesvc_spmt_get(pmti);
 
-            pmt_unload(pmti, spmt);
+            pmt_unload(pmti, spmt, &batch);
 
             pmti = spmt->next;
             pciesvc_spmt_put(spmt, DIRTY); /* loaded */
         }
+        pmt_batch_commit(&batch);
     }
 }
 
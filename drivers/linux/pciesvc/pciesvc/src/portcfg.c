@@ -18,11 +18,46 @@ portcfg_base(const int port)
     return PXC_(DHS_C_MAC_APB_ENTRY, port);
 }
 
+/*
+ * The port config header changes only on rare host writes, but values
+ * there (secbus, command) get consulted on emulation paths.  Shadow
+ * the header dws in the port shmem:  reads fill the shadow, our writes
+ * go through it, and portcfg_shadow_inval() drops it when the header
+ * can change behind our back (service start, host bus assignment).
+ */
+#define PORTCFG_SHADOW_NDW      16      /* shadow covers config header */
+
+void
+portcfg_shadow_inval(const int port)
+{
+    pciehw_port_t *p = pciesvc_port_get(port);
+
+    p->portcfgvalid = 0;
+    pciesvc_port_put(p, DIRTY);
+}
+
 u_int32_t
 portcfg_readdw(const int port, const u_int16_t addr)
 {
     u_int32_t v;
     pciesvc_assert(addr < 4096);
+
+    if (addr < PORTCFG_SHADOW_NDW * 4) {
+        const int dw = addr >> 2;
+        pciehw_port_t *p = pciesvc_port_get(port);
+
+        if (p->portcfgvalid & (1 << dw)) {
+            v = p->portcfghdr[dw];
+            pciesvc_port_put(p, CLEAN);
+            return v;
+        }
+        pciesvc_pciepreg_rd32(portcfg_base(port) + addr, &v);
+        p->portcfghdr[dw] = v;
+        p->portcfgvalid |= (1 << dw);
+        pciesvc_port_put(p, DIRTY);
+        return v;
+    }
+
     pciesvc_pciepreg_rd32(portcfg_base(port) + addr, &v);
     return v;
 }
@@ -32,6 +67,15 @@ portcfg_writedw(const int port, const u_int16_t addr, u_int32_t val)
 {
     pciesvc_assert(addr < 4096);
     pciesvc_pciepreg_wr32(portcfg_base(port) + addr, val);
+
+    if (addr < PORTCFG_SHADOW_NDW * 4) {
+        const int dw = addr >> 2;
+        pciehw_port_t *p = pciesvc_port_get(port);
+
+        p->portcfghdr[dw] = val;
+        p->portcfgvalid |= (1 << dw);
+        pciesvc_port_put(p, DIRTY);
+    }
 }
 
 u_int8_t
@@ -25,9 +25,11 @@ extern "C" {
 #define portcfg_writew          _pciesvc_portcfg_writew
 #define portcfg_writed          _pciesvc_portcfg_writed
 #define portcfg_read_bus        _pciesvc_portcfg_read_bus
+#define portcfg_shadow_inval    _pciesvc_portcfg_shadow_inval
 
 void portcfg_read_bus(const int port,
                       u_int8_t *pribus, u_int8_t *secbus, u_int8_t *subbus);
+void portcfg_shadow_inval(const int port);
 
 u_int8_t  portcfg_readb(const int port, const u_int16_t addr);
 u_int16_t portcfg_readw(const int port, const u_int16_t addr);
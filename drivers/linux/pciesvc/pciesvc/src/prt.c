@@ -33,21 +33,222 @@ assert_prts_in_range(const int prtb, const int prtc)
     }
 }
 
-int
-prt_alloc(const int n)
+/******************************************************************
+ * buddy free lists
+ *
+ * Freed prts go on per-size free lists rather than the old
+ * single-size slab free list, so multi-prt resources (large bars
+ * with many pages) can be satisfied from freed space and don't
+ * fragment the table over device add/remove cycles.  Free blocks
+ * are power-of-2 sized and aligned to their size, and a freed
+ * block merges with its free "buddy" to rebuild larger blocks.
+ */
+
+static void prt_buddy_free(int prti, int order);
+static void prt_buddy_free_range(int prtb, int prtc);
+
+/* ceil(log2(n)) */
+static int
+prt_order(const int n)
+{
+    return pciesvc_ffs((int)roundup_power2(n)) - 1;
+}
+
+static u_int32_t *
+prt_buddy_head(const int order)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    pciesvc_assert(order >= 0 && order < PRT_NORDERS);
+    return &pshmem->freeprt_order[order];
+}
+
+/*
+ * Lazy init of the buddy free lists, on first use after hwinit
+ * or after a live upgrade from fw with the slab free list.
+ * Entries on the old slab free list migrate to the buddy lists
+ * (and coalesce if adjacent).
+ */
+static void
+prt_buddy_init(void)
 {
     pciehw_shmem_t *pshmem = pciesvc_shmem_get();
     pciehw_sprt_t *sprt;
-    int prti = -1;
+    int o, prti;
+
+    if (pshmem->prtbuddy) return;
 
-    if (n == PRT_SLAB_SIZE && pshmem->freeprt_slab != PRT_INVALID) {
-        /* alloc slab entry from slab list */
+    for (o = 0; o < PRT_NORDERS; o++) {
+        pshmem->freeprt_order[o] = PRT_INVALID;
+    }
+    pshmem->reserveprt = prt_count();
+    pshmem->prtbuddy = 1;
+
+    if (!pshmem->pmtpri) return;
+
+    while (pshmem->freeprt_slab != PRT_INVALID) {
         prti = pshmem->freeprt_slab;
         sprt = pciesvc_sprt_get(prti);
         pshmem->freeprt_slab = sprt->next;
         sprt->next = PRT_INVALID;
-        pciesvc_sprt_put(sprt, DIRTY);
-    } else if (pshmem->allocprt + n < prt_count()) {
+        pciesvc_sprt_put(sprt, DIRTY); /* next */
+        prt_buddy_free_range(prti, PRT_SLAB_SIZE);
+    }
+}
+
+static void
+prt_buddy_push(const int prti, const int order)
+{
+    u_int32_t *head = prt_buddy_head(order);
+    pciehw_sprt_t *sprt = pciesvc_sprt_get(prti);
+
+    sprt->next = *head;
+    sprt->isfree = 1;
+    sprt->freeorder = order;
+    pciesvc_sprt_put(sprt, DIRTY); /* next, isfree, freeorder */
+    *head = prti;
+}
+
+static int
+prt_buddy_pop(const int order)
+{
+    u_int32_t *head = prt_buddy_head(order);
+    pciehw_sprt_t *sprt;
+    int prti;
+
+    if (*head == PRT_INVALID) return -1;
+
+    prti = *head;
+    sprt = pciesvc_sprt_get(prti);
+    *head = sprt->next;
+    sprt->next = PRT_INVALID;
+    sprt->isfree = 0;
+    sprt->freeorder = 0;
+    pciesvc_sprt_put(sprt, DIRTY); /* next, isfree, freeorder */
+    return prti;
+}
+
+static void
+prt_buddy_unlink(const int prti, const int order)
+{
+    u_int32_t *head = prt_buddy_head(order);
+    pciehw_sprt_t *sprt = pciesvc_sprt_get(prti);
+    int i;
+
+    if (*head == prti) {
+        *head = sprt->next;
+    } else {
+        /* singly-linked list, walk for the link to unlink.
+         * lists are short and this runs only on free/coalesce. */
+        i = *head;
+        while (i != PRT_INVALID) {
+            pciehw_sprt_t *psprt = pciesvc_sprt_get(i);
+
+            if (psprt->next == prti) {
+                psprt->next = sprt->next;
+                pciesvc_sprt_put(psprt, DIRTY); /* next */
+                break;
+            }
+            i = psprt->next;
+            pciesvc_sprt_put(psprt, CLEAN);
+        }
+        pciesvc_assert(i != PRT_INVALID);
+    }
+    sprt->next = PRT_INVALID;
+    sprt->isfree = 0;
+    sprt->freeorder = 0;
+    pciesvc_sprt_put(sprt, DIRTY); /* next, isfree, freeorder */
+}
+
+/* block [prti, prti + 2^order) lies entirely inside the alloc region */
+static int
+prt_buddy_in_region(const int prti, const int order)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    if (prti < 0) return 0;
+    return prti + (1 << order) <= pshmem->allocprt;
+}
+
+/*
+ * Free an aligned block, merging with its free buddy
+ * to rebuild larger blocks where possible.
+ */
+static void
+prt_buddy_free(int prti, int order)
+{
+    while (order + 1 < PRT_NORDERS) {
+        const int buddy = prti ^ (1 << order);
+        pciehw_sprt_t *bsprt;
+        int merge;
+
+        if (!prt_buddy_in_region(buddy, order)) break;
+        bsprt = pciesvc_sprt_get(buddy);
+        merge = bsprt->isfree && bsprt->freeorder == order;
+        pciesvc_sprt_put(bsprt, CLEAN);
+        if (!merge) break;
+
+        prt_buddy_unlink(buddy, order);
+        if (buddy < prti) prti = buddy;
+        order++;
+    }
+    prt_buddy_push(prti, order);
+}
+
+/* free an arbitrary range as aligned power-of-2 blocks */
+static void
+prt_buddy_free_range(int prtb, int prtc)
+{
+    while (prtc > 0) {
+        const int aorder = prtb ? pciesvc_ffs(prtb) - 1 : PRT_NORDERS - 1;
+        const int sorder = pciesvc_ffs((int)rounddn_power2(prtc)) - 1;
+        const int order = aorder < sorder ? aorder : sorder;
+
+        prt_buddy_free(prtb, order);
+        prtb += 1 << order;
+        prtc -= 1 << order;
+    }
+}
+
+static int
+prt_buddy_alloc(const int n)
+{
+    const int order = prt_order(n);
+    int o, prti;
+
+    prti = -1;
+    for (o = order; o < PRT_NORDERS; o++) {
+        prti = prt_buddy_pop(o);
+        if (prti >= 0) break;
+    }
+    if (prti < 0) return -1;
+
+    /* split back the unused upper halves */
+    while (o > order) {
+        o--;
+        prt_buddy_push(prti + (1 << o), o);
+    }
+    /* return the tail if n is not a power of 2 */
+    if (n < (1 << order)) {
+        prt_buddy_free_range(prti + n, (1 << order) - n);
+    }
+    return prti;
+}
+
+int
+prt_alloc(const int n)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+    int prti;
+
+    pciesvc_assert(n > 0);
+    pciesvc_assert(n <= prt_count());
+
+    prt_buddy_init();
+
+    prti = prt_buddy_alloc(n);
+    if (prti < 0 && pshmem->allocprt + n <= pshmem->reserveprt) {
+        /* alloc entries from sequential block */
         prti = pshmem->allocprt;
         pshmem->allocprt += n;
     }
@@ -59,17 +260,31 @@ prt_free(const int prtb, const int prtc)
 {
     assert_prts_in_range(prtb, prtc);
 
-    if (prtc == PRT_SLAB_SIZE) {
-        pciehw_shmem_t *pshmem = pciesvc_shmem_get();
-        pciehw_sprt_t *sprt;
+    prt_buddy_init();
+    prt_buddy_free_range(prtb, prtc);
+}
 
-        sprt = pciesvc_sprt_get(prtb);
-        sprt->next = pshmem->freeprt_slab;
-        pciesvc_sprt_put(sprt, DIRTY);
-        pshmem->freeprt_slab = prtb;
-    } else {
-        /* XXX */
+/*
+ * Reserve a contiguous block for predictable consumers
+ * (e.g. the per-lif doorbell ranges).  Reservations carve down
+ * from the top of the table, are never freed, and bound the
+ * sequential allocator above, so they stay contiguous without
+ * fragmenting the general pool.
+ */
+int
+prt_reserve(const int n)
+{
+    pciehw_shmem_t *pshmem = pciesvc_shmem_get();
+
+    pciesvc_assert(n > 0);
+
+    prt_buddy_init();
+
+    if (pshmem->reserveprt < pshmem->allocprt + n) {
+        return -1;
     }
+    pshmem->reserveprt -= n;
+    return pshmem->reserveprt;
 }
 
 static u_int64_t
@@ -91,6 +306,13 @@ prt_set(const int prti, const prt_t *prt)
     pciesvc_reg_wr32w(prt_addr(prti), prt->w, PRT_NWORDS);
 }
 
+/* queue an entry in a register write buffer, caller flushes */
+static void
+prt_set_wb(pciesvc_regwb_t *wb, const int prti, const prt_t *prt)
+{
+    pciesvc_regwb_wr32w(wb, prt_addr(prti), prt->w, PRT_NWORDS);
+}
+
 /******************************************************************
  * apis
  */
@@ -100,15 +322,18 @@ pciehw_prt_load(const int prtbase, const int prtcount)
 {
     const int prtend = prtbase + prtcount;
     pciehw_sprt_t *sprt;
+    pciesvc_regwb_t wb;
     int prti;
 
     assert_prts_in_range(prtbase, prtcount);
 
+    pciesvc_regwb_init(&wb);
     for (prti = prtbase; prti < prtend; prti++) {
         sprt = pciesvc_sprt_get(prti);
-        prt_set(prti, &sprt->prt);
+        prt_set_wb(&wb, prti, &sprt->prt);
         pciesvc_sprt_put(sprt, CLEAN);
     }
+    pciesvc_regwb_flush(&wb);
     return 0;
 }
 
@@ -117,11 +342,14 @@ pciehw_prt_unload(const int prtbase, const int prtcount)
 {
     const int prtend = prtbase + prtcount;
     const prt_t prt0 = {{ 0 }};
+    pciesvc_regwb_t wb;
     int prti;
 
     assert_prts_in_range(prtbase, prtcount);
 
+    pciesvc_regwb_init(&wb);
     for (prti = prtbase; prti < prtend; prti++) {
-        prt_set(prti, &prt0);
+        prt_set_wb(&wb, prti, &prt0);
     }
+    pciesvc_regwb_flush(&wb);
 }
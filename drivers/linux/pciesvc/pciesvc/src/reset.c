@@ -5,9 +5,14 @@
 
 #include "pciesvc_impl.h"
 #include "intrutils.h"
+#include "indirect.h"
+#include "notify.h"
 #include "serial.h"
 #include "reset.h"
 
+/* vfs reset per batch before servicing live transactions */
+#define VFRESET_BATCH   8
+
 static void
 pciehw_reset_lifs_event(pciehwdev_t *phwdev,
                         const int lifb, const int lifc,
@@ -52,6 +57,9 @@ pciehw_reset_device_intrs(pciehwdev_t *phwdev, const pciesvc_rsttype_t rsttype)
     } else {
         intr_reset_pci(phwdev->intrb, phwdev->intrc, dmask);
     }
+
+    /* fwcfg mode was reprogrammed behind the intr mode shadow */
+    phwdev->intrmodevalid = 0;
 }
 
 static void
@@ -152,6 +160,20 @@ pciehw_reset_vfs(pciehwdev_t *phwdev, const int vfb, const int vfc)
         }
         pciehw_reset_device(vfhwdev, PCIESVC_RSTTYPE_NONE);
         pciehwdev_vfdev_put(vfhwdev, DIRTY);
+
+        /*
+         * Resetting hundreds of vfs back-to-back takes long enough
+         * that live transactions would see completion timeouts.
+         * Service pending transactions between batches; the
+         * indirect/notify handlers guard against reentry so this is
+         * safe whether we got here from interrupt or poll context,
+         * and sriov ctrl writes arriving here are deferred by
+         * pciehw_sriov_ctrl until this reset pass completes.
+         */
+        if (((vfidx - vfb) % VFRESET_BATCH) == (VFRESET_BATCH - 1)) {
+            pciehw_indirect_poll(phwdev->port);
+            pciehw_notify_poll(phwdev->port);
+        }
     }
     pciehw_reset_lifs_event(phwdev, vflifb, vflifc * vfc, PCIESVC_RSTTYPE_VF);
 }
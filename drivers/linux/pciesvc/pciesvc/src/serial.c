@@ -15,6 +15,11 @@ typedef struct serial {
     uart_state_t *uart;         /* uart state */
     memq_t *txq;                /* txq transfer from device to memq */
     memq_t *rxq;                /* rxq transfer from memq to device */
+    int intrlevel;              /* last intr level written, -1 unknown */
+    u_int32_t txdrop;           /* thr chars dropped on full txq */
+    volatile u_int32_t *bulkpi; /* bulk console ring producer index */
+    volatile u_int32_t *bulkci; /* bulk console ring consumer index */
+    volatile u_int8_t *bulkbuf; /* bulk console ring data */
 } serial_t;
 
 static void serial_update_msl(serial_t *s);
@@ -70,7 +75,14 @@ static int
 serial_wr_thr(serial_t *s, const u_int8_t c)
 {
     if (!memq_putc(s->txq, c)) {
-        pciesvc_logerror("wr_thr: memq_putc failed\n");
+        /*
+         * seriald stopped consuming.  A console flood would drop
+         * (and log) every char here, so rate-limit the log.
+         */
+        if ((s->txdrop++ & 0xfff) == 0) {
+            pciesvc_logerror("wr_thr: memq_putc failed (%u dropped)\n",
+                             s->txdrop);
+        }
         return 0;
     }
     return 1;
@@ -217,6 +229,7 @@ uart_update_irq(serial_t *s)
     uart_state_t *uart = s->uart;
     volatile serial_state_t *st = s->state;
     uint8_t tmp_iir = UART_IIR_NO_INT;
+    int level;
 
     if ((uart->ier & UART_IER_RLSI) && (uart->lsr & UART_LSR_INT_ANY)) {
         tmp_iir = UART_IIR_RLSI;
@@ -231,10 +244,19 @@ uart_update_irq(serial_t *s)
 
     uart->iir = tmp_iir | (uart->iir & 0xf0);
 
-    if (tmp_iir != UART_IIR_NO_INT) {
-        intr_assert(st->intrb);                 /* raise interrupt */
-    } else {
-        intr_deassert(st->intrb);               /* lower interrupt */
+    /*
+     * A console flood comes through here several times per char.
+     * The interrupt is level-triggered so only touch the interrupt
+     * hw when the level actually changes.
+     */
+    level = (tmp_iir != UART_IIR_NO_INT);
+    if (level != s->intrlevel) {
+        if (level) {
+            intr_assert(st->intrb);             /* raise interrupt */
+        } else {
+            intr_deassert(st->intrb);           /* lower interrupt */
+        }
+        s->intrlevel = level;
     }
 }
 
@@ -379,6 +401,44 @@ static inline uint32_t deposit32(uint32_t value, int start, int length,
     return (value & ~mask) | ((fieldval << start) & mask);
 }
 
+/*
+ * Bulk console mode.  The 16550 path below moves console data a
+ * byte at a time and each byte costs a trapped LSR poll plus a
+ * trapped RBR read, so pulling a crash log off the console takes
+ * minutes.  An aware host discovers the bulk registers above the
+ * 16550 window by reading SERIAL_BULK_CAPS_REG, enables streams
+ * with SERIAL_BULK_EN_REG, then after one SERIAL_BULK_AVAIL_REG
+ * read per batch drains SERIAL_BULK_DATA_REG eight bytes per
+ * transaction.  The producer (seriald) watches bulk_en, appends
+ * console data at serialbulkpi, and raises the console interrupt
+ * once per batch instead of once per char.  Unaware hosts (and
+ * unaware seriald builds) never see any of this and keep the
+ * 16550 emulation unchanged.
+ */
+static u_int32_t
+serial_bulk_avail(serial_t *s)
+{
+    return *s->bulkpi - *s->bulkci;
+}
+
+static uint64_t
+serial_bulk_rd_data(serial_t *s)
+{
+    const u_int32_t ci = *s->bulkci;
+    u_int32_t n = *s->bulkpi - ci;
+    uint64_t r = 0;
+    u_int32_t i;
+
+    if (n > sizeof(r)) n = sizeof(r);
+    for (i = 0; i < n; i++) {
+        r |= (uint64_t)s->bulkbuf[(ci + i) % PCIEHW_SERIALBULKSZ] << (8 * i);
+    }
+    /* free the ring space only after the data is read out */
+    pciesvc_mem_barrier();
+    *s->bulkci = ci + n;
+    return r;
+}
+
 static serial_t *
 serial_get(pciehwdev_t *phwdev)
 {
@@ -393,6 +453,19 @@ serial_get(pciehwdev_t *phwdev)
         serial.uart = &su->uart_state;
         serial.txq = &st->txq;
         serial.rxq = &st->rxq;
+        serial.intrlevel = -1;  /* force first intr_{de,}assert */
+
+        serial.bulkpi = &pshmem->serialbulkpi;
+        serial.bulkci = &pshmem->serialbulkci;
+        serial.bulkbuf = pshmem->serialbulkbuf;
+        if (!pshmem->serialbulk) {
+            /* first use, reset the ring; producers wait for valid */
+            pshmem->serialbulkpi = 0;
+            pshmem->serialbulkci = 0;
+            pciesvc_mem_barrier();
+            pshmem->serialbulk = 1;
+        }
+        st->bulk_caps = SERIAL_BULK_RX;
 
         if (st->gen == 0) {
             st->intrb = phwdev->intrb;
@@ -415,9 +488,35 @@ serial_barrd(pciehwdev_t *phwdev,
     uart_state_t *uart = s->uart;
     uint32_t r;
 
+    /* bulk console registers, above the 16550 window */
+    if (baroff >= SERIAL_BULK_CAPS_REG) {
+        volatile serial_state_t *st = s->state;
+
+        switch (baroff) {
+        case SERIAL_BULK_CAPS_REG:
+            if (size == 4) return SERIAL_BULK_MAGIC | st->bulk_caps;
+            break;
+        case SERIAL_BULK_EN_REG:
+            if (size == 4) return st->bulk_en;
+            break;
+        case SERIAL_BULK_AVAIL_REG:
+            if (size == 4 && (st->bulk_en & SERIAL_BULK_RX)) {
+                return serial_bulk_avail(s);
+            }
+            break;
+        case SERIAL_BULK_DATA_REG:
+            if (size == 8 && (st->bulk_en & SERIAL_BULK_RX)) {
+                return serial_bulk_rd_data(s);
+            }
+            break;
+        default:
+            break;
+        }
+        return 0;
+    }
+
     /* only byte access */
     if (size != 1) return 0;
-    if (baroff >= 8) return 0;
 
     switch (baroff) {
     case UART_RX_BUF:
@@ -531,9 +630,17 @@ serial_barwr(pciehwdev_t *phwdev,
     uint8_t changed;
     uint8_t temp;
 
+    /* bulk console registers, above the 16550 window */
+    if (baroff >= SERIAL_BULK_CAPS_REG) {
+        if (baroff == SERIAL_BULK_EN_REG && size == 4) {
+            /* can only enable what the device offers */
+            st->bulk_en = (u_int32_t)val & st->bulk_caps;
+        }
+        return;
+    }
+
     /* only byte access */
     if (size != 1) return;
-    if (baroff >= 8) return;
 
     switch (baroff) {
     case UART_TX_BUF:
@@ -676,5 +783,8 @@ serial_reset(pciehwdev_t *phwdev, const pciesvc_rsttype_t rsttype)
      */
     rx_fifo_reset(s);
     tx_fifo_reset(s);
+    /* host driver is gone; next host renegotiates bulk mode */
+    s->state->bulk_en = SERIAL_BULK_NONE;
+    *s->bulkci = *s->bulkpi;
     s->state->breakreq++;
 }
@@ -132,27 +132,25 @@ virtio_barrd(pciehwdev_t *phwdev, u_int64_t addr,
         return val;
     }
 
-    switch (baroff) {
-    VIRTIO_DEV_REG_RD(cmn_cfg.device_feature_select);
-
-    VIRTIO_DEV_REG_RD_ARR(cmn_cfg.device_feature,
-                          cmn_cfg.device_feature_cfg[idx],
-                          cmn_cfg.device_feature_select,
-                          VIRTIO_PCI_FEATURE_SELECT_COUNT);
-
-    VIRTIO_DEV_REG_RD(cmn_cfg.driver_feature_select);
-
-    VIRTIO_DEV_REG_RD_ARR(cmn_cfg.driver_feature,
-                          cmn_cfg.driver_feature_cfg[idx],
-                          cmn_cfg.driver_feature_select,
-                          VIRTIO_PCI_FEATURE_SELECT_COUNT);
-
-    VIRTIO_DEV_REG_RD(cmn_cfg.config_msix_vector);
-    VIRTIO_DEV_REG_RD(cmn_cfg.num_queues);
-    VIRTIO_DEV_REG_RD(cmn_cfg.device_status);
-    VIRTIO_DEV_REG_RD(cmn_cfg.config_generation);
-    VIRTIO_DEV_REG_RD(cmn_cfg.queue_select);
+    /*
+     * Common-config fields below the queue_cfg window hold their
+     * architectural values directly (the indirect feature windows are
+     * kept materialized by the select-write procs in virtio_barwr),
+     * so serve reads with a single copy instead of per-field
+     * emulation.  Guest drivers re-read these throughout feature
+     * negotiation and queue bring-up.  Reads of the queue_cfg window
+     * stay emulated below; its register-file backing is aliased by
+     * the hidden feature configs.
+     */
+    if (baroff + size <= VIRTIO_DEV_REG_OFF(cmn_cfg.queue_cfg)) {
+        pciesvc_mem_rd(addr, &val, size);
+        pciesvc_logdebug("%s: read part0 addr "FMT64X" "
+                         "off "FMT64U" size "FMT64S" val "FMT64X"",
+                         pciehwdev_get_name(phwdev), addr, baroff, size, val);
+        return val;
+    }
 
+    switch (baroff) {
     VIRTIO_DEV_REG_RD_ARR(cmn_cfg.queue_cfg.queue_size,
                           queue_cfg[idx].queue_size,
                           cmn_cfg.queue_select,
@@ -213,6 +211,76 @@ virtio_barrd(pciehwdev_t *phwdev, u_int64_t addr,
     return val;
 }
 
+/*
+ * Select-register writes for the indirect feature windows.  Keep the
+ * architectural (dummy) feature field holding the currently selected
+ * value so reads of it take the direct part0 path in virtio_barrd.
+ */
+static void
+virtio_barwr_device_feature_select(pciehwdev_t *phwdev, u_int64_t addr,
+                                   const u_int64_t baroff, const size_t size,
+                                   const u_int64_t val)
+{
+    u_int64_t base = addr - baroff;
+    u_int32_t feature = 0;
+
+    pciesvc_mem_wr(addr, &val,
+                   VIRTIO_DEV_REG_SZ(cmn_cfg.device_feature_select));
+    if (val < VIRTIO_PCI_FEATURE_SELECT_COUNT) {
+        pciesvc_mem_rd(VIRTIO_DEV_REG_ADDR(base,
+                           cmn_cfg.device_feature_cfg[val]),
+                       &feature, sizeof(feature));
+    }
+    pciesvc_mem_wr(VIRTIO_DEV_REG_ADDR(base, cmn_cfg.device_feature),
+                   &feature, sizeof(feature));
+}
+
+static void
+virtio_barwr_driver_feature_select(pciehwdev_t *phwdev, u_int64_t addr,
+                                   const u_int64_t baroff, const size_t size,
+                                   const u_int64_t val)
+{
+    u_int64_t base = addr - baroff;
+    u_int32_t feature = 0;
+
+    pciesvc_mem_wr(addr, &val,
+                   VIRTIO_DEV_REG_SZ(cmn_cfg.driver_feature_select));
+    if (val < VIRTIO_PCI_FEATURE_SELECT_COUNT) {
+        pciesvc_mem_rd(VIRTIO_DEV_REG_ADDR(base,
+                           cmn_cfg.driver_feature_cfg[val]),
+                       &feature, sizeof(feature));
+    }
+    pciesvc_mem_wr(VIRTIO_DEV_REG_ADDR(base, cmn_cfg.driver_feature),
+                   &feature, sizeof(feature));
+}
+
+/*
+ * Driver feature writes land in the hidden per-select backing and in
+ * the materialized architectural field the current select exposes.
+ */
+static void
+virtio_barwr_driver_feature(pciehwdev_t *phwdev, u_int64_t addr,
+                            const u_int64_t baroff, const size_t size,
+                            const u_int64_t val)
+{
+    u_int64_t base = addr - baroff;
+    u_int64_t idx = 0;
+
+    pciesvc_mem_rd(VIRTIO_DEV_REG_ADDR(base, cmn_cfg.driver_feature_select),
+                   &idx, VIRTIO_DEV_REG_SZ(cmn_cfg.driver_feature_select));
+    if (idx < VIRTIO_PCI_FEATURE_SELECT_COUNT) {
+        pciesvc_mem_wr(VIRTIO_DEV_REG_ADDR(base,
+                           cmn_cfg.driver_feature_cfg[idx]),
+                       &val,
+                       VIRTIO_DEV_REG_SZ(cmn_cfg.driver_feature_cfg[idx]));
+        pciesvc_mem_wr(VIRTIO_DEV_REG_ADDR(base, cmn_cfg.driver_feature),
+                       &val, VIRTIO_DEV_REG_SZ(cmn_cfg.driver_feature));
+    } else {
+        pciesvc_logerror("%s: write driver_feature["FMT64U"] val "FMT64X" (out of bounds)",
+                         pciehwdev_get_name(phwdev), idx, val);
+    }
+}
+
 static void
 virtio_barwr_device_status(pciehwdev_t *phwdev, u_int64_t addr,
                            const u_int64_t baroff, const size_t size,
@@ -308,6 +376,51 @@ virtio_barwr_device_status(pciehwdev_t *phwdev, u_int64_t addr,
     pciesvc_mem_wr(addr, &val, VIRTIO_DEV_REG_SZ(cmn_cfg.device_status));
 }
 
+/*
+ * Doorbell write to the notify region.  Guest virtio-net rings these
+ * at packet rate; posting a notify event per ring floods the notify
+ * ring, so coalesce: record the rung slot in a dirty bitmap the
+ * backend polls, and generate an event only on the first ring of a
+ * window (bit 0 -> 1).  The backend clears the bit before it scans
+ * the queue, opening the next window.
+ */
+static void
+virtio_barwr_notify_dbell(pciehwdev_t *phwdev, u_int64_t addr,
+                          const u_int64_t baroff, const size_t size,
+                          const u_int64_t val, u_int8_t *do_notify)
+{
+    u_int64_t base = addr - baroff;
+    /* inc_pi and set_pi doorbells for a queue share one slot */
+    const u_int64_t slot =
+        ((baroff - VIRTIO_DEV_REG_OFF(notify_reg)) %
+         VIRTIO_DEV_REG_SZ(notify_reg.inc_pi_dbell)) /
+        VIRTIO_NOTIFY_MULTIPLIER;
+    const u_int64_t dirty_addr =
+        VIRTIO_DEV_REG_ADDR(base, dbell_reg.dbell_dirty[slot >> 5]);
+    const u_int32_t dirty_bit = 1u << (slot & 0x1f);
+    u_int32_t dirty = 0;
+
+    /* latest doorbell value, last write wins for the backend */
+    pciesvc_mem_wr(addr, &val, size);
+
+    pciesvc_mem_rd(dirty_addr, &dirty, sizeof(dirty));
+    if (dirty & dirty_bit) {
+        /* backend hasn't opened a new window yet, coalesce */
+        pciesvc_logdebug("%s: write notify_dbell["FMT64U"] addr "FMT64X" val "FMT64X" coalesce",
+            pciehwdev_get_name(phwdev), slot, addr, val);
+        return;
+    }
+
+    dirty |= dirty_bit;
+    /* doorbell value lands before the mark that publishes it */
+    pciesvc_mem_barrier();
+    pciesvc_mem_wr(dirty_addr, &dirty, sizeof(dirty));
+    *do_notify = 1;
+
+    pciesvc_logdebug("%s: write notify_dbell["FMT64U"] addr "FMT64X" val "FMT64X" notify",
+        pciehwdev_get_name(phwdev), slot, addr, val);
+}
+
 void
 virtio_barwr(pciehwdev_t *phwdev, u_int64_t addr,
              const u_int64_t baroff, const size_t size, const u_int64_t val,
@@ -316,20 +429,25 @@ virtio_barwr(pciehwdev_t *phwdev, u_int64_t addr,
     u_int64_t base = addr - baroff;
     u_int64_t idx = 0;
 
+    if (VIRTIO_DEV_REG_INSIDE(notify_reg, baroff, size)) {
+        virtio_barwr_notify_dbell(phwdev, addr, baroff, size, val, do_notify);
+        return;
+    }
+
     switch (baroff) {
-    VIRTIO_DEV_REG_WR(cmn_cfg.device_feature_select);
+    VIRTIO_DEV_REG_WR_PROC(cmn_cfg.device_feature_select,
+                           virtio_barwr_device_feature_select);
 
     VIRTIO_DEV_REG_WR_ARR_IGN(cmn_cfg.device_feature,
                               cmn_cfg.device_feature_cfg[idx],
                               cmn_cfg.device_feature_select,
                               VIRTIO_PCI_FEATURE_SELECT_COUNT);
 
-    VIRTIO_DEV_REG_WR(cmn_cfg.driver_feature_select);
+    VIRTIO_DEV_REG_WR_PROC(cmn_cfg.driver_feature_select,
+                           virtio_barwr_driver_feature_select);
 
-    VIRTIO_DEV_REG_WR_ARR(cmn_cfg.driver_feature,
-                          cmn_cfg.driver_feature_cfg[idx],
-                          cmn_cfg.driver_feature_select,
-                          VIRTIO_PCI_FEATURE_SELECT_COUNT);
+    VIRTIO_DEV_REG_WR_PROC(cmn_cfg.driver_feature,
+                           virtio_barwr_driver_feature);
 
     VIRTIO_DEV_REG_WR(cmn_cfg.config_msix_vector);
     VIRTIO_DEV_REG_WR_IGN(cmn_cfg.num_queues);
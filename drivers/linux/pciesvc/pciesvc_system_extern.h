@@ -58,6 +58,9 @@
 #define pciesvc_htole32(x) __cpu_to_le32(x)
 #define pciesvc_le32toh(x) __le32_to_cpu(x)
 
+#define pciesvc_htole16(x) __cpu_to_le16(x)
+#define pciesvc_le16toh(x) __le16_to_cpu(x)
+
 #define pciesvc_htobe16(x) __cpu_to_be16(x)
 #define pciesvc_be16toh(x) __be16_to_cpu(x)
 
@@ -115,6 +118,8 @@ long read_el(void);
 void kpcimgr_init_poll(kstate_t *ks);
 void pciesvc_debug_cmd(uint32_t *val);
 void kpcimgr_poll(kstate_t *ks, int index, int phase);
+unsigned int kpcimgr_code_csum(kstate_t *ks);
+int kpcimgr_code_csum_check(kstate_t *ks);
 
 /* functions in kpci_test.c */
 void kp_udelay(unsigned long us);
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2022, Pensando Systems Inc.
+ *
+ * Decode binary log records (PCIESVC_EV_LOGBIN) captured from the
+ * pciesvc event queue.  Reads raw pciesvc_eventdata_t records on
+ * stdin, writes the formatted messages to stdout.
+ *
+ * Build: cc -I../pciesvc/include -o logbin_decode logbin_decode.c
+ */
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "pciesvc_event.h"
+
+static const char *fmttab[PCIESVC_LOGFMT_COUNT] = {
+#define PCIESVC_LOGFMT_DEF(id, fmt) [id] = fmt,
+#include "pciesvc_logfmt_defs.h"
+};
+
+static const char *pritab[] = {
+    "DEBUG", "INFO", "WARN", "ERROR"
+};
+
+static const char *
+priname(const unsigned int pri)
+{
+    if (pri >= sizeof(pritab) / sizeof(pritab[0])) {
+        return "?????";
+    }
+    return pritab[pri];
+}
+
+int
+main(int argc, char *argv[])
+{
+    pciesvc_eventdata_t evd;
+
+    while (fread(&evd, sizeof(evd), 1, stdin) == 1) {
+        const pciesvc_logbin_t *lb = &evd.logbin;
+
+        if (evd.evtype != PCIESVC_EV_LOGBIN) {
+            continue;
+        }
+        if (lb->fmtid >= PCIESVC_LOGFMT_COUNT) {
+            fprintf(stderr, "unknown fmtid %u\n", lb->fmtid);
+            continue;
+        }
+        printf("[%s] ", priname(lb->pri));
+        printf(fmttab[lb->fmtid],
+               lb->args[0], lb->args[1], lb->args[2],
+               lb->args[3], lb->args[4]);
+    }
+    return 0;
+}